@@ -24,8 +24,12 @@
 #include "itkLimiterFunctionBase.h"
 #include "itkFixedArray.h"
 #include "itkAdvancedTransform.h"
+#include "itkTransformedSampleCache.h"
+#include "itkMultiThreader.h"
 #include "vnl/vnl_sparse_matrix.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -54,6 +58,12 @@ namespace itk
  *   unless you have a good reason for it...
  * \li Some convenience functions are provided, such as the IsInsideMovingMask
  *   and CheckNumberOfSamples.
+ * \li Multi-threaded evaluation of the sample loop: the sample container is
+ *   split in contiguous chunks, one per thread. Each thread accumulates into
+ *   its own value/derivative buffers, which are summed afterwards in thread
+ *   order, so that the result is deterministic for a given number of threads.
+ *   Inheriting metrics opt in by implementing ThreadedGetValueAndDerivative()
+ *   and AfterThreadedGetValueAndDerivative().
  *
  * The parameters used in this class are:
  * \parameter MovingImageDerivativeScales: scale the moving image derivatives. Use\n
@@ -86,6 +96,11 @@ public:
   itkStaticConstMacro( FixedImageDimension, unsigned int,
     TFixedImage::ImageDimension );
 
+  /** The number of samples that the sample loops pass at once
+   * to the batch functions of the transform.
+   */
+  itkStaticConstMacro( SampleBatchSize, unsigned int, 64 );
+
   /** Typedefs from the superclass. */
   typedef typename Superclass::CoordinateRepresentationType CoordinateRepresentationType;
   typedef typename Superclass::MovingImageType            MovingImageType;
@@ -148,6 +163,10 @@ public:
     FixedImageDimension,
     MovingImageDimension >                                AdvancedTransformType;
 
+  /** Typedefs for the cache of transformed samples. */
+  typedef TransformedSampleCache< AdvancedTransformType > TransformedSampleCacheType;
+  typedef typename TransformedSampleCacheType::Pointer    TransformedSampleCachePointer;
+
   /** Hessian type; for SelfHessian (experimental feature) */
   typedef typename DerivativeType::ValueType              HessianValueType;
   //typedef Array2D<HessianValueType>                       HessianType;
@@ -234,6 +253,53 @@ public:
    * This base class just returns an identity matrix of the right size. */
   virtual void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const;
 
+  /** Set/Get whether the sample loop of GetValueAndDerivative() is distributed
+   * over multiple threads; default false. Only has effect for metrics that
+   * implement ThreadedGetValueAndDerivative(), and when more than one thread
+   * is available. The threads share the moving image interpolator and the
+   * moving image mask: the ITK spatial object IsInside() and the B-spline
+   * interpolators are not thread-safe, so it is off unless requested.
+   */
+  itkSetMacro( UseMultiThread, bool );
+  itkGetConstReferenceMacro( UseMultiThread, bool );
+  itkBooleanMacro( UseMultiThread );
+
+  /** Set/Get the number of threads used to evaluate the metric.
+   * The default is the global default number of threads of the
+   * itk::MultiThreader, which is bounded by the global maximum, as set
+   * by the -threads command line argument of elastix.
+   */
+  virtual void SetNumberOfThreads( unsigned int numberOfThreads );
+  itkGetConstMacro( NumberOfThreads, unsigned int );
+
+  /** Set/Get whether the transform parameters are already set by the
+   * caller; default false. If true, SetTransformParameters() does not
+   * modify the transform. The CombinationImageToImageMetric uses this when
+   * it evaluates its sub metrics concurrently, so that they do not write to
+   * the transform while others are reading it.
+   */
+  itkSetMacro( TransformParametersAreSet, bool );
+  itkGetConstMacro( TransformParametersAreSet, bool );
+
+  /** Get the CPU time in seconds used so far by the threads that this
+   * metric started besides the calling thread, which does the work of
+   * thread 0 itself. The CombinationImageToImageMetric uses this to measure
+   * the CPU time per sub metric when it evaluates them concurrently.
+   */
+  itkGetConstMacro( ThreadsCPUTime, double );
+
+  /** Set the parameters of the transform, unless TransformParametersAreSet. */
+  void SetTransformParameters( const TransformParametersType & parameters ) const;
+
+  /** Set/Get a cache of mapped points and transform Jacobians, that can be
+   * shared with other metrics using the same image sampler; default 0.
+   * The cache is only used when its SampleSource is the image sampler of
+   * this metric, and only by the metrics that call the TransformSample*()
+   * functions. Metrics sharing a cache may not be evaluated concurrently.
+   */
+  itkSetObjectMacro( TransformedSampleCache, TransformedSampleCacheType );
+  itkGetObjectMacro( TransformedSampleCache, TransformedSampleCacheType );
+
 protected:
 
   /** Constructor. */
@@ -301,6 +367,25 @@ protected:
   MovingImageLimiterOutputType                       m_MovingImageMinLimit;
   MovingImageLimiterOutputType                       m_MovingImageMaxLimit;
 
+  /** Typedefs and variables for multi-threading. */
+  typedef MultiThreader                                   ThreaderType;
+  typedef ThreaderType::ThreadInfoStruct                  ThreadInfoType;
+
+  /** Accumulators of a single thread. Inheriting metrics that need more
+   * than a value and a derivative may define their own per-thread struct.
+   */
+  struct GetValueAndDerivativePerThreadStruct
+  {
+    unsigned long   st_NumberOfPixelsCounted;
+    MeasureType     st_Value;
+    DerivativeType  st_Derivative;
+  };
+  typedef std::vector<
+    GetValueAndDerivativePerThreadStruct >                GetValueAndDerivativePerThreadVariablesType;
+
+  ThreaderType::Pointer                                   m_Threader;
+  mutable GetValueAndDerivativePerThreadVariablesType     m_GetValueAndDerivativePerThreadVariables;
+
   /** Protected methods ************** */
 
   /** Methods for image sampler support **********/
@@ -359,6 +444,65 @@ protected:
     TransformJacobianType & jacobian,
     NonZeroJacobianIndicesType & nzji ) const;
 
+  /** Transform a batch of points from FixedImage domain to MovingImage domain,
+   * using the batch interface of the AdvancedTransform. The mapped points
+   * equal those of TransformPoint().
+   */
+  virtual void TransformPoints(
+    const FixedImagePointType * fixedImagePoints,
+    MovingImagePointType * mappedPoints,
+    const unsigned long numberOfPoints ) const;
+
+  /** Compute the sparse transform Jacobians of a batch of points,
+   * equal to those of EvaluateTransformJacobian().
+   */
+  virtual void EvaluateTransformJacobians(
+    const FixedImagePointType * fixedImagePoints,
+    TransformJacobianType * jacobians,
+    NonZeroJacobianIndicesType * nzjis,
+    const unsigned long numberOfPoints ) const;
+
+  /** Prepare the transformed sample cache for the current samples and
+   * transform parameters, if the cache is set and belongs to the image
+   * sampler of this metric. Call it after updating the image sampler,
+   * before the sample loop. Returns whether the cache is used.
+   */
+  virtual bool UpdateTransformedSampleCache( void ) const;
+
+  /** Versions of TransformPoint(), EvaluateTransformJacobian(),
+   * TransformPoints() and EvaluateTransformJacobians() for the samples of the
+   * image sampler, which take the sample indices. They read the results
+   * from the transformed sample cache, when UpdateTransformedSampleCache()
+   * enabled it, and otherwise compute them. The Jacobian versions do not
+   * copy the cached Jacobians: they compute into jacobian and nzji only when
+   * the cache is not used, and point jacobianPointer and nzjiPointer to
+   * either these buffers or the cache entries.
+   */
+  bool TransformSamplePoint(
+    const unsigned long sampleIndex,
+    const FixedImagePointType & fixedImagePoint,
+    MovingImagePointType & mappedPoint ) const;
+  bool EvaluateTransformSampleJacobian(
+    const unsigned long sampleIndex,
+    const FixedImagePointType & fixedImagePoint,
+    TransformJacobianType & jacobian,
+    NonZeroJacobianIndicesType & nzji,
+    const TransformJacobianType * & jacobianPointer,
+    const NonZeroJacobianIndicesType * & nzjiPointer ) const;
+  void TransformSamplePoints(
+    const unsigned long firstSampleIndex,
+    const FixedImagePointType * fixedImagePoints,
+    MovingImagePointType * mappedPoints,
+    const unsigned long numberOfPoints ) const;
+  void EvaluateTransformSampleJacobians(
+    const unsigned long * sampleIndices,
+    const FixedImagePointType * fixedImagePoints,
+    TransformJacobianType * jacobians,
+    NonZeroJacobianIndicesType * nzjis,
+    const TransformJacobianType ** jacobianPointers,
+    const NonZeroJacobianIndicesType ** nzjiPointers,
+    const unsigned long numberOfPoints ) const;
+
   /** Convenience method: check if point is inside the moving mask. *****************/
   virtual bool IsInsideMovingMask( const MovingImagePointType & point ) const;
 
@@ -387,6 +531,64 @@ protected:
   itkSetMacro( UseFixedImageLimiter, bool );
   itkSetMacro( UseMovingImageLimiter, bool );
 
+  /** Methods for multi-threading support **********/
+
+  /** Returns true if the threaded GetValueAndDerivative() should be used. */
+  virtual bool UseMultiThreadedGetValueAndDerivative( void ) const;
+
+  /** Resize and zero the per-thread values and sample counts. Called before
+   * the threads are launched; inheriting classes with their own per-thread
+   * struct should call the superclass' implementation.
+   */
+  virtual void InitializeThreadingParameters( void ) const;
+
+  /** Resize and zero the per-thread derivatives st_Derivative. Only called
+   * by the metrics that accumulate their derivative in them, after
+   * InitializeThreadingParameters(), so that metrics with their own
+   * per-thread derivatives do not allocate these as well.
+   */
+  void InitializePerThreadDerivatives( void ) const;
+
+  /** Compute the range [begin, end) of samples that is processed by a thread,
+   * when the samples are divided over m_NumberOfThreads threads, or over the
+   * given number of threads.
+   */
+  virtual void GetSampleRangeForThread( unsigned int threadID,
+    unsigned long numberOfSamples,
+    unsigned long & begin, unsigned long & end ) const;
+  void GetSampleRangeForThread( unsigned int threadID,
+    unsigned int numberOfThreads, unsigned long numberOfSamples,
+    unsigned long & begin, unsigned long & end ) const;
+
+  /** Run the given static callback on m_NumberOfThreads threads, with this
+   * metric as user data; blocks until all threads have finished.
+   */
+  virtual void LaunchThreaderCallback( ThreadFunctionType callback ) const;
+
+  /** The static callback function that LaunchThreaderCallback() passes to
+   * the threader. It calls the given callback and measures its CPU time.
+   */
+  static ITK_THREAD_RETURN_TYPE TimedThreaderCallback( void * arg );
+
+  /** Let each thread call ThreadedGetValueAndDerivative(); blocks until
+   * all threads have finished.
+   */
+  virtual void LaunchGetValueAndDerivativeThreaderCallback( void ) const;
+
+  /** The static callback function passed to the threader. */
+  static ITK_THREAD_RETURN_TYPE GetValueAndDerivativeThreaderCallback( void * arg );
+
+  /** Process the part of the sample container belonging to threadID.
+   * The default implementation throws an exception.
+   */
+  virtual void ThreadedGetValueAndDerivative( unsigned int threadID ) const;
+
+  /** Combine the results of all threads into a value and derivative.
+   * The default implementation throws an exception.
+   */
+  virtual void AfterThreadedGetValueAndDerivative(
+    MeasureType & value, DerivativeType & derivative ) const;
+
 private:
   AdvancedImageToImageMetric(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
@@ -400,6 +602,14 @@ private:
   double  m_RequiredRatioOfValidSamples;
   bool    m_UseMovingImageDerivativeScales;
   MovingImageDerivativeScalesType m_MovingImageDerivativeScales;
+  bool          m_UseMultiThread;
+  unsigned int  m_NumberOfThreads;
+  bool          m_TransformParametersAreSet;
+  mutable ThreadFunctionType    m_ThreaderCallback;
+  mutable std::vector< double > m_ThreaderCPUTimes;
+  mutable double                m_ThreadsCPUTime;
+  TransformedSampleCachePointer m_TransformedSampleCache;
+  mutable bool  m_UseTransformedSampleCache;
 
 }; // end class AdvancedImageToImageMetric
 
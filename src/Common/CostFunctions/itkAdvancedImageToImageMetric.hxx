@@ -18,6 +18,7 @@
 #include "itkAdvancedImageToImageMetric.h"
 #include "itkImageRegionConstIterator.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
+#include "elxTimer.h"
 
 namespace itk
 {
@@ -68,9 +69,61 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
   this->m_MovingImageMinLimit = NumericTraits< MovingImageLimiterOutputType >::Zero;
   this->m_MovingImageMaxLimit = NumericTraits< MovingImageLimiterOutputType >::One;
 
+  /** Threading related variables. The threader takes the global default
+   * number of threads, which respects the global maximum.
+   */
+  this->m_UseMultiThread = false;
+  this->m_Threader = ThreaderType::New();
+  this->m_NumberOfThreads = this->m_Threader->GetNumberOfThreads();
+  this->m_TransformParametersAreSet = false;
+  this->m_ThreaderCallback = 0;
+  this->m_ThreadsCPUTime = 0.0;
+
+  this->m_TransformedSampleCache = 0;
+  this->m_UseTransformedSampleCache = false;
+
 } // end Constructor
 
 
+/**
+ * ********************* SetNumberOfThreads ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::SetNumberOfThreads( unsigned int numberOfThreads )
+{
+  /** The threader clamps the number of threads to [1, global maximum]. */
+  this->m_Threader->SetNumberOfThreads( numberOfThreads );
+  const unsigned int clampedNumberOfThreads
+    = static_cast<unsigned int>( this->m_Threader->GetNumberOfThreads() );
+  if ( this->m_NumberOfThreads != clampedNumberOfThreads )
+  {
+    this->m_NumberOfThreads = clampedNumberOfThreads;
+    this->Modified();
+  }
+
+} // end SetNumberOfThreads()
+
+
+/**
+ * ********************* SetTransformParameters ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::SetTransformParameters( const TransformParametersType & parameters ) const
+{
+  if ( !this->m_TransformParametersAreSet )
+  {
+    this->Superclass::SetTransformParameters( parameters );
+  }
+
+} // end SetTransformParameters()
+
+
 /**
  * ********************* Initialize ****************************
  */
@@ -540,6 +593,193 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
 } // end EvaluateTransformJacobian()
 
 
+/**
+ * ********************** TransformPoints ************************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::TransformPoints(
+  const FixedImagePointType * fixedImagePoints,
+  MovingImagePointType * mappedPoints,
+  const unsigned long numberOfPoints ) const
+{
+  this->m_AdvancedTransform->TransformPoints(
+    fixedImagePoints, mappedPoints, numberOfPoints );
+
+} // end TransformPoints()
+
+
+/**
+ * *************** EvaluateTransformJacobians ****************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::EvaluateTransformJacobians(
+  const FixedImagePointType * fixedImagePoints,
+  TransformJacobianType * jacobians,
+  NonZeroJacobianIndicesType * nzjis,
+  const unsigned long numberOfPoints ) const
+{
+  this->m_AdvancedTransform->GetJacobians(
+    fixedImagePoints, jacobians, nzjis, numberOfPoints );
+
+} // end EvaluateTransformJacobians()
+
+
+/**
+ * *************** UpdateTransformedSampleCache ****************
+ */
+
+template < class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::UpdateTransformedSampleCache( void ) const
+{
+  /** The cache is only valid for the samples of the sampler it belongs to.
+   * A metric may temporarily get another sampler, e.g. to compute the
+   * exact metric value.
+   */
+  this->m_UseTransformedSampleCache = this->m_TransformedSampleCache.IsNotNull()
+    && this->m_UseImageSampler
+    && this->m_TransformIsAdvanced
+    && this->m_ImageSampler.IsNotNull()
+    && this->m_TransformedSampleCache->GetSampleSource()
+      == this->m_ImageSampler.GetPointer();
+
+  if ( this->m_UseTransformedSampleCache )
+  {
+    const ImageSampleContainerType * samples = this->m_ImageSampler->GetOutput();
+    this->m_TransformedSampleCache->Update(
+      this->m_AdvancedTransform.GetPointer(), samples, samples->Size() );
+  }
+
+  return this->m_UseTransformedSampleCache;
+
+} // end UpdateTransformedSampleCache()
+
+
+/**
+ * ********************** TransformSamplePoint ************************
+ */
+
+template < class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::TransformSamplePoint(
+  const unsigned long sampleIndex,
+  const FixedImagePointType & fixedImagePoint,
+  MovingImagePointType & mappedPoint ) const
+{
+  if ( !this->m_UseTransformedSampleCache )
+  {
+    return this->TransformPoint( fixedImagePoint, mappedPoint );
+  }
+
+  this->m_TransformedSampleCache->GetMappedPoint(
+    sampleIndex, fixedImagePoint, mappedPoint );
+  return true;
+
+} // end TransformSamplePoint()
+
+
+/**
+ * *************** EvaluateTransformSampleJacobian ****************
+ */
+
+template < class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::EvaluateTransformSampleJacobian(
+  const unsigned long sampleIndex,
+  const FixedImagePointType & fixedImagePoint,
+  TransformJacobianType & jacobian,
+  NonZeroJacobianIndicesType & nzji,
+  const TransformJacobianType * & jacobianPointer,
+  const NonZeroJacobianIndicesType * & nzjiPointer ) const
+{
+  if ( !this->m_UseTransformedSampleCache )
+  {
+    jacobianPointer = &jacobian;
+    nzjiPointer = &nzji;
+    return this->EvaluateTransformJacobian( fixedImagePoint, jacobian, nzji );
+  }
+
+  this->m_TransformedSampleCache->GetJacobian(
+    sampleIndex, fixedImagePoint, jacobianPointer, nzjiPointer );
+  return true;
+
+} // end EvaluateTransformSampleJacobian()
+
+
+/**
+ * ********************** TransformSamplePoints ************************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::TransformSamplePoints(
+  const unsigned long firstSampleIndex,
+  const FixedImagePointType * fixedImagePoints,
+  MovingImagePointType * mappedPoints,
+  const unsigned long numberOfPoints ) const
+{
+  if ( !this->m_UseTransformedSampleCache )
+  {
+    this->TransformPoints( fixedImagePoints, mappedPoints, numberOfPoints );
+    return;
+  }
+
+  for ( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    this->m_TransformedSampleCache->GetMappedPoint(
+      firstSampleIndex + i, fixedImagePoints[ i ], mappedPoints[ i ] );
+  }
+
+} // end TransformSamplePoints()
+
+
+/**
+ * *************** EvaluateTransformSampleJacobians ****************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::EvaluateTransformSampleJacobians(
+  const unsigned long * sampleIndices,
+  const FixedImagePointType * fixedImagePoints,
+  TransformJacobianType * jacobians,
+  NonZeroJacobianIndicesType * nzjis,
+  const TransformJacobianType ** jacobianPointers,
+  const NonZeroJacobianIndicesType ** nzjiPointers,
+  const unsigned long numberOfPoints ) const
+{
+  if ( !this->m_UseTransformedSampleCache )
+  {
+    this->EvaluateTransformJacobians(
+      fixedImagePoints, jacobians, nzjis, numberOfPoints );
+    for ( unsigned long i = 0; i < numberOfPoints; ++i )
+    {
+      jacobianPointers[ i ] = &jacobians[ i ];
+      nzjiPointers[ i ] = &nzjis[ i ];
+    }
+    return;
+  }
+
+  for ( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    this->m_TransformedSampleCache->GetJacobian( sampleIndices[ i ],
+      fixedImagePoints[ i ], jacobianPointers[ i ], nzjiPointers[ i ] );
+  }
+
+} // end EvaluateTransformSampleJacobians()
+
+
 /**
  * ************************** IsInsideMovingMask *************************
  * Check if point is inside moving mask
@@ -608,6 +848,225 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
 } // end CheckNumberOfSamples()
 
 
+/**
+ * ************** UseMultiThreadedGetValueAndDerivative *****************
+ */
+
+template < class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::UseMultiThreadedGetValueAndDerivative( void ) const
+{
+  return this->m_UseMultiThread && this->m_NumberOfThreads > 1;
+
+} // end UseMultiThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* InitializeThreadingParameters *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::InitializeThreadingParameters( void ) const
+{
+  this->m_GetValueAndDerivativePerThreadVariables.resize( this->m_NumberOfThreads );
+  for ( unsigned int i = 0; i < this->m_NumberOfThreads; ++i )
+  {
+    GetValueAndDerivativePerThreadStruct & perThread
+      = this->m_GetValueAndDerivativePerThreadVariables[ i ];
+    perThread.st_NumberOfPixelsCounted = 0;
+    perThread.st_Value = NumericTraits< MeasureType >::Zero;
+  }
+
+} // end InitializeThreadingParameters()
+
+
+/**
+ * ******************* InitializePerThreadDerivatives *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::InitializePerThreadDerivatives( void ) const
+{
+  /** Only resize the per-thread derivatives when the number of threads
+   * or the number of parameters changed, to avoid reallocating them
+   * in every iteration.
+   */
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  for ( unsigned int i = 0; i < this->m_NumberOfThreads; ++i )
+  {
+    GetValueAndDerivativePerThreadStruct & perThread
+      = this->m_GetValueAndDerivativePerThreadVariables[ i ];
+    if ( perThread.st_Derivative.GetSize() != numberOfParameters )
+    {
+      perThread.st_Derivative.SetSize( numberOfParameters );
+    }
+    perThread.st_Derivative.Fill( NumericTraits< DerivativeValueType >::Zero );
+  }
+
+} // end InitializePerThreadDerivatives()
+
+
+/**
+ * ******************* GetSampleRangeForThread *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::GetSampleRangeForThread( unsigned int threadID,
+  unsigned long numberOfSamples,
+  unsigned long & begin, unsigned long & end ) const
+{
+  this->GetSampleRangeForThread( threadID, this->m_NumberOfThreads,
+    numberOfSamples, begin, end );
+
+} // end GetSampleRangeForThread()
+
+
+/**
+ * ******************* GetSampleRangeForThread *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::GetSampleRangeForThread( unsigned int threadID,
+  unsigned int numberOfThreads, unsigned long numberOfSamples,
+  unsigned long & begin, unsigned long & end ) const
+{
+  /** Contiguous chunks of (almost) equal size; the first
+   * numberOfSamples % numberOfThreads threads get one sample extra.
+   */
+  const unsigned long chunk = numberOfSamples / numberOfThreads;
+  const unsigned long remainder = numberOfSamples % numberOfThreads;
+  const unsigned long id = threadID;
+
+  begin = id * chunk + vnl_math_min( id, remainder );
+  end = begin + chunk + ( id < remainder ? 1 : 0 );
+
+} // end GetSampleRangeForThread()
+
+
+/**
+ * *************** LaunchThreaderCallback ****************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::LaunchThreaderCallback( ThreadFunctionType callback ) const
+{
+  /** The threader needs a non-const pointer; the callbacks only
+   * call const member functions.
+   */
+  Self * thisNonConst = const_cast< Self * >( this );
+  this->m_ThreaderCallback = callback;
+  this->m_ThreaderCPUTimes.assign( this->m_NumberOfThreads, 0.0 );
+  this->m_Threader->SetNumberOfThreads( this->m_NumberOfThreads );
+  this->m_Threader->SetSingleMethod( Self::TimedThreaderCallback, thisNonConst );
+  this->m_Threader->SingleMethodExecute();
+
+  /** Thread 0 runs in the calling thread, which measures its own time. */
+  for ( unsigned int i = 1; i < this->m_ThreaderCPUTimes.size(); ++i )
+  {
+    this->m_ThreadsCPUTime += this->m_ThreaderCPUTimes[ i ];
+  }
+
+} // end LaunchThreaderCallback()
+
+
+/**
+ * *************** TimedThreaderCallback ****************
+ */
+
+template < class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::TimedThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  const unsigned int threadID = static_cast<unsigned int>( infoStruct->ThreadID );
+  const Self * metric = static_cast< const Self * >( infoStruct->UserData );
+
+  /** Every thread writes only its own element. */
+  const double start = tmr::Timer::GetThreadCPUTimeSec();
+  metric->m_ThreaderCallback( arg );
+  metric->m_ThreaderCPUTimes[ threadID ] = tmr::Timer::GetThreadCPUTimeSec() - start;
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end TimedThreaderCallback()
+
+
+/**
+ * *************** LaunchGetValueAndDerivativeThreaderCallback ****************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::LaunchGetValueAndDerivativeThreaderCallback( void ) const
+{
+  this->LaunchThreaderCallback( Self::GetValueAndDerivativeThreaderCallback );
+
+} // end LaunchGetValueAndDerivativeThreaderCallback()
+
+
+/**
+ * **************** GetValueAndDerivativeThreaderCallback *******
+ */
+
+template < class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::GetValueAndDerivativeThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  const unsigned int threadID = static_cast<unsigned int>( infoStruct->ThreadID );
+  const Self * metric = static_cast< const Self * >( infoStruct->UserData );
+
+  metric->ThreadedGetValueAndDerivative( threadID );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end GetValueAndDerivativeThreaderCallback()
+
+
+/**
+ * *************** ThreadedGetValueAndDerivative ****************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedGetValueAndDerivative( unsigned int itkNotUsed( threadID ) ) const
+{
+  itkExceptionMacro( << "ThreadedGetValueAndDerivative() is not implemented by this metric" );
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * *************** AfterThreadedGetValueAndDerivative ****************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::AfterThreadedGetValueAndDerivative(
+  MeasureType & itkNotUsed( value ),
+  DerivativeType & itkNotUsed( derivative ) ) const
+{
+  itkExceptionMacro( << "AfterThreadedGetValueAndDerivative() is not implemented by this metric" );
+
+} // end AfterThreadedGetValueAndDerivative()
+
+
 /**
  * ********************* PrintSelf ****************************
  */
@@ -686,6 +1145,17 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
   os << indent.GetNextIndent() << "MovingImageDerivativeScales: "
     << this->m_MovingImageDerivativeScales << std::endl;
 
+  /** Variables related to multi-threading. */
+  os << indent << "Variables related to multi-threading: " << std::endl;
+  os << indent.GetNextIndent() << "UseMultiThread: "
+    << this->m_UseMultiThread << std::endl;
+  os << indent.GetNextIndent() << "NumberOfThreads: "
+    << this->m_NumberOfThreads << std::endl;
+  os << indent.GetNextIndent() << "Threader: "
+    << this->m_Threader.GetPointer() << std::endl;
+  os << indent.GetNextIndent() << "TransformParametersAreSet: "
+    << this->m_TransformParametersAreSet << std::endl;
+
 } // end PrintSelf()
 
 
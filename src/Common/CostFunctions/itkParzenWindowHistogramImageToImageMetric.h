@@ -49,8 +49,18 @@ namespace itk
    *  - More use of iterators instead of raw buffer pointers.
    *  - An optional FiniteDifference derivative estimation.
    *
-   * \warning This class is not thread safe due the member data structures
-   *  used to the store the sampled points and the marginal and joint pdfs.
+   * The construction of the joint histogram (and of the explicit joint pdf
+   * derivatives) is multi-threaded when the superclass' UseMultiThread is
+   * true and more than one thread is available: every thread fills a private
+   * histogram with its part of the samples, after which the private histograms
+   * are added to m_JointPDF in thread order. Note that in that case every extra
+   * thread needs its own copy of the m_JointPDFDerivatives when explicit pdf
+   * derivatives are used. With a single thread the serial code is run, which
+   * gives bit-identical results to previous versions.
+   *
+   * \warning Apart from the histogram construction this class is not thread
+   *  safe, due to the member data structures used to store the marginal and
+   *  joint pdfs.
    *
    * References:\n
    * [1] "Nonrigid multimodality image registration"\n
@@ -197,6 +207,16 @@ namespace itk
     itkGetConstReferenceMacro( UseExplicitPDFDerivatives, bool );
     itkBooleanMacro( UseExplicitPDFDerivatives );
 
+    /** The maximum memory in megabytes of the private joint pdf derivative
+     * buffers that are used to compute the explicit PDF derivatives with
+     * multiple threads; default 512. Each thread but the first needs a
+     * buffer of the size of the joint pdf derivatives, so the number of
+     * threads is reduced to what fits. If only one thread fits, the
+     * derivatives are computed single-threaded.
+     */
+    itkSetMacro( MaximumMemoryForThreadedPDFDerivatives, unsigned long );
+    itkGetConstMacro( MaximumMemoryForThreadedPDFDerivatives, unsigned long );
+
     /** Whether you plan to call the GetDerivative/GetValueAndDerivative method or not.
      * This option should be set before calling Initialize(); Default: false.
      */
@@ -259,6 +279,11 @@ namespace itk
     typedef IncrementalMarginalPDFType::SizeType    IncrementalMarginalPDFSizeType;
     typedef Array<double>                           ParzenValueContainerType;
 
+    /** The largest Parzen window, i.e. that of a third order B-spline kernel.
+     * This allows to keep the Parzen values on the stack.
+     */
+    itkStaticConstMacro( MaximumParzenWindowSize, unsigned int, 4 );
+
     /** Typedefs for Parzen kernel. */
     typedef KernelFunction KernelFunctionType;
 
@@ -288,6 +313,25 @@ namespace itk
     double m_FixedParzenTermToIndexOffset;
     double m_MovingParzenTermToIndexOffset;
 
+    /** Typedefs for multi-threading. */
+    typedef typename Superclass::ThreadInfoType     ThreadInfoType;
+
+    /** The histograms of a single thread. Thread 0 uses m_JointPDF and
+     * m_JointPDFDerivatives directly; the other threads own buffers of
+     * the same size, which are added to those in AfterThreadedComputePDFs().
+     * Only the first m_NumberOfHistogramThreads threads fill histograms.
+     */
+    struct ParzenWindowHistogramPerThreadStruct
+    {
+      unsigned long                               st_NumberOfPixelsCounted;
+      typename JointPDFType::Pointer              st_JointPDF;
+      typename JointPDFDerivativesType::Pointer   st_JointPDFDerivatives;
+    };
+    typedef std::vector<
+      ParzenWindowHistogramPerThreadStruct >      ParzenWindowHistogramPerThreadVariablesType;
+    mutable ParzenWindowHistogramPerThreadVariablesType m_ParzenWindowHistogramPerThreadVariables;
+    mutable unsigned int                                m_NumberOfHistogramThreads;
+
     /** Kernels for computing Parzen histograms and derivatives. */
     typename KernelFunctionType::Pointer m_FixedKernel;
     typename KernelFunctionType::Pointer m_MovingKernel;
@@ -314,10 +358,14 @@ namespace itk
 
     /** Update the joint PDF with a pixel pair; on demand also updates the
      * pdf derivatives (if the Jacobian pointers are nonzero).
+     * The contribution is added to the given jointPDF and jointPDFDerivatives,
+     * which are m_JointPDF and m_JointPDFDerivatives, or the private
+     * histograms of a thread.
      */
     virtual void UpdateJointPDFAndDerivatives(
       RealType fixedImageValue, RealType movingImageValue,
-      const DerivativeType * imageJacobian, const NonZeroJacobianIndicesType * nzji ) const;
+      const DerivativeType * imageJacobian, const NonZeroJacobianIndicesType * nzji,
+      JointPDFType * jointPDF, JointPDFDerivativesType * jointPDFDerivatives ) const;
 
     /** Update the joint PDF and the incremental pdfs.
      * The input is a pixel pair (fixed, moving, moving mask) and
@@ -345,7 +393,8 @@ namespace itk
     void UpdateJointPDFDerivatives(
       const JointPDFIndexType & pdfIndex, double factor,
       const DerivativeType & imageJacobian,
-      const NonZeroJacobianIndicesType & nzji ) const;
+      const NonZeroJacobianIndicesType & nzji,
+      JointPDFDerivativesType * jointPDFDerivatives ) const;
 
     /** Multiply the pdf entries by the given normalization factor. */
     virtual void NormalizeJointPDF(
@@ -418,6 +467,43 @@ namespace itk
      */
     virtual void ComputePDFs( const ParametersType & parameters ) const;
 
+    /** Methods for the multi-threaded histogram construction ******** */
+
+    /** Get the number of threads that can compute the explicit PDF
+     * derivatives, given the MaximumMemoryForThreadedPDFDerivatives.
+     */
+    virtual unsigned int GetNumberOfThreadsForPDFDerivatives( void ) const;
+
+    /** Resize the per-thread histograms and allocate the private buffers of
+     * threads 1..N-1. Joint pdf derivative buffers are only allocated when
+     * useDerivatives is true, and then N is reduced to
+     * GetNumberOfThreadsForPDFDerivatives().
+     */
+    virtual void InitializeJointPDFsPerThread( bool useDerivatives ) const;
+
+    /** Fill the private histograms of threadID with its part of the samples.
+     * ThreadedComputePDFs() only computes the joint histogram;
+     * ThreadedComputePDFsAndPDFDerivatives() also the explicit joint pdf
+     * derivatives.
+     */
+    virtual void ThreadedComputePDFs( unsigned int threadID ) const;
+    virtual void ThreadedComputePDFsAndPDFDerivatives( unsigned int threadID ) const;
+
+    /** Add the private histograms of all threads to m_JointPDF (and
+     * m_JointPDFDerivatives) in thread order and compute m_Alpha.
+     */
+    virtual void AfterThreadedComputePDFs( bool useDerivatives ) const;
+
+    /** Add the private joint pdf derivatives of threads 1..N-1 to the part of
+     * m_JointPDFDerivatives that belongs to threadID.
+     */
+    virtual void ThreadedMergeJointPDFDerivatives( unsigned int threadID ) const;
+
+    /** The static callback functions passed to the threader. */
+    static ITK_THREAD_RETURN_TYPE ComputePDFsThreaderCallback( void * arg );
+    static ITK_THREAD_RETURN_TYPE ComputePDFsAndPDFDerivativesThreaderCallback( void * arg );
+    static ITK_THREAD_RETURN_TYPE MergeJointPDFDerivativesThreaderCallback( void * arg );
+
     /** Some initialization functions, called by Initialize. */
     virtual void InitializeHistograms( void );
     virtual void InitializeKernels( void );
@@ -457,6 +543,7 @@ namespace itk
     double m_FiniteDifferencePerturbation;
 
     bool m_UseExplicitPDFDerivatives;
+    unsigned long m_MaximumMemoryForThreadedPDFDerivatives;
 
   }; // end class ParzenWindowHistogramImageToImageMetric
 
@@ -65,6 +65,8 @@ namespace itk
     this->SetUseMovingImageLimiter( true );
 
     this->m_UseExplicitPDFDerivatives = true;
+    this->m_MaximumMemoryForThreadedPDFDerivatives = 512;
+    this->m_NumberOfHistogramThreads = 1;
 
   } // end Constructor
 
@@ -495,7 +497,9 @@ namespace itk
     ::UpdateJointPDFAndDerivatives(
       RealType fixedImageValue, RealType movingImageValue,
       const DerivativeType * imageJacobian,
-      const NonZeroJacobianIndicesType * nzji) const
+      const NonZeroJacobianIndicesType * nzji,
+      JointPDFType * jointPDF,
+      JointPDFDerivativesType * jointPDFDerivatives ) const
   {
     typedef ImageSliceIteratorWithIndex< JointPDFType >  PDFIteratorType;
 
@@ -513,9 +517,13 @@ namespace itk
       static_cast<OffsetValueType>( vcl_floor(
       movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset ) );
 
-    /** The Parzen values. */
-    ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[ 1 ] );
-    ParzenValueContainerType movingParzenValues( this->m_JointPDFWindow.GetSize()[ 0 ] );
+    /** The Parzen values, on the stack. */
+    double fixedParzenValuesArray[ Self::MaximumParzenWindowSize ];
+    double movingParzenValuesArray[ Self::MaximumParzenWindowSize ];
+    ParzenValueContainerType fixedParzenValues( fixedParzenValuesArray,
+      this->m_JointPDFWindow.GetSize()[ 1 ], false );
+    ParzenValueContainerType movingParzenValues( movingParzenValuesArray,
+      this->m_JointPDFWindow.GetSize()[ 0 ], false );
     this->EvaluateParzenValues(
       fixedImageParzenWindowTerm, fixedImageParzenWindowIndex,
       this->m_FixedKernel, fixedParzenValues );
@@ -523,13 +531,16 @@ namespace itk
       movingImageParzenWindowTerm, movingImageParzenWindowIndex,
       this->m_MovingKernel, movingParzenValues );
 
-    /** Position the JointPDFWindow. */
+    /** Position the JointPDFWindow. A local copy is used, so that
+     * several threads can update their histograms simultaneously.
+     */
     JointPDFIndexType pdfWindowIndex;
     pdfWindowIndex[ 0 ] = movingImageParzenWindowIndex;
     pdfWindowIndex[ 1 ] = fixedImageParzenWindowIndex;
-    this->m_JointPDFWindow.SetIndex( pdfWindowIndex );
+    JointPDFRegionType jointPDFWindow = this->m_JointPDFWindow;
+    jointPDFWindow.SetIndex( pdfWindowIndex );
 
-    PDFIteratorType it( this->m_JointPDF, this->m_JointPDFWindow );
+    PDFIteratorType it( jointPDF, jointPDFWindow );
     it.GoToBegin();
     it.SetFirstDirection( 0 );
     it.SetSecondDirection( 1 );
@@ -551,8 +562,9 @@ namespace itk
     else
     {
       /** Compute the derivatives of the moving Parzen window. */
+      double derivativeMovingParzenValuesArray[ Self::MaximumParzenWindowSize ];
       ParzenValueContainerType derivativeMovingParzenValues(
-        this->m_JointPDFWindow.GetSize()[0] );
+        derivativeMovingParzenValuesArray, this->m_JointPDFWindow.GetSize()[0], false );
       this->EvaluateParzenValues(
         movingImageParzenWindowTerm, movingImageParzenWindowIndex,
         this->m_DerivativeMovingKernel, derivativeMovingParzenValues );
@@ -571,7 +583,7 @@ namespace itk
           it.Value() += static_cast<PDFValueType>( fv * movingParzenValues[ m ] );
           this->UpdateJointPDFDerivatives(
             it.GetIndex(), fv_et * derivativeMovingParzenValues[ m ],
-            *imageJacobian, *nzji );
+            *imageJacobian, *nzji, jointPDFDerivatives );
           ++it;
         }
         it.NextLine();
@@ -591,12 +603,13 @@ namespace itk
     ::UpdateJointPDFDerivatives(
     const JointPDFIndexType & pdfIndex, double factor,
     const DerivativeType & imageJacobian,
-    const NonZeroJacobianIndicesType & nzji  ) const
+    const NonZeroJacobianIndicesType & nzji,
+    JointPDFDerivativesType * jointPDFDerivatives ) const
   {
     /** Get the pointer to the element with index [0, pdfIndex[0], pdfIndex[1]]. */
-    PDFValueType * derivPtr = this->m_JointPDFDerivatives->GetBufferPointer() +
-      ( pdfIndex[0] * this->m_JointPDFDerivatives->GetOffsetTable()[1] ) +
-      ( pdfIndex[1] * this->m_JointPDFDerivatives->GetOffsetTable()[2] );
+    PDFValueType * derivPtr = jointPDFDerivatives->GetBufferPointer() +
+      ( pdfIndex[0] * jointPDFDerivatives->GetOffsetTable()[1] ) +
+      ( pdfIndex[1] * jointPDFDerivatives->GetOffsetTable()[2] );
 
     if ( nzji.size() == this->GetNumberOfParameters() )
     {
@@ -811,9 +824,13 @@ namespace itk
     PDFValueType * incRightBasePtr = this->m_IncrementalJointPDFRight->GetBufferPointer();
     PDFValueType * incLeftBasePtr = this->m_IncrementalJointPDFLeft->GetBufferPointer();
 
-    /** The Parzen value containers. */
-    ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[1] );
-    ParzenValueContainerType movingParzenValues( this->m_JointPDFWindow.GetSize()[0] );
+    /** The Parzen value containers, on the stack. */
+    double fixedParzenValuesArray[ Self::MaximumParzenWindowSize ];
+    double movingParzenValuesArray[ Self::MaximumParzenWindowSize ];
+    ParzenValueContainerType fixedParzenValues( fixedParzenValuesArray,
+      this->m_JointPDFWindow.GetSize()[1], false );
+    ParzenValueContainerType movingParzenValues( movingParzenValuesArray,
+      this->m_JointPDFWindow.GetSize()[0], false );
 
     /** Determine fixed image Parzen window arguments (see eq. 6 of Mattes paper [2]). */
     const double fixedImageParzenWindowTerm
@@ -993,6 +1010,19 @@ namespace itk
     ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
     ::ComputePDFs( const ParametersType& parameters ) const
   {
+    /** Let the threads construct private histograms, if possible. */
+    if ( this->UseMultiThreadedGetValueAndDerivative() )
+    {
+      this->SetTransformParameters( parameters );
+      this->GetImageSampler()->Update();
+      this->UpdateTransformedSampleCache();
+
+      this->InitializeJointPDFsPerThread( false );
+      this->LaunchThreaderCallback( Self::ComputePDFsThreaderCallback );
+      this->AfterThreadedComputePDFs( false );
+      return;
+    }
+
     /** Initialize some variables. */
     this->m_JointPDF->FillBuffer( 0.0 );
     this->m_NumberOfPixelsCounted = 0;
@@ -1004,6 +1034,7 @@ namespace itk
     /** Update the imageSampler and get a handle to the sample container. */
     this->GetImageSampler()->Update();
     ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+    this->UpdateTransformedSampleCache();
 
     /** Create iterator over the sample container. */
     typename ImageSampleContainerType::ConstIterator fiter;
@@ -1019,7 +1050,7 @@ namespace itk
       MovingImagePointType mappedPoint;
 
       /** Transform point and check if it is inside the B-spline support region. */
-      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+      bool sampleOk = this->TransformSamplePoint( fiter.Index(), fixedPoint, mappedPoint );
 
       /** Check if point is inside mask. */
       if ( sampleOk )
@@ -1049,7 +1080,8 @@ namespace itk
 
         /** Compute this sample's contribution to the joint distributions. */
         this->UpdateJointPDFAndDerivatives(
-          fixedImageValue, movingImageValue, 0, 0 );
+          fixedImageValue, movingImageValue, 0, 0,
+          this->m_JointPDF.GetPointer(), 0 );
       }
 
     } // end iterating over fixed image spatial sample container for loop
@@ -1076,6 +1108,22 @@ namespace itk
     ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
     ::ComputePDFsAndPDFDerivatives( const ParametersType& parameters ) const
   {
+    /** Let the threads construct private histograms, if possible and if
+     * enough memory is allowed for their private derivative buffers.
+     */
+    if ( this->UseMultiThreadedGetValueAndDerivative()
+      && this->GetNumberOfThreadsForPDFDerivatives() > 1 )
+    {
+      this->SetTransformParameters( parameters );
+      this->GetImageSampler()->Update();
+      this->UpdateTransformedSampleCache();
+
+      this->InitializeJointPDFsPerThread( true );
+      this->LaunchThreaderCallback( Self::ComputePDFsAndPDFDerivativesThreaderCallback );
+      this->AfterThreadedComputePDFs( true );
+      return;
+    }
+
     /** Initialize some variables. */
     this->m_JointPDF->FillBuffer( 0.0 );
     this->m_JointPDFDerivatives->FillBuffer( 0.0 );
@@ -1093,6 +1141,7 @@ namespace itk
     /** Update the imageSampler and get a handle to the sample container. */
     this->GetImageSampler()->Update();
     ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+    this->UpdateTransformedSampleCache();
 
     /** Create iterator over the sample container. */
     typename ImageSampleContainerType::ConstIterator fiter;
@@ -1109,7 +1158,7 @@ namespace itk
       MovingImageDerivativeType movingImageDerivative;
 
       /** Transform point and check if it is inside the B-spline support region. */
-      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint);
+      bool sampleOk = this->TransformSamplePoint( fiter.Index(), fixedPoint, mappedPoint );
 
       /** Check if point is inside mask. */
       if ( sampleOk )
@@ -1139,15 +1188,19 @@ namespace itk
           movingImageValue, movingImageDerivative );
 
         /** Get the TransformJacobian dT/dmu. */
-        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        const TransformJacobianType * sampleJacobian;
+        const NonZeroJacobianIndicesType * sampleNzji;
+        this->EvaluateTransformSampleJacobian( fiter.Index(), fixedPoint,
+          jacobian, nzji, sampleJacobian, sampleNzji );
 
         /** Compute the inner product (dM/dx)^T (dT/dmu). */
         this->EvaluateTransformJacobianInnerProduct(
-          jacobian, movingImageDerivative, imageJacobian );
+          *sampleJacobian, movingImageDerivative, imageJacobian );
 
         /** Update the joint pdf and the joint pdf derivatives. */
         this->UpdateJointPDFAndDerivatives(
-          fixedImageValue, movingImageValue, &imageJacobian, &nzji );
+          fixedImageValue, movingImageValue, &imageJacobian, sampleNzji,
+          this->m_JointPDF.GetPointer(), this->m_JointPDFDerivatives.GetPointer() );
 
       } //end if-block check sampleOk
     } // end iterating over fixed image spatial sample container for loop
@@ -1379,6 +1432,416 @@ namespace itk
   } // end ComputePDFsAndIncrementalPDFs()
 
 
+  /**
+   * ***************** GetNumberOfThreadsForPDFDerivatives ****************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    unsigned int
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::GetNumberOfThreadsForPDFDerivatives( void ) const
+  {
+    /** Thread 0 needs no private buffer. */
+    const double bufferSize = sizeof( PDFValueType ) * static_cast<double>(
+      this->m_JointPDFDerivatives->GetBufferedRegion().GetNumberOfPixels() );
+    const double maximumMemory
+      = this->m_MaximumMemoryForThreadedPDFDerivatives * 1024.0 * 1024.0;
+    const double numberOfPrivateBuffers = vcl_floor( maximumMemory / bufferSize );
+
+    return static_cast<unsigned int>( vnl_math_min(
+      static_cast<double>( this->GetNumberOfThreads() ), 1.0 + numberOfPrivateBuffers ) );
+
+  } // end GetNumberOfThreadsForPDFDerivatives()
+
+
+  /**
+   * ******************** InitializeJointPDFsPerThread *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::InitializeJointPDFsPerThread( bool useDerivatives ) const
+  {
+    /** The explicit derivatives may be computed by less threads, to limit
+     * the memory of the private derivative buffers.
+     */
+    const unsigned int numberOfThreads = useDerivatives
+      ? this->GetNumberOfThreadsForPDFDerivatives() : this->GetNumberOfThreads();
+    this->m_NumberOfHistogramThreads = numberOfThreads;
+    this->m_ParzenWindowHistogramPerThreadVariables.resize( this->GetNumberOfThreads() );
+
+    /** Thread 0 works directly on the member histograms. */
+    this->m_ParzenWindowHistogramPerThreadVariables[ 0 ].st_JointPDF = this->m_JointPDF;
+    this->m_ParzenWindowHistogramPerThreadVariables[ 0 ].st_JointPDFDerivatives = 0;
+    if ( useDerivatives )
+    {
+      this->m_ParzenWindowHistogramPerThreadVariables[ 0 ].st_JointPDFDerivatives
+        = this->m_JointPDFDerivatives;
+    }
+
+    /** The other threads get private buffers of the same size. These are only
+     * (re)allocated when the size of the member histograms has changed.
+     */
+    const JointPDFRegionType & jointPDFRegion
+      = this->m_JointPDF->GetBufferedRegion();
+    for ( unsigned int t = 1; t < numberOfThreads; ++t )
+    {
+      ParzenWindowHistogramPerThreadStruct & perThread
+        = this->m_ParzenWindowHistogramPerThreadVariables[ t ];
+
+      if ( perThread.st_JointPDF.IsNull()
+        || perThread.st_JointPDF->GetBufferedRegion() != jointPDFRegion )
+      {
+        perThread.st_JointPDF = JointPDFType::New();
+        perThread.st_JointPDF->SetRegions( jointPDFRegion );
+        perThread.st_JointPDF->Allocate();
+      }
+
+      if ( useDerivatives )
+      {
+        const JointPDFDerivativesRegionType & jointPDFDerivativesRegion
+          = this->m_JointPDFDerivatives->GetBufferedRegion();
+        if ( perThread.st_JointPDFDerivatives.IsNull()
+          || perThread.st_JointPDFDerivatives->GetBufferedRegion() != jointPDFDerivativesRegion )
+        {
+          perThread.st_JointPDFDerivatives = JointPDFDerivativesType::New();
+          perThread.st_JointPDFDerivatives->SetRegions( jointPDFDerivativesRegion );
+          perThread.st_JointPDFDerivatives->Allocate();
+        }
+      }
+    } // end for loop over threads
+
+    /** Release the derivative buffers that are no longer used. */
+    if ( useDerivatives )
+    {
+      for ( unsigned int t = numberOfThreads;
+        t < this->m_ParzenWindowHistogramPerThreadVariables.size(); ++t )
+      {
+        this->m_ParzenWindowHistogramPerThreadVariables[ t ].st_JointPDFDerivatives = 0;
+      }
+    }
+
+  } // end InitializeJointPDFsPerThread()
+
+
+  /**
+   * ************************ ThreadedComputePDFs **************************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ThreadedComputePDFs( unsigned int threadID ) const
+  {
+    /** Get a handle to this thread's histogram and initialize it. */
+    ParzenWindowHistogramPerThreadStruct & perThread
+      = this->m_ParzenWindowHistogramPerThreadVariables[ threadID ];
+    perThread.st_JointPDF->FillBuffer( 0.0 );
+    perThread.st_NumberOfPixelsCounted = 0;
+
+    /** Get a handle to the sample container and select this thread's part. */
+    ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+    unsigned long begin = 0;
+    unsigned long end = 0;
+    this->GetSampleRangeForThread( threadID, sampleContainer->Size(), begin, end );
+
+    /** Loop over this thread's part of the sample container. */
+    for ( unsigned long i = begin; i < end; ++i )
+    {
+      /** Read fixed coordinates and initialize some variables. */
+      const FixedImagePointType & fixedPoint
+        = sampleContainer->ElementAt( i ).m_ImageCoordinates;
+      RealType movingImageValue;
+      MovingImagePointType mappedPoint;
+
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformSamplePoint( i, fixedPoint, mappedPoint );
+
+      /** Check if point is inside mask. */
+      if ( sampleOk )
+      {
+        sampleOk = this->IsInsideMovingMask( mappedPoint );
+      }
+
+      /** Compute the moving image value and check if the point is
+       * inside the moving image buffer.
+       */
+      if ( sampleOk )
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue, 0 );
+      }
+
+      if ( sampleOk )
+      {
+        perThread.st_NumberOfPixelsCounted++;
+
+        /** Get the fixed image value. */
+        RealType fixedImageValue = static_cast<RealType>(
+          sampleContainer->ElementAt( i ).m_ImageValue );
+
+        /** Make sure the values fall within the histogram range. */
+        fixedImageValue = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
+        movingImageValue = this->GetMovingImageLimiter()->Evaluate( movingImageValue );
+
+        /** Compute this sample's contribution to the private joint histogram. */
+        this->UpdateJointPDFAndDerivatives(
+          fixedImageValue, movingImageValue, 0, 0,
+          perThread.st_JointPDF.GetPointer(), 0 );
+      }
+
+    } // end for loop over this thread's samples
+
+  } // end ThreadedComputePDFs()
+
+
+  /**
+   * ***************** ThreadedComputePDFsAndPDFDerivatives ******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ThreadedComputePDFsAndPDFDerivatives( unsigned int threadID ) const
+  {
+    /** Only the first m_NumberOfHistogramThreads threads have buffers. */
+    const unsigned int numberOfThreads = this->m_NumberOfHistogramThreads;
+    if ( threadID >= numberOfThreads )
+    {
+      return;
+    }
+
+    /** Get a handle to this thread's histograms and initialize them. */
+    ParzenWindowHistogramPerThreadStruct & perThread
+      = this->m_ParzenWindowHistogramPerThreadVariables[ threadID ];
+    perThread.st_JointPDF->FillBuffer( 0.0 );
+    perThread.st_JointPDFDerivatives->FillBuffer( 0.0 );
+    perThread.st_NumberOfPixelsCounted = 0;
+
+    /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
+    NonZeroJacobianIndicesType nzji( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+    DerivativeType imageJacobian( nzji.size() );
+    TransformJacobianType jacobian;
+
+    /** Get a handle to the sample container and select this thread's part
+     * of it, for m_NumberOfHistogramThreads threads.
+     */
+    ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+    unsigned long begin, end;
+    this->GetSampleRangeForThread( threadID, numberOfThreads,
+      sampleContainer->Size(), begin, end );
+
+    /** Loop over this thread's part of the sample container. */
+    for ( unsigned long i = begin; i < end; ++i )
+    {
+      /** Read fixed coordinates and initialize some variables. */
+      const FixedImagePointType & fixedPoint
+        = sampleContainer->ElementAt( i ).m_ImageCoordinates;
+      RealType movingImageValue;
+      MovingImagePointType mappedPoint;
+      MovingImageDerivativeType movingImageDerivative;
+
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformSamplePoint( i, fixedPoint, mappedPoint );
+
+      /** Check if point is inside mask. */
+      if ( sampleOk )
+      {
+        sampleOk = this->IsInsideMovingMask( mappedPoint );
+      }
+
+      /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+       * the point is inside the moving image buffer.
+       */
+      if ( sampleOk )
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue, &movingImageDerivative );
+      }
+
+      if ( sampleOk )
+      {
+        perThread.st_NumberOfPixelsCounted++;
+
+        /** Get the fixed image value. */
+        RealType fixedImageValue = static_cast<RealType>(
+          sampleContainer->ElementAt( i ).m_ImageValue );
+
+        /** Make sure the values fall within the histogram range. */
+        fixedImageValue = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
+        movingImageValue = this->GetMovingImageLimiter()->Evaluate(
+          movingImageValue, movingImageDerivative );
+
+        /** Get the TransformJacobian dT/dmu. */
+        const TransformJacobianType * sampleJacobian;
+        const NonZeroJacobianIndicesType * sampleNzji;
+        this->EvaluateTransformSampleJacobian( i, fixedPoint,
+          jacobian, nzji, sampleJacobian, sampleNzji );
+
+        /** Compute the inner product (dM/dx)^T (dT/dmu). */
+        this->EvaluateTransformJacobianInnerProduct(
+          *sampleJacobian, movingImageDerivative, imageJacobian );
+
+        /** Update the private joint pdf and joint pdf derivatives. */
+        this->UpdateJointPDFAndDerivatives(
+          fixedImageValue, movingImageValue, &imageJacobian, sampleNzji,
+          perThread.st_JointPDF.GetPointer(),
+          perThread.st_JointPDFDerivatives.GetPointer() );
+
+      } //end if-block check sampleOk
+    } // end for loop over this thread's samples
+
+  } // end ThreadedComputePDFsAndPDFDerivatives()
+
+
+  /**
+   * ********************* AfterThreadedComputePDFs ***********************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::AfterThreadedComputePDFs( bool useDerivatives ) const
+  {
+    const unsigned int numberOfThreads = this->m_NumberOfHistogramThreads;
+
+    /** Accumulate the number of pixels counted. */
+    this->m_NumberOfPixelsCounted = 0;
+    for ( unsigned int t = 0; t < numberOfThreads; ++t )
+    {
+      this->m_NumberOfPixelsCounted
+        += this->m_ParzenWindowHistogramPerThreadVariables[ t ].st_NumberOfPixelsCounted;
+    }
+
+    /** Add the private joint histograms to m_JointPDF, in thread order,
+     * so that the result does not depend on the thread scheduling.
+     */
+    PDFValueType * jointPDFBuffer = this->m_JointPDF->GetBufferPointer();
+    const unsigned long jointPDFSize
+      = this->m_JointPDF->GetBufferedRegion().GetNumberOfPixels();
+    for ( unsigned int t = 1; t < numberOfThreads; ++t )
+    {
+      const PDFValueType * threadBuffer = this->m_ParzenWindowHistogramPerThreadVariables[ t ]
+        .st_JointPDF->GetBufferPointer();
+      for ( unsigned long i = 0; i < jointPDFSize; ++i )
+      {
+        jointPDFBuffer[ i ] += threadBuffer[ i ];
+      }
+    }
+
+    /** The joint pdf derivatives are large; let the threads merge them. */
+    if ( useDerivatives && numberOfThreads > 1 )
+    {
+      this->LaunchThreaderCallback( Self::MergeJointPDFDerivativesThreaderCallback );
+    }
+
+    /** Check if enough samples were valid. */
+    this->CheckNumberOfSamples(
+      this->GetImageSampler()->GetOutput()->Size(), this->m_NumberOfPixelsCounted );
+
+    /** Compute alpha. */
+    this->m_Alpha = 0.0;
+    if ( this->m_NumberOfPixelsCounted > 0 )
+    {
+      this->m_Alpha = 1.0 / static_cast<double>( this->m_NumberOfPixelsCounted );
+    }
+
+  } // end AfterThreadedComputePDFs()
+
+
+  /**
+   * ******************* ThreadedMergeJointPDFDerivatives *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ThreadedMergeJointPDFDerivatives( unsigned int threadID ) const
+  {
+    /** Select this thread's part of the buffer. */
+    const unsigned long bufferSize
+      = this->m_JointPDFDerivatives->GetBufferedRegion().GetNumberOfPixels();
+    unsigned long begin = 0;
+    unsigned long end = 0;
+    this->GetSampleRangeForThread( threadID, bufferSize, begin, end );
+
+    /** Add the other threads' contributions, in thread order. */
+    PDFValueType * derivativesBuffer = this->m_JointPDFDerivatives->GetBufferPointer();
+    const unsigned int numberOfThreads = this->m_NumberOfHistogramThreads;
+    for ( unsigned int t = 1; t < numberOfThreads; ++t )
+    {
+      const PDFValueType * threadBuffer = this->m_ParzenWindowHistogramPerThreadVariables[ t ]
+        .st_JointPDFDerivatives->GetBufferPointer();
+      for ( unsigned long i = begin; i < end; ++i )
+      {
+        derivativesBuffer[ i ] += threadBuffer[ i ];
+      }
+    }
+
+  } // end ThreadedMergeJointPDFDerivatives()
+
+
+  /**
+   * ******************* ComputePDFsThreaderCallback *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    ITK_THREAD_RETURN_TYPE
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ComputePDFsThreaderCallback( void * arg )
+  {
+    ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+    const unsigned int threadID = static_cast<unsigned int>( infoStruct->ThreadID );
+    const Self * metric = static_cast< const Self * >( infoStruct->UserData );
+
+    metric->ThreadedComputePDFs( threadID );
+
+    return ITK_THREAD_RETURN_VALUE;
+
+  } // end ComputePDFsThreaderCallback()
+
+
+  /**
+   * ************ ComputePDFsAndPDFDerivativesThreaderCallback ***************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    ITK_THREAD_RETURN_TYPE
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ComputePDFsAndPDFDerivativesThreaderCallback( void * arg )
+  {
+    ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+    const unsigned int threadID = static_cast<unsigned int>( infoStruct->ThreadID );
+    const Self * metric = static_cast< const Self * >( infoStruct->UserData );
+
+    metric->ThreadedComputePDFsAndPDFDerivatives( threadID );
+
+    return ITK_THREAD_RETURN_VALUE;
+
+  } // end ComputePDFsAndPDFDerivativesThreaderCallback()
+
+
+  /**
+   * ************** MergeJointPDFDerivativesThreaderCallback *****************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    ITK_THREAD_RETURN_TYPE
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::MergeJointPDFDerivativesThreaderCallback( void * arg )
+  {
+    ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+    const unsigned int threadID = static_cast<unsigned int>( infoStruct->ThreadID );
+    const Self * metric = static_cast< const Self * >( infoStruct->UserData );
+
+    metric->ThreadedMergeJointPDFDerivatives( threadID );
+
+    return ITK_THREAD_RETURN_VALUE;
+
+  } // end MergeJointPDFDerivativesThreaderCallback()
+
+
 } // end namespace itk
 
 
@@ -122,9 +122,17 @@ public:
   /** Get a pointer to the Transform.  */
   itkGetConstObjectMacro( Transform, TransformType );
 
-  /** Set the parameters defining the Transform. */
+  /** Set the parameters defining the Transform, unless
+   * TransformParametersAreSet.
+   */
   void SetTransformParameters( const ParametersType & parameters ) const;
 
+  /** Set/Get whether the transform parameters are already set by the
+   * caller; default false. See AdvancedImageToImageMetric.
+   */
+  itkSetMacro( TransformParametersAreSet, bool );
+  itkGetConstMacro( TransformParametersAreSet, bool );
+
   /** Return the number of parameters required by the transform. */
   unsigned int GetNumberOfParameters( void ) const
   { return this->m_Transform->GetNumberOfParameters(); }
@@ -162,6 +170,7 @@ protected:
   mutable TransformPointer    m_Transform;
 
   mutable unsigned int        m_NumberOfPointsCounted;
+  bool                        m_TransformParametersAreSet;
 
 private:
   SingleValuedPointSetToPointSetMetric(const Self&); //purposely not implemented
@@ -37,6 +37,7 @@ SingleValuedPointSetToPointSetMetric<TFixedPointSet,TMovingPointSet>
   this->m_MovingImageMask = 0;
 
   this->m_NumberOfPointsCounted = 0;
+  this->m_TransformParametersAreSet = false;
 
 } // end Constructor
 
@@ -54,7 +55,10 @@ SingleValuedPointSetToPointSetMetric<TFixedPointSet,TMovingPointSet>
   {
     itkExceptionMacro( << "Transform has not been assigned" );
   }
-  this->m_Transform->SetParameters( parameters );
+  if ( !this->m_TransformParametersAreSet )
+  {
+    this->m_Transform->SetParameters( parameters );
+  }
 
 } // end SetTransformParameters()
 
@@ -114,6 +118,7 @@ SingleValuedPointSetToPointSetMetric<TFixedPointSet,TMovingPointSet>
   os << "Fixed mask: " << this->m_FixedImageMask.GetPointer() << std::endl;
   os << "Moving mask: " << this->m_MovingImageMask.GetPointer() << std::endl;
   os << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << "TransformParametersAreSet: " << this->m_TransformParametersAreSet << std::endl;
 
 } // end PrintSelf()
 
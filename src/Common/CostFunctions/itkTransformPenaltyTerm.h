@@ -108,6 +108,8 @@ public:
     ::JacobianOfSpatialHessianType              JacobianOfSpatialHessianType;
   typedef typename TransformType
     ::InternalMatrixType                        InternalMatrixType;
+  typedef typename TransformType
+    ::JacobianWorkspaceType                     JacobianWorkspaceType;
 
   /** Define the dimension. */
   itkStaticConstMacro( FixedImageDimension, unsigned int, FixedImageType::ImageDimension );
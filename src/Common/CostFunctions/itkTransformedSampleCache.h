@@ -0,0 +1,152 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkTransformedSampleCache_h
+#define __itkTransformedSampleCache_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkDataObject.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * \class TransformedSampleCache
+ * \brief Stores the mapped points and the sparse transform Jacobians of
+ * a set of image samples, so that several metrics can share them.
+ *
+ * When several metrics use the same image sampler, each of them transforms
+ * the same fixed image samples, and computes the same transform Jacobians,
+ * in every iteration. A TransformedSampleCache that is set in all these
+ * metrics computes each mapped point and each Jacobian only once: the first
+ * metric that asks for it computes and stores it, the next ones read it.
+ *
+ * Before the sample loop, a metric calls Update() with the transform and
+ * its sample container. When the samples or the transform parameters
+ * differ from those of the previous call, all entries are invalidated.
+ * Update() is not thread safe, but during the sample loop the entries of
+ * different samples may be requested from different threads.
+ *
+ * Memory use is one point per sample, and for the samples whose Jacobian
+ * was requested, one sparse Jacobian plus its nonzero indices.
+ *
+ * \ingroup Metrics
+ */
+
+template < class TTransform >
+class TransformedSampleCache : public Object
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef TransformedSampleCache      Self;
+  typedef Object                      Superclass;
+  typedef SmartPointer<Self>          Pointer;
+  typedef SmartPointer<const Self>    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( TransformedSampleCache, Object );
+
+  /** Typedefs. */
+  typedef TTransform                                      TransformType;
+  typedef typename TransformType::InputPointType          InputPointType;
+  typedef typename TransformType::OutputPointType         OutputPointType;
+  typedef typename TransformType::JacobianType            JacobianType;
+  typedef typename TransformType::ParametersType          ParametersType;
+  typedef typename
+    TransformType::NonZeroJacobianIndicesType             NonZeroJacobianIndicesType;
+
+  /** Set/Get the object that produces the samples, i.e. the image sampler.
+   * Metrics only use the cache when it was set up for their own sampler.
+   */
+  itkSetConstObjectMacro( SampleSource, Object );
+  itkGetConstObjectMacro( SampleSource, Object );
+
+  /** Prepare the cache for the given sample container and the current
+   * parameters of the transform. Invalidates all entries when the samples
+   * or the parameters differ from those of the previous call.
+   */
+  virtual void Update( const TransformType * transform,
+    const DataObject * samples, const unsigned long numberOfSamples );
+
+  /** Get the mapped point of sample i, at fixedPoint. It is computed
+   * on the first request after Update().
+   */
+  void GetMappedPoint( const unsigned long i,
+    const InputPointType & fixedPoint, OutputPointType & mappedPoint );
+
+  /** Get the sparse transform Jacobian of sample i, at fixedPoint.
+   * It is computed on the first request after Update(). The Jacobian and
+   * its indices are not copied: the pointers refer to the entries in the
+   * cache, which remain valid until the next Update().
+   */
+  void GetJacobian( const unsigned long i,
+    const InputPointType & fixedPoint,
+    const JacobianType * & jacobian,
+    const NonZeroJacobianIndicesType * & nzji );
+
+  /** Get the number of samples of the last Update(). */
+  itkGetConstMacro( NumberOfSamples, unsigned long );
+
+protected:
+
+  /** The constructor. */
+  TransformedSampleCache();
+
+  /** The destructor. */
+  virtual ~TransformedSampleCache() {};
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream& os, Indent indent ) const;
+
+private:
+
+  /** The private constructor. */
+  TransformedSampleCache( const Self& );  // purposely not implemented
+  /** The private copy constructor. */
+  void operator=( const Self& );          // purposely not implemented
+
+  /** The transform, samples and parameters of the last Update(). */
+  const TransformType *                 m_Transform;
+  const DataObject *                      m_Samples;
+  unsigned long                           m_SamplesMTime;
+  unsigned long                           m_NumberOfSamples;
+  ParametersType                          m_Parameters;
+  Object::ConstPointer                    m_SampleSource;
+
+  /** The entries are valid when their time equals m_CurrentTime, which is
+   * increased by each Update() that invalidates the cache.
+   */
+  unsigned long                           m_CurrentTime;
+  std::vector< unsigned long >            m_MappedPointTimes;
+  std::vector< OutputPointType >          m_MappedPoints;
+  std::vector< unsigned long >            m_JacobianTimes;
+  std::vector< JacobianType >             m_Jacobians;
+  std::vector< NonZeroJacobianIndicesType > m_NonZeroJacobianIndices;
+
+}; // end class TransformedSampleCache
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkTransformedSampleCache.txx"
+#endif
+
+#endif // end #ifndef __itkTransformedSampleCache_h
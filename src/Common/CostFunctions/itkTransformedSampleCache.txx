@@ -0,0 +1,156 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkTransformedSampleCache_txx
+#define __itkTransformedSampleCache_txx
+
+#include "itkTransformedSampleCache.h"
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+template < class TTransform >
+TransformedSampleCache< TTransform >
+::TransformedSampleCache()
+{
+  this->m_Transform = 0;
+  this->m_Samples = 0;
+  this->m_SamplesMTime = 0;
+  this->m_NumberOfSamples = 0;
+  this->m_SampleSource = 0;
+  this->m_CurrentTime = 0;
+
+} // end Constructor
+
+
+/**
+ * ********************* Update ****************************
+ */
+
+template < class TTransform >
+void
+TransformedSampleCache< TTransform >
+::Update( const TransformType * transform,
+  const DataObject * samples, const unsigned long numberOfSamples )
+{
+  /** Check if the entries are still valid. The parameters are compared
+   * by value, because every metric sets them again before its evaluation.
+   */
+  const ParametersType & parameters = transform->GetParameters();
+  bool isValid = this->m_CurrentTime > 0
+    && this->m_Transform == transform
+    && this->m_Samples == samples
+    && this->m_SamplesMTime == samples->GetMTime()
+    && this->m_NumberOfSamples == numberOfSamples
+    && this->m_Parameters.GetSize() == parameters.GetSize();
+  if ( isValid )
+  {
+    isValid = ( this->m_Parameters == parameters );
+  }
+  if ( isValid )
+  {
+    return;
+  }
+
+  /** Store the new state and invalidate all entries. */
+  this->m_Transform = transform;
+  this->m_Samples = samples;
+  this->m_SamplesMTime = samples->GetMTime();
+  this->m_NumberOfSamples = numberOfSamples;
+  this->m_Parameters = parameters;
+  ++this->m_CurrentTime;
+
+  /** The Jacobians keep their memory, so that they are not reallocated
+   * in every iteration.
+   */
+  if ( this->m_MappedPoints.size() != numberOfSamples )
+  {
+    this->m_MappedPointTimes.resize( numberOfSamples, 0 );
+    this->m_MappedPoints.resize( numberOfSamples );
+    this->m_JacobianTimes.resize( numberOfSamples, 0 );
+    this->m_Jacobians.resize( numberOfSamples );
+    this->m_NonZeroJacobianIndices.resize( numberOfSamples );
+  }
+
+} // end Update()
+
+
+/**
+ * ********************* GetMappedPoint ****************************
+ */
+
+template < class TTransform >
+void
+TransformedSampleCache< TTransform >
+::GetMappedPoint( const unsigned long i,
+  const InputPointType & fixedPoint, OutputPointType & mappedPoint )
+{
+  if ( this->m_MappedPointTimes[ i ] != this->m_CurrentTime )
+  {
+    this->m_MappedPoints[ i ] = this->m_Transform->TransformPoint( fixedPoint );
+    this->m_MappedPointTimes[ i ] = this->m_CurrentTime;
+  }
+  mappedPoint = this->m_MappedPoints[ i ];
+
+} // end GetMappedPoint()
+
+
+/**
+ * ********************* GetJacobian ****************************
+ */
+
+template < class TTransform >
+void
+TransformedSampleCache< TTransform >
+::GetJacobian( const unsigned long i,
+  const InputPointType & fixedPoint,
+  const JacobianType * & jacobian,
+  const NonZeroJacobianIndicesType * & nzji )
+{
+  if ( this->m_JacobianTimes[ i ] != this->m_CurrentTime )
+  {
+    this->m_Transform->GetJacobian( fixedPoint,
+      this->m_Jacobians[ i ], this->m_NonZeroJacobianIndices[ i ] );
+    this->m_JacobianTimes[ i ] = this->m_CurrentTime;
+  }
+  jacobian = &this->m_Jacobians[ i ];
+  nzji = &this->m_NonZeroJacobianIndices[ i ];
+
+} // end GetJacobian()
+
+
+/**
+ * ********************* PrintSelf ****************************
+ */
+
+template < class TTransform >
+void
+TransformedSampleCache< TTransform >
+::PrintSelf( std::ostream& os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "SampleSource: " << this->m_SampleSource.GetPointer() << std::endl;
+  os << indent << "NumberOfSamples: " << this->m_NumberOfSamples << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkTransformedSampleCache_txx
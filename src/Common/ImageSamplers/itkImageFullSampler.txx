@@ -90,31 +90,35 @@ namespace itk
     } // end if no mask
     else
     {
-      if ( mask->GetSource() )
-      {
-        mask->GetSource()->Update();
-      }
-      /** Loop over the image and check if the points falls within the mask. */
-      for( iter.GoToBegin(); ! iter.IsAtEnd(); ++iter )
-      {
-        ImageSampleType tempsample;
+      /** Get the voxels inside the mask. The run-length index is shared with
+       * other samplers, so the mask is not scanned again if it did not change.
+       */
+      const typename Superclass::MaskRunLengthIndexType * insideIndex
+        = this->GetMaskRunLengthIndex();
+      sampleContainer->Reserve( insideIndex->GetNumberOfInsideVoxels() );
 
-        /** Get sampled index. */
-        InputImageIndexType index = iter.GetIndex();
+      /** Loop over the runs of voxels inside the mask. */
+      unsigned long ind = 0;
+      InputImageIndexType runIndex;
+      for ( unsigned long r = 0; r < insideIndex->GetNumberOfRuns(); ++r )
+      {
+        insideIndex->ComputeIndex( insideIndex->GetRunStart( r ), runIndex );
+        iter.SetIndex( runIndex );
+        const unsigned long runLength = insideIndex->GetRunLength( r );
+        for ( unsigned long j = 0; j < runLength; ++j, ++iter, ++ind )
+        {
+          ImageSampleType tempsample;
 
-        /** Translate index to point. */
-        inputImage->TransformIndexToPhysicalPoint( index,
-          tempsample.m_ImageCoordinates );
+          /** Translate index to point. */
+          inputImage->TransformIndexToPhysicalPoint( iter.GetIndex(),
+            tempsample.m_ImageCoordinates );
 
-        if ( mask->IsInside( tempsample.m_ImageCoordinates ) )
-        {
           /** Get sampled image value. */
           tempsample.m_ImageValue = iter.Get();
 
-          /**  Store in container. */
-          sampleContainer->push_back (tempsample );
-
-        } // end if
+          /** Store in container. */
+          sampleContainer->SetElement( ind, tempsample );
+        }
       } // end for
     } // end else (if mask exists)
 
@@ -0,0 +1,190 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkImageMaskRunLengthIndex_h
+#define __itkImageMaskRunLengthIndex_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkSpatialObject.h"
+#include "itkImageRegion.h"
+#include "itkSimpleFastMutexLock.h"
+
+#include <vector>
+
+namespace itk
+{
+
+  /** \class ImageMaskRunLengthIndex
+   *
+   * \brief A run-length encoded list of the voxels of an image region
+   * that are inside a set of masks.
+   *
+   * The voxels of the region are numbered in the order of an
+   * ImageRegionIterator. The voxels whose centre is inside all masks are
+   * stored as runs of consecutive numbers. GetIndex( k ) returns the index
+   * of the k-th inside voxel, so that the inside voxels can be visited or
+   * randomly selected without testing the masks again.
+   *
+   * Computing the index requires a scan over the whole region, which is
+   * expensive for large images. GetSharedIndex() therefore keeps a small
+   * cache of indices, which is shared by all image samplers of the same
+   * image type. An index is reused as long as the image, the masks and the
+   * region are the same, and the image and the masks were not modified
+   * after the index was computed. In a registration this means that the
+   * region is scanned once per resolution, even when several samplers or
+   * metrics use the same fixed image and mask.
+   *
+   * \ingroup ImageSamplers
+   */
+
+  template < class TImage >
+  class ImageMaskRunLengthIndex : public Object
+  {
+  public:
+
+    /** Standard ITK-stuff. */
+    typedef ImageMaskRunLengthIndex           Self;
+    typedef Object                            Superclass;
+    typedef SmartPointer<Self>                Pointer;
+    typedef SmartPointer<const Self>          ConstPointer;
+
+    /** Method for creation through the object factory. */
+    itkNewMacro( Self );
+
+    /** Run-time type information (and related methods). */
+    itkTypeMacro( ImageMaskRunLengthIndex, Object );
+
+    /** The image dimension. */
+    itkStaticConstMacro( ImageDimension, unsigned int, TImage::ImageDimension );
+
+    /** The maximum number of indices in the shared cache. */
+    itkStaticConstMacro( MaximumNumberOfSharedIndices, unsigned int, 8 );
+
+    /** Typedefs. */
+    typedef TImage                                      ImageType;
+    typedef typename ImageType::IndexType               IndexType;
+    typedef typename ImageType::SizeType                SizeType;
+    typedef typename ImageType::RegionType              RegionType;
+    typedef typename ImageType::PointType               PointType;
+    typedef SpatialObject< itkGetStaticConstMacro( ImageDimension ) > MaskType;
+    typedef typename MaskType::ConstPointer             MaskConstPointer;
+    typedef std::vector< MaskConstPointer >             MaskVectorType;
+
+    /** Scan the region of the image, and store the voxels that are inside
+     * all masks. Without masks all voxels of the region are inside. The masks
+     * should be up-to-date.
+     */
+    virtual void Compute( const ImageType * image,
+      const MaskVectorType & masks, const RegionType & region );
+
+    /** Check whether the index was computed for this image, these masks and
+     * this region, and whether the image and the masks have not been
+     * modified since.
+     */
+    virtual bool IsUpToDate( const ImageType * image,
+      const MaskVectorType & masks, const RegionType & region ) const;
+
+    /** Get the region that was scanned. */
+    itkGetConstReferenceMacro( Region, RegionType );
+
+    /** Get the number of voxels inside the masks. */
+    unsigned long GetNumberOfInsideVoxels( void ) const
+    {
+      return this->m_NumberOfInsideVoxels;
+    }
+
+    /** Get the number of runs. */
+    unsigned long GetNumberOfRuns( void ) const
+    {
+      return this->m_RunStarts.size();
+    }
+
+    /** Get the number of the first voxel of run r, within the region. */
+    unsigned long GetRunStart( const unsigned long r ) const
+    {
+      return this->m_RunStarts[ r ];
+    }
+
+    /** Get the number of voxels of run r. */
+    unsigned long GetRunLength( const unsigned long r ) const
+    {
+      return this->m_RunLengths[ r ];
+    }
+
+    /** Get the number within the region of the k-th inside voxel. */
+    unsigned long GetOffset( const unsigned long k ) const;
+
+    /** Get the image index of the k-th inside voxel. */
+    void GetIndex( const unsigned long k, IndexType & index ) const
+    {
+      this->ComputeIndex( this->GetOffset( k ), index );
+    }
+
+    /** Convert a number within the region to an image index. */
+    void ComputeIndex( unsigned long offset, IndexType & index ) const;
+
+    /** Get an index for this image, these masks and this region from the
+     * shared cache; it is computed if no up-to-date index is available.
+     * Thread-safe: the cache is locked, so that concurrent image samplers
+     * wait for each other instead of computing the same index.
+     */
+    static ConstPointer GetSharedIndex( const ImageType * image,
+      const MaskVectorType & masks, const RegionType & region );
+
+  protected:
+
+    /** The constructor. */
+    ImageMaskRunLengthIndex();
+
+    /** The destructor. */
+    virtual ~ImageMaskRunLengthIndex() {};
+
+    /** PrintSelf. */
+    void PrintSelf( std::ostream& os, Indent indent ) const;
+
+  private:
+
+    /** The private constructor. */
+    ImageMaskRunLengthIndex( const Self& ); // purposely not implemented
+    /** The private copy constructor. */
+    void operator=( const Self& );          // purposely not implemented
+
+    /** The shared cache. */
+    typedef std::vector< Pointer >          IndexVectorType;
+    static IndexVectorType & GetSharedIndices( void );
+    static SimpleFastMutexLock              m_SharedIndicesLock;
+
+    /** Member variables. The image and masks are only used to identify
+     * the index, so they are not kept alive by it.
+     */
+    std::vector< unsigned long >        m_RunStarts;
+    std::vector< unsigned long >        m_RunLengths;
+    std::vector< unsigned long >        m_RunFirstInsideVoxels;
+    unsigned long                       m_NumberOfInsideVoxels;
+    RegionType                          m_Region;
+    const ImageType *                   m_Image;
+    std::vector< const MaskType * >     m_Masks;
+    TimeStamp                           m_ComputeTime;
+
+  }; // end class ImageMaskRunLengthIndex
+
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkImageMaskRunLengthIndex.txx"
+#endif
+
+#endif // end #ifndef __itkImageMaskRunLengthIndex_h
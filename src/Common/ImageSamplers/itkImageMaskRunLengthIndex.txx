@@ -0,0 +1,272 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkImageMaskRunLengthIndex_txx
+#define __itkImageMaskRunLengthIndex_txx
+
+#include "itkImageMaskRunLengthIndex.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <algorithm>
+
+namespace itk
+{
+
+  /**
+   * ******************* Constructor *******************
+   */
+
+  template< class TImage >
+    ImageMaskRunLengthIndex< TImage >
+    ::ImageMaskRunLengthIndex()
+  {
+    this->m_NumberOfInsideVoxels = 0;
+    this->m_Image = 0;
+
+  } // end Constructor
+
+
+  /**
+   * ******************* Compute *******************
+   */
+
+  template< class TImage >
+    void
+    ImageMaskRunLengthIndex< TImage >
+    ::Compute( const ImageType * image,
+      const MaskVectorType & masks, const RegionType & region )
+  {
+    this->m_RunStarts.clear();
+    this->m_RunLengths.clear();
+    this->m_RunFirstInsideVoxels.clear();
+    this->m_NumberOfInsideVoxels = 0;
+
+    const unsigned long numberOfVoxels = region.GetNumberOfPixels();
+    if ( masks.empty() )
+    {
+      /** All voxels are inside: one run. */
+      if ( numberOfVoxels > 0 )
+      {
+        this->m_RunStarts.push_back( 0 );
+        this->m_RunLengths.push_back( numberOfVoxels );
+        this->m_RunFirstInsideVoxels.push_back( 0 );
+        this->m_NumberOfInsideVoxels = numberOfVoxels;
+      }
+    }
+    else
+    {
+      /** Scan the region and collect the runs of inside voxels. */
+      typedef ImageRegionConstIteratorWithIndex< ImageType > IteratorType;
+      IteratorType iter( image, region );
+      PointType point;
+      unsigned long offset = 0;
+      bool previousInside = false;
+      for ( iter.GoToBegin(); !iter.IsAtEnd(); ++iter, ++offset )
+      {
+        image->TransformIndexToPhysicalPoint( iter.GetIndex(), point );
+        bool inside = true;
+        for ( unsigned int i = 0; i < masks.size() && inside; ++i )
+        {
+          inside = masks[ i ]->IsInside( point );
+        }
+
+        if ( inside )
+        {
+          if ( previousInside )
+          {
+            ++this->m_RunLengths.back();
+          }
+          else
+          {
+            this->m_RunStarts.push_back( offset );
+            this->m_RunLengths.push_back( 1 );
+            this->m_RunFirstInsideVoxels.push_back( this->m_NumberOfInsideVoxels );
+          }
+          ++this->m_NumberOfInsideVoxels;
+        }
+        previousInside = inside;
+      }
+    }
+
+    /** Store what this index was computed for. */
+    this->m_Region = region;
+    this->m_Image = image;
+    this->m_Masks.resize( masks.size() );
+    for ( unsigned int i = 0; i < masks.size(); ++i )
+    {
+      this->m_Masks[ i ] = masks[ i ].GetPointer();
+    }
+    this->m_ComputeTime.Modified();
+    this->Modified();
+
+  } // end Compute()
+
+
+  /**
+   * ******************* IsUpToDate *******************
+   */
+
+  template< class TImage >
+    bool
+    ImageMaskRunLengthIndex< TImage >
+    ::IsUpToDate( const ImageType * image,
+      const MaskVectorType & masks, const RegionType & region ) const
+  {
+    const unsigned long computeTime = this->m_ComputeTime.GetMTime();
+    if ( image == 0 || image != this->m_Image || region != this->m_Region
+      || masks.size() != this->m_Masks.size()
+      || computeTime <= image->GetMTime() )
+    {
+      return false;
+    }
+    for ( unsigned int i = 0; i < masks.size(); ++i )
+    {
+      if ( masks[ i ].GetPointer() != this->m_Masks[ i ]
+        || computeTime <= masks[ i ]->GetMTime() )
+      {
+        return false;
+      }
+    }
+    return true;
+
+  } // end IsUpToDate()
+
+
+  /**
+   * ******************* GetOffset *******************
+   */
+
+  template< class TImage >
+    unsigned long
+    ImageMaskRunLengthIndex< TImage >
+    ::GetOffset( const unsigned long k ) const
+  {
+    /** Find the last run that starts at or before inside voxel k. */
+    const unsigned long r = static_cast<unsigned long>(
+      std::upper_bound( this->m_RunFirstInsideVoxels.begin(),
+      this->m_RunFirstInsideVoxels.end(), k )
+      - this->m_RunFirstInsideVoxels.begin() ) - 1;
+    return this->m_RunStarts[ r ] + ( k - this->m_RunFirstInsideVoxels[ r ] );
+
+  } // end GetOffset()
+
+
+  /**
+   * ******************* ComputeIndex *******************
+   */
+
+  template< class TImage >
+    void
+    ImageMaskRunLengthIndex< TImage >
+    ::ComputeIndex( unsigned long offset, IndexType & index ) const
+  {
+    const IndexType & regionIndex = this->m_Region.GetIndex();
+    const SizeType & regionSize = this->m_Region.GetSize();
+    for ( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      index[ d ] = regionIndex[ d ] + static_cast<long>( offset % regionSize[ d ] );
+      offset /= regionSize[ d ];
+    }
+
+  } // end ComputeIndex()
+
+
+  /** The lock of the shared cache. */
+  template< class TImage >
+    SimpleFastMutexLock ImageMaskRunLengthIndex< TImage >::m_SharedIndicesLock;
+
+
+  /**
+   * ******************* GetSharedIndices *******************
+   */
+
+  template< class TImage >
+    typename ImageMaskRunLengthIndex< TImage >::IndexVectorType &
+    ImageMaskRunLengthIndex< TImage >
+    ::GetSharedIndices( void )
+  {
+    static IndexVectorType sharedIndices;
+    return sharedIndices;
+
+  } // end GetSharedIndices()
+
+
+  /**
+   * ******************* GetSharedIndex *******************
+   */
+
+  template< class TImage >
+    typename ImageMaskRunLengthIndex< TImage >::ConstPointer
+    ImageMaskRunLengthIndex< TImage >
+    ::GetSharedIndex( const ImageType * image,
+      const MaskVectorType & masks, const RegionType & region )
+  {
+    m_SharedIndicesLock.Lock();
+    IndexVectorType & sharedIndices = Self::GetSharedIndices();
+    for ( unsigned int i = 0; i < sharedIndices.size(); ++i )
+    {
+      if ( sharedIndices[ i ]->IsUpToDate( image, masks, region ) )
+      {
+        ConstPointer index = sharedIndices[ i ].GetPointer();
+        m_SharedIndicesLock.Unlock();
+        return index;
+      }
+    }
+
+    /** Not found: compute a new index. Replace the least recently
+     * computed one if the cache is full.
+     */
+    Pointer index = Self::New();
+    try
+    {
+      index->Compute( image, masks, region );
+    }
+    catch ( ... )
+    {
+      m_SharedIndicesLock.Unlock();
+      throw;
+    }
+    if ( sharedIndices.size() >= MaximumNumberOfSharedIndices )
+    {
+      sharedIndices.erase( sharedIndices.begin() );
+    }
+    sharedIndices.push_back( index );
+    m_SharedIndicesLock.Unlock();
+
+    return index.GetPointer();
+
+  } // end GetSharedIndex()
+
+
+  /**
+   * ******************* PrintSelf *******************
+   */
+
+  template< class TImage >
+    void
+    ImageMaskRunLengthIndex< TImage >
+    ::PrintSelf( std::ostream& os, Indent indent ) const
+  {
+    Superclass::PrintSelf( os, indent );
+
+    os << indent << "Region: " << this->m_Region << std::endl;
+    os << indent << "NumberOfInsideVoxels: " << this->m_NumberOfInsideVoxels << std::endl;
+    os << indent << "NumberOfRuns: " << this->m_RunStarts.size() << std::endl;
+
+  } // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkImageMaskRunLengthIndex_txx
@@ -20,6 +20,8 @@
 #include "itkBSplineInterpolateImageFunction.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -29,6 +31,18 @@ namespace itk
    *
    * This image sampler generates not only samples that correspond with
    * pixel locations, but selects points in physical space.
+   *
+   * In the multi-threaded mode (see ImageRandomSamplerBase::SetUseMultiThread)
+   * the coordinates are generated by multiple threads. If a mask is set, the
+   * run-length index of the voxels of the cropped input image region whose
+   * centre lies inside the mask is used (see
+   * ImageSamplerBase::GetMaskRunLengthIndex()). The coordinates are then drawn
+   * uniformly within the cells of those voxels, instead of by rejection
+   * sampling. This represents the mask at the resolution of the input image,
+   * which is exact when the mask is defined on the same grid as the input
+   * image. The interpolator is evaluated in the calling thread, since it
+   * is not guaranteed to be thread-safe. The multi-threaded mode is not
+   * used in combination with UseRandomSampleRegion.
 	 *
 	 * \ingroup ImageSamplers
    */
@@ -63,6 +77,7 @@ namespace itk
     typedef typename Superclass::ImageSampleType              ImageSampleType;
     typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
     typedef typename Superclass::MaskType                     MaskType;
+    typedef typename Superclass::MaskRunLengthIndexType       MaskRunLengthIndexType;
     typedef typename Superclass::InputImageSizeType           InputImageSizeType;
     typedef typename InputImageType::SpacingType              InputImageSpacingType;
     typedef typename Superclass::InputImageIndexType          InputImageIndexType;
@@ -102,6 +117,7 @@ namespace itk
   protected:
 
     typedef typename InterpolatorType::ContinuousIndexType   InputImageContinuousIndexType;
+    typedef std::vector< InputImageContinuousIndexType >     ContinuousIndexContainerType;
 
     /** The constructor. */
     ImageRandomCoordinateSampler();
@@ -136,6 +152,10 @@ namespace itk
       InputImageContinuousIndexType & smallestContIndex,
       InputImageContinuousIndexType & largestContIndex );
 
+    /** Generate the continuous indices [begin, end) of the multi-threaded mode. */
+    virtual void ThreadedGenerateSamples( unsigned long begin,
+      unsigned long end, vnl_random & randomGenerator );
+
   private:
 
     /** The private constructor. */
@@ -145,6 +165,12 @@ namespace itk
 
     bool          m_UseRandomSampleRegion;
 
+    /** Variables for the multi-threaded mode. */
+    const MaskRunLengthIndexType *    m_InsideVoxels;
+    InputImageContinuousIndexType     m_SmallestContIndex;
+    InputImageContinuousIndexType     m_LargestContIndex;
+    ContinuousIndexContainerType      m_SampleContIndices;
+
   }; // end class ImageRandomCoordinateSampler
 
 
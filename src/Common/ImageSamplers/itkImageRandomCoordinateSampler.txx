@@ -43,6 +43,8 @@ namespace itk
     this->m_UseRandomSampleRegion = false;
     this->m_SampleRegionSize.Fill( 1.0 );
 
+    this->m_InsideVoxels = 0;
+
   } // end constructor
 
 
@@ -85,6 +87,36 @@ namespace itk
     typename ImageSampleContainerType::Iterator iter;
     typename ImageSampleContainerType::ConstIterator end = sampleContainer->End();
 
+    /** Generate the coordinates with multiple threads, if requested. */
+    if ( this->UseMultiThreadedGenerateData() && !this->GetUseRandomSampleRegion() )
+    {
+      this->m_InsideVoxels = 0;
+      if ( mask.IsNotNull() )
+      {
+        this->m_InsideVoxels = this->GetMaskRunLengthIndex();
+        if ( this->m_InsideVoxels->GetNumberOfInsideVoxels() == 0 )
+        {
+          sampleContainer->Initialize();
+          itkExceptionMacro( << "Could not find any image samples inside "
+            << "the mask. Probably the mask is too small" );
+        }
+      }
+      this->m_SmallestContIndex = smallestContIndex;
+      this->m_LargestContIndex = largestContIndex;
+      this->m_SampleContIndices.resize( this->GetNumberOfSamples() );
+      this->GenerateSamplesMultiThreaded();
+
+      /** Compute the values at the generated continuous indices. */
+      unsigned long i = 0;
+      for ( iter = sampleContainer->Begin(); iter != end; ++iter, ++i )
+      {
+        (*iter).Value().m_ImageValue = static_cast<ImageSampleValueType>(
+          this->m_Interpolator->EvaluateAtContinuousIndex(
+          this->m_SampleContIndices[ i ] ) );
+      }
+      return;
+    } // end if multi-threaded
+
     InputImageContinuousIndexType sampleContIndex;
     /** Fill the sample container. */
     if ( mask.IsNull() )
@@ -164,6 +196,73 @@ namespace itk
   } // end GenerateData()
 
 
+  /**
+   * ******************* ThreadedGenerateSamples *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomCoordinateSampler< TInputImage >
+    ::ThreadedGenerateSamples( unsigned long begin,
+      unsigned long end, vnl_random & randomGenerator )
+  {
+    const InputImageType * inputImage = this->GetInput();
+    ImageSampleContainerType * sampleContainer = this->GetOutput();
+    const InputImageContinuousIndexType & smallestContIndex = this->m_SmallestContIndex;
+    const InputImageContinuousIndexType & largestContIndex = this->m_LargestContIndex;
+
+    if ( this->m_InsideVoxels == 0 )
+    {
+      /** Draw uniformly in the region, as in GenerateRandomCoordinate(). */
+      for ( unsigned long i = begin; i < end; ++i )
+      {
+        InputImageContinuousIndexType & sampleContIndex = this->m_SampleContIndices[ i ];
+        do
+        {
+          for ( unsigned int d = 0; d < InputImageDimension; ++d )
+          {
+            sampleContIndex[ d ] = static_cast<InputImagePointValueType>(
+              randomGenerator.drand64( smallestContIndex[ d ], largestContIndex[ d ] ) );
+          }
+        } while ( !this->m_Interpolator->IsInsideBuffer( sampleContIndex ) );
+
+        inputImage->TransformContinuousIndexToPhysicalPoint( sampleContIndex,
+          sampleContainer->ElementAt( i ).m_ImageCoordinates );
+      }
+      return;
+    }
+
+    /** Pick a random inside voxel, and a random position within its cell.
+     * Positions outside the region are rejected; this happens only for
+     * voxels at the border of the region, so the loop ends quickly.
+     */
+    const MaskRunLengthIndexType * insideVoxels = this->m_InsideVoxels;
+    const int lastVoxel = static_cast<int>( insideVoxels->GetNumberOfInsideVoxels() - 1 );
+    InputImageIndexType voxelIndex;
+    for ( unsigned long i = begin; i < end; ++i )
+    {
+      InputImageContinuousIndexType & sampleContIndex = this->m_SampleContIndices[ i ];
+      bool insideRegion = false;
+      while ( !insideRegion )
+      {
+        insideVoxels->GetIndex( randomGenerator.lrand32( 0, lastVoxel ), voxelIndex );
+        insideRegion = true;
+        for ( unsigned int d = 0; d < InputImageDimension; ++d )
+        {
+          sampleContIndex[ d ] = static_cast<InputImagePointValueType>(
+            static_cast<double>( voxelIndex[ d ] ) + randomGenerator.drand64( -0.5, 0.5 ) );
+          insideRegion &= sampleContIndex[ d ] >= smallestContIndex[ d ]
+            && sampleContIndex[ d ] <= largestContIndex[ d ];
+        }
+      }
+
+      inputImage->TransformContinuousIndexToPhysicalPoint( sampleContIndex,
+        sampleContainer->ElementAt( i ).m_ImageCoordinates );
+    }
+
+  } // end ThreadedGenerateSamples()
+
+
   /**
    * ******************* GenerateRandomCoordinate *******************
    */
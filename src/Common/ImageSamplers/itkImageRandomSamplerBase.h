@@ -16,6 +16,10 @@
 #define __ImageRandomSamplerBase_h
 
 #include "itkImageSamplerBase.h"
+#include "itkMultiThreader.h"
+#include "vnl/vnl_random.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -25,6 +29,14 @@ namespace itk
    * \brief This class is a base class for any image sampler that randomly picks samples.
    *
    * It adds the Set/GetNumberOfSamples function.
+   *
+   * Subclasses may also support a multi-threaded mode, see UseMultiThread.
+   * In that mode the samples are generated in blocks of SamplesPerRandomStream
+   * samples. Each block has its own random stream, whose seed is drawn
+   * from a master stream, initialised with the RandomSeed. The threads
+   * process contiguous ranges of blocks. The generated samples therefore do
+   * not depend on the number of threads, nor on the thread scheduling: for a
+   * given RandomSeed, the samples are reproducible.
 	 *
 	 * \ingroup ImageSamplers
    */
@@ -70,13 +82,41 @@ namespace itk
     /** Get the number of samples. */
     itkGetConstMacro( NumberOfSamples, unsigned long );
 
+    /** The number of samples that are generated with one random stream
+     * in the multi-threaded mode.
+     */
+    itkStaticConstMacro( SamplesPerRandomStream, unsigned long, 1024 );
+
+    /** Set/Get whether to generate the samples with multiple threads.
+     * Only used by subclasses that implement ThreadedGenerateSamples().
+     * Note that the multi-threaded mode gives different samples than the
+     * single-threaded mode. Default: false.
+     */
+    itkSetMacro( UseMultiThread, bool );
+    itkGetConstMacro( UseMultiThread, bool );
+    itkBooleanMacro( UseMultiThread );
+
+    /** Set/Get the number of threads used to generate the samples.
+     * The default is the global default number of threads of the
+     * itk::MultiThreader.
+     */
+    virtual void SetNumberOfThreads( unsigned int numberOfThreads );
+    itkGetConstMacro( NumberOfThreads, unsigned int );
+
+    /** Set the seed of the master random stream of the multi-threaded mode.
+     * This restarts the sequence of sample sets. Default: 121212.
+     */
+    virtual void SetRandomSeed( unsigned long seed );
+    itkGetConstMacro( RandomSeed, unsigned long );
+
   protected:
 
+    /** Typedefs for multi-threading. */
+    typedef MultiThreader                         ThreaderType;
+    typedef ThreaderType::ThreadInfoStruct        ThreadInfoType;
+
     /** The constructor. */
-    ImageRandomSamplerBase()
-    {
-      this->m_NumberOfSamples = 100;
-    };
+    ImageRandomSamplerBase();
 
     /** The destructor. */
     virtual ~ImageRandomSamplerBase() {};
@@ -86,8 +126,31 @@ namespace itk
     {
       Superclass::PrintSelf( os, indent );
       os << indent << "NumberOfSamples: " << this->m_NumberOfSamples << std::endl;
+      os << indent << "UseMultiThread: " << this->m_UseMultiThread << std::endl;
+      os << indent << "NumberOfThreads: " << this->m_NumberOfThreads << std::endl;
+      os << indent << "RandomSeed: " << this->m_RandomSeed << std::endl;
     };
 
+    /** Whether GenerateData() should use the multi-threaded mode. */
+    virtual bool UseMultiThreadedGenerateData( void ) const;
+
+    /** Generate this->GetNumberOfSamples() samples with multiple threads.
+     * The output container must have been resized already. This function
+     * draws the seeds of the random streams, and calls
+     * ThreadedGenerateSamples() for each block of samples.
+     */
+    virtual void GenerateSamplesMultiThreaded( void );
+
+    /** Generate the samples [begin, end) of the output container, using the
+     * given random stream. Called concurrently from several threads, for
+     * disjoint ranges, so implementations must not modify shared state.
+     */
+    virtual void ThreadedGenerateSamples( unsigned long itkNotUsed( begin ),
+      unsigned long itkNotUsed( end ), vnl_random & itkNotUsed( randomGenerator ) ) {};
+
+    /** The threader callback. */
+    static ITK_THREAD_RETURN_TYPE GenerateSamplesThreaderCallback( void * arg );
+
     unsigned long m_NumberOfSamples;
 
   private:
@@ -97,10 +160,21 @@ namespace itk
     /** The private copy constructor. */
     void operator=( const Self& );            // purposely not implemented
 
+    bool                          m_UseMultiThread;
+    unsigned int                  m_NumberOfThreads;
+    unsigned long                 m_RandomSeed;
+    ThreaderType::Pointer         m_Threader;
+    vnl_random                    m_SeedGenerator;
+    std::vector< unsigned long >  m_RandomStreamSeeds;
+
   }; // end class ImageRandomSamplerBase
 
 
 } // end namespace itk
 
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkImageRandomSamplerBase.txx"
+#endif
+
 #endif // end #ifndef __ImageRandomSamplerBase_h
 
@@ -0,0 +1,161 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __ImageRandomSamplerBase_txx
+#define __ImageRandomSamplerBase_txx
+
+#include "itkImageRandomSamplerBase.h"
+#include "vnl/vnl_math.h"
+
+namespace itk
+{
+
+  /**
+   * ******************* Constructor *******************
+   */
+
+  template< class TInputImage >
+    ImageRandomSamplerBase< TInputImage >
+    ::ImageRandomSamplerBase()
+  {
+    this->m_NumberOfSamples = 100;
+
+    this->m_UseMultiThread = false;
+    this->m_Threader = ThreaderType::New();
+    this->m_NumberOfThreads = this->m_Threader->GetNumberOfThreads();
+    this->m_RandomSeed = 121212;
+    this->m_SeedGenerator.reseed( this->m_RandomSeed );
+
+  } // end Constructor
+
+
+  /**
+   * ******************* SetNumberOfThreads *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomSamplerBase< TInputImage >
+    ::SetNumberOfThreads( unsigned int numberOfThreads )
+  {
+    /** The threader clamps the number of threads to [1, global maximum]. */
+    this->m_Threader->SetNumberOfThreads( numberOfThreads );
+    const unsigned int clampedNumberOfThreads
+      = static_cast<unsigned int>( this->m_Threader->GetNumberOfThreads() );
+    if ( this->m_NumberOfThreads != clampedNumberOfThreads )
+    {
+      this->m_NumberOfThreads = clampedNumberOfThreads;
+      this->Modified();
+    }
+
+  } // end SetNumberOfThreads()
+
+
+  /**
+   * ******************* SetRandomSeed *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomSamplerBase< TInputImage >
+    ::SetRandomSeed( unsigned long seed )
+  {
+    this->m_RandomSeed = seed;
+    this->m_SeedGenerator.reseed( seed );
+    this->Modified();
+
+  } // end SetRandomSeed()
+
+
+  /**
+   * ******************* UseMultiThreadedGenerateData *******************
+   */
+
+  template< class TInputImage >
+    bool
+    ImageRandomSamplerBase< TInputImage >
+    ::UseMultiThreadedGenerateData( void ) const
+  {
+    return this->m_UseMultiThread && this->m_NumberOfThreads > 1;
+
+  } // end UseMultiThreadedGenerateData()
+
+
+  /**
+   * ******************* GenerateSamplesMultiThreaded *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomSamplerBase< TInputImage >
+    ::GenerateSamplesMultiThreaded( void )
+  {
+    /** Draw the seeds of the random streams serially, so that they only
+     * depend on the RandomSeed and on the number of earlier sample sets.
+     */
+    const unsigned long numberOfStreams
+      = ( this->GetNumberOfSamples() + SamplesPerRandomStream - 1 )
+      / SamplesPerRandomStream;
+    this->m_RandomStreamSeeds.resize( numberOfStreams );
+    for ( unsigned long i = 0; i < numberOfStreams; ++i )
+    {
+      this->m_RandomStreamSeeds[ i ] = this->m_SeedGenerator.lrand32();
+    }
+
+    /** Launch the threads. */
+    this->m_Threader->SetNumberOfThreads( this->m_NumberOfThreads );
+    this->m_Threader->SetSingleMethod(
+      Self::GenerateSamplesThreaderCallback, this );
+    this->m_Threader->SingleMethodExecute();
+
+  } // end GenerateSamplesMultiThreaded()
+
+
+  /**
+   * ******************* GenerateSamplesThreaderCallback *******************
+   */
+
+  template< class TInputImage >
+    ITK_THREAD_RETURN_TYPE
+    ImageRandomSamplerBase< TInputImage >
+    ::GenerateSamplesThreaderCallback( void * arg )
+  {
+    ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+    const unsigned long threadID = infoStruct->ThreadID;
+    const unsigned long numberOfThreads = infoStruct->NumberOfThreads;
+    Self * sampler = static_cast< Self * >( infoStruct->UserData );
+
+    /** Each thread takes a contiguous range of random streams. */
+    const unsigned long numberOfSamples = sampler->GetNumberOfSamples();
+    const unsigned long numberOfStreams = sampler->m_RandomStreamSeeds.size();
+    const unsigned long firstStream = ( threadID * numberOfStreams ) / numberOfThreads;
+    const unsigned long lastStream = ( ( threadID + 1 ) * numberOfStreams ) / numberOfThreads;
+
+    vnl_random randomGenerator;
+    for ( unsigned long s = firstStream; s < lastStream; ++s )
+    {
+      randomGenerator.reseed( sampler->m_RandomStreamSeeds[ s ] );
+      const unsigned long begin = s * SamplesPerRandomStream;
+      const unsigned long end = vnl_math_min( numberOfSamples, begin + SamplesPerRandomStream );
+      sampler->ThreadedGenerateSamples( begin, end, randomGenerator );
+    }
+
+    return ITK_THREAD_RETURN_VALUE;
+
+  } // end GenerateSamplesThreaderCallback()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __ImageRandomSamplerBase_txx
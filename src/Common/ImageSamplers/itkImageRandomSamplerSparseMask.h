@@ -17,7 +17,6 @@
 
 #include "itkImageRandomSamplerBase.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
-#include "itkImageFullSampler.h"
 
 namespace itk
 {
@@ -28,7 +27,10 @@ namespace itk
    *
    * This version takes into account that the mask may be very small.
    * Also, it may be more efficient when very many different sample sets
-   * of the same input image are required, because it does some precomputation.
+   * of the same input image are required, because it does some precomputation:
+   * the voxels inside the mask are stored in a run-length index (see
+   * ImageSamplerBase::GetMaskRunLengthIndex()), from which the samples
+   * are picked.
 	 * \ingroup ImageSamplers
    */
 
@@ -62,6 +64,7 @@ namespace itk
     typedef typename Superclass::ImageSampleType              ImageSampleType;
     typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
     typedef typename Superclass::MaskType                     MaskType;
+    typedef typename Superclass::MaskRunLengthIndexType       MaskRunLengthIndexType;
 
     /** The input image dimension. */
     itkStaticConstMacro( InputImageDimension, unsigned int,
@@ -76,8 +79,6 @@ namespace itk
 
   protected:
 
-    typedef itk::ImageFullSampler<InputImageType>           InternalFullSamplerType;
-
     /** The constructor. */
     ImageRandomSamplerSparseMask();
     /** The destructor. */
@@ -89,8 +90,14 @@ namespace itk
     /** Function that does the work. */
     virtual void GenerateData( void );
 
+    /** Pick the samples [begin, end) in the multi-threaded mode. */
+    virtual void ThreadedGenerateSamples( unsigned long begin,
+      unsigned long end, vnl_random & randomGenerator );
+
     typename RandomGeneratorType::Pointer     m_RandomGenerator;
-    typename InternalFullSamplerType::Pointer m_InternalFullSampler;
+
+    /** The inside voxels, only set during the multi-threaded GenerateData(). */
+    const MaskRunLengthIndexType *            m_InsideVoxels;
 
   private:
 
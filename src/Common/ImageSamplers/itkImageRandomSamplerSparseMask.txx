@@ -32,7 +32,7 @@ namespace itk
     this->m_RandomGenerator = RandomGeneratorType::New();
     //this->m_RandomGenerator->Initialize();
 
-    this->m_InternalFullSampler = InternalFullSamplerType::New();
+    this->m_InsideVoxels = 0;
 
   } // end Constructor
 
@@ -53,54 +53,72 @@ namespace itk
     /** Clear the container. */
     sampleContainer->Initialize();
 
-    /** Make sure the internal full sampler is up-to-date. */
-    this->m_InternalFullSampler->SetInput( inputImage );
-    this->m_InternalFullSampler->SetMask( this->GetMask() );
-    this->m_InternalFullSampler->SetInputImageRegion( this->GetCroppedInputImageRegion() );
-
-    /** Use try/catch, since the full sampler may crash, due to insufficient
-     * memory.
+    /** Get the voxels inside the mask. The run-length index is only
+     * recomputed when the input image, the mask or the region changed,
+     * and it is shared with the other samplers of the same image.
      */
-    try
+    const MaskRunLengthIndexType * insideVoxels = this->GetMaskRunLengthIndex();
+    const unsigned long numberOfValidSamples = insideVoxels->GetNumberOfInsideVoxels();
+    if ( numberOfValidSamples == 0 )
     {
-      this->m_InternalFullSampler->Update();
+      itkExceptionMacro( << "Could not find any image samples inside the mask." );
     }
-    catch ( ExceptionObject & err )
+
+    /** Take random samples from the inside voxels, with multiple
+     * threads if requested.
+     */
+    sampleContainer->Reserve( this->GetNumberOfSamples() );
+    if ( this->UseMultiThreadedGenerateData() )
     {
-      std::string message = "ERROR: This ImageSampler internally uses the "
-        "ImageFullSampler. Updating of this internal sampler raised the "
-        "exception:\n";
-      message += err.GetDescription();
-
-      std::string fullSamplerMessage = err.GetDescription();
-      std::string::size_type loc = fullSamplerMessage.find(
-        "ERROR: failed to allocate memory for the sample container", 0 );
-      if ( loc != std::string::npos && this->GetMask() == 0 )
-      {
-        message += "\nYou are using the ImageRandomSamplerSparseMask sampler, "
-          "but you did not set a mask. The internal ImageFullSampler therefore "
-          "requires a lot of memory. Consider using the ImageRandomSampler "
-          "instead.";
-      }
-      const char * message2 = message.c_str();
-      itkExceptionMacro( << message2 );
+      this->m_InsideVoxels = insideVoxels;
+      this->GenerateSamplesMultiThreaded();
+      this->m_InsideVoxels = 0;
+      return;
     }
 
-    typename ImageSampleContainerType::Pointer allValidSamples
-      = this->m_InternalFullSampler->GetOutput();
-    unsigned long numberOfValidSamples = allValidSamples->Size();
-
-    /** Take random samples from the allValidSamples-container. */
-    for ( unsigned int i = 0; i < this->GetNumberOfSamples(); ++i )
+    InputImageIndexType index;
+    for ( unsigned long i = 0; i < this->GetNumberOfSamples(); ++i )
     {
       unsigned long randomIndex
         = this->m_RandomGenerator->GetIntegerVariate( numberOfValidSamples - 1 );
-      sampleContainer->push_back( allValidSamples->ElementAt( randomIndex ) );
+      ImageSampleType & sample = sampleContainer->ElementAt( i );
+      insideVoxels->GetIndex( randomIndex, index );
+      inputImage->TransformIndexToPhysicalPoint( index, sample.m_ImageCoordinates );
+      sample.m_ImageValue = inputImage->GetPixel( index );
     }
 
   } // end GenerateData()
 
 
+  /**
+   * ******************* ThreadedGenerateSamples *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomSamplerSparseMask< TInputImage >
+    ::ThreadedGenerateSamples( unsigned long begin,
+      unsigned long end, vnl_random & randomGenerator )
+  {
+    const InputImageType * inputImage = this->GetInput();
+    const MaskRunLengthIndexType * insideVoxels = this->m_InsideVoxels;
+    ImageSampleContainerType * sampleContainer = this->GetOutput();
+    const int lastValidSample
+      = static_cast<int>( insideVoxels->GetNumberOfInsideVoxels() - 1 );
+
+    InputImageIndexType index;
+    for ( unsigned long i = begin; i < end; ++i )
+    {
+      const unsigned long randomIndex = randomGenerator.lrand32( 0, lastValidSample );
+      ImageSampleType & sample = sampleContainer->ElementAt( i );
+      insideVoxels->GetIndex( randomIndex, index );
+      inputImage->TransformIndexToPhysicalPoint( index, sample.m_ImageCoordinates );
+      sample.m_ImageValue = inputImage->GetPixel( index );
+    }
+
+  } // end ThreadedGenerateSamples()
+
+
   /**
    * ******************* PrintSelf *******************
    */
@@ -112,7 +130,6 @@ namespace itk
   {
     Superclass::PrintSelf( os, indent );
 
-    os << indent << "InternalFullSampler: " << this->m_InternalFullSampler.GetPointer() << std::endl;
     os << indent << "RandomGenerator: " << this->m_RandomGenerator.GetPointer() << std::endl;
 
   } // end PrintSelf()
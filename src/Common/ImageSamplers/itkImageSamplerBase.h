@@ -17,6 +17,7 @@
 
 #include "itkImageToVectorContainerFilter.h"
 #include "itkImageSample.h"
+#include "itkImageMaskRunLengthIndex.h"
 #include "itkVectorDataContainer.h"
 #include "itkSpatialObject.h"
 
@@ -89,6 +90,7 @@ namespace itk
     typedef typename MaskType::ConstPointer             MaskConstPointer;
     typedef std::vector< MaskConstPointer >             MaskVectorType;
     typedef std::vector< InputImageRegionType >         InputImageRegionVectorType;
+    typedef ImageMaskRunLengthIndex< InputImageType >   MaskRunLengthIndexType;
 
     /** ******************** Masks ******************** */
 
@@ -187,6 +189,13 @@ namespace itk
     /** Compute the intersection of the InputImageRegion and the bounding box of the mask. */
     void CropInputImageRegion( void );
 
+    /** Get the run-length index of the voxels of the cropped input image
+     * region that are inside all masks. The index is shared with other
+     * samplers of the same input image, masks and region, so the region
+     * is only scanned again when one of them changes. Updates the masks.
+     */
+    virtual const MaskRunLengthIndexType * GetMaskRunLengthIndex( void );
+
   private:
 
     /** The private constructor. */
@@ -205,6 +214,8 @@ namespace itk
     InputImageRegionType              m_CroppedInputImageRegion;
     InputImageRegionType              m_DummyInputImageRegion;
 
+    typename MaskRunLengthIndexType::ConstPointer   m_MaskRunLengthIndex;
+
   }; // end class ImageSamplerBase
 
 
@@ -248,6 +248,41 @@ namespace itk
   } // end SelectNewSamplesOnUpdate()
 
 
+  /**
+   * ******************* GetMaskRunLengthIndex *******************
+   */
+
+  template< class TInputImage >
+    const typename ImageSamplerBase< TInputImage >::MaskRunLengthIndexType *
+    ImageSamplerBase< TInputImage >
+    ::GetMaskRunLengthIndex( void )
+  {
+    /** Collect the masks that are set. */
+    typename MaskRunLengthIndexType::MaskVectorType masks;
+    for ( unsigned int i = 0; i < this->m_NumberOfMasks; ++i )
+    {
+      if ( this->GetMask( i ) )
+      {
+        masks.push_back( this->GetMask( i ) );
+      }
+    }
+    this->UpdateAllMasks();
+
+    /** Reuse the current index if possible, otherwise ask the shared cache. */
+    const InputImageType * inputImage = this->GetInput();
+    const InputImageRegionType & region = this->GetCroppedInputImageRegion();
+    if ( this->m_MaskRunLengthIndex.IsNull()
+      || !this->m_MaskRunLengthIndex->IsUpToDate( inputImage, masks, region ) )
+    {
+      this->m_MaskRunLengthIndex
+        = MaskRunLengthIndexType::GetSharedIndex( inputImage, masks, region );
+    }
+
+    return this->m_MaskRunLengthIndex.GetPointer();
+
+  } // end GetMaskRunLengthIndex()
+
+
   /**
    * ******************* IsInsideAllMasks *******************
    */
@@ -280,7 +315,7 @@ namespace itk
     /** If the masks are generated by a filter, then make sure they are updated. */
     for ( unsigned int i = 0; i < this->m_NumberOfMasks; ++i )
     {
-      if ( this->GetMask( i )->GetSource() )
+      if ( this->GetMask( i ) && this->GetMask( i )->GetSource() )
       {
         this->GetMask( i )->GetSource()->Update();
       }
@@ -86,6 +86,26 @@
   #define DLL_API
 #endif
 
+//----------------------------------------------------------------------
+//  Thread local storage
+//  The searches keep their state in global variables. These are
+//  declared thread local, so that several threads can search
+//  concurrently, in the same or in different trees. The trees
+//  themselves are not changed by a search. If the compiler offers no
+//  thread local storage, ANN_HAS_THREAD_LOCAL is 0 and all searches
+//  must be done from a single thread. (Added for elastix.)
+//----------------------------------------------------------------------
+#if defined(_MSC_VER)
+  #define ANN_THREAD_LOCAL __declspec(thread)
+  #define ANN_HAS_THREAD_LOCAL 1
+#elif defined(__GNUC__) || defined(__INTEL_COMPILER) || defined(__clang__)
+  #define ANN_THREAD_LOCAL __thread
+  #define ANN_HAS_THREAD_LOCAL 1
+#else
+  #define ANN_THREAD_LOCAL
+  #define ANN_HAS_THREAD_LOCAL 0
+#endif
+
 //----------------------------------------------------------------------
 //  basic includes
 //----------------------------------------------------------------------
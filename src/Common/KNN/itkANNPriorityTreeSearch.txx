@@ -98,24 +98,27 @@ namespace itk
     ::Search( const MeasurementVectorType & qp, IndexArrayType & ind,
       DistanceArrayType & dists )
   {
-    /** Get k , dim and eps. */
+    /** Get k and eps. */
     int k       = static_cast<int>( this->m_KNearestNeighbors );
-    int dim     = static_cast<int>( this->m_DataDimension );
     double eps  = this->m_ErrorBound;
 
-    /** Allocate memory for ANN indices and distances arrays. */
-    ANNIndexArrayType ANNIndices;
-    ANNIndices = new ANNIndexType[ k ];
-
-    ANNDistanceArrayType ANNDistances;
-    ANNDistances = new ANNDistanceType[ k ];
-
-    /** Alocate memory for ANN query point and copy qp to it. */
-    ANNPointType ANNQueryPoint = annAllocPt( dim );
-    for ( int i = 0; i < dim; i++ )
+    /** Reuse the memory of ind and dists if they have the right size,
+     * so that a caller that keeps them, e.g. one pair per thread, does not
+     * allocate memory for every search.
+     */
+    if ( ind.GetSize() != static_cast<unsigned int>( k ) )
+    {
+      ind.SetSize( k );
+    }
+    if ( dists.GetSize() != static_cast<unsigned int>( k ) )
     {
-      ANNQueryPoint[ i ] = qp[ i ];
+      dists.SetSize( k );
     }
+    ANNIndexArrayType ANNIndices = ind.data_block();
+    ANNDistanceArrayType ANNDistances = dists.data_block();
+
+    /** ANN does not modify the query point, so qp is used directly. */
+    ANNPointType ANNQueryPoint = const_cast<ANNPointType>( qp.data_block() );
 
     /** The actual ANN search. */
     this->m_BinaryTreeAskDTree->annkPriSearch(
@@ -123,17 +126,6 @@ namespace itk
     //this->m_BinaryTree->GetANNTree()->annkPriSearch(
       //ANNQueryPoint, k, ANNIndices, ANNDistances, eps );
 
-    /** Set the ANNIndices and ANNDistances in the corresponding itk::Array's.
-     * Memory management is transfered to these itk::Array's, which have SmartPointers
-     * and therefore don't have to be regarded anymore. No deallocation of
-     * ANNIndices and ANNDistances is needed now.
-     */
-    ind.SetData( ANNIndices, k, true );
-    dists.SetData( ANNDistances, k, true );
-
-    /** Deallocate the temporary ANNQueryPoint. */
-    annDeallocPt( ANNQueryPoint );
-
   } // end Search
 
 
@@ -71,9 +71,27 @@ namespace Statistics
     /** Macro to get the internal data container. */
     itkGetConstMacro( InternalContainer, InternalDataContainerType );
 
-    /** Function to resize the data container. */
+    /** Function to resize the data container. The memory is reused when
+     * the size and the measurement vector size did not change.
+     */
     void Resize( unsigned long n );
 
+    /** Function to let the data container refer to an externally owned buffer,
+     * instead of allocating memory. Point i starts at buffer + i * stride, so
+     * with a stride larger than the measurement vector size the list sample
+     * is a view on part of the features of another contiguous buffer.
+     * The buffer is not copied nor deallocated, and must remain valid until
+     * the next call to Resize() or SetExternalBuffer().
+     */
+    void SetExternalBuffer( InternalDataType buffer,
+      unsigned long n, unsigned long stride );
+
+    /** Function to get the contiguous memory of the data container. */
+    InternalDataType GetBufferPointer( void ) const;
+
+    /** Macro to check if the data container refers to an external buffer. */
+    itkGetConstMacro( UseExternalBuffer, bool );
+
     /** Function to set the actual (not the allocated) size of the data container. */
     void SetActualSize( unsigned long n );
 
@@ -134,6 +152,8 @@ namespace Statistics
     InternalDataContainerType   m_InternalContainer;
     InstanceIdentifier          m_InternalContainerSize;
     InstanceIdentifier          m_ActualSize;
+    MeasurementVectorSizeType   m_InternalContainerDimension;
+    bool                        m_UseExternalBuffer;
 
     /** Dummy needed for GetMeasurementVector(). */
     mutable MeasurementVectorType m_TemporaryMeasurementVector;
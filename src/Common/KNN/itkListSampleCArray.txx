@@ -32,6 +32,8 @@ ListSampleCArray< TMeasurementVector, TInternalValue >
   this->m_InternalContainer = 0;
   this->m_InternalContainerSize = 0;
   this->m_ActualSize = 0;
+  this->m_InternalContainerDimension = 0;
+  this->m_UseExternalBuffer = false;
 } // end Constructor
 
 
@@ -143,6 +145,16 @@ ListSampleCArray< TMeasurementVector, TInternalValue >
    * this function. So the m_ActualSize is zero.
    */
   this->m_ActualSize = 0;
+  unsigned int dim = this->GetMeasurementVectorSize();
+
+  /** Reuse the own memory if the layout does not change. */
+  if ( this->m_InternalContainer && !this->m_UseExternalBuffer
+    && this->m_InternalContainerSize == size
+    && this->m_InternalContainerDimension == dim )
+  {
+    return;
+  }
+
   if ( this->m_InternalContainer )
   {
     this->DeallocateInternalContainer();
@@ -151,15 +163,79 @@ ListSampleCArray< TMeasurementVector, TInternalValue >
   }
   if ( size > 0 )
   {
-    unsigned int dim = this->GetMeasurementVectorSize();
     this->AllocateInternalContainer( size, dim );
     this->m_InternalContainerSize = size;
+    this->m_InternalContainerDimension = dim;
     this->Modified();
   }
 
 } // end Resize()
 
 
+/**
+ * ************************ SetExternalBuffer *************************
+ */
+
+template< class TMeasurementVector, class TInternalValue >
+void
+ListSampleCArray< TMeasurementVector, TInternalValue >
+::SetExternalBuffer( InternalDataType buffer,
+  unsigned long size, unsigned long stride )
+{
+  unsigned int dim = this->GetMeasurementVectorSize();
+  if ( stride < dim )
+  {
+    itkExceptionMacro( << "The stride (" << stride
+      << ") is smaller than the measurement vector size (" << dim << ")." );
+  }
+
+  /** The external buffer contains the data, so the actual size is
+   * left to the user, as after Resize().
+   */
+  this->m_ActualSize = 0;
+
+  /** Only the array of pointers to the points is owned. It is reused
+   * if it already has the right size.
+   */
+  if ( !this->m_UseExternalBuffer || this->m_InternalContainerSize != size )
+  {
+    this->DeallocateInternalContainer();
+    this->m_InternalContainerSize = 0;
+    if ( size > 0 )
+    {
+      this->m_InternalContainer = new InternalDataType[ size ];
+      this->m_InternalContainerSize = size;
+      this->m_UseExternalBuffer = true;
+    }
+  }
+  for ( unsigned long i = 0; i < size; i++ )
+  {
+    this->m_InternalContainer[ i ] = buffer + i * stride;
+  }
+  this->m_InternalContainerDimension = dim;
+  this->Modified();
+
+} // end SetExternalBuffer()
+
+
+/**
+ * ************************ GetBufferPointer *************************
+ */
+
+template< class TMeasurementVector, class TInternalValue >
+typename ListSampleCArray< TMeasurementVector, TInternalValue >::InternalDataType
+ListSampleCArray< TMeasurementVector, TInternalValue >
+::GetBufferPointer( void ) const
+{
+  if ( this->m_InternalContainer )
+  {
+    return this->m_InternalContainer[ 0 ];
+  }
+  return 0;
+
+} // end GetBufferPointer()
+
+
 /**
  * ************************ SetActualSize *************************
  */
@@ -232,10 +308,16 @@ ListSampleCArray< TMeasurementVector, TInternalValue >
 {
   if ( this->m_InternalContainer )
   {
-    delete [] this->m_InternalContainer[0];
+    /** An external buffer is owned by someone else. */
+    if ( !this->m_UseExternalBuffer )
+    {
+      delete [] this->m_InternalContainer[0];
+    }
     delete [] this->m_InternalContainer;
     this->m_InternalContainer = NULL;
   }
+  this->m_UseExternalBuffer = false;
+  this->m_InternalContainerDimension = 0;
 } // end DeallocateInternalContainer()
 
 
@@ -272,6 +354,8 @@ ListSampleCArray< TMeasurementVector, TInternalValue >
 
   os << indent << "Internal Data Container: "
     << &m_InternalContainer << std::endl;
+  os << indent << "UseExternalBuffer: "
+    << this->m_UseExternalBuffer << std::endl;
 
 } // end PrintSelf()
 
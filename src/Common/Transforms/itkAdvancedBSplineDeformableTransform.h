@@ -250,6 +250,27 @@ public:
     JacobianType & j,
     NonZeroJacobianIndicesType & ) const;
 
+  /** Transform a batch of points. The validity of the coefficients and
+   * the pointers into the coefficient images are set up once for all
+   * points. The coefficients of a support region are gathered once for
+   * consecutive points with the same support region, so batches of points
+   * that lie in the same cell of the B-spline grid should be passed together.
+   * The results are identical to those of TransformPoint().
+   */
+  virtual void TransformPoints(
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints,
+    const unsigned long numberOfPoints ) const;
+
+  /** Compute the sparse Jacobians of a batch of points. The results are
+   * identical to those of the sparse GetJacobian().
+   */
+  virtual void GetJacobians(
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const unsigned long numberOfPoints ) const;
+
   /** Compute the spatial Jacobian of the transformation. */
   virtual void GetSpatialJacobian(
     const InputPointType & ipp,
@@ -309,6 +330,23 @@ protected:
     NonZeroJacobianIndicesType & nonZeroJacobianIndices,
     const RegionType & supportRegion ) const;
 
+  /** Compute the offsets in the coefficient buffer of the support region
+   * points, relative to the first point of the support region.
+   * Called when the grid region changes.
+   */
+  void UpdateSupportRegionOffsets( void );
+
+  /** Compute the offset in the coefficient buffer of the first point of
+   * the support region that starts at supportIndex.
+   */
+  unsigned long ComputeSupportRegionStartOffset(
+    const IndexType & supportIndex ) const;
+
+  /** The relative offsets of the support region points; the first
+   * dimension runs fastest, like the weights.
+   */
+  std::vector< unsigned long >                            m_SupportRegionOffsets;
+
   typedef typename Superclass::JacobianImageType JacobianImageType;
   typedef typename Superclass::JacobianPixelType JacobianPixelType;
 
@@ -162,6 +162,8 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>
   this->m_HasNonZeroSpatialHessian = true;
   this->m_HasNonZeroJacobianOfSpatialHessian = true;
 
+  this->UpdateSupportRegionOffsets();
+
 } // end Constructor
 
 
@@ -222,6 +224,7 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>
     this->m_ValidRegion.SetIndex( index );
 
     this->UpdateGridOffsetTable();
+    this->UpdateSupportRegionOffsets();
 
     //
     // If we are using the default parameters, update their size and set to identity.
@@ -287,41 +290,39 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>
   this->m_WeightsFunction->ComputeStartIndex( cindex, supportIndex );
   this->m_WeightsFunction->Evaluate( cindex, supportIndex, weights );
 
-  // For each dimension, correlate coefficient with weights
-  RegionType supportRegion;
-  supportRegion.SetSize( this->m_SupportSize );
-  supportRegion.SetIndex( supportIndex );
-
   outputPoint.Fill( NumericTraits<ScalarType>::Zero );
 
-  /** Create iterators over the coefficient images. */
-  typedef ImageRegionConstIterator<ImageType> IteratorType;
-  IteratorType iterator[ SpaceDimension ];
-  unsigned long counter = 0;
-  const PixelType * basePointer
-    = this->m_CoefficientImage[ 0 ]->GetBufferPointer();
-
+  /** Get pointers to the first coefficient of the support region. */
+  const unsigned long startOffset
+    = this->ComputeSupportRegionStartOffset( supportIndex );
+  const PixelType * coefficientPointers[ SpaceDimension ];
   for ( unsigned int j = 0; j < SpaceDimension; j++ )
   {
-    iterator[ j ] = IteratorType( this->m_CoefficientImage[ j ], supportRegion );
+    coefficientPointers[ j ]
+      = this->m_CoefficientImage[ j ]->GetBufferPointer() + startOffset;
   }
 
-  /** Loop over the support region. */
-  while ( !iterator[ 0 ].IsAtEnd() )
+  /** Loop over the support region, using the precomputed offsets instead
+   * of image iterators. The order of summation is that of the weights.
+   */
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  const unsigned long * supportOffsets = &( this->m_SupportRegionOffsets[ 0 ] );
+  const double * weightsPointer = weights.data_block();
+  for ( unsigned long counter = 0; counter < numberOfWeights; ++counter )
   {
+    const unsigned long offset = supportOffsets[ counter ];
+
     // populate the indices array
-    indices[ counter ] = &(iterator[ 0 ].Value()) - basePointer;
+    indices[ counter ] = startOffset + offset;
 
     // multiply weigth with coefficient to compute displacement
     for ( unsigned int j = 0; j < SpaceDimension; j++ )
     {
        outputPoint[ j ] += static_cast<ScalarType>(
-         weights[ counter ] * iterator[ j ].Value() );
-       ++iterator[ j ];
+         weightsPointer[ counter ] * coefficientPointers[ j ][ offset ] );
     }
-    ++ counter;
 
-  } // end while
+  } // end for
 
   // The output point is the start point + displacement.
   for ( unsigned int j = 0; j < SpaceDimension; j++ )
@@ -463,11 +464,6 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
 ::GetJacobian( const InputPointType & point, WeightsType& weights,
   ParameterIndexArrayType & indexes ) const
 {
-
-  RegionType supportRegion;
-  supportRegion.SetSize( this->m_SupportSize );
-  const PixelType * basePointer = this->m_CoefficientImage[0]->GetBufferPointer();
-
   ContinuousIndexType cindex;
 
   this->TransformPointToContinuousGridIndex( point, cindex );
@@ -487,21 +483,13 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
   this->m_WeightsFunction->ComputeStartIndex( cindex, supportIndex );
   this->m_WeightsFunction->Evaluate( cindex, supportIndex, weights );
 
-  // For each dimension, copy the weight to the support region
-  supportRegion.SetIndex( supportIndex );
-  unsigned long counter = 0;
-
-  typedef ImageRegionIterator<JacobianImageType> IteratorType;
-
-  IteratorType iterator = IteratorType( this->m_CoefficientImage[0], supportRegion );
-
-  while ( ! iterator.IsAtEnd() )
+  // Compute the parameter indices of the support region
+  const unsigned long startOffset
+    = this->ComputeSupportRegionStartOffset( supportIndex );
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  for ( unsigned long counter = 0; counter < numberOfWeights; ++counter )
   {
-    indexes[counter] = &(iterator.Value()) - basePointer;
-
-    // go to next coefficient in the support region
-    ++ counter;
-    ++iterator;
+    indexes[ counter ] = startOffset + this->m_SupportRegionOffsets[ counter ];
   }
 
 }
@@ -595,14 +583,17 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
   supportRegion.SetSize( this->m_SupportSize );
   supportRegion.SetIndex( supportIndex );
 
-  /** Put at the right positions */
-  unsigned int counter = 0;
+  /** Put at the right positions: row d gets the weights in
+   * columns [ d * numberOfWeights, (d+1) * numberOfWeights ).
+   */
+  const double * weightsPointer = weights.data_block();
   for ( unsigned int d = 0; d < SpaceDimension; ++d )
   {
+    typename JacobianType::element_type * jacobianRow
+      = jacobian[ d ] + d * numberOfWeights;
     for ( unsigned int mu = 0; mu < numberOfWeights; ++mu )
     {
-      jacobian( d, counter ) = weights[ mu ];
-      ++counter;
+      jacobianRow[ mu ] = weightsPointer[ mu ];
     }
   }
 
@@ -612,6 +603,204 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
 } // end GetJacobian()
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints,
+  const unsigned long numberOfPoints ) const
+{
+  /** Check if the coefficient image has been set. */
+  if ( !this->m_CoefficientImage[ 0 ] )
+  {
+    itkWarningMacro( << "B-spline coefficients have not been set" );
+    for ( unsigned long i = 0; i < numberOfPoints; ++i )
+    {
+      for ( unsigned int j = 0; j < SpaceDimension; j++ )
+      {
+        outputPoints[ i ][ j ] = inputPoints[ i ][ j ];
+      }
+    }
+    return;
+  }
+
+  /** Set up everything that does not depend on the point. */
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray[ numberOfWeights ];
+  WeightsType weights( weightsArray, numberOfWeights, false );
+  const double * weightsPointer = weights.data_block();
+  const unsigned long * supportOffsets = &( this->m_SupportRegionOffsets[ 0 ] );
+  const PixelType * coefficientBuffers[ SpaceDimension ];
+  for ( unsigned int j = 0; j < SpaceDimension; j++ )
+  {
+    coefficientBuffers[ j ] = this->m_CoefficientImage[ j ]->GetBufferPointer();
+  }
+
+  /** The coefficients of the current support region, per dimension. */
+  PixelType supportCoefficients[ SpaceDimension * numberOfWeights ];
+  IndexType gatheredSupportIndex;
+  bool coefficientsGathered = false;
+
+  ContinuousIndexType cindex;
+  IndexType supportIndex;
+  for ( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    /** Copy the input point, since the output may overwrite it. */
+    const InputPointType point = inputPoints[ i ];
+    OutputPointType & outputPoint = outputPoints[ i ];
+
+    // NOTE: if the support region does not lie totally within the grid
+    // we assume zero displacement and return the input point
+    this->TransformPointToContinuousGridIndex( point, cindex );
+    if ( !this->InsideValidRegion( cindex ) )
+    {
+      for ( unsigned int j = 0; j < SpaceDimension; j++ )
+      {
+        outputPoint[ j ] = point[ j ];
+      }
+      continue;
+    }
+
+    /** Compute the interpolation weights. */
+    this->m_WeightsFunction->ComputeStartIndex( cindex, supportIndex );
+    this->m_WeightsFunction->Evaluate( cindex, supportIndex, weights );
+
+    /** Gather the coefficients, unless the previous point had the same
+     * support region.
+     */
+    if ( !coefficientsGathered || supportIndex != gatheredSupportIndex )
+    {
+      const unsigned long startOffset
+        = this->ComputeSupportRegionStartOffset( supportIndex );
+      for ( unsigned int j = 0; j < SpaceDimension; j++ )
+      {
+        PixelType * coefficients = supportCoefficients + j * numberOfWeights;
+        for ( unsigned long counter = 0; counter < numberOfWeights; ++counter )
+        {
+          coefficients[ counter ]
+            = coefficientBuffers[ j ][ startOffset + supportOffsets[ counter ] ];
+        }
+      }
+      gatheredSupportIndex = supportIndex;
+      coefficientsGathered = true;
+    }
+
+    /** Accumulate the displacement in the same order as TransformPoint(). */
+    outputPoint.Fill( NumericTraits<ScalarType>::Zero );
+    for ( unsigned int j = 0; j < SpaceDimension; j++ )
+    {
+      const PixelType * coefficients = supportCoefficients + j * numberOfWeights;
+      for ( unsigned long counter = 0; counter < numberOfWeights; ++counter )
+      {
+        outputPoint[ j ] += static_cast<ScalarType>(
+          weightsPointer[ counter ] * coefficients[ counter ] );
+      }
+    }
+
+    // The output point is the start point + displacement.
+    for ( unsigned int j = 0; j < SpaceDimension; j++ )
+    {
+      outputPoint[ j ] += point[ j ];
+    }
+  } // end for all points
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* GetJacobians ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::GetJacobians(
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const unsigned long numberOfPoints ) const
+{
+  // Can only compute Jacobian if parameters are set via
+  // SetParameters or SetParametersByValue
+  if ( this->m_InputParametersPointer == NULL )
+  {
+    itkExceptionMacro( << "Cannot compute Jacobian: parameters not set" );
+  }
+
+  /** Set up everything that does not depend on the point. */
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  const unsigned long nnzji = numberOfWeights * SpaceDimension;
+  const unsigned long parametersPerDim
+    = this->GetNumberOfParametersPerDimension();
+  const unsigned long * supportOffsets = &( this->m_SupportRegionOffsets[ 0 ] );
+  typename WeightsType::ValueType weightsArray[ numberOfWeights ];
+  WeightsType weights( weightsArray, numberOfWeights, false );
+  const double * weightsPointer = weights.data_block();
+
+  ContinuousIndexType cindex;
+  IndexType supportIndex;
+  for ( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    JacobianType & jacobian = jacobians[ i ];
+    NonZeroJacobianIndicesType & nzji = nonZeroJacobianIndices[ i ];
+    if ( ( jacobian.cols() != nnzji ) || ( jacobian.rows() != SpaceDimension ) )
+    {
+      jacobian.SetSize( SpaceDimension, nnzji );
+    }
+    jacobian.Fill( 0.0 );
+    nzji.resize( nnzji );
+
+    // NOTE: if the support region does not lie totally within the grid
+    // we assume zero displacement and zero Jacobian
+    this->TransformPointToContinuousGridIndex( inputPoints[ i ], cindex );
+    if ( !this->InsideValidRegion( cindex ) )
+    {
+      /** Return some dummy */
+      for ( unsigned long mu = 0; mu < nnzji; ++mu )
+      {
+        nzji[ mu ] = mu;
+      }
+      continue;
+    }
+
+    /** Compute the weights. */
+    this->m_WeightsFunction->ComputeStartIndex( cindex, supportIndex );
+    this->m_WeightsFunction->Evaluate( cindex, supportIndex, weights );
+
+    /** Put at the right positions: row d gets the weights in
+     * columns [ d * numberOfWeights, (d+1) * numberOfWeights ).
+     */
+    for ( unsigned int d = 0; d < SpaceDimension; ++d )
+    {
+      typename JacobianType::element_type * jacobianRow
+        = jacobian[ d ] + d * numberOfWeights;
+      for ( unsigned long mu = 0; mu < numberOfWeights; ++mu )
+      {
+        jacobianRow[ mu ] = weightsPointer[ mu ];
+      }
+    }
+
+    /** Compute the nonzero Jacobian indices. */
+    const unsigned long startOffset
+      = this->ComputeSupportRegionStartOffset( supportIndex );
+    for ( unsigned long mu = 0; mu < numberOfWeights; ++mu )
+    {
+      const unsigned long parameterNumber = startOffset + supportOffsets[ mu ];
+      for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+      {
+        nzji[ mu + dim * numberOfWeights ] = parameterNumber + dim * parametersPerDim;
+      }
+    }
+  } // end for all points
+
+} // end GetJacobians()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -1124,9 +1313,10 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
    * d/dmu of d^2T / dx_i dx_j
    * Make use of the fact that the Hessian is symmetrical, so do not compute
    * both i,j and j,i for i != j.
+   * Keep the weights on the stack, so that no memory is allocated per point.
    */
   const unsigned int d = SpaceDimension * ( SpaceDimension + 1 ) / 2;
-  FixedArray<WeightsType, d> weightVector;
+  double weightVector[ d * numberOfWeights ];
   unsigned int count = 0;
   for ( unsigned int i = 0; i < SpaceDimension; ++i )
   {
@@ -1136,7 +1326,8 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
       this->m_SODerivativeWeightsFunctions[ i ][ j ]->Evaluate( cindex, supportIndex, weights );
 
       /** Remember the weights. */
-      weightVector[ count ] = weights;
+      memcpy( weightVector + count * numberOfWeights,
+        weights.data_block(), numberOfWeights * sizeof( double ) );
       ++count;
 
     } // end for j
@@ -1152,7 +1343,7 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
     {
       for ( unsigned int j = 0; j <= i; ++j )
       {
-        double tmp = weightVector[ count ][ mu ];
+        double tmp = *( weightVector + count * numberOfWeights + mu );
         matrix[ i ][ j ] = tmp;
         if ( i != j ) matrix[ j ][ i ] = tmp;
         ++count;
@@ -1382,24 +1573,20 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
 {
   nonZeroJacobianIndices.resize( this->GetNumberOfNonZeroJacobianIndices() );
 
-  /** Create an iterator over the coefficient image. */
-  ImageRegionConstIterator< ImageType >
-    it( this->m_CoefficientImage[ 0 ], supportRegion );
-
   /** Initialize some helper variables. */
   const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
   const unsigned long parametersPerDim
     = this->GetNumberOfParametersPerDimension();
-  unsigned long mu = 0;
+  const unsigned long startOffset
+    = this->ComputeSupportRegionStartOffset( supportRegion.GetIndex() );
 
   /** For all control points in the support region, set which of the
    * indices in the parameter array are non-zero.
    */
-  const PixelType * basePointer = this->m_CoefficientImage[0]->GetBufferPointer();
-
-  while ( !it.IsAtEnd() )
+  for ( unsigned long mu = 0; mu < numberOfWeights; ++mu )
   {
-    unsigned long parameterNumber = &(it.Value()) - basePointer;
+    const unsigned long parameterNumber
+      = startOffset + this->m_SupportRegionOffsets[ mu ];
 
     /** Update the nonZeroJacobianIndices for all directions. */
     for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
@@ -1407,14 +1594,74 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
       nonZeroJacobianIndices[ mu + dim * numberOfWeights ]
         = parameterNumber + dim * parametersPerDim;
     }
+  }
 
-    /** Increase the iterators. */
-    ++it;
-    ++mu;
+} // end ComputeNonZeroJacobianIndices()
 
-  } // end while
 
-} // end ComputeNonZeroJacobianIndices()
+/**
+ * ********************* UpdateSupportRegionOffsets ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::UpdateSupportRegionOffsets( void )
+{
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  this->m_SupportRegionOffsets.resize( numberOfWeights );
+
+  /** Walk through the support region with the first dimension running
+   * fastest, and store the buffer offset of each point.
+   */
+  IndexType position;
+  position.Fill( 0 );
+  for ( unsigned long mu = 0; mu < numberOfWeights; ++mu )
+  {
+    unsigned long offset = 0;
+    for ( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      offset += static_cast<unsigned long>(
+        position[ j ] * this->m_GridOffsetTable[ j ] );
+    }
+    this->m_SupportRegionOffsets[ mu ] = offset;
+
+    /** Go to the next point of the support region. */
+    for ( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      ++position[ j ];
+      if ( position[ j ] < static_cast<typename IndexType::IndexValueType>(
+        this->m_SupportSize[ j ] ) )
+      {
+        break;
+      }
+      position[ j ] = 0;
+    }
+  }
+
+} // end UpdateSupportRegionOffsets()
+
+
+/**
+ * ******************* ComputeSupportRegionStartOffset ***********************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+unsigned long
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::ComputeSupportRegionStartOffset( const IndexType & supportIndex ) const
+{
+  const IndexType & gridIndex = this->m_GridRegion.GetIndex();
+  unsigned long offset = 0;
+  for ( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    offset += static_cast<unsigned long>(
+      ( supportIndex[ j ] - gridIndex[ j ] ) * this->m_GridOffsetTable[ j ] );
+  }
+
+  return offset;
+
+} // end ComputeSupportRegionStartOffset()
 
 // Print self
 template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
@@ -242,6 +242,12 @@ public:
   /** Return the region of the grid wholly within the support region */
   itkGetConstReferenceMacro( ValidRegion, RegionType );
 
+  /** Return whether the spline order is odd. The support region of a point
+   * changes where its continuous grid index is an integer for odd orders,
+   * and halfway between two integers for even orders.
+   */
+  itkGetConstMacro( SplineOrderOdd, bool );
+
   /** Indicates that this transform is linear. That is, given two
    * points P and Q, and scalar coefficients a and b, then
    *
@@ -89,6 +89,7 @@ public:
   typedef typename Superclass::SpatialHessianType             SpatialHessianType;
   typedef typename Superclass::JacobianOfSpatialHessianType   JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType             InternalMatrixType;
+  typedef typename Superclass::JacobianWorkspaceType          JacobianWorkspaceType;
 
   /** Typedefs for the InitialTransform. */
   typedef Superclass                                      InitialTransformType;
@@ -213,6 +214,43 @@ public:
     JacobianOfSpatialHessianType & jsh,
     NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
 
+  /** Compute the Jacobian of the spatial Hessian of the transformation,
+   * using the workspace for the intermediate results of the composition.
+   */
+  virtual void GetJacobianOfSpatialHessian(
+    const InputPointType & ipp,
+    JacobianOfSpatialHessianType & jsh,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    JacobianWorkspaceType & workspace ) const;
+
+  /** Compute both the spatial Hessian and the Jacobian of the
+   * spatial Hessian of the transformation, using the workspace for
+   * the intermediate results of the composition.
+   */
+  virtual void GetJacobianOfSpatialHessian(
+    const InputPointType & ipp,
+    SpatialHessianType & sh,
+    JacobianOfSpatialHessianType & jsh,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    JacobianWorkspaceType & workspace ) const;
+
+  /** Transform a batch of points. For composition, the initial and the
+   * current transform are each applied to the whole batch.
+   */
+  virtual void TransformPoints(
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints,
+    const unsigned long numberOfPoints ) const;
+
+  /** Compute the sparse Jacobians of a batch of points, using the batch
+   * interface of the current transform.
+   */
+  virtual void GetJacobians(
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const unsigned long numberOfPoints ) const;
+
   /** Typedefs for function pointers. */
   typedef OutputPointType (Self::*TransformPointFunctionPointer)( const InputPointType & ) const;
   typedef const JacobianType & (Self::*GetJacobianFunctionPointer)( const InputPointType & ) const;
@@ -238,12 +276,23 @@ public:
   typedef void (Self::*GetJacobianOfSpatialHessianFunctionPointer)(
     const InputPointType &,
     JacobianOfSpatialHessianType &,
-    NonZeroJacobianIndicesType & ) const;
+    NonZeroJacobianIndicesType &,
+    JacobianWorkspaceType & ) const;
   typedef void (Self::*GetJacobianOfSpatialHessianFunctionPointer2)(
     const InputPointType &,
     SpatialHessianType &,
     JacobianOfSpatialHessianType &,
-    NonZeroJacobianIndicesType & ) const;
+    NonZeroJacobianIndicesType &,
+    JacobianWorkspaceType & ) const;
+  typedef void (Self::*TransformPointsFunctionPointer)(
+    const InputPointType *,
+    OutputPointType *,
+    const unsigned long ) const;
+  typedef void (Self::*GetJacobiansFunctionPointer)(
+    const InputPointType *,
+    JacobianType *,
+    NonZeroJacobianIndicesType *,
+    const unsigned long ) const;
 
 protected:
 
@@ -289,6 +338,8 @@ protected:
   GetJacobianOfSpatialJacobianFunctionPointer2  m_SelectedGetJacobianOfSpatialJacobianFunction2;
   GetJacobianOfSpatialHessianFunctionPointer    m_SelectedGetJacobianOfSpatialHessianFunction;
   GetJacobianOfSpatialHessianFunctionPointer2   m_SelectedGetJacobianOfSpatialHessianFunction2;
+  TransformPointsFunctionPointer                m_SelectedTransformPointsFunction;
+  GetJacobiansFunctionPointer                   m_SelectedGetJacobiansFunction;
 
   /** ************************************************
    * Methods to transform a point.
@@ -312,6 +363,36 @@ protected:
   inline OutputPointType TransformPointNoCurrentTransform(
     const InputPointType & point ) const;
 
+  /** ************************************************
+   * Methods to transform a batch of points.
+   */
+
+  /** ADDITION: \f$T(x) = T_0(x) + T_1(x) - x\f$ */
+  inline void TransformPointsUseAddition(
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints,
+    const unsigned long numberOfPoints ) const;
+
+  /** COMPOSITION: \f$T(x) = T_1( T_0(x) )\f$
+   * \warning: assumes that input and output point type are the same.
+   */
+  inline void TransformPointsUseComposition(
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints,
+    const unsigned long numberOfPoints ) const;
+
+  /** CURRENT ONLY: \f$T(x) = T_1(x)\f$ */
+  inline void TransformPointsNoInitialTransform(
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints,
+    const unsigned long numberOfPoints ) const;
+
+  /** NO CURRENT TRANSFORM SET: throw an exception. */
+  inline void TransformPointsNoCurrentTransform(
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints,
+    const unsigned long numberOfPoints ) const;
+
   /** ************************************************
    * Methods to compute the Jacobian.
    */
@@ -364,6 +445,40 @@ protected:
     JacobianType &,
     NonZeroJacobianIndicesType & ) const;
 
+  /** ************************************************
+   * Methods to compute the sparse Jacobians of a batch of points.
+   */
+
+  /** ADDITION: \f$J(x) = J_1(x)\f$ */
+  inline void GetJacobiansUseAddition(
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const unsigned long numberOfPoints ) const;
+
+  /** COMPOSITION: \f$J(x) = J_1( T_0(x) )\f$
+   * \warning: assumes that input and output point type are the same.
+   */
+  inline void GetJacobiansUseComposition(
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const unsigned long numberOfPoints ) const;
+
+  /** CURRENT ONLY: \f$J(x) = J_1(x)\f$ */
+  inline void GetJacobiansNoInitialTransform(
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const unsigned long numberOfPoints ) const;
+
+  /** NO CURRENT TRANSFORM SET: throw an exception. */
+  inline void GetJacobiansNoCurrentTransform(
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const unsigned long numberOfPoints ) const;
+
   /** ************************************************
    * Methods to compute the spatial Jacobian.
    */
@@ -478,51 +593,62 @@ protected:
   inline void GetJacobianOfSpatialHessianUseAddition(
     const InputPointType & ipp,
     JacobianOfSpatialHessianType & jsh,
-    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    JacobianWorkspaceType & workspace ) const;
 
   inline void GetJacobianOfSpatialHessianUseAddition(
     const InputPointType & ipp,
     SpatialHessianType & sh,
     JacobianOfSpatialHessianType & jsh,
-    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    JacobianWorkspaceType & workspace ) const;
 
   /** COMPOSITION: \f$J(x) = J_1( T_0(x) )\f$
+   * The Jacobian of the spatial Jacobian of the current transform, needed
+   * when the initial transform has a nonzero spatial Hessian, is stored
+   * in the workspace.
    * \warning: assumes that input and output point type are the same.
    */
   inline void GetJacobianOfSpatialHessianUseComposition(
     const InputPointType & ipp,
     JacobianOfSpatialHessianType & jsh,
-    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    JacobianWorkspaceType & workspace ) const;
 
   virtual inline void GetJacobianOfSpatialHessianUseComposition(
     const InputPointType & ipp,
     SpatialHessianType & sh,
     JacobianOfSpatialHessianType & jsh,
-    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    JacobianWorkspaceType & workspace ) const;
 
   /** CURRENT ONLY: \f$J(x) = J_1(x)\f$ */
   inline void GetJacobianOfSpatialHessianNoInitialTransform(
     const InputPointType & ipp,
     JacobianOfSpatialHessianType & jsh,
-    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    JacobianWorkspaceType & workspace ) const;
 
   inline void GetJacobianOfSpatialHessianNoInitialTransform(
     const InputPointType & ipp,
     SpatialHessianType & sh,
     JacobianOfSpatialHessianType & jsh,
-    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    JacobianWorkspaceType & workspace ) const;
 
   /** NO CURRENT TRANSFORM SET: throw an exception. */
   inline void GetJacobianOfSpatialHessianNoCurrentTransform(
     const InputPointType & ipp,
     JacobianOfSpatialHessianType & jsh,
-    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    JacobianWorkspaceType & workspace ) const;
 
   inline void GetJacobianOfSpatialHessianNoCurrentTransform(
     const InputPointType & ipp,
     SpatialHessianType & sh,
     JacobianOfSpatialHessianType & jsh,
-    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    JacobianWorkspaceType & workspace ) const;
 
   /** How to combine the transformations. */
   bool m_UseAddition;
@@ -16,6 +16,7 @@
 #define __itkAdvancedCombinationTransform_hxx
 
 #include "itkAdvancedCombinationTransform.h"
+#include "vnl/vnl_math.h"
 
 
 namespace itk
@@ -56,6 +57,10 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
     = &Self::GetJacobianOfSpatialHessianNoCurrentTransform;
   this->m_SelectedGetJacobianOfSpatialHessianFunction2
     = &Self::GetJacobianOfSpatialHessianNoCurrentTransform;
+  this->m_SelectedTransformPointsFunction
+    = &Self::TransformPointsNoCurrentTransform;
+  this->m_SelectedGetJacobiansFunction
+    = &Self::GetJacobiansNoCurrentTransform;
 
 } // end Constructor
 
@@ -535,6 +540,10 @@ void AdvancedCombinationTransform<TScalarType, NDimensions>
       = &Self::GetJacobianOfSpatialHessianNoCurrentTransform;
     this->m_SelectedGetJacobianOfSpatialHessianFunction2
       = &Self::GetJacobianOfSpatialHessianNoCurrentTransform;
+    this->m_SelectedTransformPointsFunction
+      = &Self::TransformPointsNoCurrentTransform;
+    this->m_SelectedGetJacobiansFunction
+      = &Self::GetJacobiansNoCurrentTransform;
   }
   else if ( this->m_InitialTransform.IsNull() )
   {
@@ -556,6 +565,10 @@ void AdvancedCombinationTransform<TScalarType, NDimensions>
       = &Self::GetJacobianOfSpatialHessianNoInitialTransform;
     this->m_SelectedGetJacobianOfSpatialHessianFunction2
       = &Self::GetJacobianOfSpatialHessianNoInitialTransform;
+    this->m_SelectedTransformPointsFunction
+      = &Self::TransformPointsNoInitialTransform;
+    this->m_SelectedGetJacobiansFunction
+      = &Self::GetJacobiansNoInitialTransform;
   }
   else if ( this->m_UseAddition )
   {
@@ -577,6 +590,10 @@ void AdvancedCombinationTransform<TScalarType, NDimensions>
       = &Self::GetJacobianOfSpatialHessianUseAddition;
     this->m_SelectedGetJacobianOfSpatialHessianFunction2
       = &Self::GetJacobianOfSpatialHessianUseAddition;
+    this->m_SelectedTransformPointsFunction
+      = &Self::TransformPointsUseAddition;
+    this->m_SelectedGetJacobiansFunction
+      = &Self::GetJacobiansUseAddition;
   }
   else
   {
@@ -598,6 +615,10 @@ void AdvancedCombinationTransform<TScalarType, NDimensions>
       = &Self::GetJacobianOfSpatialHessianUseComposition;
     this->m_SelectedGetJacobianOfSpatialHessianFunction2
       = &Self::GetJacobianOfSpatialHessianUseComposition;
+    this->m_SelectedTransformPointsFunction
+      = &Self::TransformPointsUseComposition;
+    this->m_SelectedGetJacobiansFunction
+      = &Self::GetJacobiansUseComposition;
   }
 
 } // end UpdateCombinationMethod()
@@ -620,8 +641,8 @@ void AdvancedCombinationTransform<TScalarType, NDimensions>
  *
  * ***********************************************************
  * ***** Functions that implement the:
- * ***** - TransformPoint()
- * ***** - GetJacobian()
+ * ***** - TransformPoint(), TransformPoints()
+ * ***** - GetJacobian(), GetJacobians()
  * ***** - GetSpatialJacobian()
  * ***** - GetSpatialHessian()
  * ***** - GetJacobianOfSpatialJacobian()
@@ -844,6 +865,170 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
 } // end GetJacobianNoCurrentTransform()
 
 
+/**
+ * ************* TransformPointsUseAddition **********************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::TransformPointsUseAddition(
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints,
+  const unsigned long numberOfPoints ) const
+{
+  for ( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    outputPoints[ i ] = this->TransformPointUseAddition( inputPoints[ i ] );
+  }
+
+} // end TransformPointsUseAddition()
+
+
+/**
+ * **************** TransformPointsUseComposition *************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::TransformPointsUseComposition(
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints,
+  const unsigned long numberOfPoints ) const
+{
+  /** The intermediate points are stored in the output array. */
+  this->m_InitialTransform->TransformPoints(
+    inputPoints, outputPoints, numberOfPoints );
+  this->m_CurrentTransform->TransformPoints(
+    outputPoints, outputPoints, numberOfPoints );
+
+} // end TransformPointsUseComposition()
+
+
+/**
+ * **************** TransformPointsNoInitialTransform ******************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::TransformPointsNoInitialTransform(
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints,
+  const unsigned long numberOfPoints ) const
+{
+  this->m_CurrentTransform->TransformPoints(
+    inputPoints, outputPoints, numberOfPoints );
+
+} // end TransformPointsNoInitialTransform()
+
+
+/**
+ * ******** TransformPointsNoCurrentTransform ******************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::TransformPointsNoCurrentTransform(
+  const InputPointType * itkNotUsed( inputPoints ),
+  OutputPointType * itkNotUsed( outputPoints ),
+  const unsigned long itkNotUsed( numberOfPoints ) ) const
+{
+  /** Throw an exception. */
+  this->NoCurrentTransformSet();
+
+} // end TransformPointsNoCurrentTransform()
+
+
+/**
+ * ************* GetJacobiansUseAddition ***************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::GetJacobiansUseAddition(
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const unsigned long numberOfPoints ) const
+{
+  this->m_CurrentTransform->GetJacobians(
+    inputPoints, jacobians, nonZeroJacobianIndices, numberOfPoints );
+
+} // end GetJacobiansUseAddition()
+
+
+/**
+ * **************** GetJacobiansUseComposition *************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::GetJacobiansUseComposition(
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const unsigned long numberOfPoints ) const
+{
+  /** The points are mapped by the initial transform in chunks,
+   * so that no heap memory is needed for the intermediate points.
+   */
+  const unsigned long chunkSize = 64;
+  InputPointType transformedPoints[ chunkSize ];
+  for ( unsigned long first = 0; first < numberOfPoints; first += chunkSize )
+  {
+    const unsigned long n = vnl_math_min( chunkSize, numberOfPoints - first );
+    this->m_InitialTransform->TransformPoints(
+      inputPoints + first, transformedPoints, n );
+    this->m_CurrentTransform->GetJacobians( transformedPoints,
+      jacobians + first, nonZeroJacobianIndices + first, n );
+  }
+
+} // end GetJacobiansUseComposition()
+
+
+/**
+ * **************** GetJacobiansNoInitialTransform ******************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::GetJacobiansNoInitialTransform(
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const unsigned long numberOfPoints ) const
+{
+  this->m_CurrentTransform->GetJacobians(
+    inputPoints, jacobians, nonZeroJacobianIndices, numberOfPoints );
+
+} // end GetJacobiansNoInitialTransform()
+
+
+/**
+ * ******** GetJacobiansNoCurrentTransform ******************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::GetJacobiansNoCurrentTransform(
+  const InputPointType * itkNotUsed( inputPoints ),
+  JacobianType * itkNotUsed( jacobians ),
+  NonZeroJacobianIndicesType * itkNotUsed( nonZeroJacobianIndices ),
+  const unsigned long itkNotUsed( numberOfPoints ) ) const
+{
+  /** Throw an exception. */
+  this->NoCurrentTransformSet();
+
+} // end GetJacobiansNoCurrentTransform()
+
+
 /**
  * ************* GetSpatialJacobianUseAddition ***************************
  */
@@ -1068,17 +1253,19 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
   JacobianOfSpatialJacobianType & jsj,
   NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
 {
+  /** The Jacobian of the spatial Jacobian of the current transform is
+   * computed directly in jsj and post-multiplied in place, which avoids
+   * a temporary container.
+   */
   SpatialJacobianType sj0;
-  JacobianOfSpatialJacobianType jsj1;
   this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
   this->m_CurrentTransform->GetJacobianOfSpatialJacobian(
     this->m_InitialTransform->TransformPoint( ipp ),
-    jsj1, nonZeroJacobianIndices );
+    jsj, nonZeroJacobianIndices );
 
-  jsj.resize( nonZeroJacobianIndices.size() );
   for ( unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu )
   {
-    jsj[ mu ] = jsj1[ mu ] * sj0;
+    jsj[ mu ] = jsj[ mu ] * sj0;
   }
 
 } // end GetJacobianOfSpatialJacobianUseComposition()
@@ -1097,18 +1284,17 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
   JacobianOfSpatialJacobianType & jsj,
   NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
 {
+  /** See above: jsj is post-multiplied in place. */
   SpatialJacobianType sj0, sj1;
-  JacobianOfSpatialJacobianType jsj1;
   this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
   this->m_CurrentTransform->GetJacobianOfSpatialJacobian(
     this->m_InitialTransform->TransformPoint( ipp ),
-    sj1, jsj1, nonZeroJacobianIndices );
+    sj1, jsj, nonZeroJacobianIndices );
 
   sj = sj1 * sj0;
-  jsj.resize( nonZeroJacobianIndices.size() );
   for ( unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu )
   {
-    jsj[ mu ] = jsj1[ mu ] * sj0;
+    jsj[ mu ] = jsj[ mu ] * sj0;
   }
 
 } // end GetJacobianOfSpatialJacobianUseComposition()
@@ -1198,10 +1384,11 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
 ::GetJacobianOfSpatialHessianUseAddition(
   const InputPointType & ipp,
   JacobianOfSpatialHessianType & jsh,
-  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+  JacobianWorkspaceType & workspace ) const
 {
   this->m_CurrentTransform->GetJacobianOfSpatialHessian(
-    ipp, jsh, nonZeroJacobianIndices );
+    ipp, jsh, nonZeroJacobianIndices, workspace );
 
 } // end GetJacobianOfSpatialHessianUseAddition()
 
@@ -1217,10 +1404,11 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
   const InputPointType & ipp,
   SpatialHessianType & sh,
   JacobianOfSpatialHessianType & jsh,
-  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+  JacobianWorkspaceType & workspace ) const
 {
   this->m_CurrentTransform->GetJacobianOfSpatialHessian(
-    ipp, sh, jsh, nonZeroJacobianIndices );
+    ipp, sh, jsh, nonZeroJacobianIndices, workspace );
 
 } // end GetJacobianOfSpatialHessianUseAddition()
 
@@ -1235,13 +1423,12 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
 ::GetJacobianOfSpatialHessianUseComposition(
   const InputPointType & ipp,
   JacobianOfSpatialHessianType & jsh,
-  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+  JacobianWorkspaceType & workspace ) const
 {
   /** Create intermediary variables for the internal transforms. */
   SpatialJacobianType sj0;
   SpatialHessianType sh0;
-  JacobianOfSpatialJacobianType jsj1;
-  JacobianOfSpatialHessianType jsh1;
 
   /** Transform the input point. */
   // \todo: this has already been computed and it is expensive.
@@ -1249,33 +1436,37 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
     = this->m_InitialTransform->TransformPoint( ipp );
 
   /** Compute the (Jacobian of the) spatial Jacobian / Hessian of the
-   * internal transforms. */
+   * internal transforms. The Jacobian of the spatial Hessian of the current
+   * transform is computed directly in jsh, and combined in place below.
+   * The workspace is passed on, and is only used by this function after
+   * the call returned, so nested combination transforms can share it.
+   */
   this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
-  this->m_InitialTransform->GetSpatialHessian( ipp, sh0 );
-
-  /** Assume/demand that GetJacobianOfSpatialJacobian returns
-   * the same nonZeroJacobianIndices as the GetJacobianOfSpatialHessian. */
-  this->m_CurrentTransform->GetJacobianOfSpatialJacobian(
-    transformedPoint, jsj1, nonZeroJacobianIndices );
   this->m_CurrentTransform->GetJacobianOfSpatialHessian(
-    transformedPoint, jsh1, nonZeroJacobianIndices );
+    transformedPoint, jsh, nonZeroJacobianIndices, workspace );
 
   typename SpatialJacobianType::InternalMatrixType sj0tvnl = sj0.GetTranspose();
   SpatialJacobianType sj0t( sj0tvnl );
 
-  jsh.resize( nonZeroJacobianIndices.size() );
-
   /** Combine them in one overall Jacobian of spatial Hessian. */
   for ( unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu )
   {
     for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
     {
-      jsh[mu][dim] = sj0t * ( jsh1[mu][dim] * sj0 );
+      jsh[mu][dim] = sj0t * ( jsh[mu][dim] * sj0 );
     }
   }
 
   if ( this->m_InitialTransform->GetHasNonZeroSpatialHessian() )
   {
+    /** Assume/demand that GetJacobianOfSpatialJacobian returns
+     * the same nonZeroJacobianIndices as the GetJacobianOfSpatialHessian.
+     */
+    JacobianOfSpatialJacobianType & jsj1 = workspace.m_JacobianOfSpatialJacobian;
+    this->m_InitialTransform->GetSpatialHessian( ipp, sh0 );
+    this->m_CurrentTransform->GetJacobianOfSpatialJacobian(
+      transformedPoint, jsj1, nonZeroJacobianIndices );
+
     for ( unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu )
     {
       for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
@@ -1302,13 +1493,12 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
   const InputPointType & ipp,
   SpatialHessianType & sh,
   JacobianOfSpatialHessianType & jsh,
-  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+  JacobianWorkspaceType & workspace ) const
 {
   /** Create intermediary variables for the internal transforms. */
   SpatialJacobianType sj0, sj1;
   SpatialHessianType sh0, sh1;
-  JacobianOfSpatialJacobianType jsj1;
-  JacobianOfSpatialHessianType jsh1;
 
   /** Transform the input point. */
   // \todo this has already been computed and it is expensive.
@@ -1316,34 +1506,40 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
     = this->m_InitialTransform->TransformPoint( ipp );
 
   /** Compute the (Jacobian of the) spatial Jacobian / Hessian of the
-   * internal transforms.
+   * internal transforms. See above for the use of jsh and the workspace.
    */
   this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
-  this->m_InitialTransform->GetSpatialHessian( ipp, sh0 );
-
-  /** Assume/demand that GetJacobianOfSpatialJacobian returns the same
-   * nonZeroJacobianIndices as the GetJacobianOfSpatialHessian.
-   */
-  this->m_CurrentTransform->GetJacobianOfSpatialJacobian(
-    transformedPoint, sj1, jsj1, nonZeroJacobianIndices );
   this->m_CurrentTransform->GetJacobianOfSpatialHessian(
-    transformedPoint, sh1, jsh1, nonZeroJacobianIndices );
+    transformedPoint, sh1, jsh, nonZeroJacobianIndices, workspace );
 
   typename SpatialJacobianType::InternalMatrixType sj0tvnl = sj0.GetTranspose();
   SpatialJacobianType sj0t( sj0tvnl );
-  jsh.resize( nonZeroJacobianIndices.size() );
 
   /** Combine them in one overall Jacobian of spatial Hessian. */
   for ( unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu )
   {
     for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
     {
-      jsh[mu][dim] = sj0t * ( jsh1[mu][dim] * sj0 );
+      jsh[mu][dim] = sj0t * ( jsh[mu][dim] * sj0 );
     }
   }
 
+  /** Combine them in one overall spatial Hessian. */
+  for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+  {
+    sh[dim] = sj0t * ( sh1[dim] * sj0 );
+  }
+
   if ( this->m_InitialTransform->GetHasNonZeroSpatialHessian() )
   {
+    /** Assume/demand that GetJacobianOfSpatialJacobian returns the same
+     * nonZeroJacobianIndices as the GetJacobianOfSpatialHessian.
+     */
+    JacobianOfSpatialJacobianType & jsj1 = workspace.m_JacobianOfSpatialJacobian;
+    this->m_InitialTransform->GetSpatialHessian( ipp, sh0 );
+    this->m_CurrentTransform->GetJacobianOfSpatialJacobian(
+      transformedPoint, sj1, jsj1, nonZeroJacobianIndices );
+
     for ( unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu )
     {
       for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
@@ -1354,16 +1550,7 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
         }
       }
     }
-  }
 
-  /** Combine them in one overall spatial Hessian. */
-  for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
-  {
-    sh[dim] = sj0t * ( sh1[dim] * sj0 );
-  }
-
-  if ( this->m_InitialTransform->GetHasNonZeroSpatialHessian() )
-  {
     for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
     {
       for ( unsigned int p = 0; p < SpaceDimension; ++p )
@@ -1386,10 +1573,11 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
 ::GetJacobianOfSpatialHessianNoInitialTransform(
   const InputPointType & ipp,
   JacobianOfSpatialHessianType & jsh,
-  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+  JacobianWorkspaceType & workspace ) const
 {
   this->m_CurrentTransform->GetJacobianOfSpatialHessian(
-    ipp, jsh, nonZeroJacobianIndices );
+    ipp, jsh, nonZeroJacobianIndices, workspace );
 
 } // end GetJacobianOfSpatialHessianNoInitialTransform()
 
@@ -1405,10 +1593,11 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
   const InputPointType & ipp,
   SpatialHessianType & sh,
   JacobianOfSpatialHessianType & jsh,
-  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+  JacobianWorkspaceType & workspace ) const
 {
   this->m_CurrentTransform->GetJacobianOfSpatialHessian(
-    ipp, sh, jsh, nonZeroJacobianIndices );
+    ipp, sh, jsh, nonZeroJacobianIndices, workspace );
 
 } // end GetJacobianOfSpatialHessianNoInitialTransform()
 
@@ -1423,7 +1612,8 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
 ::GetJacobianOfSpatialHessianNoCurrentTransform(
   const InputPointType & itkNotUsed( ipp ),
   JacobianOfSpatialHessianType & itkNotUsed( jsh ),
-  NonZeroJacobianIndicesType & itkNotUsed( nonZeroJacobianIndices ) ) const
+  NonZeroJacobianIndicesType & itkNotUsed( nonZeroJacobianIndices ),
+  JacobianWorkspaceType & itkNotUsed( workspace ) ) const
 {
   /** Throw an exception. */
   this->NoCurrentTransformSet();
@@ -1442,7 +1632,8 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
   const InputPointType & itkNotUsed( ipp ),
   SpatialHessianType & itkNotUsed( sh ),
   JacobianOfSpatialHessianType & itkNotUsed( jsh ),
-  NonZeroJacobianIndicesType & itkNotUsed( nonZeroJacobianIndices ) ) const
+  NonZeroJacobianIndicesType & itkNotUsed( nonZeroJacobianIndices ),
+  JacobianWorkspaceType & itkNotUsed( workspace ) ) const
 {
   /** Throw an exception. */
   this->NoCurrentTransformSet();
@@ -1509,6 +1700,45 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
 } // end GetJacobian()
 
 
+/**
+ * ****************** TransformPoints ****************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints,
+  const unsigned long numberOfPoints ) const
+{
+  /** Call the selected TransformPointsFunction. */
+  ((*this).*m_SelectedTransformPointsFunction)(
+    inputPoints, outputPoints, numberOfPoints );
+
+} // end TransformPoints()
+
+
+/**
+ * ****************** GetJacobians ****************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::GetJacobians(
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const unsigned long numberOfPoints ) const
+{
+  /** Call the selected GetJacobians. */
+  ((*this).*m_SelectedGetJacobiansFunction)(
+    inputPoints, jacobians, nonZeroJacobianIndices, numberOfPoints );
+
+} // end GetJacobians()
+
+
 /**
  * ****************** GetSpatialJacobian ****************************
  */
@@ -1596,9 +1826,10 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
   JacobianOfSpatialHessianType & jsh,
   NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
 {
-  /** Call the selected GetJacobian. */
+  /** Call the selected GetJacobian, with a temporary workspace. */
+  JacobianWorkspaceType workspace;
   return ((*this).*m_SelectedGetJacobianOfSpatialHessianFunction)(
-    ipp, jsh, nonZeroJacobianIndices );
+    ipp, jsh, nonZeroJacobianIndices, workspace );
 
 } // end GetJacobianOfSpatialHessian()
 
@@ -1615,10 +1846,52 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
   SpatialHessianType & sh,
   JacobianOfSpatialHessianType & jsh,
   NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** Call the selected GetJacobian, with a temporary workspace. */
+  JacobianWorkspaceType workspace;
+  return ((*this).*m_SelectedGetJacobianOfSpatialHessianFunction2)(
+    ipp, sh, jsh, nonZeroJacobianIndices, workspace );
+
+} // end GetJacobianOfSpatialHessian()
+
+
+/**
+ * ****************** GetJacobianOfSpatialHessian ****************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::GetJacobianOfSpatialHessian(
+  const InputPointType & ipp,
+  JacobianOfSpatialHessianType & jsh,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+  JacobianWorkspaceType & workspace ) const
+{
+  /** Call the selected GetJacobian. */
+  return ((*this).*m_SelectedGetJacobianOfSpatialHessianFunction)(
+    ipp, jsh, nonZeroJacobianIndices, workspace );
+
+} // end GetJacobianOfSpatialHessian()
+
+
+/**
+ * ****************** GetJacobianOfSpatialHessian ****************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::GetJacobianOfSpatialHessian(
+  const InputPointType & ipp,
+  SpatialHessianType & sh,
+  JacobianOfSpatialHessianType & jsh,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+  JacobianWorkspaceType & workspace ) const
 {
   /** Call the selected GetJacobian. */
   return ((*this).*m_SelectedGetJacobianOfSpatialHessianFunction2)(
-    ipp, sh, jsh, nonZeroJacobianIndices );
+    ipp, sh, jsh, nonZeroJacobianIndices, workspace );
 
 } // end GetJacobianOfSpatialHessian()
 
@@ -0,0 +1,153 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkAdvancedCombinationTransformFlattener_h
+#define __itkAdvancedCombinationTransformFlattener_h
+
+#include "itkObject.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * \class AdvancedCombinationTransformFlattener
+ * \brief This class replaces the linear parts of a chain of
+ * AdvancedCombinationTransforms by single matrix transforms.
+ *
+ * A transform that was loaded with initial transforms, e.g.
+ * Euler -> Affine -> B-spline, is a nested chain of combination
+ * transforms, and every TransformPoint() walks the whole chain. This class
+ * computes an equivalent transform with fewer levels:
+ * \li A linear transform is replaced by an AdvancedMatrixOffsetTransformBase
+ * with the same matrix and offset.
+ * \li A combination transform with a nonlinear current transform gets a
+ * flattened copy of its initial transform.
+ *
+ * The matrix and offset of a linear transform are obtained by transforming
+ * the origin and the unit vectors, so any transform that reports
+ * IsLinear() can be flattened. Subclasses of AdvancedCombinationTransform
+ * that override TransformPoint() are not flattened correctly; use
+ * ComputeMaximumDifference() to check the result.
+ *
+ * The input transform is not modified; the flattened transform shares
+ * the nonlinear current transforms with it.
+ *
+ * \ingroup Transforms
+ */
+
+template < class TScalarType, unsigned int NDimensions >
+class ITK_EXPORT AdvancedCombinationTransformFlattener
+  : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef AdvancedCombinationTransformFlattener   Self;
+  typedef Object                                  Superclass;
+  typedef SmartPointer< Self >                    Pointer;
+  typedef SmartPointer< const Self >              ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( AdvancedCombinationTransformFlattener, Object );
+
+  /** Dimension of the domain space. */
+  itkStaticConstMacro( Dimension, unsigned int, NDimensions );
+
+  /** Typedef's. */
+  typedef AdvancedTransform< TScalarType,
+    NDimensions, NDimensions >                    TransformType;
+  typedef typename TransformType::ConstPointer    TransformConstPointer;
+  typedef typename TransformType::InputPointType  InputPointType;
+  typedef typename TransformType::OutputPointType OutputPointType;
+  typedef AdvancedCombinationTransform<
+    TScalarType, NDimensions >                    CombinationTransformType;
+  typedef AdvancedMatrixOffsetTransformBase<
+    TScalarType, NDimensions, NDimensions >       LinearTransformType;
+  typedef typename LinearTransformType::Pointer   LinearTransformPointer;
+  typedef typename LinearTransformType::MatrixType  MatrixType;
+  typedef typename LinearTransformType::OffsetType  OffsetType;
+  typedef std::vector< InputPointType >           PointListType;
+
+  /** Set/Get the transform to flatten. */
+  itkSetConstObjectMacro( Transform, TransformType );
+  itkGetConstObjectMacro( Transform, TransformType );
+
+  /** Compute the flattened transform. */
+  virtual void Compute( void );
+
+  /** Get the flattened transform. This is the input transform itself if
+   * nothing could be flattened.
+   */
+  itkGetConstObjectMacro( FlattenedTransform, TransformType );
+
+  /** Get the number of transforms that were merged into matrix transforms. */
+  itkGetConstMacro( NumberOfMergedTransforms, unsigned int );
+
+  /** Get whether the flattened transform is a single matrix transform. */
+  itkGetConstMacro( FlattenedTransformIsLinear, bool );
+
+  /** Compute the maximum distance between the points transformed by the
+   * input transform and by the flattened transform.
+   */
+  virtual double ComputeMaximumDifference( const PointListType & points ) const;
+
+  /** Compute the matrix transform that is equal to a linear transform. */
+  static LinearTransformPointer ComputeLinearTransform(
+    const TransformType * transform );
+
+protected:
+
+  /** The constructor. */
+  AdvancedCombinationTransformFlattener();
+
+  /** The destructor. */
+  virtual ~AdvancedCombinationTransformFlattener() {};
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+  /** Flatten a transform recursively. */
+  virtual TransformConstPointer FlattenTransform( const TransformType * transform );
+
+  /** Count the number of transforms in a chain. */
+  static unsigned int CountTransforms( const TransformType * transform );
+
+private:
+
+  AdvancedCombinationTransformFlattener( const Self& ); // purposely not implemented
+  void operator=( const Self& );                        // purposely not implemented
+
+  /** Member variables. */
+  TransformConstPointer   m_Transform;
+  TransformConstPointer   m_FlattenedTransform;
+  unsigned int            m_NumberOfMergedTransforms;
+  bool                    m_FlattenedTransformIsLinear;
+
+}; // end class AdvancedCombinationTransformFlattener
+
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkAdvancedCombinationTransformFlattener.txx"
+#endif
+
+#endif // end #ifndef __itkAdvancedCombinationTransformFlattener_h
@@ -0,0 +1,236 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkAdvancedCombinationTransformFlattener_txx
+#define __itkAdvancedCombinationTransformFlattener_txx
+
+#include "itkAdvancedCombinationTransformFlattener.h"
+#include "vnl/vnl_math.h"
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+template < class TScalarType, unsigned int NDimensions >
+AdvancedCombinationTransformFlattener< TScalarType, NDimensions >
+::AdvancedCombinationTransformFlattener()
+{
+  this->m_Transform = 0;
+  this->m_FlattenedTransform = 0;
+  this->m_NumberOfMergedTransforms = 0;
+  this->m_FlattenedTransformIsLinear = false;
+
+} // end Constructor
+
+
+/**
+ * ********************* Compute ****************************
+ */
+
+template < class TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransformFlattener< TScalarType, NDimensions >
+::Compute( void )
+{
+  if ( this->m_Transform.IsNull() )
+  {
+    itkExceptionMacro( << "ERROR: No transform is set." );
+  }
+
+  this->m_NumberOfMergedTransforms = 0;
+  this->m_FlattenedTransform = this->FlattenTransform( this->m_Transform );
+  this->m_FlattenedTransformIsLinear = dynamic_cast<const LinearTransformType *>(
+    this->m_FlattenedTransform.GetPointer() ) != 0;
+
+} // end Compute()
+
+
+/**
+ * ********************* FlattenTransform ****************************
+ */
+
+template < class TScalarType, unsigned int NDimensions >
+typename AdvancedCombinationTransformFlattener< TScalarType, NDimensions >
+::TransformConstPointer
+AdvancedCombinationTransformFlattener< TScalarType, NDimensions >
+::FlattenTransform( const TransformType * transform )
+{
+  /** A linear chain becomes a single matrix transform. */
+  if ( transform->IsLinear() )
+  {
+    this->m_NumberOfMergedTransforms += Self::CountTransforms( transform );
+    TransformConstPointer linear = Self::ComputeLinearTransform( transform ).GetPointer();
+    return linear;
+  }
+
+  /** Otherwise only the initial transform of a combination can be flattened. */
+  const CombinationTransformType * combination
+    = dynamic_cast<const CombinationTransformType *>( transform );
+  if ( combination == 0 || combination->GetInitialTransform() == 0 )
+  {
+    return transform;
+  }
+  typename CombinationTransformType::CurrentTransformType * current
+    = const_cast<CombinationTransformType *>( combination )->GetCurrentTransform();
+  if ( current == 0 )
+  {
+    return transform;
+  }
+
+  TransformConstPointer initial
+    = this->FlattenTransform( combination->GetInitialTransform() );
+  if ( initial.GetPointer() == combination->GetInitialTransform() )
+  {
+    return transform;
+  }
+
+  /** Combine the flattened initial transform with the current transform
+   * in the same way as the original.
+   */
+  typename CombinationTransformType::Pointer flattened
+    = CombinationTransformType::New();
+  flattened->SetCurrentTransform( current );
+  flattened->SetInitialTransform( initial );
+  flattened->SetUseComposition( combination->GetUseComposition() );
+
+  TransformConstPointer result = flattened.GetPointer();
+  return result;
+
+} // end FlattenTransform()
+
+
+/**
+ * ********************* ComputeLinearTransform ****************************
+ */
+
+template < class TScalarType, unsigned int NDimensions >
+typename AdvancedCombinationTransformFlattener< TScalarType, NDimensions >
+::LinearTransformPointer
+AdvancedCombinationTransformFlattener< TScalarType, NDimensions >
+::ComputeLinearTransform( const TransformType * transform )
+{
+  /** T(x) = A x + b, so b = T(0) and column j of A is T(e_j) - T(0). */
+  InputPointType point;
+  point.Fill( NumericTraits<TScalarType>::Zero );
+  const OutputPointType origin = transform->TransformPoint( point );
+
+  MatrixType matrix;
+  OffsetType offset;
+  for ( unsigned int j = 0; j < NDimensions; ++j )
+  {
+    point.Fill( NumericTraits<TScalarType>::Zero );
+    point[ j ] = NumericTraits<TScalarType>::One;
+    const OutputPointType column = transform->TransformPoint( point );
+    for ( unsigned int i = 0; i < NDimensions; ++i )
+    {
+      matrix[ i ][ j ] = column[ i ] - origin[ i ];
+    }
+    offset[ j ] = origin[ j ];
+  }
+
+  LinearTransformPointer linear = LinearTransformType::New();
+  linear->SetMatrix( matrix );
+  linear->SetOffset( offset );
+  return linear;
+
+} // end ComputeLinearTransform()
+
+
+/**
+ * ********************* CountTransforms ****************************
+ */
+
+template < class TScalarType, unsigned int NDimensions >
+unsigned int
+AdvancedCombinationTransformFlattener< TScalarType, NDimensions >
+::CountTransforms( const TransformType * transform )
+{
+  const CombinationTransformType * combination
+    = dynamic_cast<const CombinationTransformType *>( transform );
+  if ( combination == 0 )
+  {
+    return 1;
+  }
+
+  unsigned int count = 0;
+  if ( combination->GetInitialTransform() != 0 )
+  {
+    count += Self::CountTransforms( combination->GetInitialTransform() );
+  }
+  const TransformType * current
+    = const_cast<CombinationTransformType *>( combination )->GetCurrentTransform();
+  if ( current != 0 )
+  {
+    count += Self::CountTransforms( current );
+  }
+  return count;
+
+} // end CountTransforms()
+
+
+/**
+ * ********************* ComputeMaximumDifference ****************************
+ */
+
+template < class TScalarType, unsigned int NDimensions >
+double
+AdvancedCombinationTransformFlattener< TScalarType, NDimensions >
+::ComputeMaximumDifference( const PointListType & points ) const
+{
+  if ( this->m_Transform.IsNull() || this->m_FlattenedTransform.IsNull() )
+  {
+    itkExceptionMacro( << "ERROR: The flattened transform is not computed." );
+  }
+
+  double maximumDifference = 0.0;
+  for ( unsigned int k = 0; k < points.size(); ++k )
+  {
+    const OutputPointType p = this->m_Transform->TransformPoint( points[ k ] );
+    const OutputPointType q = this->m_FlattenedTransform->TransformPoint( points[ k ] );
+    maximumDifference = vnl_math_max( maximumDifference,
+      static_cast<double>( p.EuclideanDistanceTo( q ) ) );
+  }
+  return maximumDifference;
+
+} // end ComputeMaximumDifference()
+
+
+/**
+ * ********************* PrintSelf ****************************
+ */
+
+template < class TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransformFlattener< TScalarType, NDimensions >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << indent << "FlattenedTransform: "
+    << this->m_FlattenedTransform.GetPointer() << std::endl;
+  os << indent << "NumberOfMergedTransforms: "
+    << this->m_NumberOfMergedTransforms << std::endl;
+  os << indent << "FlattenedTransformIsLinear: "
+    << ( this->m_FlattenedTransformIsLinear ? "true" : "false" ) << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkAdvancedCombinationTransformFlattener_txx
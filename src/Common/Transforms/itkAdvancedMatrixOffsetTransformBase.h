@@ -331,6 +331,14 @@ public:
   OutputCovariantVectorType TransformCovariantVector(
     const InputCovariantVectorType & vector ) const;
 
+  /** Transform a batch of points, without a virtual call per point.
+   * The input and output arrays may be the same.
+   */
+  virtual void TransformPoints(
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints,
+    const unsigned long numberOfPoints ) const;
+
   /** Create inverse of an affine transformation
     *
     * This populates the parameters an affine transform such that
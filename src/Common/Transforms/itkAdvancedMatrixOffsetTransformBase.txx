@@ -261,6 +261,26 @@ AdvancedMatrixOffsetTransformBase<TScalarType, NInputDimensions, NOutputDimensio
 }
 
 
+// Transform a batch of points
+template<class TScalarType, unsigned int NInputDimensions,
+                            unsigned int NOutputDimensions>
+void
+AdvancedMatrixOffsetTransformBase<TScalarType, NInputDimensions, NOutputDimensions>
+::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints,
+  const unsigned long numberOfPoints ) const
+{
+  /** The right-hand side is evaluated into a temporary,
+   * so the input may be overwritten.
+   */
+  for ( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    outputPoints[ i ] = this->m_Matrix * inputPoints[ i ] + this->m_Offset;
+  }
+}
+
+
 // Transform a vector
 template<class TScalarType, unsigned int NInputDimensions,
                             unsigned int NOutputDimensions>
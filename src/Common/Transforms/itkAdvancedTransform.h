@@ -132,6 +132,19 @@ public:
   typedef std::vector< SpatialHessianType >         JacobianOfSpatialHessianType;
   typedef typename SpatialJacobianType::InternalMatrixType  InternalMatrixType;
 
+  /** Scratch space for intermediate results of the Jacobian functions.
+   * Transforms that combine other transforms, like the
+   * AdvancedCombinationTransform, need temporary containers to compute
+   * the Jacobian of the spatial Hessian. By passing a workspace that lives
+   * outside the loop over the samples, these containers are only allocated
+   * once instead of once per sample. A workspace should not be shared
+   * between threads.
+   */
+  struct JacobianWorkspaceType
+  {
+    JacobianOfSpatialJacobianType   m_JacobianOfSpatialJacobian;
+  };
+
   /** Get the number of nonzero Jacobian indices. By default all. */
   virtual unsigned long GetNumberOfNonZeroJacobianIndices( void ) const;
 
@@ -176,6 +189,27 @@ public:
    */
   virtual const JacobianType & GetJacobian( const InputPointType & ) const;
 
+  /** Transform a batch of points. The output array should have room for
+   * numberOfPoints points, and may be the same as the input array.
+   * By default TransformPoint() is called for each point; subclasses may
+   * override this to hoist the per-call setup out of the loop.
+   */
+  virtual void TransformPoints(
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints,
+    const unsigned long numberOfPoints ) const;
+
+  /** Compute the sparse Jacobians of a batch of points. The output arrays
+   * should have room for numberOfPoints elements; each Jacobian and vector
+   * of nonzero Jacobian indices is resized as in the sparse GetJacobian().
+   * By default the sparse GetJacobian() is called for each point.
+   */
+  virtual void GetJacobians(
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const unsigned long numberOfPoints ) const;
+
 	/** Compute the spatial Jacobian of the transformation.
    *
    * The spatial Jacobian is expressed as a vector of partial derivatives of the
@@ -266,6 +300,28 @@ public:
     JacobianOfSpatialHessianType & jsh,
     NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
 
+  /** Compute the Jacobian of the spatial Hessian of the transformation,
+   * using the given workspace for intermediate results. The default
+   * implementation ignores the workspace.
+   */
+  virtual void GetJacobianOfSpatialHessian(
+    const InputPointType & ipp,
+    JacobianOfSpatialHessianType & jsh,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    JacobianWorkspaceType & workspace ) const;
+
+  /** Compute both the spatial Hessian and the Jacobian of the
+   * spatial Hessian of the transformation, using the given workspace
+   * for intermediate results. The default implementation ignores the
+   * workspace.
+   */
+  virtual void GetJacobianOfSpatialHessian(
+    const InputPointType & ipp,
+    SpatialHessianType & sh,
+    JacobianOfSpatialHessianType & jsh,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    JacobianWorkspaceType & workspace ) const;
+
 protected:
   AdvancedTransform();
   AdvancedTransform( unsigned int Dimension, unsigned int NumberOfParameters );
@@ -114,6 +114,47 @@ AdvancedTransform<TScalarType,NInputDimensions,NOutputDimensions>
 } // end GetJacobian()
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template < class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform<TScalarType,NInputDimensions,NOutputDimensions>
+::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints,
+  const unsigned long numberOfPoints ) const
+{
+  for ( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    outputPoints[ i ] = this->TransformPoint( inputPoints[ i ] );
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* GetJacobians ****************************
+ */
+
+template < class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform<TScalarType,NInputDimensions,NOutputDimensions>
+::GetJacobians(
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const unsigned long numberOfPoints ) const
+{
+  for ( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    this->GetJacobian( inputPoints[ i ], jacobians[ i ], nonZeroJacobianIndices[ i ] );
+  }
+
+} // end GetJacobians()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -216,6 +257,43 @@ AdvancedTransform<TScalarType,NInputDimensions,NOutputDimensions>
 } // end GetJacobianOfSpatialHessian()
 
 
+/**
+ * ********************* GetJacobianOfSpatialHessian ****************************
+ */
+
+template < class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform<TScalarType,NInputDimensions,NOutputDimensions>
+::GetJacobianOfSpatialHessian(
+  const InputPointType & ipp,
+  JacobianOfSpatialHessianType & jsh,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+  JacobianWorkspaceType & itkNotUsed( workspace ) ) const
+{
+  this->GetJacobianOfSpatialHessian( ipp, jsh, nonZeroJacobianIndices );
+
+} // end GetJacobianOfSpatialHessian()
+
+
+/**
+ * ********************* GetJacobianOfSpatialHessian ****************************
+ */
+
+template < class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform<TScalarType,NInputDimensions,NOutputDimensions>
+::GetJacobianOfSpatialHessian(
+  const InputPointType & ipp,
+  SpatialHessianType & sh,
+  JacobianOfSpatialHessianType & jsh,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+  JacobianWorkspaceType & itkNotUsed( workspace ) ) const
+{
+  this->GetJacobianOfSpatialHessian( ipp, sh, jsh, nonZeroJacobianIndices );
+
+} // end GetJacobianOfSpatialHessian()
+
+
 } // end namespace itk
 
 
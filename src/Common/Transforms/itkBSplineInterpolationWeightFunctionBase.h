@@ -180,6 +180,24 @@ private:
    */
   void InitializeOffsetToIndexTable( void );
 
+  /** Structures to select the tensor product implementation. */
+  struct DispatchBase {};
+  template<unsigned int>
+  struct Dispatch : DispatchBase {};
+
+  /** Compute the weights as the tensor product of the 1D weights.
+   * The 2D and 3D versions are written out with compile-time loop bounds,
+   * which lets the compiler unroll and vectorize them. The products are
+   * formed in the same order as in the generic version, so all versions
+   * give identical results.
+   */
+  void ComputeTensorProduct( const Dispatch<2> &,
+    const OneDWeightsType & weights1D, WeightsType & weights ) const;
+  void ComputeTensorProduct( const Dispatch<3> &,
+    const OneDWeightsType & weights1D, WeightsType & weights ) const;
+  void ComputeTensorProduct( const DispatchBase &,
+    const OneDWeightsType & weights1D, WeightsType & weights ) const;
+
 };
 
 } // end namespace itk
@@ -196,6 +196,92 @@ BSplineInterpolationWeightFunctionBase<TCoordRep,VSpaceDimension, VSplineOrder>
   this->Compute1DWeights( cindex, startIndex, weights1D );
 
   /** Compute the vector of weights. */
+  this->ComputeTensorProduct( Dispatch<SpaceDimension>(), weights1D, weights );
+
+} // end Evaluate()
+
+
+/**
+ * ******************* ComputeTensorProduct *******************
+ */
+
+template<class TCoordRep, unsigned int VSpaceDimension, unsigned int VSplineOrder>
+void
+BSplineInterpolationWeightFunctionBase<TCoordRep,VSpaceDimension, VSplineOrder>
+::ComputeTensorProduct( const Dispatch<2> &,
+  const OneDWeightsType & weights1D, WeightsType & weights ) const
+{
+  const unsigned int supportSize = SplineOrder + 1;
+  const double * w0 = weights1D[ 0 ];
+  const double * w1 = weights1D[ 1 ];
+  double * weightsPointer = weights.data_block();
+
+  /** The first dimension runs fastest, as in the support region. */
+  for ( unsigned int i1 = 0; i1 < supportSize; ++i1 )
+  {
+    for ( unsigned int i0 = 0; i0 < supportSize; ++i0 )
+    {
+      *weightsPointer = w0[ i0 ] * w1[ i1 ];
+      ++weightsPointer;
+    }
+  }
+
+} // end ComputeTensorProduct()
+
+
+/**
+ * ******************* ComputeTensorProduct *******************
+ */
+
+template<class TCoordRep, unsigned int VSpaceDimension, unsigned int VSplineOrder>
+void
+BSplineInterpolationWeightFunctionBase<TCoordRep,VSpaceDimension, VSplineOrder>
+::ComputeTensorProduct( const Dispatch<3> &,
+  const OneDWeightsType & weights1D, WeightsType & weights ) const
+{
+  const unsigned int supportSize = SplineOrder + 1;
+  const unsigned int supportSize2 = supportSize * supportSize;
+  const double * w0 = weights1D[ 0 ];
+  const double * w1 = weights1D[ 1 ];
+  const double * w2 = weights1D[ 2 ];
+  double * weightsPointer = weights.data_block();
+
+  /** First the products of the first two dimensions, which are reused
+   * for every slice of the support region.
+   */
+  double w01[ ( SplineOrder + 1 ) * ( SplineOrder + 1 ) ];
+  for ( unsigned int i1 = 0; i1 < supportSize; ++i1 )
+  {
+    for ( unsigned int i0 = 0; i0 < supportSize; ++i0 )
+    {
+      w01[ i0 + i1 * supportSize ] = w0[ i0 ] * w1[ i1 ];
+    }
+  }
+
+  for ( unsigned int i2 = 0; i2 < supportSize; ++i2 )
+  {
+    const double w2i = w2[ i2 ];
+    for ( unsigned int i01 = 0; i01 < supportSize2; ++i01 )
+    {
+      *weightsPointer = w01[ i01 ] * w2i;
+      ++weightsPointer;
+    }
+  }
+
+} // end ComputeTensorProduct()
+
+
+/**
+ * ******************* ComputeTensorProduct *******************
+ */
+
+template<class TCoordRep, unsigned int VSpaceDimension, unsigned int VSplineOrder>
+void
+BSplineInterpolationWeightFunctionBase<TCoordRep,VSpaceDimension, VSplineOrder>
+::ComputeTensorProduct( const DispatchBase &,
+  const OneDWeightsType & weights1D, WeightsType & weights ) const
+{
+  /** Generic implementation, using the offset to index table. */
   for ( unsigned int k = 0; k < this->m_NumberOfWeights; k++ )
   {
     double tmp1 = 1.0;
@@ -207,7 +293,7 @@ BSplineInterpolationWeightFunctionBase<TCoordRep,VSpaceDimension, VSplineOrder>
     weights[ k ] = tmp1;
   }
 
-} // end Evaluate()
+} // end ComputeTensorProduct()
 
 
 } // end namespace itk
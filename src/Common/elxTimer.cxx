@@ -14,6 +14,13 @@
 #ifndef __elxTimer_CXX_
 #define __elxTimer_CXX_
 
+/** If running on a Windows-system, include "windows.h".
+ *  This is to get the CPU time of the process.
+ */
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  #include <windows.h>
+#endif
+
 #include "elxTimer.h"
 
 
@@ -22,6 +29,72 @@ namespace tmr
 using namespace itk;
 
 
+/**
+ * ********************* GetProcessCPUTime ****************************
+ *
+ * Return the CPU time used by all threads of the process, in seconds.
+ * clock() measures this on POSIX systems, but returns the wall clock
+ * time on Windows.
+ */
+
+static double GetProcessCPUTime( void )
+{
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  if ( !GetProcessTimes( GetCurrentProcess(),
+    &creationTime, &exitTime, &kernelTime, &userTime ) )
+  {
+    return 0.0;
+  }
+  ULARGE_INTEGER kernel, user;
+  kernel.LowPart = kernelTime.dwLowDateTime;
+  kernel.HighPart = kernelTime.dwHighDateTime;
+  user.LowPart = userTime.dwLowDateTime;
+  user.HighPart = userTime.dwHighDateTime;
+  /** The times are in units of 100 ns. */
+  return static_cast<double>( kernel.QuadPart + user.QuadPart ) * 1.0e-7;
+#elif defined( ELX_USE_CLOCK_GETTIME )
+  struct timespec cpuTime;
+  clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &cpuTime );
+  return cpuTime.tv_sec + cpuTime.tv_nsec / 1.0e9;
+#else
+  return static_cast<double>( clock() ) / CLOCKS_PER_SEC;
+#endif
+
+} // end GetProcessCPUTime()
+
+
+/**
+ * ********************* GetThreadCPUTimeSec ****************************
+ */
+
+double Timer::GetThreadCPUTimeSec( void )
+{
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  if ( !GetThreadTimes( GetCurrentThread(),
+    &creationTime, &exitTime, &kernelTime, &userTime ) )
+  {
+    return 0.0;
+  }
+  ULARGE_INTEGER kernel, user;
+  kernel.LowPart = kernelTime.dwLowDateTime;
+  kernel.HighPart = kernelTime.dwHighDateTime;
+  user.LowPart = userTime.dwLowDateTime;
+  user.HighPart = userTime.dwHighDateTime;
+  /** The times are in units of 100 ns. */
+  return static_cast<double>( kernel.QuadPart + user.QuadPart ) * 1.0e-7;
+#elif defined( ELX_USE_CLOCK_GETTIME )
+  struct timespec cpuTime;
+  clock_gettime( CLOCK_THREAD_CPUTIME_ID, &cpuTime );
+  return cpuTime.tv_sec + cpuTime.tv_nsec / 1.0e9;
+#else
+  return GetProcessCPUTime();
+#endif
+
+} // end GetThreadCPUTimeSec()
+
+
 /**
  * ********************* Constructor ****************************
  */
@@ -34,6 +107,9 @@ Timer::Timer()
   this->m_StartClock = 0;
   this->m_StopTime = 0;
   this->m_StopClock = 0;
+  this->m_StartCPUTime = 0.0;
+  this->m_StopCPUTime = 0.0;
+  this->m_ElapsedCPUTimeSec = 0.0;
 
 } // end Constructor
 
@@ -51,6 +127,7 @@ void Timer::StartTimer( void )
 #ifdef ELX_USE_CLOCK_GETTIME
   clock_gettime( CLOCK_MONOTONIC, &this->m_StartClockMonotonic );
 #endif
+  this->m_StartCPUTime = GetProcessCPUTime();
 
 } // end StartTimer()
 
@@ -71,6 +148,7 @@ int Timer::StopTimer( void )
 #ifdef ELX_USE_CLOCK_GETTIME
   clock_gettime( CLOCK_MONOTONIC, &this->m_StopClockMonotonic );
 #endif
+  this->m_StopCPUTime = GetProcessCPUTime();
 
   /** Get the elapsed time. */
   this->ElapsedClockAndTime();
@@ -104,6 +182,9 @@ int Timer::ElapsedClockAndTime( void )
   this->m_ElapsedClockSec += ( this->m_StopClockMonotonic.tv_nsec - this->m_StartClockMonotonic.tv_nsec ) / 1.0e9;
 #endif
 
+  /** Fill m_ElapsedCPUTimeSec. */
+  this->m_ElapsedCPUTimeSec = this->m_StopCPUTime - this->m_StartCPUTime;
+
   /** Fill m_TimeDHMS. */
   const std::size_t secondsPerMinute = 60;
   const std::size_t secondsPerHour = 60 * secondsPerMinute;
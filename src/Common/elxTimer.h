@@ -106,6 +106,17 @@ public:
   itkGetConstMacro( ElapsedClock, double );
   itkGetConstMacro( ElapsedClockSec, double );
 
+  /** The CPU time in seconds used by all threads of the process between
+   * StartTimer() and StopTimer(). It only measures a single computation
+   * if nothing else runs concurrently in the process.
+   */
+  itkGetConstMacro( ElapsedCPUTimeSec, double );
+
+  /** The CPU time in seconds used so far by the calling thread. Where the
+   * system offers no per-thread clock, this is the CPU time of the process.
+   */
+  static double GetThreadCPUTimeSec( void );
+
 protected:
 
   Timer();
@@ -121,6 +132,9 @@ protected:
   TimeDHMSType  m_ElapsedTimeDHMS;
   std::size_t   m_ElapsedTimeSec;
   double        m_ElapsedClockSec;
+  double        m_StartCPUTime;
+  double        m_StopCPUTime;
+  double        m_ElapsedCPUTimeSec;
 
   /** GCC specific. We can use clock_gettime(). */
 #if defined( __GNUC__ ) && !defined( __APPLE__ )
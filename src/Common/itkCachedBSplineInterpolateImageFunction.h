@@ -0,0 +1,184 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkCachedBSplineInterpolateImageFunction_h
+#define __itkCachedBSplineInterpolateImageFunction_h
+
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkTimeStamp.h"
+#include "vxl_config.h"
+
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+  /** \class CachedBSplineInterpolateImageFunction
+   *
+   * \brief A BSplineInterpolateImageFunction that reuses previously
+   * computed B-spline coefficient images.
+   *
+   * Setting the input image of a BSplineInterpolateImageFunction runs a
+   * BSplineDecompositionImageFilter over the whole image, which for large
+   * images is a considerable part of the total run time. In elastix the
+   * same moving image is often set several times with the same spline
+   * order: by the resample interpolator after each resolution and after
+   * each parameter file, and by every transformix call on that image.
+   *
+   * This class can keep the coefficients in two caches:
+   * \li A small in-memory cache, shared by all instances with the same
+   * template arguments, enabled with SetUseCoefficientCache(). An entry is
+   * reused as long as the image and the spline order are the same, and
+   * the image was not modified since the coefficients were computed.
+   * \li A directory with coefficient files, set with
+   * SetCoefficientCacheDirectory(). The files are named after a hash of
+   * the image voxels and geometry, the spline order and the coefficient
+   * type, so that they can be reused by later processes.
+   *
+   * The coefficients are identical to those computed by the superclass.
+   * The in-memory cache keeps the coefficient images alive, so enable it
+   * only when memory permits. SetInputImage() is not thread-safe.
+   *
+   * \ingroup ImageFunctions
+   */
+
+  template < class TImageType, class TCoordRep = double,
+    class TCoefficientType = double >
+  class CachedBSplineInterpolateImageFunction :
+    public BSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+  {
+  public:
+
+    /** Standard ITK-stuff. */
+    typedef CachedBSplineInterpolateImageFunction   Self;
+    typedef BSplineInterpolateImageFunction<
+      TImageType, TCoordRep, TCoefficientType >     Superclass;
+    typedef SmartPointer<Self>                      Pointer;
+    typedef SmartPointer<const Self>                ConstPointer;
+
+    /** Method for creation through the object factory. */
+    itkNewMacro( Self );
+
+    /** Run-time type information (and related methods). */
+    itkTypeMacro( CachedBSplineInterpolateImageFunction, BSplineInterpolateImageFunction );
+
+    /** The image dimension. */
+    itkStaticConstMacro( ImageDimension, unsigned int, Superclass::ImageDimension );
+
+    /** The maximum number of coefficient images in the in-memory cache. */
+    itkStaticConstMacro( MaximumNumberOfCachedCoefficientImages, unsigned int, 2 );
+
+    /** Typedefs. */
+    typedef typename Superclass::InputImageType         InputImageType;
+    typedef typename Superclass::CoefficientDataType    CoefficientDataType;
+    typedef typename Superclass::CoefficientImageType   CoefficientImageType;
+    typedef typename CoefficientImageType::ConstPointer CoefficientImageConstPointer;
+    typedef typename Superclass::CoefficientFilter      CoefficientFilterType;
+    typedef typename Superclass::Superclass             InterpolateImageFunctionType;
+
+    /** Set the input image. The coefficients are taken from one of the
+     * caches if possible, and computed otherwise.
+     */
+    virtual void SetInputImage( const TImageType * inputData );
+
+    /** Use the in-memory cache. Default: false. */
+    itkSetMacro( UseCoefficientCache, bool );
+    itkGetConstMacro( UseCoefficientCache, bool );
+    itkBooleanMacro( UseCoefficientCache );
+
+    /** Set the directory of the coefficient files. An empty string, which
+     * is the default, disables the file cache.
+     */
+    itkSetStringMacro( CoefficientCacheDirectory );
+    itkGetStringMacro( CoefficientCacheDirectory );
+
+    /** Get whether the coefficients of the last input image were taken
+     * from one of the caches.
+     */
+    itkGetConstMacro( CoefficientsFromCache, bool );
+
+    /** Remove all coefficient images from the in-memory cache. */
+    static void ClearCoefficientCache( void );
+
+  protected:
+
+    /** The constructor. */
+    CachedBSplineInterpolateImageFunction();
+
+    /** The destructor. */
+    virtual ~CachedBSplineInterpolateImageFunction() {};
+
+    /** PrintSelf. */
+    void PrintSelf( std::ostream& os, Indent indent ) const;
+
+    /** Compute the coefficients with a new decomposition filter, so that
+     * the result is not overwritten when another image is set.
+     */
+    virtual CoefficientImageConstPointer ComputeCoefficients(
+      const InputImageType * inputData ) const;
+
+    /** Compute the hash of the voxels and the geometry of an image. */
+    static vxl_uint_64 ComputeImageHash( const InputImageType * inputData );
+
+    /** Get the name of the coefficient file of an image. */
+    virtual std::string GetCoefficientFileName( const InputImageType * inputData ) const;
+
+    /** Read the coefficients from a file. Returns 0 if the file does not
+     * exist, can not be read, or does not match the image.
+     */
+    virtual CoefficientImageConstPointer ReadCoefficients(
+      const std::string & fileName, const InputImageType * inputData ) const;
+
+    /** Write the coefficients to a file. Failures are ignored, since the
+     * file cache is only an optimisation.
+     */
+    virtual void WriteCoefficients( const std::string & fileName,
+      const CoefficientImageType * coefficients ) const;
+
+  private:
+
+    /** The private constructor. */
+    CachedBSplineInterpolateImageFunction( const Self& ); // purposely not implemented
+    /** The private copy constructor. */
+    void operator=( const Self& );                        // purposely not implemented
+
+    /** An entry of the in-memory cache. The image is only used to identify
+     * the entry, so it is not kept alive by it.
+     */
+    struct CacheEntryType
+    {
+      const InputImageType *        m_Image;
+      unsigned long                 m_ImageMTime;
+      unsigned int                  m_SplineOrder;
+      CoefficientImageConstPointer  m_Coefficients;
+    };
+    typedef std::vector< CacheEntryType >   CacheType;
+    static CacheType & GetCoefficientCache( void );
+
+    /** Member variables. */
+    bool          m_UseCoefficientCache;
+    std::string   m_CoefficientCacheDirectory;
+    bool          m_CoefficientsFromCache;
+
+  }; // end class CachedBSplineInterpolateImageFunction
+
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkCachedBSplineInterpolateImageFunction.txx"
+#endif
+
+#endif // end #ifndef __itkCachedBSplineInterpolateImageFunction_h
@@ -0,0 +1,380 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkCachedBSplineInterpolateImageFunction_txx
+#define __itkCachedBSplineInterpolateImageFunction_txx
+
+#include "itkCachedBSplineInterpolateImageFunction.h"
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "vnl/vnl_math.h"
+#include <itksys/SystemTools.hxx>
+
+#include <cstdio>
+#include <sstream>
+#include <iomanip>
+
+namespace itk
+{
+
+  /**
+   * ******************* Constructor *******************
+   */
+
+  template < class TImageType, class TCoordRep, class TCoefficientType >
+    CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+    ::CachedBSplineInterpolateImageFunction()
+  {
+    this->m_UseCoefficientCache = false;
+    this->m_CoefficientCacheDirectory = "";
+    this->m_CoefficientsFromCache = false;
+
+  } // end Constructor
+
+
+  /**
+   * ******************* SetInputImage *******************
+   */
+
+  template < class TImageType, class TCoordRep, class TCoefficientType >
+    void
+    CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+    ::SetInputImage( const TImageType * inputData )
+  {
+    this->m_CoefficientsFromCache = false;
+    const bool useFileCache = !this->m_CoefficientCacheDirectory.empty();
+    if ( inputData == 0 || ( !this->m_UseCoefficientCache && !useFileCache ) )
+    {
+      this->Superclass::SetInputImage( inputData );
+      return;
+    }
+
+    /** Look in the in-memory cache. */
+    CoefficientImageConstPointer coefficients = 0;
+    CacheType & cache = Self::GetCoefficientCache();
+    if ( this->m_UseCoefficientCache )
+    {
+      for ( unsigned int i = 0; i < cache.size(); ++i )
+      {
+        if ( cache[ i ].m_Image == inputData
+          && cache[ i ].m_ImageMTime == inputData->GetMTime()
+          && cache[ i ].m_SplineOrder == this->m_SplineOrder )
+        {
+          coefficients = cache[ i ].m_Coefficients;
+          break;
+        }
+      }
+    }
+
+    /** Look in the file cache, and compute the coefficients if all fails. */
+    bool storeInCache = this->m_UseCoefficientCache;
+    if ( coefficients.IsNotNull() )
+    {
+      this->m_CoefficientsFromCache = true;
+      storeInCache = false;
+    }
+    else
+    {
+      std::string fileName = "";
+      if ( useFileCache )
+      {
+        fileName = this->GetCoefficientFileName( inputData );
+        coefficients = this->ReadCoefficients( fileName, inputData );
+      }
+
+      if ( coefficients.IsNotNull() )
+      {
+        this->m_CoefficientsFromCache = true;
+      }
+      else
+      {
+        coefficients = this->ComputeCoefficients( inputData );
+        if ( useFileCache )
+        {
+          this->WriteCoefficients( fileName, coefficients );
+        }
+      }
+    }
+
+    /** Store the coefficients in the in-memory cache. Replace the oldest
+     * entry if the cache is full.
+     */
+    if ( storeInCache )
+    {
+      CacheEntryType entry;
+      entry.m_Image = inputData;
+      entry.m_ImageMTime = inputData->GetMTime();
+      entry.m_SplineOrder = this->m_SplineOrder;
+      entry.m_Coefficients = coefficients;
+      if ( cache.size() >= MaximumNumberOfCachedCoefficientImages )
+      {
+        cache.erase( cache.begin() );
+      }
+      cache.push_back( entry );
+    }
+
+    /** Do what the superclass does after running its filter. */
+    this->m_Coefficients = coefficients;
+    this->InterpolateImageFunctionType::SetInputImage( inputData );
+    this->m_DataLength = inputData->GetBufferedRegion().GetSize();
+
+  } // end SetInputImage()
+
+
+  /**
+   * ******************* ComputeCoefficients *******************
+   */
+
+  template < class TImageType, class TCoordRep, class TCoefficientType >
+    typename CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+    ::CoefficientImageConstPointer
+    CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+    ::ComputeCoefficients( const InputImageType * inputData ) const
+  {
+    typename CoefficientFilterType::Pointer filter = CoefficientFilterType::New();
+    filter->SetSplineOrder( this->m_SplineOrder );
+    filter->SetInput( inputData );
+    filter->Update();
+
+    CoefficientImageConstPointer coefficients = filter->GetOutput();
+    return coefficients;
+
+  } // end ComputeCoefficients()
+
+
+  /**
+   * ******************* ComputeImageHash *******************
+   */
+
+  template < class TImageType, class TCoordRep, class TCoefficientType >
+    vxl_uint_64
+    CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+    ::ComputeImageHash( const InputImageType * inputData )
+  {
+    /** A 64 bit FNV-1a hash of the buffer, followed by the geometry. */
+    const vxl_uint_64 prime
+      = ( static_cast<vxl_uint_64>( 0x00000100UL ) << 32 ) | 0x000001b3UL;
+    vxl_uint_64 hash
+      = ( static_cast<vxl_uint_64>( 0xcbf29ce4UL ) << 32 ) | 0x84222325UL;
+
+    const unsigned char * bytes
+      = reinterpret_cast<const unsigned char *>( inputData->GetBufferPointer() );
+    const unsigned long numberOfBytes
+      = inputData->GetBufferedRegion().GetNumberOfPixels()
+      * sizeof( typename InputImageType::PixelType );
+    for ( unsigned long i = 0; i < numberOfBytes; ++i )
+    {
+      hash = ( hash ^ bytes[ i ] ) * prime;
+    }
+
+    std::vector< double > geometry;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      geometry.push_back( static_cast<double>( inputData->GetBufferedRegion().GetIndex()[ i ] ) );
+      geometry.push_back( static_cast<double>( inputData->GetBufferedRegion().GetSize()[ i ] ) );
+      geometry.push_back( inputData->GetSpacing()[ i ] );
+      geometry.push_back( inputData->GetOrigin()[ i ] );
+      for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+        geometry.push_back( inputData->GetDirection()[ i ][ j ] );
+      }
+    }
+    const unsigned char * geometryBytes
+      = reinterpret_cast<const unsigned char *>( &( geometry[ 0 ] ) );
+    for ( unsigned long i = 0; i < geometry.size() * sizeof( double ); ++i )
+    {
+      hash = ( hash ^ geometryBytes[ i ] ) * prime;
+    }
+
+    return hash;
+
+  } // end ComputeImageHash()
+
+
+  /**
+   * ******************* GetCoefficientFileName *******************
+   */
+
+  template < class TImageType, class TCoordRep, class TCoefficientType >
+    std::string
+    CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+    ::GetCoefficientFileName( const InputImageType * inputData ) const
+  {
+    const vxl_uint_64 hash = Self::ComputeImageHash( inputData );
+    std::ostringstream fileName;
+    fileName << this->m_CoefficientCacheDirectory << "/BSplineCoefficients."
+      << std::hex << std::setfill( '0' )
+      << std::setw( 8 ) << static_cast<unsigned long>( hash >> 32 )
+      << std::setw( 8 ) << static_cast<unsigned long>( hash & 0xffffffffUL )
+      << std::dec << ".order" << this->m_SplineOrder
+      << ".bytes" << sizeof( CoefficientDataType ) << ".mha";
+    return fileName.str();
+
+  } // end GetCoefficientFileName()
+
+
+  /**
+   * ******************* ReadCoefficients *******************
+   */
+
+  template < class TImageType, class TCoordRep, class TCoefficientType >
+    typename CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+    ::CoefficientImageConstPointer
+    CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+    ::ReadCoefficients( const std::string & fileName,
+      const InputImageType * inputData ) const
+  {
+    if ( !itksys::SystemTools::FileExists( fileName.c_str() ) )
+    {
+      return 0;
+    }
+
+    typedef ImageFileReader< CoefficientImageType > ReaderType;
+    typename ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName( fileName.c_str() );
+    try
+    {
+      reader->Update();
+    }
+    catch ( ExceptionObject & )
+    {
+      return 0;
+    }
+
+    /** Check that the file matches the image, to guard against hash
+     * collisions and incomplete files.
+     */
+    const CoefficientImageType * coefficients = reader->GetOutput();
+    if ( coefficients->GetLargestPossibleRegion().GetSize()
+      != inputData->GetBufferedRegion().GetSize() )
+    {
+      return 0;
+    }
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      if ( vnl_math_abs( coefficients->GetSpacing()[ i ] - inputData->GetSpacing()[ i ] )
+        > 1e-6 * vnl_math_abs( inputData->GetSpacing()[ i ] )
+        || vnl_math_abs( coefficients->GetOrigin()[ i ] - inputData->GetOrigin()[ i ] )
+        > 1e-6 * ( 1.0 + vnl_math_abs( inputData->GetOrigin()[ i ] ) ) )
+      {
+        return 0;
+      }
+    }
+
+    /** The file does not store the start index of the buffered region. */
+    typename CoefficientImageType::Pointer output = reader->GetOutput();
+    output->DisconnectPipeline();
+    typename CoefficientImageType::RegionType region = output->GetLargestPossibleRegion();
+    region.SetIndex( inputData->GetBufferedRegion().GetIndex() );
+    output->SetRegions( region );
+    output->SetDirection( inputData->GetDirection() );
+
+    CoefficientImageConstPointer result = output.GetPointer();
+    return result;
+
+  } // end ReadCoefficients()
+
+
+  /**
+   * ******************* WriteCoefficients *******************
+   */
+
+  template < class TImageType, class TCoordRep, class TCoefficientType >
+    void
+    CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+    ::WriteCoefficients( const std::string & fileName,
+      const CoefficientImageType * coefficients ) const
+  {
+    /** Write to a temporary file first, so that other processes never
+     * read an incomplete file.
+     */
+    std::ostringstream tmpName;
+    tmpName << fileName << "." << static_cast<const void *>( this ) << ".tmp.mha";
+
+    typedef ImageFileWriter< CoefficientImageType > WriterType;
+    typename WriterType::Pointer writer = WriterType::New();
+    writer->SetInput( coefficients );
+    writer->SetFileName( tmpName.str().c_str() );
+    try
+    {
+      writer->Update();
+    }
+    catch ( ExceptionObject & )
+    {
+      itksys::SystemTools::RemoveFile( tmpName.str().c_str() );
+      return;
+    }
+
+    if ( std::rename( tmpName.str().c_str(), fileName.c_str() ) != 0 )
+    {
+      itksys::SystemTools::RemoveFile( tmpName.str().c_str() );
+    }
+
+  } // end WriteCoefficients()
+
+
+  /**
+   * ******************* GetCoefficientCache *******************
+   */
+
+  template < class TImageType, class TCoordRep, class TCoefficientType >
+    typename CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+    ::CacheType &
+    CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+    ::GetCoefficientCache( void )
+  {
+    static CacheType cache;
+    return cache;
+
+  } // end GetCoefficientCache()
+
+
+  /**
+   * ******************* ClearCoefficientCache *******************
+   */
+
+  template < class TImageType, class TCoordRep, class TCoefficientType >
+    void
+    CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+    ::ClearCoefficientCache( void )
+  {
+    Self::GetCoefficientCache().clear();
+
+  } // end ClearCoefficientCache()
+
+
+  /**
+   * ******************* PrintSelf *******************
+   */
+
+  template < class TImageType, class TCoordRep, class TCoefficientType >
+    void
+    CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+    ::PrintSelf( std::ostream& os, Indent indent ) const
+  {
+    Superclass::PrintSelf( os, indent );
+
+    os << indent << "UseCoefficientCache: "
+      << ( this->m_UseCoefficientCache ? "true" : "false" ) << std::endl;
+    os << indent << "CoefficientCacheDirectory: "
+      << this->m_CoefficientCacheDirectory << std::endl;
+    os << indent << "CoefficientsFromCache: "
+      << ( this->m_CoefficientsFromCache ? "true" : "false" ) << std::endl;
+
+  } // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkCachedBSplineInterpolateImageFunction_txx
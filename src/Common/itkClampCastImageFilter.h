@@ -0,0 +1,122 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkClampCastImageFilter_h
+#define __itkClampCastImageFilter_h
+
+#include "itkUnaryFunctorImageFilter.h"
+#include "itkNumericTraits.h"
+#include "vnl/vnl_math.h"
+
+namespace itk
+{
+
+namespace Functor
+{
+
+  /** \class ClampCast
+   * \brief Casts a scalar to another type, after clamping it to the range
+   * of that type and, for integer types, rounding it to the nearest integer.
+   */
+
+  template< class TInput, class TOutput >
+  class ClampCast
+  {
+  public:
+    ClampCast() {};
+    ~ClampCast() {};
+
+    bool operator!=( const ClampCast & ) const
+    {
+      return false;
+    }
+    bool operator==( const ClampCast & other ) const
+    {
+      return !( *this != other );
+    }
+
+    inline TOutput operator()( const TInput & A ) const
+    {
+      const double value = static_cast<double>( A );
+      if ( value <= static_cast<double>( NumericTraits<TOutput>::NonpositiveMin() ) )
+      {
+        return NumericTraits<TOutput>::NonpositiveMin();
+      }
+      if ( value >= static_cast<double>( NumericTraits<TOutput>::max() ) )
+      {
+        return NumericTraits<TOutput>::max();
+      }
+      if ( NumericTraits<TOutput>::is_integer )
+      {
+        return static_cast<TOutput>( vnl_math_rnd( value ) );
+      }
+      return static_cast<TOutput>( A );
+    }
+  }; // end class ClampCast
+
+} // end namespace Functor
+
+
+/** \class ClampCastImageFilter
+ * \brief Casts the pixels of a scalar image to another type, clamping them
+ * to the range of the output type and rounding them if that is an integer
+ * type.
+ *
+ * Unlike the CastImageFilter, values outside the range of the output type
+ * do not wrap around, and values are not truncated towards zero. The filter
+ * is multi-threaded and supports streaming.
+ *
+ * \ingroup IntensityImageFilters Multithreaded
+ */
+
+template < class TInputImage, class TOutputImage >
+class ITK_EXPORT ClampCastImageFilter :
+  public UnaryFunctorImageFilter< TInputImage, TOutputImage,
+    Functor::ClampCast<
+      typename TInputImage::PixelType,
+      typename TOutputImage::PixelType > >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef ClampCastImageFilter                        Self;
+  typedef UnaryFunctorImageFilter< TInputImage, TOutputImage,
+    Functor::ClampCast<
+      typename TInputImage::PixelType,
+      typename TOutputImage::PixelType > >            Superclass;
+  typedef SmartPointer<Self>                          Pointer;
+  typedef SmartPointer<const Self>                    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ClampCastImageFilter, UnaryFunctorImageFilter );
+
+protected:
+
+  ClampCastImageFilter() {};
+  virtual ~ClampCastImageFilter() {};
+
+private:
+
+  ClampCastImageFilter( const Self& ); // purposely not implemented
+  void operator=( const Self& );       // purposely not implemented
+
+}; // end class ClampCastImageFilter
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkClampCastImageFilter_h
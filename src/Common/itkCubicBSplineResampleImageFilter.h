@@ -0,0 +1,254 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#ifndef __itkCubicBSplineResampleImageFilter_h
+#define __itkCubicBSplineResampleImageFilter_h
+
+#include "itkImage.h"
+#include "itkResampleImageFilter.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkBSplineDeformableTransform.h"
+#include "itkMultiThreader.h"
+
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+/** \class CubicBSplineResampleImageFilter
+ * \brief Resample an image on the CPU with the algorithm of the CUDA resampler.
+ *
+ * This class implements the algorithm of the itkCUDAResampleImageFilter
+ * on the CPU, so that it can be used on hosts without a GPU. For each
+ * output voxel the displacement is evaluated from the B-spline coefficients
+ * of the transform, and the input image is sampled with third order
+ * B-spline interpolation from its precomputed B-spline coefficients, in
+ * the same way as the cubic texture lookups of the CUDA kernel:
+ * single precision arithmetic, clamped coefficient indices, and the
+ * default pixel value outside the B-spline grid or the input image.
+ *
+ * Since the direction cosines are the identity, the coordinates of an
+ * output line only vary along x. The coefficients of the B-spline
+ * transform are therefore first reduced along y and z once per line,
+ * after which each voxel only needs four coefficients per dimension.
+ * The lines are divided over the threads, and the inner loops have fixed
+ * trip counts over contiguous single precision data, so that the compiler
+ * can vectorize them.
+ *
+ * Configurations that the CUDA kernel does not support are resampled by
+ * the ResampleImageFilter.
+ *
+ * \warning The implementation is limited in the same way as the CUDA
+ * resampler: only a single third order B-spline transform is supported
+ * for 3D images together with third order B-spline interpolation.
+ *
+ * \ingroup GeometricTransforms
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType = float>
+class ITK_EXPORT CubicBSplineResampleImageFilter:
+  public ResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+{
+public:
+  /** Standard class typedefs. */
+  typedef CubicBSplineResampleImageFilter                     Self;
+  typedef ResampleImageFilter<
+    TInputImage,TOutputImage,TInterpolatorPrecisionType>      Superclass;
+  typedef SmartPointer<Self>                                  Pointer;
+  typedef SmartPointer<const Self>                            ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( CubicBSplineResampleImageFilter, ResampleImageFilter );
+
+  /** The image dimension. */
+  itkStaticConstMacro( ImageDimension, unsigned int, TOutputImage::ImageDimension );
+
+  /** Typedefs from Superclass. */
+  typedef typename Superclass::InputImageType           InputImageType;
+  typedef typename Superclass::OutputImageType          OutputImageType;
+  typedef typename Superclass::InputImagePointer        InputImagePointer;
+  typedef typename Superclass::InputImageConstPointer   InputImageConstPointer;
+  typedef typename Superclass::OutputImagePointer       OutputImagePointer;
+  typedef typename Superclass::InputImageRegionType     InputImageRegionType;
+
+  typedef typename Superclass::TransformType            TransformType;
+  typedef typename Superclass::TransformPointerType     TransformPointerType;
+  typedef typename Superclass::InterpolatorType         InterpolatorType;
+  typedef typename Superclass::InterpolatorPointerType  InterpolatorPointerType;
+
+  typedef typename Superclass::SizeType                 SizeType;
+  typedef typename Superclass::IndexType                IndexType;
+  typedef typename Superclass::PointType                PointType;
+  typedef typename Superclass::PixelType                PixelType;
+  typedef typename Superclass::InputPixelType           InputPixelType;
+  typedef typename Superclass::OutputImageRegionType    OutputImageRegionType;
+  typedef typename Superclass::SpacingType              SpacingType;
+  typedef typename Superclass::OriginPointType          OriginPointType;
+  typedef typename Superclass::DirectionType            DirectionType;
+  typedef typename Superclass::ImageBaseType            ImageBaseType;
+
+  /** Typedefs. */
+  typedef AdvancedCombinationTransform<
+    TInterpolatorPrecisionType, 3 >                     InternalComboTransformType;
+  typedef AdvancedBSplineDeformableTransform<
+    TInterpolatorPrecisionType, 3, 3 >                  InternalAdvancedBSplineTransformType;
+  typedef typename InternalAdvancedBSplineTransformType::Pointer ValidTransformPointer;
+  typedef typename InternalAdvancedBSplineTransformType::ConstPointer ValidTransformConstPointer;
+  typedef BSplineDeformableTransform<
+    TInterpolatorPrecisionType, 3, 3 >                  InternalBSplineTransformType;
+
+  /** Typedef for the B-spline coefficients of the input image. */
+  typedef Image< float,
+    itkGetStaticConstMacro( ImageDimension ) >          CoefficientImageType;
+
+  /** Resample using the CPU implementation of the CUDA kernel if possible,
+   * or with the ResampleImageFilter otherwise.
+   */
+  virtual void GenerateData( void );
+
+  /** Get whether the last configuration could be resampled with the
+   * algorithm of the CUDA kernel.
+   */
+  itkGetConstMacro( ConfigurationIsValid, bool );
+
+  /** For reporting warnings. */
+  class WarningReportType
+  {
+  public:
+    std::vector<std::string>  m_Warnings;
+
+    void ResetWarningReport( void )
+    {
+      this->m_Warnings.resize( 0 );
+    }
+    std::string GetWarningReportAsString( void ) const
+    {
+      std::string warnings = "\n---------------------------------\n";
+      for ( std::size_t i = 0; i < this->m_Warnings.size(); i++ )
+      {
+        warnings += "itkCUDAResampleImageFilter: " + this->m_Warnings[ i ];
+        warnings += "\n---------------------------------\n";
+      }
+      return warnings;
+    }
+  };
+  //itkGetConstReferenceMacro( WarningReport, WarningReportType );
+  virtual const WarningReportType & GetWarningReport( void ) const
+  {
+    return this->m_WarningReport;
+  }
+
+protected:
+  CubicBSplineResampleImageFilter();
+  virtual ~CubicBSplineResampleImageFilter() {};
+
+  /** Check whether the transform, the interpolator and the direction cosines
+   * are supported, and fill in the B-spline transform if so. The result
+   * is available through GetConfigurationIsValid().
+   */
+  virtual void CheckForValidConfiguration( ValidTransformPointer & bSplineTransform );
+
+  /** Resample a valid configuration. This implementation runs the
+   * CPU implementation of the CUDA kernel.
+   */
+  virtual void GenerateDataForValidConfiguration( ValidTransformPointer bSplineTransform );
+
+  /** The warnings of the last check. */
+  WarningReportType           m_WarningReport;
+
+private:
+  CubicBSplineResampleImageFilter( const Self& ); // purposely not implemented
+  void operator=( const Self& );                  // purposely not implemented
+
+  /** Helper function to check for a valid transform.
+   * Currently, only resampling of 3D images for 3-rd order B-splines is supported,
+   * and only for one transform, so no concatenations.
+   */
+  bool CheckForValidTransform( ValidTransformPointer & bSplineTransform ) const;
+
+  /** Helper function to check for a valid interpolator.
+   * Currently, only resampling using 3-rd order B-spline interpolation is supported.
+   */
+  bool CheckForValidInterpolator( void ) const;
+
+  /** Helper function to check for a valid direction cosines.
+   * Currently, only resampling using identity cosines is supported.
+   */
+  bool CheckForValidDirectionCosines( ValidTransformPointer bSplineTransform ) ;//const;
+  // NOTE: const can be added again in ITK4. It's due to GetInput() being not const-correct.
+
+  /** The data shared by the threads. */
+  struct MultiThreaderParameterType
+  {
+    Self *                      m_Filter;
+    const float *               m_InputCoefficients;
+    const std::vector<float> *  m_GridCoefficients;
+    long                        m_NumberOfLines;
+  };
+
+  /** The threader callback, which calls ThreadedGenerateLines(). */
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void * arg );
+
+  /** Resample a range of lines of the output buffer. */
+  void ThreadedGenerateLines( const MultiThreaderParameterType & parameters,
+    const long firstLine, const long lastLine );
+
+  /** Compute the four cubic B-spline weights at a continuous index,
+   * and the first of the four indices they apply to.
+   */
+  static inline long ComputeCubicBSplineWeights( const float cindex, float weights[ 4 ] );
+
+  /** Clamp an index to [0, size), like the clamped texture lookups. */
+  static inline long ClampIndex( const long index, const long size );
+
+  /** Compute the B-spline coefficients of the input image, unless they
+   * are still up to date from a previous call.
+   */
+  void ComputeInputCoefficients( void );
+
+  /** Member variables. */
+  bool        m_ConfigurationIsValid;
+
+  /** The B-spline coefficients of the input image, which are reused for
+   * the next stream piece as long as the input did not change.
+   */
+  typename CoefficientImageType::Pointer  m_InputCoefficients;
+  const InputImageType *                  m_InputCoefficientsSource;
+  unsigned long                           m_InputCoefficientsMTime;
+
+  /** Geometry of the input image, the output image and the B-spline grid,
+   * in single precision as in the CUDA kernel.
+   */
+  float       m_InputOrigin[ 3 ];
+  float       m_InputSpacing[ 3 ];
+  long        m_InputSize[ 3 ];
+  float       m_OutputOrigin[ 3 ];
+  float       m_OutputSpacing[ 3 ];
+  float       m_GridOrigin[ 3 ];
+  float       m_GridSpacing[ 3 ];
+  long        m_GridSize[ 3 ];
+
+}; // end class CubicBSplineResampleImageFilter
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkCubicBSplineResampleImageFilter.txx"
+#endif
+
+#endif // end #ifndef __itkCubicBSplineResampleImageFilter_h
@@ -0,0 +1,626 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#ifndef __itkCubicBSplineResampleImageFilter_txx
+#define __itkCubicBSplineResampleImageFilter_txx
+
+#include "itkCubicBSplineResampleImageFilter.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkBSplineDecompositionImageFilter.h"
+#include "vnl/vnl_math.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+CubicBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::CubicBSplineResampleImageFilter()
+{
+  this->m_ConfigurationIsValid = false;
+  this->m_InputCoefficients = 0;
+  this->m_InputCoefficientsSource = 0;
+  this->m_InputCoefficientsMTime = 0;
+
+  for ( unsigned int d = 0; d < 3; ++d )
+  {
+    this->m_InputOrigin[ d ] = 0.0f;
+    this->m_InputSpacing[ d ] = 1.0f;
+    this->m_InputSize[ d ] = 1;
+    this->m_OutputOrigin[ d ] = 0.0f;
+    this->m_OutputSpacing[ d ] = 1.0f;
+    this->m_GridOrigin[ d ] = 0.0f;
+    this->m_GridSpacing[ d ] = 1.0f;
+    this->m_GridSize[ d ] = 1;
+  }
+
+} // end Constructor
+
+
+/**
+ * ******************* CheckForValidTransform ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+bool
+CubicBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::CheckForValidTransform( ValidTransformPointer & bSplineTransform ) const
+{
+  /** First check if the Transform is valid for CUDA. */
+  typename InternalBSplineTransformType::Pointer testPtr1a
+    = const_cast<InternalBSplineTransformType *>(
+    dynamic_cast<const InternalBSplineTransformType *>( this->GetTransform() ) );
+  typename InternalAdvancedBSplineTransformType::Pointer testPtr1b
+    = const_cast<InternalAdvancedBSplineTransformType *>(
+    dynamic_cast<const InternalAdvancedBSplineTransformType *>( this->GetTransform() ) );
+  typename InternalComboTransformType::Pointer testPtr2a
+    = const_cast<InternalComboTransformType *>(
+    dynamic_cast<const InternalComboTransformType *>( this->GetTransform() ) );
+
+  bool transformIsValid = false;
+  if ( testPtr1a )
+  {
+    /** The transform is of type BSplineDeformableTransform. It is not
+     * supported: GenerateDataForValidConfiguration() is written for the
+     * AdvancedBSplineDeformableTransform, so this case is resampled by
+     * the generic implementation.
+     */
+    transformIsValid = false;
+  }
+  else if ( testPtr1b )
+  {
+    /** The transform is of type AdvancedBSplineDeformableTransform. */
+    transformIsValid = true;
+    bSplineTransform = testPtr1b;
+  }
+  else if ( testPtr2a )
+  {
+    // Check that the comboT has no initial transform and that current = B-spline
+    // and that B-spline = 3rd order
+
+    /** The transform is of type AdvancedCombinationTransform. */
+    if ( !testPtr2a->GetInitialTransform() )
+    {
+      typename InternalAdvancedBSplineTransformType::Pointer testPtr2b
+        = dynamic_cast<InternalAdvancedBSplineTransformType *>(
+        testPtr2a->GetCurrentTransform() );
+      if ( testPtr2b )
+      {
+        /** The current transform is of type AdvancedBSplineDeformableTransform. */
+        transformIsValid = true;
+        bSplineTransform = testPtr2b;
+      }
+    }
+  } // end if combo transform
+
+  return transformIsValid;
+
+} // end CheckForValidTransform()
+
+
+/**
+ * ******************* CheckForValidInterpolator ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+bool
+CubicBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::CheckForValidInterpolator( void ) const
+{
+  /** Check if the interpolator is valid for CUDA. */
+  // ImageType = ElastixType::MovingImageType = InputImageType
+  // CoordRepType = ElastixType::CoordRepType = TInterpolatorPrecisionType
+  // CoefficientType = float or double, does not matter
+  typedef BSplineInterpolateImageFunction<
+    InputImageType, TInterpolatorPrecisionType, float >   ValidInterpolatorFloatType;
+  typedef BSplineInterpolateImageFunction<
+    InputImageType, TInterpolatorPrecisionType, double >  ValidInterpolatorDoubleType;
+
+  typename ValidInterpolatorFloatType::Pointer testPtr1
+    = const_cast<ValidInterpolatorFloatType *>(
+    dynamic_cast<const ValidInterpolatorFloatType *>( this->GetInterpolator() ) );
+  typename ValidInterpolatorDoubleType::Pointer testPtr2
+    = const_cast<ValidInterpolatorDoubleType *>(
+    dynamic_cast<const ValidInterpolatorDoubleType *>( this->GetInterpolator() ) );
+
+  bool interpolatorIsValid = false;
+  if ( testPtr1 )
+  {
+    if ( testPtr1->GetSplineOrder() == 3 )
+    {
+      interpolatorIsValid = true;
+    }
+  }
+  else if ( testPtr2 )
+  {
+    if ( testPtr2->GetSplineOrder() == 3 )
+    {
+      interpolatorIsValid = true;
+    }
+  }
+
+  return interpolatorIsValid;
+
+} // end CheckForValidInterpolator()
+
+
+/**
+ * ******************* CheckForValidDirectionCosines ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+bool
+CubicBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::CheckForValidDirectionCosines( ValidTransformPointer bSplineTransform )// const
+{
+  /** Check if the direction cosines are valid for CUDA. */
+  bool directionCosinesAreValid = true;
+  DirectionType identityDC; identityDC.SetIdentity();
+  typedef typename InternalAdvancedBSplineTransformType::DirectionType GridDirectionType;
+  GridDirectionType identityDCGrid; identityDCGrid.SetIdentity();
+
+  /** Check input image direction cosines. */
+  DirectionType inputImageDC = this->GetInput()->GetDirection();
+  if ( inputImageDC != identityDC )
+  {
+    directionCosinesAreValid = false;
+  }
+
+  /** Check output image direction cosines. */
+  DirectionType outputImageDC = this->GetOutputDirection();
+  if ( outputImageDC != identityDC )
+  {
+    directionCosinesAreValid = false;
+  }
+
+  /** Check B-spline grid direction cosines. */
+  GridDirectionType bsplineGridDC = bSplineTransform->GetGridDirection();
+  if ( bsplineGridDC != identityDCGrid )
+  {
+    directionCosinesAreValid = false;
+  }
+
+  return directionCosinesAreValid;
+
+} // end CheckForValidDirectionCosines()
+
+
+/**
+ * ******************* CheckForValidConfiguration ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+void
+CubicBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::CheckForValidConfiguration( ValidTransformPointer & bSplineTransform )// const
+{
+  this->m_ConfigurationIsValid = false;
+  this->m_WarningReport.ResetWarningReport();
+
+  /** Check for valid transform: 3rd order B-spline, no initial transform, dimension 3. */
+  bool transformIsValid = this->CheckForValidTransform( bSplineTransform );
+  if ( !transformIsValid )
+  {
+    std::string message = "WARNING: No valid transform set:\n"
+      + std::string( "The transform should be 3rd order B-spline, 3D image, no initial transform.\n" )
+      + std::string( "Falling back to the generic CPU implementation." );
+    this->m_WarningReport.m_Warnings.push_back( message );
+  }
+
+  /** Check for valid interpolator: 3rd order B-spline. */
+  bool interpolatorIsValid = this->CheckForValidInterpolator();
+  if ( !interpolatorIsValid )
+  {
+    std::string message = "WARNING: No valid interpolator set:\n"
+      + std::string( "The interpolator should be 3rd order B-spline, 3D image\n" )
+      + std::string( "Falling back to the generic CPU implementation." );
+    this->m_WarningReport.m_Warnings.push_back( message );
+  }
+
+  /** Check for identity cosines. */
+  bool directionCosinesAreValid = false;
+  if ( transformIsValid )
+  {
+    directionCosinesAreValid = this->CheckForValidDirectionCosines( bSplineTransform );
+    if ( !directionCosinesAreValid )
+    {
+      std::string message = "WARNING: No valid direction cosines:\n"
+        + std::string( "The input image, output image, and B-spline grid direction should all be the identity.\n" )
+        + std::string( "Falling back to the generic CPU implementation." );
+      this->m_WarningReport.m_Warnings.push_back( message );
+    }
+  }
+
+  this->m_ConfigurationIsValid
+    = transformIsValid && interpolatorIsValid && directionCosinesAreValid;
+
+} // end CheckForValidConfiguration()
+
+
+/**
+ * ******************* GenerateData ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+void
+CubicBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::GenerateData( void )
+{
+  /** Checks! */
+  ValidTransformPointer tempTransform = NULL;
+  this->CheckForValidConfiguration( tempTransform );
+
+  /** The algorithm of the CUDA kernel can't be used. Use the ResampleImageFilter instead. */
+  if ( !this->m_ConfigurationIsValid )
+  {
+    return this->Superclass::GenerateData();
+  }
+
+  this->GenerateDataForValidConfiguration( tempTransform );
+
+} // end GenerateData()
+
+
+/**
+ * ******************* ComputeInputCoefficients ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+void
+CubicBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::ComputeInputCoefficients( void )
+{
+  /** The coefficients are reused for the next pieces of a streamed output. */
+  const InputImageType * inputPtr = this->GetInput();
+  if ( this->m_InputCoefficients.IsNotNull()
+    && this->m_InputCoefficientsSource == inputPtr
+    && this->m_InputCoefficientsMTime == inputPtr->GetMTime() )
+  {
+    return;
+  }
+
+  /** Prefilter the input image, like the CUDA kernel does before it
+   * uses cubic texture lookups.
+   */
+  typedef BSplineDecompositionImageFilter<
+    InputImageType, CoefficientImageType >              DecompositionFilterType;
+  typename DecompositionFilterType::Pointer decompositionFilter
+    = DecompositionFilterType::New();
+  decompositionFilter->SetSplineOrder( 3 );
+  decompositionFilter->SetInput( inputPtr );
+  decompositionFilter->Update();
+
+  this->m_InputCoefficients = decompositionFilter->GetOutput();
+  this->m_InputCoefficientsSource = inputPtr;
+  this->m_InputCoefficientsMTime = inputPtr->GetMTime();
+
+} // end ComputeInputCoefficients()
+
+
+/**
+ * ******************* GenerateDataForValidConfiguration ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+void
+CubicBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::GenerateDataForValidConfiguration( ValidTransformPointer bSplineTransform )
+{
+  /** Allocate the output. Only the requested region is resampled,
+   * so that the output can be streamed.
+   */
+  this->AllocateOutputs();
+  const OutputImageRegionType & outputRegion
+    = this->GetOutput()->GetBufferedRegion();
+
+  /** Prefilter the input image. */
+  this->ComputeInputCoefficients();
+
+  /** Copy the geometry in single precision. The origins are those of the
+   * first voxel of the buffers, so that the continuous indices computed
+   * from them are offsets in the buffers.
+   */
+  const InputImageRegionType & coefficientRegion
+    = this->m_InputCoefficients->GetBufferedRegion();
+  typename CoefficientImageType::PointType inputOrigin;
+  this->m_InputCoefficients->TransformIndexToPhysicalPoint(
+    coefficientRegion.GetIndex(), inputOrigin );
+  const typename InternalAdvancedBSplineTransformType::RegionType gridRegion
+    = bSplineTransform->GetGridRegion();
+  const typename InternalAdvancedBSplineTransformType::OriginType itkGridOrigin
+    = bSplineTransform->GetGridOrigin();
+  const typename InternalAdvancedBSplineTransformType::SpacingType itkGridSpacing
+    = bSplineTransform->GetGridSpacing();
+  for ( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    this->m_InputOrigin[ d ]   = static_cast<float>( inputOrigin[ d ] );
+    this->m_InputSpacing[ d ]  = static_cast<float>( this->m_InputCoefficients->GetSpacing()[ d ] );
+    this->m_InputSize[ d ]     = static_cast<long>( coefficientRegion.GetSize()[ d ] );
+    this->m_OutputOrigin[ d ]  = static_cast<float>( this->GetOutputOrigin()[ d ]
+      + outputRegion.GetIndex()[ d ] * this->GetOutputSpacing()[ d ] );
+    this->m_OutputSpacing[ d ] = static_cast<float>( this->GetOutputSpacing()[ d ] );
+    this->m_GridSpacing[ d ]   = static_cast<float>( itkGridSpacing[ d ] );
+    this->m_GridOrigin[ d ]    = static_cast<float>( itkGridOrigin[ d ]
+      + gridRegion.GetIndex()[ d ] * itkGridSpacing[ d ] );
+    this->m_GridSize[ d ]      = static_cast<long>( gridRegion.GetSize()[ d ] );
+  }
+
+  /** Copy the B-spline coefficients in single precision. */
+  std::vector<float> gridCoefficients[ 3 ];
+  for ( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    typedef typename InternalAdvancedBSplineTransformType::ImageType GridImageType;
+    const GridImageType * coefficientImage = bSplineTransform->GetCoefficientImage()[ d ];
+    const typename GridImageType::PixelType * coefficients
+      = coefficientImage->GetBufferPointer();
+    gridCoefficients[ d ].assign( coefficients,
+      coefficients + coefficientImage->GetBufferedRegion().GetNumberOfPixels() );
+  }
+
+  /** Divide the lines of the output over the threads. */
+  MultiThreaderParameterType str;
+  str.m_Filter = this;
+  str.m_InputCoefficients = this->m_InputCoefficients->GetBufferPointer();
+  str.m_GridCoefficients = gridCoefficients;
+  str.m_NumberOfLines = static_cast<long>(
+    outputRegion.GetNumberOfPixels() / outputRegion.GetSize()[ 0 ] );
+
+  const int numberOfThreads = static_cast<int>( vnl_math_max( 1L,
+    vnl_math_min( static_cast<long>( this->GetNumberOfThreads() ), str.m_NumberOfLines ) ) );
+  this->GetMultiThreader()->SetNumberOfThreads( numberOfThreads );
+  this->GetMultiThreader()->SetSingleMethod( this->ThreaderCallback, &str );
+  this->GetMultiThreader()->SingleMethodExecute();
+
+} // end GenerateDataForValidConfiguration()
+
+
+/**
+ * ******************* ThreaderCallback ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+ITK_THREAD_RETURN_TYPE
+CubicBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::ThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * infoStruct
+    = static_cast<MultiThreader::ThreadInfoStruct *>( arg );
+  const long threadId = infoStruct->ThreadID;
+  const long numberOfThreads = infoStruct->NumberOfThreads;
+  MultiThreaderParameterType * str
+    = static_cast<MultiThreaderParameterType *>( infoStruct->UserData );
+
+  /** Each thread processes a contiguous range of lines. */
+  const long firstLine = ( str->m_NumberOfLines * threadId ) / numberOfThreads;
+  const long lastLine = ( str->m_NumberOfLines * ( threadId + 1 ) ) / numberOfThreads;
+  str->m_Filter->ThreadedGenerateLines( *str, firstLine, lastLine );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ThreaderCallback()
+
+
+/**
+ * ******************* ClampIndex ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+long
+CubicBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::ClampIndex( const long index, const long size )
+{
+  return index < 0 ? 0 : ( index >= size ? size - 1 : index );
+
+} // end ClampIndex()
+
+
+/**
+ * ******************* ComputeCubicBSplineWeights ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+long
+CubicBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::ComputeCubicBSplineWeights( const float cindex, float weights[ 4 ] )
+{
+  /** The weights of the coefficients floor(cindex)-1, .., floor(cindex)+2. */
+  const float index = std::floor( cindex );
+  const float t  = cindex - index;
+  const float t2 = t * t;
+  const float t3 = t2 * t;
+  const float s  = 1.0f - t;
+
+  weights[ 0 ] = s * s * s / 6.0f;
+  weights[ 1 ] = ( 3.0f * t3 - 6.0f * t2 + 4.0f ) / 6.0f;
+  weights[ 2 ] = ( -3.0f * t3 + 3.0f * t2 + 3.0f * t + 1.0f ) / 6.0f;
+  weights[ 3 ] = t3 / 6.0f;
+
+  return static_cast<long>( index ) - 1;
+
+} // end ComputeCubicBSplineWeights()
+
+
+/**
+ * ******************* ThreadedGenerateLines ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+void
+CubicBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::ThreadedGenerateLines( const MultiThreaderParameterType & parameters,
+  const long firstLine, const long lastLine )
+{
+  OutputImageType * outputPtr = this->GetOutput();
+  const OutputImageRegionType & outputRegion = outputPtr->GetBufferedRegion();
+  const PixelType defaultValue = this->GetDefaultPixelValue();
+
+  long outputSize[ 3 ] = { 1, 1, 1 };
+  for ( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    outputSize[ d ] = static_cast<long>( outputRegion.GetSize()[ d ] );
+  }
+  const long * gridSize = this->m_GridSize;
+  const long * inputSize = this->m_InputSize;
+  const long inputSliceSize = inputSize[ 0 ] * inputSize[ 1 ];
+  const float * inputCoefficients = parameters.m_InputCoefficients;
+
+  /** The upper bounds of the region where the B-spline is evaluated, as in the CUDA kernel. */
+  float gridUpperBound[ 3 ];
+  float inputUpperBound[ 3 ];
+  for ( unsigned int d = 0; d < 3; ++d )
+  {
+    gridUpperBound[ d ] = static_cast<float>( gridSize[ d ] - 2 );
+    inputUpperBound[ d ] = static_cast<float>( inputSize[ d ] ) - 0.5f;
+  }
+
+  /** The B-spline coefficients of a line, reduced along y and z. */
+  std::vector<float> lineCoefficients( 3 * gridSize[ 0 ] );
+
+  PixelType * outputLine = outputPtr->GetBufferPointer() + firstLine * outputSize[ 0 ];
+  for ( long line = firstLine; line < lastLine; ++line, outputLine += outputSize[ 0 ] )
+  {
+    /** The y and z coordinates are constant along the line. */
+    const long y = line % outputSize[ 1 ];
+    const long z = line / outputSize[ 1 ];
+    float point[ 3 ];
+    point[ 1 ] = y * this->m_OutputSpacing[ 1 ] + this->m_OutputOrigin[ 1 ];
+    point[ 2 ] = z * this->m_OutputSpacing[ 2 ] + this->m_OutputOrigin[ 2 ];
+    const float gridY = ( point[ 1 ] - this->m_GridOrigin[ 1 ] ) / this->m_GridSpacing[ 1 ];
+    const float gridZ = ( point[ 2 ] - this->m_GridOrigin[ 2 ] ) / this->m_GridSpacing[ 2 ];
+
+    /** The whole line is outside the B-spline grid. */
+    if ( !( gridY >= 0.0f && gridY < gridUpperBound[ 1 ]
+      && gridZ >= 0.0f && gridZ < gridUpperBound[ 2 ] ) )
+    {
+      std::fill( outputLine, outputLine + outputSize[ 0 ], defaultValue );
+      continue;
+    }
+
+    /** Reduce the B-spline coefficients along y and z. */
+    float weightsY[ 4 ];
+    float weightsZ[ 4 ];
+    const long startY = this->ComputeCubicBSplineWeights( gridY, weightsY );
+    const long startZ = this->ComputeCubicBSplineWeights( gridZ, weightsZ );
+    long rowOffsets[ 16 ];
+    float rowWeights[ 16 ];
+    for ( unsigned int k = 0; k < 4; ++k )
+    {
+      for ( unsigned int j = 0; j < 4; ++j )
+      {
+        rowOffsets[ 4 * k + j ] = ( this->ClampIndex( startZ + k, gridSize[ 2 ] ) * gridSize[ 1 ]
+          + this->ClampIndex( startY + j, gridSize[ 1 ] ) ) * gridSize[ 0 ];
+        rowWeights[ 4 * k + j ] = weightsZ[ k ] * weightsY[ j ];
+      }
+    }
+    for ( unsigned int d = 0; d < 3; ++d )
+    {
+      float * lineCoefficient = &( lineCoefficients[ d * gridSize[ 0 ] ] );
+      std::fill( lineCoefficient, lineCoefficient + gridSize[ 0 ], 0.0f );
+      for ( unsigned int r = 0; r < 16; ++r )
+      {
+        const float * rowCoefficient = &( parameters.m_GridCoefficients[ d ][ rowOffsets[ r ] ] );
+        const float rowWeight = rowWeights[ r ];
+        for ( long i = 0; i < gridSize[ 0 ]; ++i )
+        {
+          lineCoefficient[ i ] += rowWeight * rowCoefficient[ i ];
+        }
+      }
+    }
+
+    /** Resample the voxels of the line. */
+    for ( long x = 0; x < outputSize[ 0 ]; ++x )
+    {
+      point[ 0 ] = x * this->m_OutputSpacing[ 0 ] + this->m_OutputOrigin[ 0 ];
+      const float gridX = ( point[ 0 ] - this->m_GridOrigin[ 0 ] ) / this->m_GridSpacing[ 0 ];
+      if ( !( gridX >= 0.0f && gridX < gridUpperBound[ 0 ] ) )
+      {
+        outputLine[ x ] = defaultValue;
+        continue;
+      }
+
+      /** Evaluate the displacement and compute the input continuous index. */
+      float weightsX[ 4 ];
+      const long startX = this->ComputeCubicBSplineWeights( gridX, weightsX );
+      long indicesX[ 4 ];
+      for ( unsigned int i = 0; i < 4; ++i )
+      {
+        indicesX[ i ] = this->ClampIndex( startX + i, gridSize[ 0 ] );
+      }
+      float cindex[ 3 ];
+      bool isInside = true;
+      for ( unsigned int d = 0; d < 3; ++d )
+      {
+        const float * lineCoefficient = &( lineCoefficients[ d * gridSize[ 0 ] ] );
+        float displacement = 0.0f;
+        for ( unsigned int i = 0; i < 4; ++i )
+        {
+          displacement += weightsX[ i ] * lineCoefficient[ indicesX[ i ] ];
+        }
+        cindex[ d ] = ( point[ d ] + displacement - this->m_InputOrigin[ d ] )
+          / this->m_InputSpacing[ d ];
+        isInside &= ( cindex[ d ] > -0.5f && cindex[ d ] < inputUpperBound[ d ] );
+      }
+      if ( !isInside )
+      {
+        outputLine[ x ] = defaultValue;
+        continue;
+      }
+
+      /** Third order B-spline interpolation of the input image. */
+      float weights[ 3 ][ 4 ];
+      long offsets[ 3 ][ 4 ];
+      for ( unsigned int d = 0; d < 3; ++d )
+      {
+        const long start = this->ComputeCubicBSplineWeights( cindex[ d ], weights[ d ] );
+        for ( unsigned int i = 0; i < 4; ++i )
+        {
+          offsets[ d ][ i ] = this->ClampIndex( start + i, inputSize[ d ] );
+        }
+      }
+      for ( unsigned int i = 0; i < 4; ++i )
+      {
+        offsets[ 1 ][ i ] *= inputSize[ 0 ];
+        offsets[ 2 ][ i ] *= inputSliceSize;
+      }
+      float value = 0.0f;
+      for ( unsigned int k = 0; k < 4; ++k )
+      {
+        float valueZ = 0.0f;
+        for ( unsigned int j = 0; j < 4; ++j )
+        {
+          const float * row = inputCoefficients + offsets[ 2 ][ k ] + offsets[ 1 ][ j ];
+          const float valueY = weights[ 0 ][ 0 ] * row[ offsets[ 0 ][ 0 ] ]
+            + weights[ 0 ][ 1 ] * row[ offsets[ 0 ][ 1 ] ]
+            + weights[ 0 ][ 2 ] * row[ offsets[ 0 ][ 2 ] ]
+            + weights[ 0 ][ 3 ] * row[ offsets[ 0 ][ 3 ] ];
+          valueZ += weights[ 1 ][ j ] * valueY;
+        }
+        value += weights[ 2 ][ k ] * valueZ;
+      }
+      outputLine[ x ] = static_cast<PixelType>( value );
+
+    } // end for x
+  } // end for lines
+
+} // end ThreadedGenerateLines()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkCubicBSplineResampleImageFilter_txx
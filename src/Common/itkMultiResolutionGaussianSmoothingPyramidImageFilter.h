@@ -182,6 +182,19 @@ public:
    * ProcessObject::GenerateInputRequestedRegion() */
   virtual void GenerateInputRequestedRegion();
 
+  /** Set/Get whether only the output of CurrentLevel is computed. The other
+   * outputs are released. This allows a registration method to generate the
+   * levels one at a time, instead of keeping all of them in memory.
+   * Default: false.
+   */
+  itkSetMacro( ComputeOnlyForCurrentLevel, bool );
+  itkGetConstMacro( ComputeOnlyForCurrentLevel, bool );
+  itkBooleanMacro( ComputeOnlyForCurrentLevel );
+
+  /** Set/Get the level that is computed if ComputeOnlyForCurrentLevel is true. */
+  itkSetMacro( CurrentLevel, unsigned int );
+  itkGetConstMacro( CurrentLevel, unsigned int );
+
 protected:
   MultiResolutionGaussianSmoothingPyramidImageFilter();
   ~MultiResolutionGaussianSmoothingPyramidImageFilter() {};
@@ -199,6 +212,9 @@ private:
   MultiResolutionGaussianSmoothingPyramidImageFilter(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
 
+  bool          m_ComputeOnlyForCurrentLevel;
+  unsigned int  m_CurrentLevel;
+
 };
 
 
@@ -51,6 +51,8 @@ template <class TInputImage, class TOutputImage>
 MultiResolutionGaussianSmoothingPyramidImageFilter<TInputImage, TOutputImage>
 ::MultiResolutionGaussianSmoothingPyramidImageFilter()
 {
+  this->m_ComputeOnlyForCurrentLevel = false;
+  this->m_CurrentLevel = 0;
 }
 
 
@@ -142,8 +144,15 @@ MultiResolutionGaussianSmoothingPyramidImageFilter<TInputImage, TOutputImage>
     this->UpdateProgress( static_cast<float>( ilevel ) /
                           static_cast<float>( this->m_NumberOfLevels ) );
 
-    // Allocate memory for each output
+    // Only compute the current level, if desired
     OutputImagePointer outputPtr = this->GetOutput( ilevel );
+    if ( this->m_ComputeOnlyForCurrentLevel && ilevel != this->m_CurrentLevel )
+    {
+      outputPtr->ReleaseData();
+      continue;
+    }
+
+    // Allocate memory for each output
     outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
     outputPtr->Allocate();
 
@@ -215,6 +224,9 @@ MultiResolutionGaussianSmoothingPyramidImageFilter<TInputImage, TOutputImage>
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   Superclass::PrintSelf(os,indent);
+  os << indent << "ComputeOnlyForCurrentLevel: "
+    << this->m_ComputeOnlyForCurrentLevel << std::endl;
+  os << indent << "CurrentLevel: " << this->m_CurrentLevel << std::endl;
 }
 
 
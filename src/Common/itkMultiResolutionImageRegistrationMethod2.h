@@ -209,6 +209,18 @@ public:
   /** Get the current resolution level being processed. */
   itkGetMacro( CurrentLevel, unsigned long );
 
+  /** Set/Get whether the pyramid images are computed per level, just before
+   * the level is processed, instead of all levels at the start of the
+   * registration. Together with the release of each level after it has been
+   * processed, only one level of each pyramid is kept in memory. This is
+   * supported by the MultiResolutionGaussianSmoothingPyramidImageFilter and
+   * the MultiResolutionShrinkPyramidImageFilter; other pyramids compute all
+   * levels at the start. Default: false.
+   */
+  itkSetMacro( ComputePyramidLevelsOnDemand, bool );
+  itkGetConstMacro( ComputePyramidLevelsOnDemand, bool );
+  itkBooleanMacro( ComputePyramidLevelsOnDemand );
+
   /** Set/Get the initial transformation parameters. */
   itkSetMacro( InitialTransformParameters, ParametersType );
   itkGetConstReferenceMacro( InitialTransformParameters, ParametersType );
@@ -263,6 +275,20 @@ protected:
   /** Compute the size of the fixed region for each level of the pyramid. */
   virtual void PreparePyramids( void );
 
+  /** Compute the pyramid images of the current level, for the pyramids that
+   * compute their levels on demand. Called before each level.
+   */
+  virtual void UpdatePyramidsForCurrentLevel( void );
+
+  /** Let a pyramid compute only the output of the given level, or all
+   * outputs if computeOnlyForLevel is false. Returns false if the pyramid
+   * does not support the computation of a single level.
+   */
+  template < class TImage >
+  static bool ConfigurePyramidLevel(
+    MultiResolutionPyramidImageFilter< TImage, TImage > * pyramid,
+    const bool computeOnlyForLevel, const unsigned long level );
+
   /** Set the current level to be processed. */
   itkSetMacro( CurrentLevel, unsigned long );
 
@@ -297,6 +323,10 @@ private:
   unsigned long                    m_NumberOfLevels;
   unsigned long                    m_CurrentLevel;
 
+  bool                             m_ComputePyramidLevelsOnDemand;
+  bool                             m_FixedImagePyramidOnDemand;
+  bool                             m_MovingImagePyramidOnDemand;
+
 }; // end class MultiResolutionImageRegistrationMethod2
 
 
@@ -37,6 +37,8 @@
 
 #include "itkMultiResolutionImageRegistrationMethod2.h"
 #include "itkRecursiveMultiResolutionPyramidImageFilter.h"
+#include "itkMultiResolutionGaussianSmoothingPyramidImageFilter.h"
+#include "itkMultiResolutionShrinkPyramidImageFilter.h"
 #include "itkContinuousIndex.h"
 #include "vnl/vnl_math.h"
 
@@ -67,6 +69,10 @@ MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
   this->m_NumberOfLevels = 1;
   this->m_CurrentLevel = 0;
 
+  this->m_ComputePyramidLevelsOnDemand = false;
+  this->m_FixedImagePyramidOnDemand = false;
+  this->m_MovingImagePyramidOnDemand = false;
+
   this->m_Stop = false;
 
   this->m_InitialTransformParameters = ParametersType(0);
@@ -196,15 +202,36 @@ MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
     itkExceptionMacro(<<"Moving image pyramid is not present");
     }
 
-  // Setup the fixed image pyramid
+  // Setup the fixed image pyramid. If the levels are computed on demand,
+  // only the output information is needed here.
   this->m_FixedImagePyramid->SetNumberOfLevels( this->m_NumberOfLevels );
   this->m_FixedImagePyramid->SetInput( this->m_FixedImage );
-  this->m_FixedImagePyramid->UpdateLargestPossibleRegion();
+  this->m_FixedImagePyramidOnDemand = Self::ConfigurePyramidLevel(
+    this->m_FixedImagePyramid.GetPointer(), this->m_ComputePyramidLevelsOnDemand, 0 )
+    && this->m_ComputePyramidLevelsOnDemand;
+  if ( this->m_FixedImagePyramidOnDemand )
+  {
+    this->m_FixedImagePyramid->UpdateOutputInformation();
+  }
+  else
+  {
+    this->m_FixedImagePyramid->UpdateLargestPossibleRegion();
+  }
 
   // Setup the moving image pyramid
   this->m_MovingImagePyramid->SetNumberOfLevels( this->m_NumberOfLevels );
   this->m_MovingImagePyramid->SetInput( this->m_MovingImage );
-  this->m_MovingImagePyramid->UpdateLargestPossibleRegion();
+  this->m_MovingImagePyramidOnDemand = Self::ConfigurePyramidLevel(
+    this->m_MovingImagePyramid.GetPointer(), this->m_ComputePyramidLevelsOnDemand, 0 )
+    && this->m_ComputePyramidLevelsOnDemand;
+  if ( this->m_MovingImagePyramidOnDemand )
+  {
+    this->m_MovingImagePyramid->UpdateOutputInformation();
+  }
+  else
+  {
+    this->m_MovingImagePyramid->UpdateLargestPossibleRegion();
+  }
 
   typedef typename FixedImageRegionType::SizeType         SizeType;
   typedef typename FixedImageRegionType::IndexType        IndexType;
@@ -270,6 +297,70 @@ MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
 } // end PreparePyramids()
 
 
+/*
+ * Compute the pyramid images of the current level
+ */
+template < typename TFixedImage, typename TMovingImage >
+void
+MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
+::UpdatePyramidsForCurrentLevel( void )
+{
+  if ( this->m_FixedImagePyramidOnDemand )
+  {
+    Self::ConfigurePyramidLevel( this->m_FixedImagePyramid.GetPointer(),
+      true, this->m_CurrentLevel );
+    this->m_FixedImagePyramid->UpdateLargestPossibleRegion();
+  }
+
+  if ( this->m_MovingImagePyramidOnDemand )
+  {
+    Self::ConfigurePyramidLevel( this->m_MovingImagePyramid.GetPointer(),
+      true, this->m_CurrentLevel );
+    this->m_MovingImagePyramid->UpdateLargestPossibleRegion();
+  }
+
+} // end UpdatePyramidsForCurrentLevel()
+
+
+/*
+ * Let a pyramid compute a single level
+ */
+template < typename TFixedImage, typename TMovingImage >
+template < class TImage >
+bool
+MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
+::ConfigurePyramidLevel(
+  MultiResolutionPyramidImageFilter< TImage, TImage > * pyramid,
+  const bool computeOnlyForLevel, const unsigned long level )
+{
+  typedef MultiResolutionGaussianSmoothingPyramidImageFilter<
+    TImage, TImage >                                  SmoothingPyramidType;
+  typedef MultiResolutionShrinkPyramidImageFilter<
+    TImage, TImage >                                  ShrinkPyramidType;
+
+  SmoothingPyramidType * smoothingPyramid
+    = dynamic_cast< SmoothingPyramidType * >( pyramid );
+  if ( smoothingPyramid )
+  {
+    smoothingPyramid->SetComputeOnlyForCurrentLevel( computeOnlyForLevel );
+    smoothingPyramid->SetCurrentLevel( level );
+    return true;
+  }
+
+  ShrinkPyramidType * shrinkPyramid
+    = dynamic_cast< ShrinkPyramidType * >( pyramid );
+  if ( shrinkPyramid )
+  {
+    shrinkPyramid->SetComputeOnlyForCurrentLevel( computeOnlyForLevel );
+    shrinkPyramid->SetCurrentLevel( level );
+    return true;
+  }
+
+  return false;
+
+} // end ConfigurePyramidLevel()
+
+
 /*
  * Starts the Registration Process
  */
@@ -304,6 +395,10 @@ MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
           this->m_CurrentLevel++ )
       {
 
+      // Compute the pyramid images of this level, if that was not
+      // done for all levels in PreparePyramids().
+      this->UpdatePyramidsForCurrentLevel();
+
       // Invoke an iteration event.
       // This allows a UI to reset any of the components between
       // resolution level.
@@ -388,6 +483,8 @@ MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
 
   os << indent << "NumberOfLevels: " << this->m_NumberOfLevels << std::endl;
   os << indent << "CurrentLevel: " << this->m_CurrentLevel << std::endl;
+  os << indent << "ComputePyramidLevelsOnDemand: "
+    << this->m_ComputePyramidLevelsOnDemand << std::endl;
 
   os << indent << "InitialTransformParameters: "
     << this->m_InitialTransformParameters << std::endl;
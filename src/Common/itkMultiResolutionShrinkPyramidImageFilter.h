@@ -70,6 +70,19 @@ public:
   /** Overwrite the Superclass implementation: no padding required. */
   virtual void GenerateInputRequestedRegion( void );
 
+  /** Set/Get whether only the output of CurrentLevel is computed. The other
+   * outputs are released. This allows a registration method to generate the
+   * levels one at a time, instead of keeping all of them in memory.
+   * Default: false.
+   */
+  itkSetMacro( ComputeOnlyForCurrentLevel, bool );
+  itkGetConstMacro( ComputeOnlyForCurrentLevel, bool );
+  itkBooleanMacro( ComputeOnlyForCurrentLevel );
+
+  /** Set/Get the level that is computed if ComputeOnlyForCurrentLevel is true. */
+  itkSetMacro( CurrentLevel, unsigned int );
+  itkGetConstMacro( CurrentLevel, unsigned int );
+
 #ifdef ITK_USE_CONCEPT_CHECKING
   /** Begin concept checking */
   itkConceptMacro(SameDimensionCheck,
@@ -80,7 +93,11 @@ public:
 #endif
 
 protected:
-  MultiResolutionShrinkPyramidImageFilter() {};
+  MultiResolutionShrinkPyramidImageFilter()
+  {
+    this->m_ComputeOnlyForCurrentLevel = false;
+    this->m_CurrentLevel = 0;
+  };
   ~MultiResolutionShrinkPyramidImageFilter() {};
 
   /** Generate the output data. */
@@ -90,6 +107,9 @@ private:
   MultiResolutionShrinkPyramidImageFilter(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
 
+  bool          m_ComputeOnlyForCurrentLevel;
+  unsigned int  m_CurrentLevel;
+
 };
 
 
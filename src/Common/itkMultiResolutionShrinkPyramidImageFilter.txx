@@ -46,8 +46,15 @@ MultiResolutionShrinkPyramidImageFilter<TInputImage, TOutputImage>
     this->UpdateProgress( static_cast<float>( ilevel )
       / static_cast<float>( this->m_NumberOfLevels ) );
 
-    // Allocate memory for each output
+    // Only compute the current level, if desired
     OutputImagePointer outputPtr = this->GetOutput( ilevel );
+    if ( this->m_ComputeOnlyForCurrentLevel && ilevel != this->m_CurrentLevel )
+    {
+      outputPtr->ReleaseData();
+      continue;
+    }
+
+    // Allocate memory for each output
     outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
     outputPtr->Allocate();
 
@@ -0,0 +1,172 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkTiledResampleImageFilter_h
+#define __itkTiledResampleImageFilter_h
+
+#include "itkResampleImageFilter.h"
+#include "itkAdvancedTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedBSplineDeformableTransformBase.h"
+#include <vector>
+
+namespace itk
+{
+
+  /** \class TiledResampleImageFilter
+   *
+   * \brief A ResampleImageFilter that processes the output in tiles.
+   *
+   * The ResampleImageFilter visits the output voxels in raster order and
+   * transforms each of them separately. For a B-spline transform on a large
+   * volume, consecutive output lines then touch coefficients and moving
+   * image voxels that have long been evicted from the cache.
+   *
+   * When UseTiles is on and the transform is a nonlinear AdvancedTransform,
+   * this filter instead splits the region of each thread in tiles. A tile
+   * is processed line by line: the input points of a line are computed
+   * incrementally from the first one, transformed together with the batch
+   * AdvancedTransform::TransformPoints(), and then interpolated. By default
+   * the tiles are the cells of the B-spline grid, if the transform (or the
+   * current transform of a combination) is a B-spline transform that is
+   * evaluated at the output points, and the grid is aligned with the output
+   * image. The voxels of a tile then share one support region, so the
+   * B-spline transform gathers its coefficients once per batch of lines.
+   * Cells of less than 4 voxels are merged, and cells of more than 64
+   * voxels are split. If the grid cannot be aligned, for example after a
+   * composition with an initial transform, the tiles have the size of a
+   * cell, but start at the start of the region. A tile then maps to a
+   * compact part of the moving image.
+   *
+   * Linear transforms are left to the superclass, which already computes
+   * the mapped points incrementally. The output equals that of the
+   * superclass up to rounding errors in the computation of the input points.
+   *
+   * \ingroup GeometricTransforms
+   */
+
+  template < class TInputImage, class TOutputImage,
+    class TInterpolatorPrecisionType = double >
+  class TiledResampleImageFilter :
+    public ResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+  {
+  public:
+
+    /** Standard ITK-stuff. */
+    typedef TiledResampleImageFilter                  Self;
+    typedef ResampleImageFilter<
+      TInputImage, TOutputImage,
+      TInterpolatorPrecisionType >                    Superclass;
+    typedef SmartPointer<Self>                        Pointer;
+    typedef SmartPointer<const Self>                  ConstPointer;
+
+    /** Method for creation through the object factory. */
+    itkNewMacro( Self );
+
+    /** Run-time type information (and related methods). */
+    itkTypeMacro( TiledResampleImageFilter, ResampleImageFilter );
+
+    /** The image dimension. */
+    itkStaticConstMacro( ImageDimension, unsigned int, TOutputImage::ImageDimension );
+
+    /** Typedefs from the superclass. */
+    typedef typename Superclass::OutputImageType        OutputImageType;
+    typedef typename Superclass::TransformType          TransformType;
+    typedef typename Superclass::InterpolatorType       InterpolatorType;
+    typedef typename Superclass::SizeType               SizeType;
+    typedef typename Superclass::IndexType              IndexType;
+    typedef typename Superclass::PointType              PointType;
+    typedef typename Superclass::PixelType              PixelType;
+    typedef typename Superclass::OutputImageRegionType  OutputImageRegionType;
+
+    /** Typedefs for the transforms. */
+    typedef AdvancedTransform< TInterpolatorPrecisionType,
+      itkGetStaticConstMacro( ImageDimension ),
+      itkGetStaticConstMacro( ImageDimension ) >      AdvancedTransformType;
+    typedef AdvancedCombinationTransform< TInterpolatorPrecisionType,
+      itkGetStaticConstMacro( ImageDimension ) >      CombinationTransformType;
+    typedef AdvancedBSplineDeformableTransformBase< TInterpolatorPrecisionType,
+      itkGetStaticConstMacro( ImageDimension ) >      BSplineTransformBaseType;
+
+    /** Set/Get whether to process the output in tiles. Default: false. */
+    itkSetMacro( UseTiles, bool );
+    itkGetConstMacro( UseTiles, bool );
+    itkBooleanMacro( UseTiles );
+
+    /** Set/Get the size of the tiles, in voxels. A zero component is
+     * replaced by the number of voxels per B-spline grid cell in that
+     * dimension, or 32 if the transform is not a B-spline transform.
+     * In a dimension with a zero component, the tiles follow the cells
+     * of an aligned B-spline grid instead. Default: all zero.
+     */
+    itkSetMacro( TileSize, SizeType );
+    itkGetConstReferenceMacro( TileSize, SizeType );
+
+    /** Get the tile size that was used in the last update. */
+    itkGetConstReferenceMacro( ComputedTileSize, SizeType );
+
+  protected:
+
+    /** The constructor. */
+    TiledResampleImageFilter();
+
+    /** The destructor. */
+    virtual ~TiledResampleImageFilter() {};
+
+    /** PrintSelf. */
+    void PrintSelf( std::ostream & os, Indent indent ) const;
+
+    /** Determine whether tiles are used, and compute their size. */
+    virtual void BeforeThreadedGenerateData( void );
+
+    /** Resample a region, in tiles if possible. */
+    virtual void ThreadedGenerateData(
+      const OutputImageRegionType & outputRegionForThread, int threadId );
+
+    /** Resample a region in tiles. */
+    virtual void TiledThreadedGenerateData(
+      const OutputImageRegionType & outputRegionForThread, int threadId );
+
+    /** Find the B-spline transform in the transform, if any. */
+    virtual const BSplineTransformBaseType * GetBSplineTransform( void ) const;
+
+    /** Compute the output indices where a cell of the B-spline grid starts,
+     * for each dimension in which the grid is aligned with the output image.
+     */
+    virtual void ComputeCellBoundaries( const BSplineTransformBaseType * bsplineTransform );
+
+  private:
+
+    /** The private constructor. */
+    TiledResampleImageFilter( const Self& ); // purposely not implemented
+    /** The private copy constructor. */
+    void operator=( const Self& );           // purposely not implemented
+
+    /** Member variables. */
+    bool                            m_UseTiles;
+    SizeType                        m_TileSize;
+    SizeType                        m_ComputedTileSize;
+    const AdvancedTransformType *   m_AdvancedTransform;
+    std::vector< long >             m_CellBoundaries[ ImageDimension ];
+
+  }; // end class TiledResampleImageFilter
+
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkTiledResampleImageFilter.txx"
+#endif
+
+#endif // end #ifndef __itkTiledResampleImageFilter_h
@@ -0,0 +1,478 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkTiledResampleImageFilter_txx
+#define __itkTiledResampleImageFilter_txx
+
+#include "itkTiledResampleImageFilter.h"
+#include "itkProgressReporter.h"
+#include "itkNumericTraits.h"
+#include "vnl/vnl_math.h"
+
+#include <vector>
+
+namespace itk
+{
+
+  /**
+   * ******************* Constructor *******************
+   */
+
+  template < class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+  TiledResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+  ::TiledResampleImageFilter()
+  {
+    this->m_UseTiles = false;
+    this->m_TileSize.Fill( 0 );
+    this->m_ComputedTileSize.Fill( 0 );
+    this->m_AdvancedTransform = 0;
+
+  } // end Constructor
+
+
+  /**
+   * ******************* BeforeThreadedGenerateData *******************
+   */
+
+  template < class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+  void
+  TiledResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+  ::BeforeThreadedGenerateData( void )
+  {
+    this->Superclass::BeforeThreadedGenerateData();
+
+    /** Tiles are only used for nonlinear advanced transforms. */
+    this->m_AdvancedTransform = 0;
+    this->m_ComputedTileSize.Fill( 0 );
+    for ( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      this->m_CellBoundaries[ d ].clear();
+    }
+    const TransformType * transform = this->GetTransform();
+    if ( !this->m_UseTiles || transform == 0 || transform->IsLinear() )
+    {
+      return;
+    }
+    this->m_AdvancedTransform
+      = dynamic_cast<const AdvancedTransformType *>( transform );
+    if ( this->m_AdvancedTransform == 0 )
+    {
+      return;
+    }
+
+    /** Fill in the tile size, by default from the B-spline grid spacing. */
+    const BSplineTransformBaseType * bsplineTransform = this->GetBSplineTransform();
+    const typename OutputImageType::SpacingType & outputSpacing
+      = this->GetOutputSpacing();
+    for ( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      unsigned long tileSize = this->m_TileSize[ d ];
+      if ( tileSize == 0 && bsplineTransform != 0 )
+      {
+        const double voxelsPerCell = bsplineTransform->GetGridSpacing()[ d ]
+          / outputSpacing[ d ];
+        tileSize = static_cast<unsigned long>( vnl_math_max( 4, vnl_math_min( 64,
+          vnl_math_rnd( voxelsPerCell ) ) ) );
+      }
+      else if ( tileSize == 0 )
+      {
+        tileSize = 32;
+      }
+      this->m_ComputedTileSize[ d ] = tileSize;
+    }
+
+    /** Let the tiles follow the cells of the B-spline grid. */
+    if ( bsplineTransform != 0 )
+    {
+      this->ComputeCellBoundaries( bsplineTransform );
+    }
+
+  } // end BeforeThreadedGenerateData()
+
+
+  /**
+   * ******************* GetBSplineTransform *******************
+   */
+
+  template < class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+  const typename TiledResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+  ::BSplineTransformBaseType *
+  TiledResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+  ::GetBSplineTransform( void ) const
+  {
+    const BSplineTransformBaseType * bsplineTransform
+      = dynamic_cast<const BSplineTransformBaseType *>( this->GetTransform() );
+    if ( bsplineTransform != 0 )
+    {
+      return bsplineTransform;
+    }
+
+    /** Look at the current transform of a combination. */
+    const CombinationTransformType * combination
+      = dynamic_cast<const CombinationTransformType *>( this->GetTransform() );
+    if ( combination != 0 )
+    {
+      bsplineTransform = dynamic_cast<const BSplineTransformBaseType *>(
+        const_cast<CombinationTransformType *>( combination )->GetCurrentTransform() );
+    }
+    return bsplineTransform;
+
+  } // end GetBSplineTransform()
+
+
+  /**
+   * ******************* ComputeCellBoundaries *******************
+   */
+
+  template < class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+  void
+  TiledResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+  ::ComputeCellBoundaries( const BSplineTransformBaseType * bsplineTransform )
+  {
+    /** The B-spline transform should be evaluated at the output points,
+     * not at the points mapped by an initial transform.
+     */
+    const CombinationTransformType * combination
+      = dynamic_cast<const CombinationTransformType *>( this->GetTransform() );
+    if ( combination != 0 && combination->GetInitialTransform() != 0
+      && combination->GetUseComposition() )
+    {
+      return;
+    }
+
+    /** Compute the continuous grid index of the output index 0, and its
+     * change per step along each dimension of the output image.
+     */
+    typedef typename BSplineTransformBaseType::DirectionType  GridDirectionType;
+    GridDirectionType gridIndexToPoint = bsplineTransform->GetGridDirection();
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+        gridIndexToPoint[ i ][ j ] *= bsplineTransform->GetGridSpacing()[ j ];
+      }
+    }
+    GridDirectionType gridPointToIndex;
+    gridPointToIndex = gridIndexToPoint.GetInverse();
+
+    const OutputImageType * outputPtr = this->GetOutput();
+    IndexType index;
+    index.Fill( 0 );
+    PointType point0;
+    outputPtr->TransformIndexToPhysicalPoint( index, point0 );
+    const typename PointType::VectorType gridIndex0
+      = gridPointToIndex * ( point0 - bsplineTransform->GetGridOrigin() );
+    GridDirectionType gridIndexSteps;
+    for ( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      index.Fill( 0 );
+      index[ d ] = 1;
+      PointType point;
+      outputPtr->TransformIndexToPhysicalPoint( index, point );
+      const typename PointType::VectorType step = gridPointToIndex * ( point - point0 );
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+        gridIndexSteps[ i ][ d ] = step[ i ];
+      }
+    }
+
+    /** The tiles can only follow the cells if the grid is aligned with the
+     * output image, i.e. if a grid index only depends on one output index.
+     */
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      for ( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+        if ( i != d && vcl_abs( gridIndexSteps[ i ][ d ] )
+          > 1e-6 * vcl_abs( gridIndexSteps[ i ][ i ] ) )
+        {
+          return;
+        }
+      }
+    }
+
+    /** A new support region starts where the continuous grid index, minus
+     * this shift, passes an integer.
+     */
+    const double shift = bsplineTransform->GetSplineOrderOdd() ? 0.0 : 0.5;
+    const long minimumCellSize = 4;
+    const long maximumCellSize = 64;
+
+    const OutputImageRegionType & region = outputPtr->GetRequestedRegion();
+    for ( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      /** A tile size given by the user is kept. */
+      if ( this->m_TileSize[ d ] != 0 )
+      {
+        continue;
+      }
+
+      /** Find the start of each cell. Cells that are too small are merged
+       * with the next, and cells that are too large are split.
+       */
+      std::vector< long > & boundaries = this->m_CellBoundaries[ d ];
+      const long begin = region.GetIndex()[ d ];
+      const long end = begin + static_cast<long>( region.GetSize()[ d ] );
+      long previousCell = 0;
+      for ( long i = begin; i < end; ++i )
+      {
+        const long cell = static_cast<long>( vcl_floor(
+          gridIndex0[ d ] + gridIndexSteps[ d ][ d ] * static_cast<double>( i ) - shift ) );
+        if ( i == begin )
+        {
+          boundaries.push_back( i );
+        }
+        else if ( cell != previousCell && i - boundaries.back() >= minimumCellSize )
+        {
+          boundaries.push_back( i );
+        }
+        else if ( i - boundaries.back() >= maximumCellSize )
+        {
+          boundaries.push_back( i );
+        }
+        previousCell = cell;
+      }
+    }
+
+  } // end ComputeCellBoundaries()
+
+
+  /**
+   * ******************* ThreadedGenerateData *******************
+   */
+
+  template < class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+  void
+  TiledResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+  ::ThreadedGenerateData( const OutputImageRegionType & outputRegionForThread,
+    int threadId )
+  {
+    if ( this->m_AdvancedTransform == 0 )
+    {
+      this->Superclass::ThreadedGenerateData( outputRegionForThread, threadId );
+      return;
+    }
+
+    this->TiledThreadedGenerateData( outputRegionForThread, threadId );
+
+  } // end ThreadedGenerateData()
+
+
+  /**
+   * ******************* TiledThreadedGenerateData *******************
+   */
+
+  template < class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+  void
+  TiledResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+  ::TiledThreadedGenerateData( const OutputImageRegionType & outputRegionForThread,
+    int threadId )
+  {
+    typedef typename PointType::VectorType    VectorType;
+
+    OutputImageType * outputPtr = this->GetOutput();
+    const InterpolatorType * interpolator = this->GetInterpolator();
+    const PixelType defaultValue = this->GetDefaultPixelValue();
+    const SizeType & tileSize = this->m_ComputedTileSize;
+    const IndexType & regionIndex = outputRegionForThread.GetIndex();
+    const SizeType & regionSize = outputRegionForThread.GetSize();
+
+    /** The physical point of an index is a linear function of the index,
+     * so it is computed from the first point of the region and the steps
+     * along each dimension.
+     */
+    PointType regionPoint;
+    outputPtr->TransformIndexToPhysicalPoint( regionIndex, regionPoint );
+    VectorType steps[ ImageDimension ];
+    for ( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      IndexType index = regionIndex;
+      ++index[ d ];
+      PointType point;
+      outputPtr->TransformIndexToPhysicalPoint( index, point );
+      steps[ d ] = point - regionPoint;
+    }
+
+    /** The output values are clamped to the range of the pixel type. */
+    typedef typename InterpolatorType::OutputType InterpolatorOutputType;
+    const InterpolatorOutputType minimumValue
+      = static_cast<InterpolatorOutputType>( NumericTraits<PixelType>::NonpositiveMin() );
+    const InterpolatorOutputType maximumValue
+      = static_cast<InterpolatorOutputType>( NumericTraits<PixelType>::max() );
+
+    /** Compute the start of the tiles in each dimension, followed by the
+     * end of the region. The tiles follow the cells of the B-spline grid
+     * where these are known, and have a fixed size otherwise.
+     */
+    std::vector< long > tileStarts[ ImageDimension ];
+    unsigned long totalNumberOfTiles = 1;
+    for ( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      const long begin = regionIndex[ d ];
+      const long end = begin + static_cast<long>( regionSize[ d ] );
+      tileStarts[ d ].push_back( begin );
+      if ( !this->m_CellBoundaries[ d ].empty() )
+      {
+        for ( unsigned int i = 0; i < this->m_CellBoundaries[ d ].size(); ++i )
+        {
+          const long boundary = this->m_CellBoundaries[ d ][ i ];
+          if ( boundary > begin && boundary < end )
+          {
+            tileStarts[ d ].push_back( boundary );
+          }
+        }
+      }
+      else
+      {
+        const long step = static_cast<long>( tileSize[ d ] );
+        for ( long boundary = begin + step; boundary < end; boundary += step )
+        {
+          tileStarts[ d ].push_back( boundary );
+        }
+      }
+      tileStarts[ d ].push_back( end );
+      totalNumberOfTiles *= tileStarts[ d ].size() - 1;
+    }
+
+    /** Storage for the points of a batch of lines of a tile. All lines of
+     * a small tile are transformed together, so that the B-spline transform
+     * gathers the coefficients of the tile once.
+     */
+    unsigned long maximumLineLength = 1;
+    for ( unsigned int i = 0; i + 1 < tileStarts[ 0 ].size(); ++i )
+    {
+      maximumLineLength = vnl_math_max( maximumLineLength,
+        static_cast<unsigned long>( tileStarts[ 0 ][ i + 1 ] - tileStarts[ 0 ][ i ] ) );
+    }
+    const unsigned long linesPerBatch
+      = vnl_math_max( 1ul, 4096ul / maximumLineLength );
+    std::vector< PointType > inputPoints( linesPerBatch * maximumLineLength );
+    std::vector< PointType > outputPoints( linesPerBatch * maximumLineLength );
+    std::vector< IndexType > lineIndices( linesPerBatch );
+
+    ProgressReporter progress( this, threadId,
+      outputRegionForThread.GetNumberOfPixels() );
+
+    for ( unsigned long tile = 0; tile < totalNumberOfTiles; ++tile )
+    {
+      /** Compute the start and size of the tile. */
+      IndexType tileIndex;
+      SizeType tileExtent;
+      unsigned long rest = tile;
+      unsigned long numberOfLines = 1;
+      for ( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+        const unsigned long numberOfTiles = tileStarts[ d ].size() - 1;
+        const unsigned long position = rest % numberOfTiles;
+        rest /= numberOfTiles;
+        tileIndex[ d ] = tileStarts[ d ][ position ];
+        tileExtent[ d ] = static_cast<unsigned long>(
+          tileStarts[ d ][ position + 1 ] - tileStarts[ d ][ position ] );
+        if ( d > 0 )
+        {
+          numberOfLines *= tileExtent[ d ];
+        }
+      }
+      const unsigned long lineLength = tileExtent[ 0 ];
+
+      for ( unsigned long firstLine = 0; firstLine < numberOfLines; firstLine += linesPerBatch )
+      {
+        const unsigned long numberOfBatchLines
+          = vnl_math_min( linesPerBatch, numberOfLines - firstLine );
+
+        /** Compute the input points of the lines and transform them together. */
+        PointType * inputPoint = &( inputPoints[ 0 ] );
+        for ( unsigned long line = 0; line < numberOfBatchLines; ++line )
+        {
+          IndexType & lineIndex = lineIndices[ line ];
+          lineIndex = tileIndex;
+          rest = firstLine + line;
+          for ( unsigned int d = 1; d < ImageDimension; ++d )
+          {
+            lineIndex[ d ] += static_cast<long>( rest % tileExtent[ d ] );
+            rest /= tileExtent[ d ];
+          }
+          PointType linePoint = regionPoint;
+          for ( unsigned int d = 0; d < ImageDimension; ++d )
+          {
+            linePoint += steps[ d ] * static_cast<double>( lineIndex[ d ] - regionIndex[ d ] );
+          }
+          for ( unsigned long k = 0; k < lineLength; ++k, ++inputPoint )
+          {
+            *inputPoint = linePoint + steps[ 0 ] * static_cast<double>( k );
+          }
+        }
+        this->m_AdvancedTransform->TransformPoints(
+          &( inputPoints[ 0 ] ), &( outputPoints[ 0 ] ),
+          numberOfBatchLines * lineLength );
+
+        /** Interpolate the moving image. */
+        const PointType * outputPoint = &( outputPoints[ 0 ] );
+        for ( unsigned long line = 0; line < numberOfBatchLines; ++line )
+        {
+          PixelType * outputPixel = outputPtr->GetBufferPointer()
+            + outputPtr->ComputeOffset( lineIndices[ line ] );
+          for ( unsigned long k = 0; k < lineLength; ++k, ++outputPixel, ++outputPoint )
+          {
+            if ( interpolator->IsInsideBuffer( *outputPoint ) )
+            {
+              const InterpolatorOutputType value
+                = interpolator->Evaluate( *outputPoint );
+              if ( value < minimumValue )
+              {
+                *outputPixel = NumericTraits<PixelType>::NonpositiveMin();
+              }
+              else if ( value > maximumValue )
+              {
+                *outputPixel = NumericTraits<PixelType>::max();
+              }
+              else
+              {
+                *outputPixel = static_cast<PixelType>( value );
+              }
+            }
+            else
+            {
+              *outputPixel = defaultValue;
+            }
+            progress.CompletedPixel();
+          }
+        }
+      } // end for batches of lines
+    } // end for tiles
+
+  } // end TiledThreadedGenerateData()
+
+
+  /**
+   * ******************* PrintSelf *******************
+   */
+
+  template < class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+  void
+  TiledResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+  ::PrintSelf( std::ostream & os, Indent indent ) const
+  {
+    Superclass::PrintSelf( os, indent );
+
+    os << indent << "UseTiles: " << ( this->m_UseTiles ? "true" : "false" ) << std::endl;
+    os << indent << "TileSize: " << this->m_TileSize << std::endl;
+    os << indent << "ComputedTileSize: " << this->m_ComputedTileSize << std::endl;
+
+  } // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkTiledResampleImageFilter_txx
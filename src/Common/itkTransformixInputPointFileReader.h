@@ -16,8 +16,10 @@
 #define __itkTransformixInputPointFileReader_h
 
 #include "itkMeshFileReaderBase.h"
+#include "itkMultiThreader.h"
 
 #include <fstream>
+#include <vector>
 
 namespace itk
 {
@@ -36,6 +38,9 @@ namespace itk
  *
  * The second word in the text file represents the number of points that
  * should be read.
+ *
+ * The coordinates are read in one block and parsed with strtod. Large files
+ * are split in chunks at white space, which are parsed by multiple threads.
  **/
 
 template <class TOutputMesh>
@@ -82,6 +87,10 @@ public:
    */
   virtual void GenerateOutputInformation( void );
 
+  /** Set/Get the maximum number of threads used to parse the file. */
+  itkSetClampMacro( NumberOfThreads, unsigned int, 1, ITK_MAX_THREADS );
+  itkGetConstMacro( NumberOfThreads, unsigned int );
+
 protected:
   TransformixInputPointFileReader();
   virtual ~TransformixInputPointFileReader();
@@ -89,11 +98,29 @@ protected:
   /** Fill the point container of the output. */
   virtual void GenerateData( void );
 
+  /** Parse the numbers in [begin, end) of the buffer; returns false if a
+   * word is not a number.
+   */
+  static bool ParseNumbers( const char * begin, const char * end,
+    std::vector< double > & numbers );
+
+  /** The callback of the threads that parse the buffer. */
+  static ITK_THREAD_RETURN_TYPE ParseThreaderCallback( void * arg );
+
   unsigned long m_NumberOfPoints;
   bool m_PointsAreIndices;
+  unsigned int m_NumberOfThreads;
 
   std::ifstream m_Reader;
 
+  /** The contents of the file after the header, the chunks of the threads,
+   * and the numbers and parse result of each chunk.
+   */
+  std::vector< char >                   m_Buffer;
+  std::vector< unsigned long >          m_ChunkBounds;
+  std::vector< std::vector< double > >  m_ChunkNumbers;
+  std::vector< unsigned char >          m_ChunkIsValid;
+
 private:
   TransformixInputPointFileReader(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
@@ -16,6 +16,10 @@
 #define __itkTransformixInputPointFileReader_hxx
 
 #include "itkTransformixInputPointFileReader.h"
+#include "vnl/vnl_math.h"
+
+#include <cstdlib>
+#include <cctype>
 
 namespace itk
 {
@@ -30,6 +34,7 @@ TransformixInputPointFileReader<TOutputMesh>
 {
   this->m_NumberOfPoints = 0;
   this->m_PointsAreIndices = false;
+  this->m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
 } // end constructor
 
 
@@ -108,42 +113,106 @@ TransformixInputPointFileReader<TOutputMesh>
   typedef typename OutputMeshType::PointsContainer  PointsContainerType;
   typedef typename PointsContainerType::Pointer     PointsContainerPointer;
   typedef typename OutputMeshType::PointType        PointType;
+  typedef typename PointType::ValueType             CoordinateType;
   const unsigned int dimension = OutputMeshType::PointDimension;
 
   OutputMeshPointer output = this->GetOutput();
   PointsContainerPointer points = PointsContainerType::New();
 
-  /** Read the file */
-  if ( this->m_Reader.is_open() )
+  if ( !this->m_Reader.is_open() )
+  {
+    OStringStream msg;
+    msg << "The file has unexpectedly been closed. "
+      << std::endl << "Filename: " << this->m_FileName
+      << std::endl;
+    MeshFileReaderException e( __FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION );
+    throw e;
+    return;
+  }
+
+  /** Read the rest of the file in one block, terminated by a zero. */
+  const std::streampos begin = this->m_Reader.tellg();
+  this->m_Reader.seekg( 0, std::ios::end );
+  const std::streampos end = this->m_Reader.tellg();
+  this->m_Reader.seekg( begin );
+  const unsigned long bufferSize = static_cast<unsigned long>( end - begin );
+  this->m_Buffer.resize( bufferSize + 1 );
+  if ( bufferSize > 0 )
+  {
+    this->m_Reader.read( &( this->m_Buffer[ 0 ] ), bufferSize );
+  }
+  this->m_Buffer[ bufferSize ] = '\0';
+  this->m_Reader.close();
+
+  /** Split the buffer in chunks at white space, roughly one per megabyte
+   * up to the number of threads.
+   */
+  const unsigned long minimumChunkSize = 1 << 20;
+  const unsigned int numberOfChunks = static_cast<unsigned int>( vnl_math_max(
+    1ul, vnl_math_min( static_cast<unsigned long>( this->m_NumberOfThreads ),
+    bufferSize / minimumChunkSize ) ) );
+  this->m_ChunkBounds.resize( numberOfChunks + 1 );
+  this->m_ChunkBounds[ 0 ] = 0;
+  for ( unsigned int c = 1; c < numberOfChunks; ++c )
   {
-    for ( unsigned int i = 0; i < this->m_NumberOfPoints; ++i )
+    unsigned long bound = vnl_math_max( this->m_ChunkBounds[ c - 1 ],
+      ( c * bufferSize ) / numberOfChunks );
+    while ( bound < bufferSize && !isspace(
+      static_cast<unsigned char>( this->m_Buffer[ bound ] ) ) )
     {
-      // read point from textfile
-      PointType point;
-      for ( unsigned int j = 0; j < dimension; j++ )
-      {
-        if ( !this->m_Reader.eof() )
-        {
-          this->m_Reader >> point[ j ];
-        }
-        else
-        {
-          OStringStream msg;
-          msg << "The file is not large enough. "
-            << std::endl << "Filename: " << this->m_FileName
-            << std::endl;
-          MeshFileReaderException e( __FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION );
-          throw e;
-          return;
-        }
-      }
-      points->push_back( point );
+      ++bound;
     }
+    this->m_ChunkBounds[ c ] = bound;
+  }
+  this->m_ChunkBounds[ numberOfChunks ] = bufferSize;
+  this->m_ChunkNumbers.assign( numberOfChunks, std::vector< double >() );
+  this->m_ChunkIsValid.assign( numberOfChunks, 1 );
+
+  /** Parse the chunks. */
+  if ( numberOfChunks == 1 )
+  {
+    this->m_ChunkIsValid[ 0 ] = Self::ParseNumbers( &( this->m_Buffer[ 0 ] ),
+      &( this->m_Buffer[ 0 ] ) + bufferSize, this->m_ChunkNumbers[ 0 ] );
   }
   else
+  {
+    MultiThreader::Pointer threader = MultiThreader::New();
+    threader->SetNumberOfThreads( numberOfChunks );
+    threader->SetSingleMethod( Self::ParseThreaderCallback, this );
+    threader->SingleMethodExecute();
+  }
+  std::vector< char >().swap( this->m_Buffer );
+
+  /** Fill the point container with the numbers of the chunks in order. */
+  points->Reserve( this->m_NumberOfPoints );
+  const unsigned long numberOfCoordinates = this->m_NumberOfPoints * dimension;
+  unsigned long k = 0;
+  for ( unsigned int c = 0; c < numberOfChunks && k < numberOfCoordinates; ++c )
+  {
+    const std::vector< double > & numbers = this->m_ChunkNumbers[ c ];
+    for ( unsigned long n = 0; n < numbers.size() && k < numberOfCoordinates; ++n, ++k )
+    {
+      points->ElementAt( k / dimension )[ k % dimension ]
+        = static_cast<CoordinateType>( numbers[ n ] );
+    }
+
+    /** Parsing of a chunk stops at the first word that is not a number. */
+    if ( !this->m_ChunkIsValid[ c ] && k < numberOfCoordinates )
+    {
+      OStringStream msg;
+      msg << "The file contains a word that is not a number. "
+        << std::endl << "Filename: " << this->m_FileName
+        << std::endl;
+      MeshFileReaderException e( __FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION );
+      throw e;
+    }
+  }
+  this->m_ChunkNumbers.clear();
+
+  if ( k < numberOfCoordinates )
   {
     OStringStream msg;
-    msg << "The file has unexpectedly been closed. "
+    msg << "The file is not large enough. "
       << std::endl << "Filename: " << this->m_FileName
       << std::endl;
     MeshFileReaderException e( __FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION );
@@ -155,9 +224,6 @@ TransformixInputPointFileReader<TOutputMesh>
   output->Initialize();
   output->SetPoints( points );
 
-  /** Close the reader */
-  this->m_Reader.close();
-
   /** This indicates that the current BufferedRegion is equal to the
    * requested region. This action prevents useless re-executions of
    * the pipeline.
@@ -167,6 +233,71 @@ TransformixInputPointFileReader<TOutputMesh>
 } // end GenerateData()
 
 
+/**
+ * *************** ParseNumbers ***********
+ */
+
+template <class TOutputMesh>
+bool
+TransformixInputPointFileReader<TOutputMesh>
+::ParseNumbers( const char * begin, const char * end,
+  std::vector< double > & numbers )
+{
+  /** The chunks end at white space or at the terminating zero, so strtod
+   * never reads past the end of a chunk.
+   */
+  const char * position = begin;
+  while ( position < end )
+  {
+    if ( isspace( static_cast<unsigned char>( *position ) ) )
+    {
+      ++position;
+      continue;
+    }
+    char * next = 0;
+    const double value = strtod( position, &next );
+    if ( next == position )
+    {
+      return false;
+    }
+    numbers.push_back( value );
+    position = next;
+  }
+  return true;
+
+} // end ParseNumbers()
+
+
+/**
+ * *************** ParseThreaderCallback ***********
+ */
+
+template <class TOutputMesh>
+ITK_THREAD_RETURN_TYPE
+TransformixInputPointFileReader<TOutputMesh>
+::ParseThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * infoStruct
+    = static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  const unsigned int threadID = infoStruct->ThreadID;
+  Self * reader = static_cast< Self * >( infoStruct->UserData );
+
+  /** The threader may start fewer threads than chunks. */
+  const unsigned int numberOfChunks = reader->m_ChunkNumbers.size();
+  for ( unsigned int c = threadID; c < numberOfChunks; c += infoStruct->NumberOfThreads )
+  {
+    const char * buffer = &( reader->m_Buffer[ 0 ] );
+    std::vector< double > & numbers = reader->m_ChunkNumbers[ c ];
+    numbers.reserve( ( reader->m_ChunkBounds[ c + 1 ] - reader->m_ChunkBounds[ c ] ) / 8 );
+    reader->m_ChunkIsValid[ c ] = Self::ParseNumbers(
+      buffer + reader->m_ChunkBounds[ c ], buffer + reader->m_ChunkBounds[ c + 1 ], numbers );
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ParseThreaderCallback()
+
+
 } // end namespace itk
 
 #endif
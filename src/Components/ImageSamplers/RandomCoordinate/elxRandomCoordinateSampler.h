@@ -69,6 +69,12 @@ using namespace itk;
    *    With this option you can specify the order of interpolation.\n
    *    example: <tt>(FixedImageBSplineInterpolationOrder 0 0 1)</tt>\n
    *    Default value: 1. The parameter can be specified for each resolution.
+   * \parameter UseMultiThreadingForSamplers: Whether to generate the sample coordinates
+   *    with multiple threads. If a mask is used, the coordinates are drawn within the
+   *    voxels whose centre is inside the mask, instead of by rejection sampling. Not used
+   *    in combination with UseRandomSampleRegion.\n
+   *    example: <tt>(UseMultiThreadingForSamplers "true")</tt>\n
+   *    Default: false. The parameter can be specified for each resolution.
    *
    * \ingroup ImageSamplers
    */
@@ -54,6 +54,12 @@ namespace elastix
       "UseRandomSampleRegion", this->GetComponentLabel(), level, 0);
     this->SetUseRandomSampleRegion( useRandomSampleRegion );
 
+    /** Set whether to generate the samples with multiple threads. */
+    bool useMultiThread = false;
+    this->GetConfiguration()->ReadParameter( useMultiThread,
+      "UseMultiThreadingForSamplers", this->GetComponentLabel(), level, 0 );
+    this->SetUseMultiThread( useMultiThread );
+
     /** Set the SampleRegionSize. */
     if ( useRandomSampleRegion )
     {
@@ -45,6 +45,10 @@ using namespace itk;
    *    metric value and its derivative in each iteration. Must be given for each resolution.\n
    *    example: <tt>(NumberOfSpatialSamples 2048 2048 4000)</tt> \n
    *    The default is 5000.
+   * \parameter UseMultiThreadingForSamplers: Whether to pick the samples with multiple
+   *    threads.\n
+   *    example: <tt>(UseMultiThreadingForSamplers "true")</tt>\n
+   *    Default: false. The parameter can be specified for each resolution.
    *
    * \ingroup ImageSamplers
    */
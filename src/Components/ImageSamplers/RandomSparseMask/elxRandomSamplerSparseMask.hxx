@@ -40,6 +40,12 @@ namespace elastix
 
     this->SetNumberOfSamples( numberOfSpatialSamples );
 
+    /** Set whether to generate the samples with multiple threads. */
+    bool useMultiThread = false;
+    this->GetConfiguration()->ReadParameter( useMultiThread,
+      "UseMultiThreadingForSamplers", this->GetComponentLabel(), level, 0 );
+    this->SetUseMultiThread( useMultiThread );
+
   } // end BeforeEachResolution()
 
 
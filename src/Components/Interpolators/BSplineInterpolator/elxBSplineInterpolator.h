@@ -15,7 +15,7 @@
 #ifndef __elxBSplineInterpolator_h
 #define __elxBSplineInterpolator_h
 
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkCachedBSplineInterpolateImageFunction.h"
 #include "elxIncludes.h"
 
 namespace elastix
@@ -41,6 +41,17 @@ using namespace itk;
    *    example: <tt>(BSplineInterpolationOrder 3 2 3)</tt> \n
    *    The default order is 1. The parameter can be specified for each resolution.\n
    *    If only given for one resolution, that value is used for the other resolutions as well.
+   * \parameter CacheBSplineCoefficients: whether to keep the B-spline coefficients of the
+   *    images in memory, so that they are computed only once when the same image is
+   *    interpolated several times with the same order, for example by several metrics,
+   *    or by this interpolator and the FinalBSplineInterpolator. This costs extra memory. \n
+   *    example: <tt>(CacheBSplineCoefficients "true")</tt> \n
+   *    Default: "false".
+   * \parameter BSplineCoefficientCacheDirectory: a directory where the B-spline coefficients
+   *    are stored, in files named after a hash of the image and the spline order. Later
+   *    runs on the same image read the coefficients from these files. \n
+   *    example: <tt>(BSplineCoefficientCacheDirectory "/tmp/coefficients")</tt> \n
+   *    Default: "", which disables the coefficient files.
    *
    * \ingroup Interpolators
    */
@@ -48,7 +59,7 @@ using namespace itk;
   template < class TElastix >
     class BSplineInterpolator :
     public
-      BSplineInterpolateImageFunction<
+      CachedBSplineInterpolateImageFunction<
         ITK_TYPENAME InterpolatorBase<TElastix>::InputImageType,
         ITK_TYPENAME InterpolatorBase<TElastix>::CoordRepType,
         double > , //CoefficientType
@@ -59,7 +70,7 @@ using namespace itk;
 
     /** Standard ITK-stuff. */
     typedef BSplineInterpolator                 Self;
-    typedef BSplineInterpolateImageFunction<
+    typedef CachedBSplineInterpolateImageFunction<
       typename InterpolatorBase<TElastix>::InputImageType,
       typename InterpolatorBase<TElastix>::CoordRepType,
       double >                                  Superclass1;
@@ -71,7 +82,7 @@ using namespace itk;
     itkNewMacro( Self );
 
     /** Run-time type information (and related methods). */
-    itkTypeMacro( BSplineInterpolator, BSplineInterpolateImageFunction );
+    itkTypeMacro( BSplineInterpolator, CachedBSplineInterpolateImageFunction );
 
     /** Name of this class.
      * Use this name in the parameter file to select this specific interpolator. \n
@@ -104,6 +115,11 @@ using namespace itk;
     typedef typename Superclass2::RegistrationPointer       RegistrationPointer;
     typedef typename Superclass2::ITKBaseType               ITKBaseType;
 
+    /** Execute stuff before the actual registration:
+     * \li Set the coefficient caches.
+     */
+    virtual void BeforeRegistration( void );
+
     /** Execute stuff before each new pyramid resolution:
      * \li Set the spline order.
      */
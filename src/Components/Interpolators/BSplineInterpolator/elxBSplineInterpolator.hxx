@@ -22,6 +22,29 @@ namespace elastix
 using namespace itk;
 
 
+/**
+ * ***************** BeforeRegistration ***********************
+ */
+
+template <class TElastix>
+void BSplineInterpolator<TElastix>
+::BeforeRegistration( void )
+{
+  /** Read whether the coefficients should be kept in memory. */
+  bool cacheCoefficients = false;
+  this->GetConfiguration()->ReadParameter( cacheCoefficients,
+    "CacheBSplineCoefficients", this->GetComponentLabel(), 0, 0 );
+  this->SetUseCoefficientCache( cacheCoefficients );
+
+  /** Read the directory of the coefficient files. */
+  std::string cacheDirectory = "";
+  this->GetConfiguration()->ReadParameter( cacheDirectory,
+    "BSplineCoefficientCacheDirectory", this->GetComponentLabel(), 0, 0 );
+  this->SetCoefficientCacheDirectory( cacheDirectory.c_str() );
+
+} // end BeforeRegistration()
+
+
 /**
  * ***************** BeforeEachResolution ***********************
  */
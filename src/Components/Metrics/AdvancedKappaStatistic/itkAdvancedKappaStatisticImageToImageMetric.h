@@ -176,6 +176,24 @@ protected:
   typedef typename Superclass::MovingImageDerivativeType          MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType         NonZeroJacobianIndicesType;
 
+  /** Accumulators of a single thread; the kappa statistic needs three
+   * counters and two derivative sums, so it has its own per-thread struct.
+   */
+  struct KappaGetValueAndDerivativePerThreadStruct
+  {
+    unsigned long   st_NumberOfPixelsCounted;
+    std::size_t     st_FixedForegroundArea;
+    std::size_t     st_MovingForegroundArea;
+    std::size_t     st_Intersection;
+    DerivativeType  st_DerivativeSum1;
+    DerivativeType  st_DerivativeSum2;
+  };
+  typedef std::vector<
+    KappaGetValueAndDerivativePerThreadStruct >                   KappaGetValueAndDerivativePerThreadVariablesType;
+
+  mutable KappaGetValueAndDerivativePerThreadVariablesType
+    m_KappaGetValueAndDerivativePerThreadVariables;
+
   /** Computes the inner product of transform Jacobian with moving image gradient.
    * The results are stored in the imageJacobian, which is supposed
    * to have the right size (same length as Jacobian's number of columns).
@@ -185,6 +203,16 @@ protected:
     const MovingImageDerivativeType & movingImageDerivative,
     DerivativeType & innerProduct ) const;
 
+  /** Resize and zero the per-thread accumulators. */
+  virtual void InitializeThreadingParameters( void ) const;
+
+  /** Multi-threaded version of the sample loop of GetValueAndDerivative(). */
+  virtual void ThreadedGetValueAndDerivative( unsigned int threadID ) const;
+
+  /** Gather the results of all threads and compute the value and derivative. */
+  virtual void AfterThreadedGetValueAndDerivative(
+    MeasureType & value, DerivativeType & derivative ) const;
+
   /** Compute a pixel's contribution to the measure and derivatives;
    * Called by GetValueAndDerivative().
    */
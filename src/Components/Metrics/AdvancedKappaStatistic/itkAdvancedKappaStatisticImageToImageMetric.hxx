@@ -236,8 +236,19 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
-  /** Update the imageSampler and get a handle to the sample container. */
+  /** Update the imageSampler. */
   this->GetImageSampler()->Update();
+
+  /** Distribute the sample loop over the threads, if desired. */
+  if ( this->UseMultiThreadedGetValueAndDerivative() )
+  {
+    this->InitializeThreadingParameters();
+    this->LaunchGetValueAndDerivativeThreaderCallback();
+    this->AfterThreadedGetValueAndDerivative( value, derivative );
+    return;
+  }
+
+  /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Some variables. */
@@ -339,6 +350,200 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
 } // end GetValueAndDerivative()
 
 
+/**
+ * ******************* InitializeThreadingParameters *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
+::InitializeThreadingParameters( void ) const
+{
+  /** Initialize the per-thread variables of the superclass. */
+  this->Superclass::InitializeThreadingParameters();
+
+  /** Initialize the per-thread variables of this class. The derivative
+   * vectors are only reallocated when their size changes.
+   */
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  this->m_KappaGetValueAndDerivativePerThreadVariables.resize(
+    this->GetNumberOfThreads() );
+  for ( unsigned int i = 0; i < this->GetNumberOfThreads(); ++i )
+  {
+    KappaGetValueAndDerivativePerThreadStruct & perThread
+      = this->m_KappaGetValueAndDerivativePerThreadVariables[ i ];
+    perThread.st_NumberOfPixelsCounted = 0;
+    perThread.st_FixedForegroundArea   = 0;
+    perThread.st_MovingForegroundArea  = 0;
+    perThread.st_Intersection          = 0;
+    if ( perThread.st_DerivativeSum1.GetSize() != numberOfParameters )
+    {
+      perThread.st_DerivativeSum1.SetSize( numberOfParameters );
+      perThread.st_DerivativeSum2.SetSize( numberOfParameters );
+    }
+    perThread.st_DerivativeSum1.Fill( NumericTraits< DerivativeValueType >::Zero );
+    perThread.st_DerivativeSum2.Fill( NumericTraits< DerivativeValueType >::Zero );
+  }
+
+} // end InitializeThreadingParameters()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedGetValueAndDerivative( unsigned int threadID ) const
+{
+  /** Get a handle to this thread's accumulators. */
+  KappaGetValueAndDerivativePerThreadStruct & perThread
+    = this->m_KappaGetValueAndDerivativePerThreadVariables[ threadID ];
+
+  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
+  NonZeroJacobianIndicesType nzji( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+  DerivativeType imageJacobian( nzji.size() );
+  TransformJacobianType jacobian;
+
+  /** Get a handle to the sample container and select this thread's part. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  unsigned long begin = 0;
+  unsigned long end = 0;
+  this->GetSampleRangeForThread( threadID, sampleContainer->Size(), begin, end );
+
+  /** Some variables. */
+  RealType movingImageValue;
+  MovingImagePointType mappedPoint;
+
+  /** Loop over this thread's part of the sample container. */
+  for ( unsigned long i = begin; i < end; ++i )
+  {
+    /** Read fixed coordinates. */
+    const FixedImagePointType & fixedPoint
+      = sampleContainer->ElementAt( i ).m_ImageCoordinates;
+
+    /** Transform point and check if it is inside the B-spline support region. */
+    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+
+    /** Check if point is inside moving mask. */
+    if ( sampleOk )
+    {
+      sampleOk = this->IsInsideMovingMask( mappedPoint );
+    }
+
+    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+     * the point is inside the moving image buffer.
+     */
+    MovingImageDerivativeType movingImageDerivative;
+    if ( sampleOk )
+    {
+      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+        mappedPoint, movingImageValue, &movingImageDerivative );
+    }
+
+    /** Do the actual calculation of the metric value. */
+    if ( sampleOk )
+    {
+      perThread.st_NumberOfPixelsCounted++;
+
+      /** Get the fixed image value. */
+      const RealType & fixedImageValue
+        = static_cast<RealType>( sampleContainer->ElementAt( i ).m_ImageValue );
+
+      /** Get the TransformJacobian dT/dmu. */
+      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+
+      /** Compute the inner products (dM/dx)^T (dT/dmu). */
+      this->EvaluateMovingImageAndTransformJacobianInnerProduct(
+        jacobian, movingImageDerivative, imageJacobian );
+
+      /** Compute this pixel's contribution to the measure and derivatives. */
+      this->UpdateValueAndDerivativeTerms(
+        fixedImageValue, movingImageValue,
+        perThread.st_FixedForegroundArea,
+        perThread.st_MovingForegroundArea,
+        perThread.st_Intersection,
+        imageJacobian, nzji,
+        perThread.st_DerivativeSum1, perThread.st_DerivativeSum2 );
+
+    } // end if sampleOk
+
+  } // end for loop over this thread's samples
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
+::AfterThreadedGetValueAndDerivative(
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Gather the results of all threads, always in the same order,
+   * so that the outcome does not depend on thread scheduling.
+   */
+  this->m_NumberOfPixelsCounted = 0;
+  std::size_t fixedForegroundArea  = 0;
+  std::size_t movingForegroundArea = 0;
+  std::size_t intersection         = 0;
+  DerivativeType vecSum1
+    = this->m_KappaGetValueAndDerivativePerThreadVariables[ 0 ].st_DerivativeSum1;
+  DerivativeType vecSum2
+    = this->m_KappaGetValueAndDerivativePerThreadVariables[ 0 ].st_DerivativeSum2;
+  for ( unsigned int i = 0; i < this->GetNumberOfThreads(); ++i )
+  {
+    const KappaGetValueAndDerivativePerThreadStruct & perThread
+      = this->m_KappaGetValueAndDerivativePerThreadVariables[ i ];
+    this->m_NumberOfPixelsCounted += perThread.st_NumberOfPixelsCounted;
+    fixedForegroundArea  += perThread.st_FixedForegroundArea;
+    movingForegroundArea += perThread.st_MovingForegroundArea;
+    intersection         += perThread.st_Intersection;
+    if ( i > 0 )
+    {
+      vecSum1 += perThread.st_DerivativeSum1;
+      vecSum2 += perThread.st_DerivativeSum2;
+    }
+  }
+
+  /** Check if enough samples were valid. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  this->CheckNumberOfSamples(
+    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+
+  /** Compute the final metric value. */
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  std::size_t areaSum = fixedForegroundArea + movingForegroundArea;
+  const MeasureType intersectionFloat = static_cast<MeasureType>( intersection );
+  const MeasureType areaSumFloat = static_cast<MeasureType>( areaSum );
+  if ( areaSum > 0 )
+  {
+    measure = 1.0 - 2.0 * intersectionFloat / areaSumFloat;
+  }
+  if ( !this->m_Complement ){ measure = 1.0 - measure; }
+  value = measure;
+
+  /** Calculate the derivative. */
+  derivative.SetSize( this->GetNumberOfParameters() );
+  derivative.Fill( NumericTraits< DerivativeValueType >::Zero );
+  MeasureType direction = -1.0;
+  if ( !this->m_Complement ) direction = 1.0;
+  const MeasureType areaSumFloatSquare = direction * areaSumFloat * areaSumFloat;
+  const MeasureType tmp1 = areaSumFloat / areaSumFloatSquare;
+  const MeasureType tmp2 = 2.0 * intersectionFloat / areaSumFloatSquare;
+
+  if ( areaSum > 0 )
+  {
+    derivative = tmp1 * vecSum1 - tmp2 * vecSum2;
+  }
+
+} // end AfterThreadedGetValueAndDerivative()
+
+
 /**
  * *************** UpdateValueAndDerivativeTerms ***************************
  */
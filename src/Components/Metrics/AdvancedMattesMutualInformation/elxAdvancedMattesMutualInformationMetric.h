@@ -91,6 +91,15 @@ using namespace itk;
    *    B-spline grids.
    *    example: <tt>(UseFastAndLowMemoryVersion "false")</tt> \n
    *    The default is "true".
+   * \parameter MaximumMemoryForThreadedPDFDerivatives: The memory in MB that
+   *    the per-thread copies of the joint histogram derivatives may use, when
+   *    UseFastAndLowMemoryVersion is "false" and UseMultiThreadingForMetrics
+   *    is "true". Each thread needs a copy of the large 3D matrix described
+   *    above; the number of threads is reduced to what fits in this memory,
+   *    and with only one thread the derivatives are computed single-threaded.
+   *    Can be given for each resolution, or for all resolutions at once. \n
+   *    example: <tt>(MaximumMemoryForThreadedPDFDerivatives 1024)</tt> \n
+   *    The default is 512.
    *
    * \sa ParzenWindowMutualInformationImageToImageMetric
    * \ingroup Metrics
@@ -118,6 +118,12 @@ using namespace itk;
       "UseFastAndLowMemoryVersion", this->GetComponentLabel(), level, 0 );
     this->SetUseExplicitPDFDerivatives( !useFastAndLowMemoryVersion );
 
+    /** Set the memory for the per-thread joint histogram derivatives. */
+    unsigned long maximumMemoryForThreadedPDFDerivatives = 512;
+    this->GetConfiguration()->ReadParameter( maximumMemoryForThreadedPDFDerivatives,
+      "MaximumMemoryForThreadedPDFDerivatives", this->GetComponentLabel(), level, 0 );
+    this->SetMaximumMemoryForThreadedPDFDerivatives( maximumMemoryForThreadedPDFDerivatives );
+
     /** Set whether to use Nick Tustison's preconditioning technique. */
     bool useJacobianPreconditioning = false;
     this->GetConfiguration()->ReadParameter( useJacobianPreconditioning,
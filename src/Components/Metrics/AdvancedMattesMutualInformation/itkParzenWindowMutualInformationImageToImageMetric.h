@@ -50,7 +50,9 @@ namespace itk
    * Notes:\n
    * 1. This class returns the negative mutual information value.\n
    * 2. This class in not thread safe due the private data structures
-   *     used to the store the marginal and joint pdfs.
+   *     used to the store the marginal and joint pdfs. Internally, the
+   *     construction of the joint histogram and, in the low memory variant,
+   *     the second pass over the samples are multi-threaded.
    *
    * References:\n
    * [1] "Nonrigid multimodality image registration"\n
@@ -185,6 +187,7 @@ namespace itk
     typedef typename Superclass::ParzenValueContainerType           ParzenValueContainerType;
     typedef typename Superclass::KernelFunctionType                 KernelFunctionType;
     typedef typename Superclass::NonZeroJacobianIndicesType         NonZeroJacobianIndicesType;
+    typedef typename Superclass::GetValueAndDerivativePerThreadStruct GetValueAndDerivativePerThreadStruct;
 
     /**  Get the value and analytic derivatives for single valued optimizers.
      * Called by GetValueAndDerivative if UseFiniteDifferenceDerivative == false.
@@ -217,6 +220,18 @@ namespace itk
     /** Some initialization functions, called by Initialize. */
     virtual void InitializeHistograms( void );
 
+    /** The threaded part of GetValueAndAnalyticDerivativeLowMemory():
+     * the second pass over the samples, which accumulates this thread's
+     * part of the derivative using the precomputed m_PRatioArray.
+     */
+    virtual void ThreadedGetValueAndDerivative( unsigned int threadID ) const;
+
+    /** Add the derivatives of all threads in thread order. The value
+     * is not touched, since it is computed from the joint histogram.
+     */
+    virtual void AfterThreadedGetValueAndDerivative(
+      MeasureType & value, DerivativeType & derivative ) const;
+
   private:
 
     /** The private constructor. */
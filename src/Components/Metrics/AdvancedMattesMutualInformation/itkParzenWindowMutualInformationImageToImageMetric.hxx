@@ -282,6 +282,19 @@ namespace itk
 
     // NOW A SECOND PASS OVER THE SAMPLES to compute the derivative
 
+    /** Let the threads do the second pass, if possible. The Jacobian
+     * preconditioning is only supported by the single-threaded code.
+     */
+    if ( this->UseMultiThreadedGetValueAndDerivative()
+      && !this->GetUseJacobianPreconditioning() )
+    {
+      this->InitializeThreadingParameters();
+      this->InitializePerThreadDerivatives();
+      this->LaunchGetValueAndDerivativeThreaderCallback();
+      this->AfterThreadedGetValueAndDerivative( value, derivative );
+      return;
+    }
+
     /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
     NonZeroJacobianIndicesType nzji( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
     DerivativeType imageJacobian( nzji.size() );
@@ -310,7 +323,7 @@ namespace itk
       MovingImagePointType mappedPoint;
 
       /** Transform point and check if it is inside the B-spline support region. */
-      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+      bool sampleOk = this->TransformSamplePoint( fiter.Index(), fixedPoint, mappedPoint );
 
       /** Check if the point is inside the moving mask. */
       if ( sampleOk )
@@ -339,20 +352,23 @@ namespace itk
           ->Evaluate( movingImageValue, movingImageDerivative );
 
         /** Get the transform Jacobian dT/dmu. */
-        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        const TransformJacobianType * sampleJacobian;
+        const NonZeroJacobianIndicesType * sampleNzji;
+        this->EvaluateTransformSampleJacobian( fiter.Index(), fixedPoint,
+          jacobian, nzji, sampleJacobian, sampleNzji );
 
         /** Compute the inner product (dM/dx)^T (dT/dmu). */
         this->EvaluateTransformJacobianInnerProduct(
-          jacobian, movingImageDerivative, imageJacobian );
+          *sampleJacobian, movingImageDerivative, imageJacobian );
 
         /** If desired, apply the technique introduced by Tustison */
         if ( this->GetUseJacobianPreconditioning() )
         {
-          this->ComputeJacobianPreconditioner( jacobian, nzji,
+          this->ComputeJacobianPreconditioner( *sampleJacobian, *sampleNzji,
             jacobianPreconditioner, preconditioningDivisor );
           DerivativeValueType * imjacit = imageJacobian.begin();
           DerivativeValueType * jacprecit = jacobianPreconditioner.begin();
-          for ( unsigned int i = 0; i < nzji.size(); ++i )
+          for ( unsigned int i = 0; i < sampleNzji->size(); ++i )
           while ( imjacit != imageJacobian.end() )
           {
             (*imjacit) *= (*jacprecit);
@@ -363,7 +379,7 @@ namespace itk
 
         /** Compute this sample's contribution to the joint distributions. */
         this->UpdateDerivativeLowMemory(
-          fixedImageValue, movingImageValue, imageJacobian, nzji, derivative );
+          fixedImageValue, movingImageValue, imageJacobian, *sampleNzji, derivative );
 
       } // end sampleOk
     } // end loop over sample container
@@ -507,16 +523,21 @@ namespace itk
       static_cast<int>( vcl_floor(
       movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset ) );
 
-    /** The Parzen values. */
-    ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[ 1 ] );
-    ParzenValueContainerType movingParzenValues( this->m_JointPDFWindow.GetSize()[ 0 ] );
+    /** The Parzen values, on the stack. */
+    double fixedParzenValuesArray[ Superclass::MaximumParzenWindowSize ];
+    double movingParzenValuesArray[ Superclass::MaximumParzenWindowSize ];
+    ParzenValueContainerType fixedParzenValues( fixedParzenValuesArray,
+      this->m_JointPDFWindow.GetSize()[ 1 ], false );
+    ParzenValueContainerType movingParzenValues( movingParzenValuesArray,
+      this->m_JointPDFWindow.GetSize()[ 0 ], false );
     this->EvaluateParzenValues(
       fixedImageParzenWindowTerm, fixedParzenWindowIndex,
       this->m_FixedKernel, fixedParzenValues );
 
     /** Compute the derivatives of the moving Parzen window. */
+    double derivativeMovingParzenValuesArray[ Superclass::MaximumParzenWindowSize ];
     ParzenValueContainerType derivativeMovingParzenValues(
-      this->m_JointPDFWindow.GetSize()[ 0 ] );
+      derivativeMovingParzenValuesArray, this->m_JointPDFWindow.GetSize()[ 0 ], false );
     this->EvaluateParzenValues(
       movingImageParzenWindowTerm, movingParzenWindowIndex,
       this->m_DerivativeMovingKernel, derivativeMovingParzenValues );
@@ -564,6 +585,113 @@ namespace itk
   } // end UpdateDerivativeLowMemory()
 
 
+  /**
+   * ******************* ThreadedGetValueAndDerivative *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+  void
+    ParzenWindowMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
+    ::ThreadedGetValueAndDerivative( unsigned int threadID ) const
+  {
+    /** Get a handle to this thread's derivative. */
+    GetValueAndDerivativePerThreadStruct & perThread
+      = this->m_GetValueAndDerivativePerThreadVariables[ threadID ];
+
+    /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
+    NonZeroJacobianIndicesType nzji( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+    DerivativeType imageJacobian( nzji.size() );
+    TransformJacobianType jacobian;
+
+    /** Get a handle to the sample container and select this thread's part. */
+    ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+    unsigned long begin = 0;
+    unsigned long end = 0;
+    this->GetSampleRangeForThread( threadID, sampleContainer->Size(), begin, end );
+
+    /** Loop over this thread's part of the sample container. */
+    for ( unsigned long i = begin; i < end; ++i )
+    {
+      /** Read fixed coordinates and create some variables. */
+      const FixedImagePointType & fixedPoint
+        = sampleContainer->ElementAt( i ).m_ImageCoordinates;
+      RealType movingImageValue;
+      MovingImageDerivativeType movingImageDerivative;
+      MovingImagePointType mappedPoint;
+
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformSamplePoint( i, fixedPoint, mappedPoint );
+
+      /** Check if the point is inside the moving mask. */
+      if ( sampleOk )
+      {
+        sampleOk = this->IsInsideMovingMask( mappedPoint );
+      }
+
+      /** Compute the moving image value, its derivative, and check
+       * if the point is inside the moving image buffer.
+       */
+      if ( sampleOk )
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue, &movingImageDerivative );
+      }
+
+      if ( sampleOk )
+      {
+        /** Get the fixed image value. */
+        RealType fixedImageValue = static_cast<RealType>(
+          sampleContainer->ElementAt( i ).m_ImageValue );
+
+        /** Make sure the values fall within the histogram range. */
+        fixedImageValue = this->GetFixedImageLimiter()
+          ->Evaluate( fixedImageValue );
+        movingImageValue = this->GetMovingImageLimiter()
+          ->Evaluate( movingImageValue, movingImageDerivative );
+
+        /** Get the transform Jacobian dT/dmu. */
+        const TransformJacobianType * sampleJacobian;
+        const NonZeroJacobianIndicesType * sampleNzji;
+        this->EvaluateTransformSampleJacobian( i, fixedPoint,
+          jacobian, nzji, sampleJacobian, sampleNzji );
+
+        /** Compute the inner product (dM/dx)^T (dT/dmu). */
+        this->EvaluateTransformJacobianInnerProduct(
+          *sampleJacobian, movingImageDerivative, imageJacobian );
+
+        /** Compute this sample's contribution to this thread's derivative. */
+        this->UpdateDerivativeLowMemory(
+          fixedImageValue, movingImageValue, imageJacobian, *sampleNzji,
+          perThread.st_Derivative );
+
+      } // end sampleOk
+    } // end for loop over this thread's samples
+
+  } // end ThreadedGetValueAndDerivative()
+
+
+  /**
+   * ******************* AfterThreadedGetValueAndDerivative *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+  void
+    ParzenWindowMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
+    ::AfterThreadedGetValueAndDerivative(
+    MeasureType & itkNotUsed( value ),
+    DerivativeType & derivative ) const
+  {
+    /** Add the derivatives of all threads in thread order. */
+    const unsigned int numberOfThreads = this->GetNumberOfThreads();
+    derivative = this->m_GetValueAndDerivativePerThreadVariables[ 0 ].st_Derivative;
+    for ( unsigned int t = 1; t < numberOfThreads; ++t )
+    {
+      derivative += this->m_GetValueAndDerivativePerThreadVariables[ t ].st_Derivative;
+    }
+
+  } // end AfterThreadedGetValueAndDerivative()
+
+
   /**
    * ******************** GetValueAndFiniteDifferenceDerivative *******************
    * Get both the Value and the Derivative of the Measure.
@@ -187,6 +187,8 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType          MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType         NonZeroJacobianIndicesType;
+  typedef typename
+    Superclass::GetValueAndDerivativePerThreadStruct              GetValueAndDerivativePerThreadStruct;
 
   /** Protected typedefs for SelfHessian */
   typedef SmoothingRecursiveGaussianImageFilter<
@@ -218,6 +220,26 @@ protected:
     MeasureType & measure,
     DerivativeType & deriv ) const;
 
+  /** Compute the contributions of the samples [begin, end) to the measure
+   * and derivative. The samples are processed in batches, using the batch
+   * functions of the transform, and accumulated in sample order.
+   * Called by GetValueAndDerivative() and ThreadedGetValueAndDerivative().
+   */
+  void AccumulateValueAndDerivativeTerms(
+    ImageSampleContainerType * sampleContainer,
+    const unsigned long begin,
+    const unsigned long end,
+    unsigned long & numberOfPixelsCounted,
+    MeasureType & measure,
+    DerivativeType & deriv ) const;
+
+  /** Multi-threaded version of the sample loop of GetValueAndDerivative(). */
+  virtual void ThreadedGetValueAndDerivative( unsigned int threadID ) const;
+
+  /** Gather the values and derivatives of all threads. */
+  virtual void AfterThreadedGetValueAndDerivative(
+    MeasureType & value, DerivativeType & derivative ) const;
+
   /** Compute a pixel's contribution to the SelfHessian;
    * Called by GetSelfHessian(). */
   void UpdateSelfHessianTerms(
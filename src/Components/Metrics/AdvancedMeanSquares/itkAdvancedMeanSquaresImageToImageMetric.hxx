@@ -17,6 +17,7 @@
 
 #include "itkAdvancedMeanSquaresImageToImageMetric.h"
 #include "vnl/algo/vnl_matrix_update.h"
+#include "vnl/vnl_math.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 
 namespace itk
@@ -164,56 +165,64 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
   /** Update the imageSampler and get a handle to the sample container. */
   this->GetImageSampler()->Update();
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  this->UpdateTransformedSampleCache();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend = sampleContainer->End();
+  /** Buffers for one batch of samples. */
+  const unsigned int batchSize = Superclass::SampleBatchSize;
+  FixedImagePointType fixedPoints[ batchSize ];
+  MovingImagePointType mappedPoints[ batchSize ];
 
   /** Loop over the fixed image samples to calculate the mean squares. */
-  for ( fiter = fbegin; fiter != fend; ++fiter )
+  const unsigned long numberOfSamples = sampleContainer->Size();
+  for ( unsigned long first = 0; first < numberOfSamples; first += batchSize )
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
-    RealType movingImageValue;
-    MovingImagePointType mappedPoint;
+    const unsigned long n = vnl_math_min(
+      static_cast<unsigned long>( batchSize ), numberOfSamples - first );
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-
-    /** Check if point is inside mask. */
-    if ( sampleOk )
+    /** Transform all points of this batch. */
+    for ( unsigned long i = 0; i < n; ++i )
     {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
+      fixedPoints[ i ] = sampleContainer->ElementAt( first + i ).m_ImageCoordinates;
     }
+    this->TransformSamplePoints( first, fixedPoints, mappedPoints, n );
 
-    /** Compute the moving image value and check if the point is
-     * inside the moving image buffer.
-     */
-    if ( sampleOk )
+    for ( unsigned long i = 0; i < n; ++i )
     {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, 0 );
-    }
+      RealType movingImageValue;
 
-    if ( sampleOk )
-    {
-      this->m_NumberOfPixelsCounted++;
+      /** Check if point is inside mask. */
+      bool sampleOk = this->IsInsideMovingMask( mappedPoints[ i ] );
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue = static_cast<double>( (*fiter).Value().m_ImageValue );
+      /** Compute the moving image value and check if the point is
+       * inside the moving image buffer.
+       */
+      if ( sampleOk )
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(
+          mappedPoints[ i ], movingImageValue, 0 );
+      }
 
-      /** The difference squared. */
-      const RealType diff = movingImageValue - fixedImageValue;
-      measure += diff * diff;
+      if ( sampleOk )
+      {
+        this->m_NumberOfPixelsCounted++;
 
-    } // end if sampleOk
+        /** Get the fixed image value. */
+        const RealType fixedImageValue = static_cast<double>(
+          sampleContainer->ElementAt( first + i ).m_ImageValue );
 
-  } // end for loop over the image sample container
+        /** The difference squared. */
+        const RealType diff = movingImageValue - fixedImageValue;
+        measure += diff * diff;
+
+      } // end if sampleOk
+
+    } // end for samples in this batch
+
+  } // end for all batches
 
   /** Check if enough samples were valid. */
   this->CheckNumberOfSamples(
-    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+    numberOfSamples, this->m_NumberOfPixelsCounted );
 
   /** Update measure value. */
   double normal_sum = 0.0;
@@ -274,77 +283,207 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
   derivative = DerivativeType( this->GetNumberOfParameters() );
   derivative.Fill( NumericTraits< DerivativeValueType >::Zero );
 
-  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
-  NonZeroJacobianIndicesType nzji(
-    this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-  DerivativeType imageJacobian( nzji.size() );
-  TransformJacobianType jacobian;
-
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
-  /** Update the imageSampler and get a handle to the sample container. */
+  /** Update the imageSampler. */
   this->GetImageSampler()->Update();
+  this->UpdateTransformedSampleCache();
+
+  /** Distribute the sample loop over the threads, if desired. */
+  if ( this->UseMultiThreadedGetValueAndDerivative() )
+  {
+    this->InitializeThreadingParameters();
+    this->InitializePerThreadDerivatives();
+    this->LaunchGetValueAndDerivativeThreaderCallback();
+    this->AfterThreadedGetValueAndDerivative( value, derivative );
+    return;
+  }
+
+  /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend = sampleContainer->End();
+  /** Loop over the fixed image samples to calculate the mean squares. */
+  this->AccumulateValueAndDerivativeTerms( sampleContainer,
+    0, sampleContainer->Size(), this->m_NumberOfPixelsCounted,
+    measure, derivative );
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for ( fiter = fbegin; fiter != fend; ++fiter )
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(
+    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+
+  /** Compute the measure value and derivative. */
+  double normal_sum = 0.0;
+  if ( this->m_NumberOfPixelsCounted > 0 )
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
-    RealType movingImageValue;
-    MovingImagePointType mappedPoint;
-    MovingImageDerivativeType movingImageDerivative;
+    normal_sum = this->m_NormalizationFactor /
+      static_cast<double>( this->m_NumberOfPixelsCounted );
+  }
+  measure *= normal_sum;
+  derivative *= normal_sum;
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+  /** The return value. */
+  value = measure;
 
-    /** Check if point is inside mask. */
-    if ( sampleOk )
-    {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
-    }
+} // end GetValueAndDerivative()
 
-    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
-     * the point is inside the moving image buffer.
-     */
-    if ( sampleOk )
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedGetValueAndDerivative( unsigned int threadID ) const
+{
+  /** Get a handle to this thread's accumulators. */
+  GetValueAndDerivativePerThreadStruct & perThread
+    = this->m_GetValueAndDerivativePerThreadVariables[ threadID ];
+
+  /** Get a handle to the sample container and select this thread's part. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  unsigned long begin = 0;
+  unsigned long end = 0;
+  this->GetSampleRangeForThread( threadID, sampleContainer->Size(), begin, end );
+
+  /** Loop over this thread's part of the sample container. */
+  this->AccumulateValueAndDerivativeTerms( sampleContainer,
+    begin, end, perThread.st_NumberOfPixelsCounted,
+    perThread.st_Value, perThread.st_Derivative );
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* AccumulateValueAndDerivativeTerms *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
+::AccumulateValueAndDerivativeTerms(
+  ImageSampleContainerType * sampleContainer,
+  const unsigned long begin,
+  const unsigned long end,
+  unsigned long & numberOfPixelsCounted,
+  MeasureType & measure,
+  DerivativeType & deriv ) const
+{
+  /** Array that stores dM(x)/dmu. */
+  DerivativeType imageJacobian(
+    this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+
+  /** Buffers for one batch of samples. The Jacobians keep their size
+   * from batch to batch, so they are allocated only once. They are not
+   * filled when the Jacobians are read from the transformed sample cache.
+   */
+  const unsigned int batchSize = Superclass::SampleBatchSize;
+  FixedImagePointType fixedPoints[ batchSize ];
+  MovingImagePointType mappedPoints[ batchSize ];
+  RealType fixedImageValues[ batchSize ];
+  RealType movingImageValues[ batchSize ];
+  MovingImageDerivativeType movingImageDerivatives[ batchSize ];
+  TransformJacobianType jacobians[ batchSize ];
+  NonZeroJacobianIndicesType nzjis[ batchSize ];
+  const TransformJacobianType * jacobianPointers[ batchSize ];
+  const NonZeroJacobianIndicesType * nzjiPointers[ batchSize ];
+  unsigned long sampleIndices[ batchSize ];
+
+  for ( unsigned long first = begin; first < end; first += batchSize )
+  {
+    const unsigned long n = vnl_math_min(
+      static_cast<unsigned long>( batchSize ), end - first );
+
+    /** Transform all points of this batch. */
+    for ( unsigned long i = 0; i < n; ++i )
     {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, &movingImageDerivative );
+      fixedPoints[ i ] = sampleContainer->ElementAt( first + i ).m_ImageCoordinates;
     }
+    this->TransformSamplePoints( first, fixedPoints, mappedPoints, n );
 
-    if ( sampleOk )
+    /** Keep the valid samples, compacted at the front of the buffers. */
+    unsigned long numberOfValidSamples = 0;
+    for ( unsigned long i = 0; i < n; ++i )
     {
-      this->m_NumberOfPixelsCounted++;
+      const unsigned long k = numberOfValidSamples;
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue
-        = static_cast<RealType>( (*fiter).Value().m_ImageValue );
+      /** Check if point is inside mask. */
+      bool sampleOk = this->IsInsideMovingMask( mappedPoints[ i ] );
 
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+      /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+       * the point is inside the moving image buffer.
+       */
+      if ( sampleOk )
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(
+          mappedPoints[ i ], movingImageValues[ k ], &movingImageDerivatives[ k ] );
+      }
+
+      if ( sampleOk )
+      {
+        fixedPoints[ k ] = fixedPoints[ i ];
+        sampleIndices[ k ] = first + i;
+        fixedImageValues[ k ] = static_cast<RealType>(
+          sampleContainer->ElementAt( first + i ).m_ImageValue );
+        ++numberOfValidSamples;
+      }
+    }
+    numberOfPixelsCounted += numberOfValidSamples;
 
+    /** Get the TransformJacobians dT/dmu of the valid samples. */
+    this->EvaluateTransformSampleJacobians( sampleIndices, fixedPoints,
+      jacobians, nzjis, jacobianPointers, nzjiPointers, numberOfValidSamples );
+
+    /** Accumulate the contributions in sample order. */
+    for ( unsigned long k = 0; k < numberOfValidSamples; ++k )
+    {
       /** Compute the inner products (dM/dx)^T (dT/dmu). */
       this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+        *jacobianPointers[ k ], movingImageDerivatives[ k ], imageJacobian );
 
       /** Compute this pixel's contribution to the measure and derivatives. */
       this->UpdateValueAndDerivativeTerms(
-        fixedImageValue, movingImageValue,
-        imageJacobian, nzji,
-        measure, derivative );
+        fixedImageValues[ k ], movingImageValues[ k ],
+        imageJacobian, *nzjiPointers[ k ],
+        measure, deriv );
+    }
 
-    } // end if sampleOk
+  } // end for all batches
 
-  } // end for loop over the image sample container
+} // end AccumulateValueAndDerivativeTerms()
+
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
+::AfterThreadedGetValueAndDerivative(
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Gather the results of all threads, always in the same order,
+   * so that the outcome does not depend on thread scheduling.
+   */
+  this->m_NumberOfPixelsCounted = 0;
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  derivative = this->m_GetValueAndDerivativePerThreadVariables[ 0 ].st_Derivative;
+  for ( unsigned int i = 0; i < this->GetNumberOfThreads(); ++i )
+  {
+    const GetValueAndDerivativePerThreadStruct & perThread
+      = this->m_GetValueAndDerivativePerThreadVariables[ i ];
+    this->m_NumberOfPixelsCounted += perThread.st_NumberOfPixelsCounted;
+    measure += perThread.st_Value;
+    if ( i > 0 )
+    {
+      derivative += perThread.st_Derivative;
+    }
+  }
 
   /** Check if enough samples were valid. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
   this->CheckNumberOfSamples(
     sampleContainer->Size(), this->m_NumberOfPixelsCounted );
 
@@ -361,7 +500,7 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
   /** The return value. */
   value = measure;
 
-} // end GetValueAndDerivative()
+} // end AfterThreadedGetValueAndDerivative()
 
 
 /**
@@ -190,6 +190,29 @@ protected:
   typedef typename Superclass::MovingImageDerivativeType          MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType         NonZeroJacobianIndicesType;
 
+  /** Typedefs for multi-threading. */
+  typedef typename NumericTraits< MeasureType >::AccumulateType   AccumulateType;
+
+  /** Accumulators of a single thread; NC needs more than a value and
+   * a derivative, so it has its own per-thread struct. */
+  struct CorrelationGetValueAndDerivativePerThreadStruct
+  {
+    unsigned long   st_NumberOfPixelsCounted;
+    AccumulateType  st_Sff;
+    AccumulateType  st_Smm;
+    AccumulateType  st_Sfm;
+    AccumulateType  st_Sf;
+    AccumulateType  st_Sm;
+    DerivativeType  st_DerivativeF;
+    DerivativeType  st_DerivativeM;
+    DerivativeType  st_Differential;
+  };
+  typedef std::vector<
+    CorrelationGetValueAndDerivativePerThreadStruct >             CorrelationGetValueAndDerivativePerThreadVariablesType;
+
+  mutable CorrelationGetValueAndDerivativePerThreadVariablesType
+    m_CorrelationGetValueAndDerivativePerThreadVariables;
+
   /** Computes the innerproduct of transform Jacobian with moving image gradient.
    * The results are stored in imageJacobian, which is supposed
    * to have the right size (same length as Jacobian's number of columns). */
@@ -198,6 +221,16 @@ protected:
     const MovingImageDerivativeType & movingImageDerivative,
     DerivativeType & imageJacobian) const;
 
+  /** Resize and zero the per-thread accumulators. */
+  virtual void InitializeThreadingParameters( void ) const;
+
+  /** Multi-threaded version of the sample loop of GetValueAndDerivative(). */
+  virtual void ThreadedGetValueAndDerivative( unsigned int threadID ) const;
+
+  /** Gather the sums of all threads and compute the value and derivative. */
+  virtual void AfterThreadedGetValueAndDerivative(
+    MeasureType & value, DerivativeType & derivative ) const;
+
   /** Compute a pixel's contribution to the derivative terms;
    * Called by GetValueAndDerivative(). */
   void UpdateDerivativeTerms(
@@ -161,6 +161,7 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
   /** Update the imageSampler and get a handle to the sample container. */
   this->GetImageSampler()->Update();
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  this->UpdateTransformedSampleCache();
 
   /** Create iterator over the sample container. */
   typename ImageSampleContainerType::ConstIterator fiter;
@@ -184,7 +185,7 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
     MovingImagePointType mappedPoint;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = this->TransformSamplePoint( fiter.Index(), fixedPoint, mappedPoint );
 
     /** Check if point is inside mask. */
     if ( sampleOk )
@@ -316,8 +317,20 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
-  /** Update the imageSampler and get a handle to the sample container. */
+  /** Update the imageSampler. */
   this->GetImageSampler()->Update();
+  this->UpdateTransformedSampleCache();
+
+  /** Distribute the sample loop over the threads, if desired. */
+  if ( this->UseMultiThreadedGetValueAndDerivative() )
+  {
+    this->InitializeThreadingParameters();
+    this->LaunchGetValueAndDerivativeThreaderCallback();
+    this->AfterThreadedGetValueAndDerivative( value, derivative );
+    return;
+  }
+
+  /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Create iterator over the sample container. */
@@ -335,7 +348,7 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
     MovingImageDerivativeType movingImageDerivative;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = this->TransformSamplePoint( fiter.Index(), fixedPoint, mappedPoint );
 
     /** Check if point is inside mask. */
     if ( sampleOk )
@@ -360,11 +373,14 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
       const RealType & fixedImageValue = static_cast<RealType>( (*fiter).Value().m_ImageValue );
 
       /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+      const TransformJacobianType * sampleJacobian;
+      const NonZeroJacobianIndicesType * sampleNzji;
+      this->EvaluateTransformSampleJacobian( fiter.Index(), fixedPoint,
+        jacobian, nzji, sampleJacobian, sampleNzji );
 
       /** Compute the innerproducts (dM/dx)^T (dT/dmu) and (dMask/dx)^T (dT/dmu). */
       this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+        *sampleJacobian, movingImageDerivative, imageJacobian );
 
       /** Update some sums needed to calculate the value of NC. */
       sff += fixedImageValue  * fixedImageValue;
@@ -375,7 +391,7 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
 
       /** Compute this pixel's contribution to the derivative terms. */
       this->UpdateDerivativeTerms(
-        fixedImageValue, movingImageValue, imageJacobian, nzji,
+        fixedImageValue, movingImageValue, imageJacobian, *sampleNzji,
         derivativeF, derivativeM, differential );
 
     } // end if sampleOk
@@ -425,6 +441,229 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
 } // end GetValueAndDerivative()
 
 
+/**
+ * ******************* InitializeThreadingParameters *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::InitializeThreadingParameters( void ) const
+{
+  /** Initialize the per-thread variables of the superclass. */
+  this->Superclass::InitializeThreadingParameters();
+
+  /** Initialize the per-thread variables of this class. The derivative
+   * vectors are only reallocated when their size changes.
+   */
+  typedef typename DerivativeType::ValueType        DerivativeValueType;
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  this->m_CorrelationGetValueAndDerivativePerThreadVariables.resize(
+    this->GetNumberOfThreads() );
+  for ( unsigned int i = 0; i < this->GetNumberOfThreads(); ++i )
+  {
+    CorrelationGetValueAndDerivativePerThreadStruct & perThread
+      = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ];
+    perThread.st_NumberOfPixelsCounted = 0;
+    perThread.st_Sff = NumericTraits< AccumulateType >::Zero;
+    perThread.st_Smm = NumericTraits< AccumulateType >::Zero;
+    perThread.st_Sfm = NumericTraits< AccumulateType >::Zero;
+    perThread.st_Sf  = NumericTraits< AccumulateType >::Zero;
+    perThread.st_Sm  = NumericTraits< AccumulateType >::Zero;
+    if ( perThread.st_DerivativeF.GetSize() != numberOfParameters )
+    {
+      perThread.st_DerivativeF.SetSize( numberOfParameters );
+      perThread.st_DerivativeM.SetSize( numberOfParameters );
+      perThread.st_Differential.SetSize( numberOfParameters );
+    }
+    perThread.st_DerivativeF.Fill( NumericTraits< DerivativeValueType >::Zero );
+    perThread.st_DerivativeM.Fill( NumericTraits< DerivativeValueType >::Zero );
+    perThread.st_Differential.Fill( NumericTraits< DerivativeValueType >::Zero );
+  }
+
+} // end InitializeThreadingParameters()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedGetValueAndDerivative( unsigned int threadID ) const
+{
+  /** Get a handle to this thread's accumulators. */
+  CorrelationGetValueAndDerivativePerThreadStruct & perThread
+    = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadID ];
+
+  /** Array that stores dM(x)/dmu, and the sparse Jacobian + indices. */
+  NonZeroJacobianIndicesType nzji( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+  DerivativeType imageJacobian( nzji.size() );
+  TransformJacobianType jacobian;
+
+  /** Get a handle to the sample container and select this thread's part. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  unsigned long begin = 0;
+  unsigned long end = 0;
+  this->GetSampleRangeForThread( threadID, sampleContainer->Size(), begin, end );
+
+  /** Loop over this thread's part of the sample container. */
+  for ( unsigned long i = begin; i < end; ++i )
+  {
+    /** Read fixed coordinates and initialize some variables. */
+    const FixedImagePointType & fixedPoint
+      = sampleContainer->ElementAt( i ).m_ImageCoordinates;
+    RealType movingImageValue;
+    MovingImagePointType mappedPoint;
+    MovingImageDerivativeType movingImageDerivative;
+
+    /** Transform point and check if it is inside the B-spline support region. */
+    bool sampleOk = this->TransformSamplePoint( i, fixedPoint, mappedPoint );
+
+    /** Check if point is inside mask. */
+    if ( sampleOk )
+    {
+      sampleOk = this->IsInsideMovingMask( mappedPoint );
+    }
+
+    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+     * the point is inside the moving image buffer.
+     */
+    if ( sampleOk )
+    {
+      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+        mappedPoint, movingImageValue, &movingImageDerivative );
+    }
+
+    if ( sampleOk )
+    {
+      perThread.st_NumberOfPixelsCounted++;
+
+      /** Get the fixed image value. */
+      const RealType & fixedImageValue
+        = static_cast<RealType>( sampleContainer->ElementAt( i ).m_ImageValue );
+
+      /** Get the TransformJacobian dT/dmu. */
+      const TransformJacobianType * sampleJacobian;
+      const NonZeroJacobianIndicesType * sampleNzji;
+      this->EvaluateTransformSampleJacobian( i, fixedPoint,
+        jacobian, nzji, sampleJacobian, sampleNzji );
+
+      /** Compute the innerproducts (dM/dx)^T (dT/dmu) and (dMask/dx)^T (dT/dmu). */
+      this->EvaluateTransformJacobianInnerProduct(
+        *sampleJacobian, movingImageDerivative, imageJacobian );
+
+      /** Update some sums needed to calculate the value of NC. */
+      perThread.st_Sff += fixedImageValue  * fixedImageValue;
+      perThread.st_Smm += movingImageValue * movingImageValue;
+      perThread.st_Sfm += fixedImageValue  * movingImageValue;
+      perThread.st_Sf  += fixedImageValue;  // Only needed when m_SubtractMean == true
+      perThread.st_Sm  += movingImageValue; // Only needed when m_SubtractMean == true
+
+      /** Compute this pixel's contribution to the derivative terms. */
+      this->UpdateDerivativeTerms(
+        fixedImageValue, movingImageValue, imageJacobian, *sampleNzji,
+        perThread.st_DerivativeF, perThread.st_DerivativeM,
+        perThread.st_Differential );
+
+    } // end if sampleOk
+
+  } // end for loop over this thread's samples
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::AfterThreadedGetValueAndDerivative(
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  typedef typename DerivativeType::ValueType        DerivativeValueType;
+
+  /** Gather the results of all threads, always in the same order,
+   * so that the outcome does not depend on thread scheduling.
+   */
+  this->m_NumberOfPixelsCounted = 0;
+  AccumulateType sff = NumericTraits< AccumulateType >::Zero;
+  AccumulateType smm = NumericTraits< AccumulateType >::Zero;
+  AccumulateType sfm = NumericTraits< AccumulateType >::Zero;
+  AccumulateType sf  = NumericTraits< AccumulateType >::Zero;
+  AccumulateType sm  = NumericTraits< AccumulateType >::Zero;
+  DerivativeType derivativeF
+    = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_DerivativeF;
+  DerivativeType derivativeM
+    = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_DerivativeM;
+  DerivativeType differential
+    = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_Differential;
+  for ( unsigned int i = 0; i < this->GetNumberOfThreads(); ++i )
+  {
+    const CorrelationGetValueAndDerivativePerThreadStruct & perThread
+      = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ];
+    this->m_NumberOfPixelsCounted += perThread.st_NumberOfPixelsCounted;
+    sff += perThread.st_Sff;
+    smm += perThread.st_Smm;
+    sfm += perThread.st_Sfm;
+    sf  += perThread.st_Sf;
+    sm  += perThread.st_Sm;
+    if ( i > 0 )
+    {
+      derivativeF  += perThread.st_DerivativeF;
+      derivativeM  += perThread.st_DerivativeM;
+      differential += perThread.st_Differential;
+    }
+  }
+
+  /** Check if enough samples were valid. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  this->CheckNumberOfSamples(
+    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+
+  /** If SubtractMean, then subtract things from sff, smm, sfm,
+   * derivativeF and derivativeM.
+   */
+  const RealType N = static_cast<RealType>( this->m_NumberOfPixelsCounted );
+  if ( this->m_SubtractMean && this->m_NumberOfPixelsCounted > 0 )
+  {
+    sff -= ( sf * sf / N );
+    smm -= ( sm * sm / N );
+    sfm -= ( sf * sm / N );
+
+    for( unsigned int i = 0; i < this->GetNumberOfParameters(); i++ )
+    {
+      derivativeF[ i ] -= sf * differential[ i ] / N;
+      derivativeM[ i ] -= sm * differential[ i ] / N;
+    }
+  }
+
+  /** The denominator of the value and the derivative. */
+  const RealType denom = -1.0 * vcl_sqrt( sff * smm );
+
+  /** Calculate the value and the derivative. */
+  derivative.SetSize( this->GetNumberOfParameters() );
+  if ( this->m_NumberOfPixelsCounted > 0 && denom < -1e-14 )
+  {
+    value = sfm / denom;
+    for ( unsigned int i = 0; i < this->GetNumberOfParameters(); i++ )
+    {
+      derivative[ i ] = ( derivativeF[ i ] - ( sfm / smm ) * derivativeM[ i ] )
+        / denom;
+    }
+  }
+  else
+  {
+    value = NumericTraits< MeasureType >::Zero;
+    derivative.Fill( NumericTraits< DerivativeValueType >::Zero );
+  }
+
+} // end AfterThreadedGetValueAndDerivative()
+
+
 } // end namespace itk
 
 
@@ -106,6 +106,7 @@ public:
   typedef typename Superclass
     ::JacobianOfSpatialHessianType                  JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType   InternalMatrixType;
+  typedef typename Superclass::JacobianWorkspaceType  JacobianWorkspaceType;
 	typedef typename Superclass::HessianValueType			HessianValueType;
 	typedef typename Superclass::HessianType					HessianType;
 
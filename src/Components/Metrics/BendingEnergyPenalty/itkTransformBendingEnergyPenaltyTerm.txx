@@ -158,6 +158,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   SpatialHessianType spatialHessian;
   JacobianOfSpatialHessianType jacobianOfSpatialHessian;
   NonZeroJacobianIndicesType nonZeroJacobianIndices;
+  JacobianWorkspaceType jacobianWorkspace;
   unsigned long numberOfNonZeroJacobianIndices = this->m_AdvancedTransform
      ->GetNumberOfNonZeroJacobianIndices();
   jacobianOfSpatialHessian.resize( numberOfNonZeroJacobianIndices );
@@ -221,7 +222,8 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
 //       this->m_AdvancedTransform->GetJacobianOfSpatialHessian( fixedPoint,
 //         jacobianOfSpatialHessian, nonZeroJacobianIndices );
        this->m_AdvancedTransform->GetJacobianOfSpatialHessian( fixedPoint,
-         spatialHessian, jacobianOfSpatialHessian, nonZeroJacobianIndices );
+         spatialHessian, jacobianOfSpatialHessian, nonZeroJacobianIndices,
+         jacobianWorkspace );
 
       /** Prepare some stuff for the computation of the metric (derivative). */
       FixedArray< InternalMatrixType, FixedImageDimension > A;
@@ -351,6 +353,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   NonZeroJacobianIndicesType nonZeroJacobianIndices(
     this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
   JacobianOfSpatialHessianType jacobianOfSpatialHessian;
+  JacobianWorkspaceType jacobianWorkspace;
 
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
@@ -411,7 +414,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
       this->m_NumberOfPixelsCounted++;
 
       this->m_AdvancedTransform->GetJacobianOfSpatialHessian( fixedPoint,
-        jacobianOfSpatialHessian, nonZeroJacobianIndices );
+        jacobianOfSpatialHessian, nonZeroJacobianIndices, jacobianWorkspace );
 
       /** Compute the contribution to the metric derivative of this point. */
       for ( unsigned int muA = 0; muA < nonZeroJacobianIndices.size(); ++muA )
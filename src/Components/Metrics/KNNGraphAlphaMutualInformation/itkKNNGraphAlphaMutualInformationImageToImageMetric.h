@@ -33,6 +33,7 @@
 #include "itkANNStandardTreeSearch.h"
 #include "itkANNFixedRadiusTreeSearch.h"
 #include "itkANNPriorityTreeSearch.h"
+#include "ANN/ANN.h"
 
 /** Include for the spatial derivatives. */
 #include "itkArray2D.h"
@@ -65,6 +66,12 @@ namespace itk
  * IEEE Transactions on Medical Imaging, vol. 28, no. 9, pp. 1412 - 1421,
  * September 2009.
  *
+ * The k nearest neighbour queries are distributed over multiple threads,
+ * if multi-threading is enabled in the superclass and the compiler supports
+ * the thread local storage that ANN needs for that. The tree of the fixed
+ * samples is only rebuilt when the fixed samples have changed since the
+ * previous evaluation of the metric.
+ *
  * \ingroup RegistrationMetrics
  */
 
@@ -280,12 +287,56 @@ private:
   typedef std::vector<NonZeroJacobianIndicesType>        TransformJacobianIndicesContainerType;
   typedef Array2D<double>                                SpatialDerivativeType;
   typedef std::vector<SpatialDerivativeType>             SpatialDerivativeContainerType;
+  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
+
+  /** Typedefs for multi-threading. */
+  typedef typename Superclass::ThreadInfoType            ThreadInfoType;
+
+  /** The graph lengths of a single thread, which are added in thread
+   * order in ComputeKNNGraphLengths().
+   */
+  struct KNNGraphPerThreadStruct
+  {
+    AccumulateType  st_SumG;
+    DerivativeType  st_Contribution;
+  };
+  typedef std::vector< KNNGraphPerThreadStruct >         KNNGraphPerThreadVariablesType;
+  mutable KNNGraphPerThreadVariablesType                 m_KNNGraphPerThreadVariables;
+
+  /** The list samples and derivative information of the current evaluation,
+   * which are shared by the threads in ComputeKNNGraphLengths().
+   */
+  mutable ListSamplePointer                              m_ListSampleFixed;
+  mutable ListSamplePointer                              m_ListSampleMoving;
+  mutable ListSamplePointer                              m_ListSampleJoint;
+  mutable const TransformJacobianContainerType *         m_JacobianContainer;
+  mutable const TransformJacobianIndicesContainerType *  m_JacobianIndicesContainer;
+  mutable const SpatialDerivativeContainerType *         m_SpatialDerivativesContainer;
+  mutable bool                                           m_ComputeKNNGraphDerivative;
+
+  /** Two sets of list samples, in which the samples of an evaluation are
+   * stored. The fixed and moving list samples are views on the joint list
+   * sample, which owns the memory. An evaluation uses the set that is not
+   * referred to by the fixed tree, which may be kept from a previous
+   * evaluation, see UpdateFixedTree().
+   */
+  ListSamplePointer                                      m_ListSampleSetFixed[ 2 ];
+  ListSamplePointer                                      m_ListSampleSetMoving[ 2 ];
+  ListSamplePointer                                      m_ListSampleSetJoint[ 2 ];
+
+  /** Get the set of list samples to be used by the current evaluation. */
+  virtual void GetListSamples(
+    ListSamplePointer & listSampleFixed,
+    ListSamplePointer & listSampleMoving,
+    ListSamplePointer & listSampleJoint ) const;
 
   /** This function takes the fixed image samples from the ImageSampler
    * and puts them in the listSampleFixed, together with the fixed feature
    * image samples. Also the corresponding moving image values and moving
    * feature values are computed and put into listSampleMoving. The
-   * concatenation is put into listSampleJoint.
+   * concatenation is put into listSampleJoint. The feature vectors are
+   * written directly in the memory of listSampleJoint; listSampleFixed and
+   * listSampleMoving are set to views on the fixed and moving features.
    * If desired, i.e. if doDerivative is true, then also things needed to
    * compute the derivative of the cost function to the transform parameters
    * are computed:
@@ -330,6 +381,44 @@ private:
     DerivativeType & dGamma_M,
     DerivativeType & dGamma_J ) const;
 
+  /** Build the tree of the fixed samples, and connect it to the fixed
+   * tree searcher. The fixed samples do not depend on the transform
+   * parameters, so if they equal the samples of the current fixed tree,
+   * which is the case when the image sampler did not select new samples,
+   * the current fixed tree is kept.
+   */
+  virtual void UpdateFixedTree( const ListSamplePointer & listSampleFixed ) const;
+
+  /** Search the k nearest neighbours of all query points, and compute
+   * sumG = \sum_i G_i^{2 \gamma} and, if doDerivative, the contribution
+   * to the derivative. The query points are distributed over the threads,
+   * if multi-threading is enabled.
+   */
+  virtual void ComputeKNNGraphLengths(
+    const ListSamplePointer & listSampleFixed,
+    const ListSamplePointer & listSampleMoving,
+    const ListSamplePointer & listSampleJoint,
+    const bool & doDerivative,
+    const TransformJacobianContainerType & jacobians,
+    const TransformJacobianIndicesContainerType & jacobiansIndices,
+    const SpatialDerivativeContainerType & spatialDerivatives,
+    AccumulateType & sumG,
+    DerivativeType & contribution ) const;
+
+  /** Compute the graph lengths of the query points [begin, end). Only
+   * the trees and the samples are shared, so this function may be
+   * called by multiple threads concurrently for disjoint ranges.
+   */
+  virtual void ComputeKNNGraphLengthsForRange(
+    unsigned long begin, unsigned long end,
+    AccumulateType & sumG, DerivativeType & contribution ) const;
+
+  /** Compute the graph lengths of the query points of threadID. */
+  virtual void ThreadedComputeKNNGraphLengths( unsigned int threadID ) const;
+
+  /** The static callback function passed to the threader. */
+  static ITK_THREAD_RETURN_TYPE ComputeKNNGraphLengthsThreaderCallback( void * arg );
+
  }; // end class KNNGraphAlphaMutualInformationImageToImageMetric
 
 } // end namespace itk
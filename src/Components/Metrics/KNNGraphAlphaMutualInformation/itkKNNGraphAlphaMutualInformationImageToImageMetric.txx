@@ -42,6 +42,18 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
   this->m_BinaryKNNTreeSearcherMoving = 0;
   this->m_BinaryKNNTreeSearcherJoint = 0;
 
+  this->m_JacobianContainer = 0;
+  this->m_JacobianIndicesContainer = 0;
+  this->m_SpatialDerivativesContainer = 0;
+  this->m_ComputeKNNGraphDerivative = false;
+
+  for ( unsigned int i = 0; i < 2; ++i )
+  {
+    this->m_ListSampleSetFixed[ i ]  = ListSampleType::New();
+    this->m_ListSampleSetMoving[ i ] = ListSampleType::New();
+    this->m_ListSampleSetJoint[ i ]  = ListSampleType::New();
+  }
+
 } // end Constructor()
 
 
@@ -309,10 +321,11 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
    * *************** Create the three list samples ******************
    */
 
-  /** Create list samples. */
-  ListSamplePointer listSampleFixed  = ListSampleType::New();
-  ListSamplePointer listSampleMoving = ListSampleType::New();
-  ListSamplePointer listSampleJoint  = ListSampleType::New();
+  /** Get the list samples. Their memory is reused between evaluations. */
+  ListSamplePointer listSampleFixed  = 0;
+  ListSamplePointer listSampleMoving = 0;
+  ListSamplePointer listSampleJoint  = 0;
+  this->GetListSamples( listSampleFixed, listSampleMoving, listSampleJoint );
 
   /** Compute the three list samples. */
   TransformJacobianContainerType dummyJacobianContainer;
@@ -334,9 +347,8 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
    * and connect them to the searchers.
    */
 
-  /** Generate the tree for the fixed image samples. */
-  this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
-  this->m_BinaryKNNTreeFixed->GenerateTree();
+  /** Generate the tree for the fixed image samples, if they changed. */
+  this->UpdateFixedTree( listSampleFixed );
 
   /** Generate the tree for the moving image samples. */
   this->m_BinaryKNNTreeMoving->SetSample( listSampleMoving );
@@ -346,9 +358,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
   this->m_BinaryKNNTreeJoint->SetSample( listSampleJoint );
   this->m_BinaryKNNTreeJoint->GenerateTree();
 
-  /** Initialize tree searchers. */
-  this->m_BinaryKNNTreeSearcherFixed
-    ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
+  /** Initialize the moving and joint tree searchers. */
   this->m_BinaryKNNTreeSearcherMoving
     ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
   this->m_BinaryKNNTreeSearcherJoint
@@ -387,77 +397,13 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
    * where d1 and d2 are the possibly different dimensions of the two feature sets.
    */
 
-  /** Temporary variables. */
-  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
-  MeasurementVectorType z_F, z_M, z_J;
-  IndexArrayType indices_F, indices_M, indices_J;
-  DistanceArrayType distances_F, distances_M, distances_J;
-
-  MeasureType H, G;
+  /** Search the nearest neighbours of all query points. */
   AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
-
-  /** Get the size of the feature vectors. */
-  unsigned int fixedSize  = this->GetNumberOfFixedImages();
-  unsigned int movingSize = this->GetNumberOfMovingImages();
-  unsigned int jointSize  = fixedSize + movingSize;
-
-  /** Get the number of neighbours and \gamma. */
-  unsigned int k = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
-  double twoGamma = jointSize * ( 1.0 - this->m_Alpha );
-
-  /** Loop over all query points, i.e. all samples. */
-  for ( unsigned long i = 0; i < this->m_NumberOfPixelsCounted; i++ )
-  {
-    /** Get the i-th query point. */
-    listSampleFixed->GetMeasurementVector(  i, z_F );
-    listSampleMoving->GetMeasurementVector( i, z_M );
-    listSampleJoint->GetMeasurementVector(  i, z_J );
-
-    /** Search for the K nearest neighbours of the current query point. */
-    this->m_BinaryKNNTreeSearcherFixed->Search(  z_F, indices_F, distances_F );
-    this->m_BinaryKNNTreeSearcherMoving->Search( z_M, indices_M, distances_M );
-    this->m_BinaryKNNTreeSearcherJoint->Search(  z_J, indices_J, distances_J );
-
-    /** Add the distances between the points to get the total graph length.
-     * The outcommented implementation calculates: sum J/sqrt(F*M)
-     *
-    for ( unsigned int j = 0; j < K; j++ )
-    {
-    enumerator = vcl_sqrt( distsJ[ j ] );
-    denominator = vcl_sqrt( vcl_sqrt( distsF[ j ] ) * vcl_sqrt( distsM[ j ] ) );
-    if ( denominator > 1e-14 )
-    {
-    contribution += vcl_pow( enumerator / denominator, twoGamma );
-    }
-    }*/
-
-    /** Add the distances of all neighbours of the query point,
-    * for the three graphs:
-    * sum M / sqrt( sum F * sum M)
-    */
-
-    /** Variables to compute the measure. */
-    AccumulateType Gamma_F = NumericTraits< AccumulateType >::Zero;
-    AccumulateType Gamma_M = NumericTraits< AccumulateType >::Zero;
-    AccumulateType Gamma_J = NumericTraits< AccumulateType >::Zero;
-
-    /** Loop over the neighbours. */
-    for ( unsigned int p = 0; p < k; p++ )
-    {
-      Gamma_F += vcl_sqrt( distances_F[ p ] );
-      Gamma_M += vcl_sqrt( distances_M[ p ] );
-      Gamma_J += vcl_sqrt( distances_J[ p ] );
-    } // end loop over the k neighbours
-
-    /** Calculate the contribution of this query point. */
-    H = vcl_sqrt( Gamma_F * Gamma_M );
-    if ( H > this->m_AvoidDivisionBy )
-    {
-      /** Compute some sums. */
-      G = Gamma_J / H;
-      sumG += vcl_pow( G, twoGamma );
-    }
-  } // end looping over all query points
+  DerivativeType dummyContribution;
+  this->ComputeKNNGraphLengths(
+    listSampleFixed, listSampleMoving, listSampleJoint,
+    false, dummyJacobianContainer, dummyJacobianIndicesContainer,
+    dummySpatialDerivativesContainer, sumG, dummyContribution );
 
   /**
    * *************** Finally, calculate the metric value \alpha MI ******************
@@ -524,10 +470,11 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
    * *************** Create the three list samples ******************
    */
 
-  /** Create list samples. */
-  ListSamplePointer listSampleFixed  = ListSampleType::New();
-  ListSamplePointer listSampleMoving = ListSampleType::New();
-  ListSamplePointer listSampleJoint  = ListSampleType::New();
+  /** Get the list samples. Their memory is reused between evaluations. */
+  ListSamplePointer listSampleFixed  = 0;
+  ListSamplePointer listSampleMoving = 0;
+  ListSamplePointer listSampleJoint  = 0;
+  this->GetListSamples( listSampleFixed, listSampleMoving, listSampleJoint );
 
   /** Compute the three list samples and the derivatives. */
   TransformJacobianContainerType jacobianContainer;
@@ -547,9 +494,8 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
    * and connect them to the searchers.
    */
 
-  /** Generate the tree for the fixed image samples. */
-  this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
-  this->m_BinaryKNNTreeFixed->GenerateTree();
+  /** Generate the tree for the fixed image samples, if they changed. */
+  this->UpdateFixedTree( listSampleFixed );
 
   /** Generate the tree for the moving image samples. */
   this->m_BinaryKNNTreeMoving->SetSample( listSampleMoving );
@@ -559,9 +505,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
   this->m_BinaryKNNTreeJoint->SetSample( listSampleJoint );
   this->m_BinaryKNNTreeJoint->GenerateTree();
 
-  /** Initialize tree searchers. */
-  this->m_BinaryKNNTreeSearcherFixed
-    ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
+  /** Initialize the moving and joint tree searchers. */
   this->m_BinaryKNNTreeSearcherMoving
     ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
   this->m_BinaryKNNTreeSearcherJoint
@@ -600,108 +544,19 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
    * where d1 and d2 are the possibly different dimensions of the two feature sets.
    */
 
-  /** Temporary variables. */
-  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
-  MeasurementVectorType z_F, z_M, z_J, z_M_ip, z_J_ip, diff_M, diff_J;
-  IndexArrayType    indices_F,   indices_M,   indices_J;
-  DistanceArrayType distances_F, distances_M, distances_J;
-  MeasureType       distance_F,  distance_M,  distance_J;
-
-  MeasureType H, G, Gpow;
+  /** Search the nearest neighbours of all query points. */
   AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
-
   DerivativeType contribution( this->GetNumberOfParameters() );
-  contribution.Fill( NumericTraits< DerivativeValueType >::Zero );
-  DerivativeType dGamma_M( this->GetNumberOfParameters() );
-  DerivativeType dGamma_J( this->GetNumberOfParameters() );
+  this->ComputeKNNGraphLengths(
+    listSampleFixed, listSampleMoving, listSampleJoint,
+    true, jacobianContainer, jacobianIndicesContainer,
+    spatialDerivativesContainer, sumG, contribution );
 
   /** Get the size of the feature vectors. */
   unsigned int fixedSize  = this->GetNumberOfFixedImages();
   unsigned int movingSize = this->GetNumberOfMovingImages();
   unsigned int jointSize  = fixedSize + movingSize;
 
-  /** Get the number of neighbours and \gamma. */
-  unsigned int k = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
-  double twoGamma = jointSize * ( 1.0 - this->m_Alpha );
-
-  /** Loop over all query points, i.e. all samples. */
-  for ( unsigned long i = 0; i < this->m_NumberOfPixelsCounted; i++ )
-  {
-    /** Get the i-th query point. */
-    listSampleFixed->GetMeasurementVector(  i, z_F );
-    listSampleMoving->GetMeasurementVector( i, z_M );
-    listSampleJoint->GetMeasurementVector(  i, z_J );
-
-    /** Search for the k nearest neighbours of the current query point. */
-    this->m_BinaryKNNTreeSearcherFixed->Search(  z_F, indices_F, distances_F );
-    this->m_BinaryKNNTreeSearcherMoving->Search( z_M, indices_M, distances_M );
-    this->m_BinaryKNNTreeSearcherJoint->Search(  z_J, indices_J, distances_J );
-
-    /** Variables to compute the measure and its derivative. */
-    AccumulateType Gamma_F = NumericTraits< AccumulateType >::Zero;
-    AccumulateType Gamma_M = NumericTraits< AccumulateType >::Zero;
-    AccumulateType Gamma_J = NumericTraits< AccumulateType >::Zero;
-
-    SpatialDerivativeType D1sparse, D2sparse_M, D2sparse_J;
-    D1sparse = spatialDerivativesContainer[ i ] * jacobianContainer[ i ];
-
-    dGamma_M.Fill( NumericTraits< DerivativeValueType >::Zero );
-    dGamma_J.Fill( NumericTraits< DerivativeValueType >::Zero );
-
-    /** Loop over the neighbours. */
-    for ( unsigned int p = 0; p < k; p++ )
-    {
-      /** Get the neighbour point z_ip^M. */
-      listSampleMoving->GetMeasurementVector( indices_M[ p ], z_M_ip );
-      listSampleMoving->GetMeasurementVector( indices_J[ p ], z_J_ip );
-
-      /** Get the distances. */
-      distance_F = vcl_sqrt( distances_F[ p ] );
-      distance_M = vcl_sqrt( distances_M[ p ] );
-      distance_J = vcl_sqrt( distances_J[ p ] );
-
-      /** Compute Gamma's. */
-      Gamma_F += distance_F;
-      Gamma_M += distance_M;
-      Gamma_J += distance_J;
-
-      /** Get the difference of z_ip^M with z_i^M. */
-      diff_M = z_M - z_M_ip;
-      diff_J = z_M - z_J_ip;
-
-      /** Compute derivatives. */
-      D2sparse_M = spatialDerivativesContainer[ indices_M[ p ] ]
-      * jacobianContainer[ indices_M[ p ] ];
-      D2sparse_J = spatialDerivativesContainer[ indices_J[ p ] ]
-      * jacobianContainer[ indices_J[ p ] ];
-
-      /** Update the dGamma's. */
-      this->UpdateDerivativeOfGammas(
-        D1sparse, D2sparse_M, D2sparse_J,
-        jacobianIndicesContainer[ i ],
-        jacobianIndicesContainer[ indices_M[ p ] ],
-        jacobianIndicesContainer[ indices_J[ p ] ],
-        diff_M, diff_J,
-        distance_M, distance_J,
-        dGamma_M, dGamma_J );
-
-    } // end loop over the k neighbours
-
-    /** Compute contributions. */
-    H = vcl_sqrt( Gamma_F * Gamma_M );
-    if ( H > this->m_AvoidDivisionBy )
-    {
-      /** Compute some sums. */
-      G = Gamma_J / H;
-      sumG += vcl_pow( G, twoGamma );
-
-      /** Compute the contribution to the derivative. */
-      Gpow = vcl_pow( G, twoGamma - 1.0 );
-      contribution += ( Gpow / H ) * ( dGamma_J - ( 0.5 * Gamma_J / Gamma_M ) * dGamma_M );
-    }
-
-  } // end looping over all query points
-
   /**
    * *************** Finally, calculate the metric value and derivative ******************
    */
@@ -723,6 +578,37 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
 } // end GetValueAndDerivative()
 
 
+/**
+ * ************************ GetListSamples *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
+::GetListSamples(
+  ListSamplePointer & listSampleFixed,
+  ListSamplePointer & listSampleMoving,
+  ListSamplePointer & listSampleJoint ) const
+{
+  /** Select the set that is not referred to by the fixed tree. The fixed tree
+   * may be kept from a previous evaluation, so its samples must not be
+   * overwritten.
+   */
+  unsigned int set = 0;
+  if ( this->m_BinaryKNNTreeFixed.IsNotNull()
+    && this->m_BinaryKNNTreeFixed->GetSample()
+      == this->m_ListSampleSetFixed[ 0 ].GetPointer() )
+  {
+    set = 1;
+  }
+
+  listSampleFixed  = this->m_ListSampleSetFixed[ set ];
+  listSampleMoving = this->m_ListSampleSetMoving[ set ];
+  listSampleJoint  = this->m_ListSampleSetJoint[ set ];
+
+} // end GetListSamples()
+
+
 /**
  * ************************ ComputeListSampleValuesAndDerivativePlusJacobian *************************
  */
@@ -760,13 +646,21 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
   const unsigned int movingSize = this->GetNumberOfMovingImages();
   const unsigned int jointSize  = fixedSize + movingSize;
 
-  /** Resize the list samples so that enough memory is allocated. */
-  listSampleFixed->SetMeasurementVectorSize( fixedSize );
-  listSampleFixed->Resize( nrOfRequestedSamples );
-  listSampleMoving->SetMeasurementVectorSize( movingSize );
-  listSampleMoving->Resize( nrOfRequestedSamples );
+  /** Resize the joint list sample so that enough memory is allocated.
+   * The memory is reused if the number of samples did not change.
+   * The fixed and moving list samples are views on the first fixedSize
+   * and the last movingSize features of the joint samples, so that
+   * every feature value is stored only once.
+   */
   listSampleJoint->SetMeasurementVectorSize( jointSize );
   listSampleJoint->Resize( nrOfRequestedSamples );
+  MeasurementVectorValueType * jointBuffer = listSampleJoint->GetBufferPointer();
+  listSampleFixed->SetMeasurementVectorSize( fixedSize );
+  listSampleFixed->SetExternalBuffer(
+    jointBuffer, nrOfRequestedSamples, jointSize );
+  listSampleMoving->SetMeasurementVectorSize( movingSize );
+  listSampleMoving->SetExternalBuffer(
+    jointBuffer + fixedSize, nrOfRequestedSamples, jointSize );
 
   /** Potential speedup: it avoids re-allocations. I noticed performance
    * gains when nrOfRequestedSamples is about 10000 or higher.
@@ -828,40 +722,28 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
       const RealType & fixedImageValue = static_cast<RealType>(
         (*fiter).Value().m_ImageValue );
 
-      /** Add the samples to the ListSampleCarrays. */
-      listSampleFixed->SetMeasurement(  this->m_NumberOfPixelsCounted, 0,
-        fixedImageValue );
-      listSampleMoving->SetMeasurement( this->m_NumberOfPixelsCounted, 0,
-        movingImageValue );
-      listSampleJoint->SetMeasurement(  this->m_NumberOfPixelsCounted, 0,
-        fixedImageValue );
-      listSampleJoint->SetMeasurement(  this->m_NumberOfPixelsCounted,
-        this->GetNumberOfFixedImages(), movingImageValue );
+      /** Add the sample to the joint list sample, which also sets it
+       * in the fixed and moving list samples.
+       */
+      MeasurementVectorValueType * z_J = listSampleJoint
+        ->GetInternalContainer()[ this->m_NumberOfPixelsCounted ];
+      z_J[ 0 ] = fixedImageValue;
+      z_J[ fixedSize ] = movingImageValue;
 
       /** Get and set the values of the fixed feature images. */
-      for ( unsigned int j = 1; j < this->GetNumberOfFixedImages(); j++ )
+      for ( unsigned int j = 1; j < fixedSize; j++ )
       {
         fixedFeatureValue = this->m_FixedImageInterpolatorVector[ j ]
           ->Evaluate( fixedPoint );
-        listSampleFixed->SetMeasurement(
-          this->m_NumberOfPixelsCounted, j, fixedFeatureValue );
-        listSampleJoint->SetMeasurement(
-          this->m_NumberOfPixelsCounted, j, fixedFeatureValue );
+        z_J[ j ] = fixedFeatureValue;
       }
 
       /** Get and set the values of the moving feature images. */
-      for ( unsigned int j = 1; j < this->GetNumberOfMovingImages(); j++ )
+      for ( unsigned int j = 1; j < movingSize; j++ )
       {
         movingFeatureValue = this->m_InterpolatorVector[ j ]
           ->Evaluate( mappedPoint );
-        listSampleMoving->SetMeasurement(
-          this->m_NumberOfPixelsCounted,
-          j,
-          movingFeatureValue );
-        listSampleJoint->SetMeasurement(
-          this->m_NumberOfPixelsCounted,
-          j + this->GetNumberOfFixedImages(),
-          movingFeatureValue );
+        z_J[ j + fixedSize ] = movingFeatureValue;
       }
 
       /** Compute additional stuff for the computation of the derivative, if necessary.
@@ -1063,6 +945,327 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
 } // end UpdateDerivativeOfGammas()
 
 
+/**
+ * ************************ UpdateFixedTree *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
+::UpdateFixedTree( const ListSamplePointer & listSampleFixed ) const
+{
+  /** Compare the new fixed samples with the samples of the current tree.
+   * The fixed samples only depend on the sampler output and the fixed
+   * (feature) images, so they are the same as long as the sampler does
+   * not select new samples and the same samples were valid.
+   */
+  const ListSampleType * currentSample = this->m_BinaryKNNTreeFixed->GetSample();
+  bool fixedSamplesChanged = true;
+  if ( currentSample
+    && this->m_BinaryKNNTreeFixed->GetActualNumberOfDataPoints()
+      == listSampleFixed->GetActualSize()
+    && currentSample->GetMeasurementVectorSize()
+      == listSampleFixed->GetMeasurementVectorSize() )
+  {
+    const unsigned long numberOfSamples = listSampleFixed->GetActualSize();
+    const unsigned int dimension = listSampleFixed->GetMeasurementVectorSize();
+    const double * const * currentData = currentSample->GetInternalContainer();
+    const double * const * newData = listSampleFixed->GetInternalContainer();
+
+    fixedSamplesChanged = false;
+    for ( unsigned long i = 0; i < numberOfSamples && !fixedSamplesChanged; ++i )
+    {
+      for ( unsigned int j = 0; j < dimension; ++j )
+      {
+        if ( currentData[ i ][ j ] != newData[ i ][ j ] )
+        {
+          fixedSamplesChanged = true;
+          break;
+        }
+      }
+    }
+  }
+
+  /** Only generate a new tree if needed. Otherwise the current tree, and
+   * the sample it refers to, are kept. The query points are taken from
+   * the new fixed samples, which have the same values.
+   */
+  if ( fixedSamplesChanged )
+  {
+    this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
+    this->m_BinaryKNNTreeFixed->GenerateTree();
+  }
+
+  /** Initialize the fixed tree searcher. */
+  this->m_BinaryKNNTreeSearcherFixed
+    ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
+
+} // end UpdateFixedTree()
+
+
+/**
+ * ************************ ComputeKNNGraphLengths *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
+::ComputeKNNGraphLengths(
+  const ListSamplePointer & listSampleFixed,
+  const ListSamplePointer & listSampleMoving,
+  const ListSamplePointer & listSampleJoint,
+  const bool & doDerivative,
+  const TransformJacobianContainerType & jacobians,
+  const TransformJacobianIndicesContainerType & jacobiansIndices,
+  const SpatialDerivativeContainerType & spatialDerivatives,
+  AccumulateType & sumG,
+  DerivativeType & contribution ) const
+{
+  /** Store the data of this evaluation, so that the threads can access it. */
+  this->m_ListSampleFixed  = listSampleFixed;
+  this->m_ListSampleMoving = listSampleMoving;
+  this->m_ListSampleJoint  = listSampleJoint;
+  this->m_JacobianContainer = &jacobians;
+  this->m_JacobianIndicesContainer = &jacobiansIndices;
+  this->m_SpatialDerivativesContainer = &spatialDerivatives;
+  this->m_ComputeKNNGraphDerivative = doDerivative;
+
+  sumG = NumericTraits< AccumulateType >::Zero;
+  if ( doDerivative )
+  {
+    contribution.SetSize( this->GetNumberOfParameters() );
+    contribution.Fill( NumericTraits< DerivativeValueType >::Zero );
+  }
+
+  /** ANN keeps the search state in globals, which are only thread local
+   * when the compiler supports it.
+   */
+  if ( !ANN_HAS_THREAD_LOCAL || !this->UseMultiThreadedGetValueAndDerivative() )
+  {
+    /** Process all query points in this thread. */
+    this->ComputeKNNGraphLengthsForRange(
+      0, this->m_NumberOfPixelsCounted, sumG, contribution );
+  }
+  else
+  {
+    /** Initialize the per-thread variables. */
+    const unsigned int numberOfThreads = this->GetNumberOfThreads();
+    this->m_KNNGraphPerThreadVariables.resize( numberOfThreads );
+    for ( unsigned int t = 0; t < numberOfThreads; ++t )
+    {
+      KNNGraphPerThreadStruct & perThread = this->m_KNNGraphPerThreadVariables[ t ];
+      perThread.st_SumG = NumericTraits< AccumulateType >::Zero;
+      if ( doDerivative )
+      {
+        perThread.st_Contribution.SetSize( this->GetNumberOfParameters() );
+        perThread.st_Contribution.Fill( NumericTraits< DerivativeValueType >::Zero );
+      }
+    }
+
+    /** Search the nearest neighbours in parallel. */
+    this->LaunchThreaderCallback( Self::ComputeKNNGraphLengthsThreaderCallback );
+
+    /** Add the results of the threads, in thread order, so that the
+     * result does not depend on the thread scheduling.
+     */
+    for ( unsigned int t = 0; t < numberOfThreads; ++t )
+    {
+      const KNNGraphPerThreadStruct & perThread = this->m_KNNGraphPerThreadVariables[ t ];
+      sumG += perThread.st_SumG;
+      if ( doDerivative )
+      {
+        contribution += perThread.st_Contribution;
+      }
+    }
+  }
+
+  /** Release the data of this evaluation. */
+  this->m_ListSampleFixed  = 0;
+  this->m_ListSampleMoving = 0;
+  this->m_ListSampleJoint  = 0;
+  this->m_JacobianContainer = 0;
+  this->m_JacobianIndicesContainer = 0;
+  this->m_SpatialDerivativesContainer = 0;
+
+} // end ComputeKNNGraphLengths()
+
+
+/**
+ * ************************ ComputeKNNGraphLengthsForRange *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
+::ComputeKNNGraphLengthsForRange(
+  unsigned long begin, unsigned long end,
+  AccumulateType & sumG, DerivativeType & contribution ) const
+{
+  /** Get handles to the data of this evaluation. */
+  const ListSampleType * listSampleFixed  = this->m_ListSampleFixed.GetPointer();
+  const ListSampleType * listSampleMoving = this->m_ListSampleMoving.GetPointer();
+  const ListSampleType * listSampleJoint  = this->m_ListSampleJoint.GetPointer();
+  const bool doDerivative = this->m_ComputeKNNGraphDerivative;
+
+  /** Temporary variables. These are local, so that each thread
+   * has its own query points and search buffers.
+   */
+  MeasurementVectorType z_F, z_M, z_J, z_M_ip, z_J_ip, diff_M, diff_J;
+  IndexArrayType    indices_F,   indices_M,   indices_J;
+  DistanceArrayType distances_F, distances_M, distances_J;
+  MeasureType       distance_F,  distance_M,  distance_J;
+  MeasureType H, G, Gpow;
+  SpatialDerivativeType D1sparse, D2sparse_M, D2sparse_J;
+
+  DerivativeType dGamma_M, dGamma_J;
+  if ( doDerivative )
+  {
+    dGamma_M.SetSize( this->GetNumberOfParameters() );
+    dGamma_J.SetSize( this->GetNumberOfParameters() );
+  }
+
+  /** Get the size of the feature vectors. */
+  unsigned int fixedSize  = this->GetNumberOfFixedImages();
+  unsigned int movingSize = this->GetNumberOfMovingImages();
+  unsigned int jointSize  = fixedSize + movingSize;
+
+  /** Get the number of neighbours and \gamma. */
+  unsigned int k = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
+  double twoGamma = jointSize * ( 1.0 - this->m_Alpha );
+
+  /** Loop over the query points [begin, end). */
+  for ( unsigned long i = begin; i < end; i++ )
+  {
+    /** Get the i-th query point. */
+    listSampleFixed->GetMeasurementVector(  i, z_F );
+    listSampleMoving->GetMeasurementVector( i, z_M );
+    listSampleJoint->GetMeasurementVector(  i, z_J );
+
+    /** Search for the k nearest neighbours of the current query point. */
+    this->m_BinaryKNNTreeSearcherFixed->Search(  z_F, indices_F, distances_F );
+    this->m_BinaryKNNTreeSearcherMoving->Search( z_M, indices_M, distances_M );
+    this->m_BinaryKNNTreeSearcherJoint->Search(  z_J, indices_J, distances_J );
+
+    /** Variables to compute the measure and its derivative. */
+    AccumulateType Gamma_F = NumericTraits< AccumulateType >::Zero;
+    AccumulateType Gamma_M = NumericTraits< AccumulateType >::Zero;
+    AccumulateType Gamma_J = NumericTraits< AccumulateType >::Zero;
+
+    if ( doDerivative )
+    {
+      D1sparse = ( *this->m_SpatialDerivativesContainer )[ i ]
+        * ( *this->m_JacobianContainer )[ i ];
+      dGamma_M.Fill( NumericTraits< DerivativeValueType >::Zero );
+      dGamma_J.Fill( NumericTraits< DerivativeValueType >::Zero );
+    }
+
+    /** Loop over the neighbours. */
+    for ( unsigned int p = 0; p < k; p++ )
+    {
+      /** Get the distances. */
+      distance_F = vcl_sqrt( distances_F[ p ] );
+      distance_M = vcl_sqrt( distances_M[ p ] );
+      distance_J = vcl_sqrt( distances_J[ p ] );
+
+      /** Compute Gamma's. */
+      Gamma_F += distance_F;
+      Gamma_M += distance_M;
+      Gamma_J += distance_J;
+
+      if ( !doDerivative )
+      {
+        continue;
+      }
+
+      /** Get the neighbour point z_ip^M. */
+      listSampleMoving->GetMeasurementVector( indices_M[ p ], z_M_ip );
+      listSampleMoving->GetMeasurementVector( indices_J[ p ], z_J_ip );
+
+      /** Get the difference of z_ip^M with z_i^M. */
+      diff_M = z_M - z_M_ip;
+      diff_J = z_M - z_J_ip;
+
+      /** Compute derivatives. */
+      D2sparse_M = ( *this->m_SpatialDerivativesContainer )[ indices_M[ p ] ]
+        * ( *this->m_JacobianContainer )[ indices_M[ p ] ];
+      D2sparse_J = ( *this->m_SpatialDerivativesContainer )[ indices_J[ p ] ]
+        * ( *this->m_JacobianContainer )[ indices_J[ p ] ];
+
+      /** Update the dGamma's. */
+      this->UpdateDerivativeOfGammas(
+        D1sparse, D2sparse_M, D2sparse_J,
+        ( *this->m_JacobianIndicesContainer )[ i ],
+        ( *this->m_JacobianIndicesContainer )[ indices_M[ p ] ],
+        ( *this->m_JacobianIndicesContainer )[ indices_J[ p ] ],
+        diff_M, diff_J,
+        distance_M, distance_J,
+        dGamma_M, dGamma_J );
+
+    } // end loop over the k neighbours
+
+    /** Compute contributions. */
+    H = vcl_sqrt( Gamma_F * Gamma_M );
+    if ( H > this->m_AvoidDivisionBy )
+    {
+      /** Compute some sums. */
+      G = Gamma_J / H;
+      sumG += vcl_pow( G, twoGamma );
+
+      /** Compute the contribution to the derivative. */
+      if ( doDerivative )
+      {
+        Gpow = vcl_pow( G, twoGamma - 1.0 );
+        contribution += ( Gpow / H ) * ( dGamma_J - ( 0.5 * Gamma_J / Gamma_M ) * dGamma_M );
+      }
+    }
+
+  } // end looping over the query points
+
+} // end ComputeKNNGraphLengthsForRange()
+
+
+/**
+ * ************************ ThreadedComputeKNNGraphLengths *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedComputeKNNGraphLengths( unsigned int threadID ) const
+{
+  /** Select this thread's part of the query points. */
+  unsigned long begin = 0;
+  unsigned long end = 0;
+  this->GetSampleRangeForThread( threadID,
+    this->m_NumberOfPixelsCounted, begin, end );
+
+  KNNGraphPerThreadStruct & perThread = this->m_KNNGraphPerThreadVariables[ threadID ];
+  this->ComputeKNNGraphLengthsForRange( begin, end,
+    perThread.st_SumG, perThread.st_Contribution );
+
+} // end ThreadedComputeKNNGraphLengths()
+
+
+/**
+ * ************************ ComputeKNNGraphLengthsThreaderCallback *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+ITK_THREAD_RETURN_TYPE
+KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
+::ComputeKNNGraphLengthsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  const unsigned int threadID = static_cast<unsigned int>( infoStruct->ThreadID );
+  const Self * metric = static_cast< const Self * >( infoStruct->UserData );
+
+  metric->ThreadedComputeKNNGraphLengths( threadID );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ComputeKNNGraphLengthsThreaderCallback()
+
+
 /**
  * ************************ PrintSelf *************************
  */
@@ -425,7 +425,10 @@ void NormalizedGradientCorrelationImageToImageMetric<TFixedImage,TMovingImage>
   {
     itkExceptionMacro( << "Transform has not been assigned" );
   }
-  this->m_Transform->SetParameters( parameters );
+  if ( !this->GetTransformParametersAreSet() )
+  {
+    this->m_Transform->SetParameters( parameters );
+  }
 
 } // end SetTransformParameters()
 
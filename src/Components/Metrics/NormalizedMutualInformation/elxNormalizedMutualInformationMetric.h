@@ -64,6 +64,13 @@ using namespace itk;
    *    useful if you use high order B-spline interpolator for the moving image.\n
    *    example: <tt>(MovingLimitRangeRatio 0.001 0.01 0.01)</tt> \n
    *    The default value is 0.01. Can be given for each resolution, or for all resolutions at once.
+   * \parameter MaximumMemoryForThreadedPDFDerivatives: The memory in MB that the per-thread
+   *    copies of the joint histogram derivatives may use, when UseMultiThreadingForMetrics is "true".
+   *    Each thread needs a copy of size NumberOfFixedHistogramBins * NumberOfMovingHistogramBins *
+   *    number of affected transform parameters; the number of threads is reduced to what fits in
+   *    this memory, and with only one thread the derivatives are computed single-threaded.\n
+   *    example: <tt>(MaximumMemoryForThreadedPDFDerivatives 1024)</tt> \n
+   *    The default value is 512. Can be given for each resolution, or for all resolutions at once.
    *
    * \sa ParzenWindowNormalizedMutualInformationImageToImageMetric
    * \ingroup Metrics
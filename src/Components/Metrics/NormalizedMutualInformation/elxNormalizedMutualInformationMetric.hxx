@@ -96,6 +96,12 @@ using namespace itk;
     this->SetFixedKernelBSplineOrder( fixedKernelBSplineOrder );
     this->SetMovingKernelBSplineOrder( movingKernelBSplineOrder );
 
+    /** Set the memory for the per-thread joint histogram derivatives. */
+    unsigned long maximumMemoryForThreadedPDFDerivatives = 512;
+    this->GetConfiguration()->ReadParameter( maximumMemoryForThreadedPDFDerivatives,
+      "MaximumMemoryForThreadedPDFDerivatives", this->GetComponentLabel(), level, 0 );
+    this->SetMaximumMemoryForThreadedPDFDerivatives( maximumMemoryForThreadedPDFDerivatives );
+
     /** Set moving image derivative scales. */
     this->SetUseMovingImageDerivativeScales( false );
     MovingImageDerivativeScalesType movingImageDerivativeScales;
@@ -24,8 +24,6 @@
 /** Needed for the filtering of the B-spline coefficients. */
 #include "itkNeighborhood.h"
 #include "itkImageRegionIterator.h"
-#include "itkNeighborhoodOperatorImageFilter.h"
-#include "itkNeighborhoodIterator.h"
 
 /** Include stuff needed for the construction of the rigidity coefficient image. */
 #include "itkGrayscaleDilateImageFilter.h"
@@ -47,8 +45,10 @@ namespace itk
  * The intended use for this metric is to filter a B-spline coefficient
  * image in order to calculate a rigidity penalty term on a B-spline transform.
  *
- * The RigidityPenaltyTermValueImageFilter at each pixel location is computed by
- * convolution with some separable 1D kernels.
+ * The first and second order derivatives of the B-spline coefficient images
+ * at each control point are computed by correlation with some separable 1D
+ * kernels. All derivatives are computed in a single sweep over the control
+ * point grid, which is distributed over the threads plane by plane.
  *
  * The rigid penalty term penalizes deviations from a rigid
  * transformation at regions specified by the so-called rigidity images.
@@ -146,6 +146,7 @@ public:
   typedef typename BSplineTransformType::ImageType      CoefficientImageType;
   typedef typename CoefficientImageType::Pointer        CoefficientImagePointer;
   typedef typename CoefficientImageType::SpacingType    CoefficientImageSpacingType;
+  typedef typename CoefficientImageType::PixelType      CoefficientPixelType;
   typedef AdvancedCombinationTransform< ScalarType,
     FixedImageDimension >                               CombinationTransformType;
 
@@ -154,10 +155,6 @@ public:
     itkGetStaticConstMacro( FixedImageDimension ) >     NeighborhoodType;
   typedef typename NeighborhoodType::SizeType           NeighborhoodSizeType;
   typedef ImageRegionIterator< CoefficientImageType >   CoefficientImageIteratorType;
-  typedef NeighborhoodOperatorImageFilter<
-    CoefficientImageType, CoefficientImageType >        NOIFType;
-  typedef NeighborhoodIterator<CoefficientImageType>    NeighborhoodIteratorType;
-  typedef typename NeighborhoodIteratorType::RadiusType RadiusType;
 
   /** Typedef's for the construction of the rigidity image. */
   typedef CoefficientImageType                          RigidityImageType;
@@ -312,9 +309,80 @@ private:
   void CreateNDOperator( NeighborhoodType & F, const std::string WhichF,
     const CoefficientImageSpacingType & spacing ) const;
 
-  /** Private function used for the filtering. It performs 1D separable filtering. */
-  CoefficientImagePointer FilterSeparable( const CoefficientImageType *,
-    const std::vector< NeighborhoodType > &Operators ) const;
+  /** Typedefs for multi-threading. */
+  typedef typename Superclass::ThreadInfoType   ThreadInfoType;
+
+  /** The operators that compute the first (A, B, C) and second (D, E, F,
+   * G, H, I) order derivatives of the coefficient images. The operators
+   * C, F, H and I only exist in 3D, so they are numbered last.
+   */
+  enum OperatorIndexType {
+    OperatorA = 0, OperatorB, OperatorD, OperatorE, OperatorG,
+    OperatorC, OperatorF, OperatorH, OperatorI, NumberOfOperators };
+
+  /** The condition values and squared gradient magnitudes of a single
+   * thread, and its work buffers. The part buffer holds the subparts of
+   * the derivative, multiplied by the rigidity coefficient, of a window of
+   * three consecutive planes of the control point grid.
+   */
+  struct RigidityPenaltyPerThreadStruct
+  {
+    MeasureType               st_LinearityConditionValue;
+    MeasureType               st_OrthonormalityConditionValue;
+    MeasureType               st_PropernessConditionValue;
+    MeasureType               st_LinearityConditionGradientMagnitude;
+    MeasureType               st_OrthonormalityConditionGradientMagnitude;
+    MeasureType               st_PropernessConditionGradientMagnitude;
+    std::vector< ScalarType > st_ColumnSums;
+    std::vector< ScalarType > st_Parts;
+  };
+  typedef std::vector< RigidityPenaltyPerThreadStruct > RigidityPenaltyPerThreadVariablesType;
+  mutable RigidityPenaltyPerThreadVariablesType         m_RigidityPenaltyPerThreadVariables;
+
+  /** Compute the condition values, summed over the control point grid, and
+   * if derivative is not null, the derivative, both not yet normalized by the
+   * sum of the rigidity coefficients. Multi-threaded if desired.
+   */
+  void ComputeRigidity( DerivativeType * derivative,
+    RigidityPenaltyPerThreadStruct & sums ) const;
+
+  /** Compute the 1D and ND operator weights for the current grid spacing. */
+  void InitializeOperatorWeights( const CoefficientImageSpacingType & spacing ) const;
+
+  /** Compute the condition values of the planes [begin, end) of the control
+   * point grid, along the last dimension, and, if derivative is not null,
+   * the (unnormalized) derivative at these planes. Only the coefficient
+   * images and the rigidity coefficient image are shared, so this function
+   * may be called by multiple threads concurrently for disjoint ranges.
+   */
+  void ComputeRigidityForPlanes( unsigned long begin, unsigned long end,
+    DerivativeType * derivative, RigidityPenaltyPerThreadStruct & perThread ) const;
+
+  /** Compute the derivatives A..I at all control points of one plane, add
+   * the condition values to perThread if addToValue, and store the
+   * weighted subparts in the part buffer if storeParts.
+   */
+  void ComputeRigidityPlane( unsigned long plane,
+    bool addToValue, bool storeParts,
+    RigidityPenaltyPerThreadStruct & perThread ) const;
+
+  /** Compute the value of the orthonormality condition, given the first
+   * order derivatives mu, and if parts is not null, its subparts.
+   */
+  void EvaluateOrthonormalityCondition( const ScalarType * mu,
+    MeasureType & value, ScalarType * parts ) const;
+
+  /** Compute the value of the properness condition, given the first
+   * order derivatives mu, and if parts is not null, its subparts.
+   */
+  void EvaluatePropernessCondition( const ScalarType * mu,
+    MeasureType & value, ScalarType * parts ) const;
+
+  /** Compute the planes of the control point grid of the current thread. */
+  void ThreadedComputeRigidity( unsigned int threadID ) const;
+
+  /** The static callback function passed to the threader. */
+  static ITK_THREAD_RETURN_TYPE ComputeRigidityThreaderCallback( void * arg );
 
   /** Member variables. */
   BSplineTransformPointer m_BSplineTransform;
@@ -337,6 +405,14 @@ private:
   bool                    m_CalculateOrthonormalityCondition;
   bool                    m_CalculatePropernessCondition;
 
+  /** The data of the current evaluation, which are shared by the threads
+   * in ComputeRigidityThreaderCallback().
+   */
+  mutable ScalarType      m_FilterWeights[ NumberOfOperators ][ 3 ][ 3 ];
+  mutable ScalarType      m_AdjointWeights[ NumberOfOperators ][ 27 ];
+  mutable std::vector< const CoefficientPixelType * > m_CoefficientBuffers;
+  mutable DerivativeType *                  m_RigidityPenaltyDerivative;
+
   /** Rigidity image variables. */
   CoordinateRepresentationType    m_DilationRadiusMultiplier;
   bool                            m_DilateRigidityImages;
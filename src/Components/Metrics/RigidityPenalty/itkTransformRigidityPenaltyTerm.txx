@@ -17,8 +17,6 @@
 
 #include "itkTransformRigidityPenaltyTerm.h"
 
-#include "itkZeroFluxNeumannBoundaryCondition.h"
-
 
 namespace itk
 {
@@ -80,6 +78,9 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   this->m_FixedRigidityImageDilated = 0;
   this->m_MovingRigidityImageDilated = 0;
 
+  /** Initialize the data that is shared by the threads. */
+  this->m_RigidityPenaltyDerivative = 0;
+
   /** We don't use an image sampler for this advanced metric. */
   this->SetUseImageSampler( false );
 
@@ -343,7 +344,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   }
 
   /** Make sure that the transform is up to date. */
-  this->m_Transform->SetParameters( parameters );
+  this->SetTransformParameters( parameters );
 
   /** Create and reset an iterator over m_RigidityCoefficientImage. */
   RigidityImageIteratorType it( this->m_RigidityCoefficientImage,
@@ -457,7 +458,10 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   /** Set the parameters in the transform.
    * In this function, also the coefficient images are created.
    */
-  this->m_BSplineTransform->SetParameters( parameters );
+  if ( !this->GetTransformParametersAreSet() )
+  {
+    this->m_BSplineTransform->SetParameters( parameters );
+  }
 
   /** Sanity check. */
   if ( ImageDimension != 2 && ImageDimension != 3 )
@@ -465,16 +469,6 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
     itkExceptionMacro( << "ERROR: This filter is only implemented for dimension 2 and 3." );
   }
 
-  /** Get a handle to the B-spline coefficient images. */
-  std::vector< CoefficientImagePointer >  inputImages( ImageDimension );
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    inputImages[ i ] = this->m_BSplineTransform->GetCoefficientImage()[ i ];
-  }
-
-  /** Get the B-spline coefficient image spacing. */
-  CoefficientImageSpacingType spacing = inputImages[ 0 ]->GetSpacing();
-
   /** TASK 0:
    * Compute the rigidityCoefficientSum and check on it.
    *
@@ -501,324 +495,18 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   }
 
   /** TASK 1:
-   * Prepare for the calculation of the rigidity penalty term.
+   * Compute the first and second order derivatives of the B-spline
+   * coefficient images, and the conditions, in a single sweep.
    *
    ************************************************************************* */
 
-  /** Create 1D neighbourhood operators. */
-  std::vector< NeighborhoodType > Operators_A( ImageDimension ),
-    Operators_B( ImageDimension ), Operators_C( ImageDimension ),
-    Operators_D( ImageDimension ), Operators_E( ImageDimension ),
-    Operators_F( ImageDimension ), Operators_G( ImageDimension ),
-    Operators_H( ImageDimension ), Operators_I( ImageDimension );
-
-  /** Create B-spline coefficient images that are filtered once. */
-  std::vector< CoefficientImagePointer > ui_FA( ImageDimension ),
-    ui_FB( ImageDimension ), ui_FC( ImageDimension ),
-    ui_FD( ImageDimension ), ui_FE( ImageDimension ),
-    ui_FF( ImageDimension ), ui_FG( ImageDimension ),
-    ui_FH( ImageDimension ), ui_FI( ImageDimension );
-
-  /** For all dimensions ... */
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    /** ... create the filtered images ... */
-    ui_FA[ i ] = CoefficientImageType::New();
-    ui_FB[ i ] = CoefficientImageType::New();
-    ui_FD[ i ] = CoefficientImageType::New();
-    ui_FE[ i ] = CoefficientImageType::New();
-    ui_FG[ i ] = CoefficientImageType::New();
-    if ( ImageDimension == 3 )
-    {
-      ui_FC[ i ] = CoefficientImageType::New();
-      ui_FF[ i ] = CoefficientImageType::New();
-      ui_FH[ i ] = CoefficientImageType::New();
-      ui_FI[ i ] = CoefficientImageType::New();
-    }
-    /** ... and the apropiate operators.
-     * The operators C, D and E from the paper are here created
-     * by Create1DOperator D, E and G, because of the 3D case and history.
-     */
-    this->Create1DOperator( Operators_A[ i ], "FA_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_B[ i ], "FB_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_D[ i ], "FD_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_E[ i ], "FE_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_G[ i ], "FG_xi", i + 1, spacing );
-    if ( ImageDimension == 3 )
-    {
-      this->Create1DOperator( Operators_C[ i ], "FC_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_F[ i ], "FF_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_H[ i ], "FH_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_I[ i ], "FI_xi", i + 1, spacing );
-    }
-  } // end for loop
+  RigidityPenaltyPerThreadStruct sums;
+  this->ComputeRigidity( 0, sums );
+  this->m_LinearityConditionValue = sums.st_LinearityConditionValue;
+  this->m_OrthonormalityConditionValue = sums.st_OrthonormalityConditionValue;
+  this->m_PropernessConditionValue = sums.st_PropernessConditionValue;
 
   /** TASK 2:
-   * Filter the B-spline coefficient images.
-   *
-   ************************************************************************* */
-
-  /** Filter the inputImages. */
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    ui_FA[ i ] = this->FilterSeparable( inputImages[ i ], Operators_A );
-    ui_FB[ i ] = this->FilterSeparable( inputImages[ i ], Operators_B );
-    ui_FD[ i ] = this->FilterSeparable( inputImages[ i ], Operators_D );
-    ui_FE[ i ] = this->FilterSeparable( inputImages[ i ], Operators_E );
-    ui_FG[ i ] = this->FilterSeparable( inputImages[ i ], Operators_G );
-    if ( ImageDimension == 3 )
-    {
-      ui_FC[ i ] = this->FilterSeparable( inputImages[ i ], Operators_C );
-      ui_FF[ i ] = this->FilterSeparable( inputImages[ i ], Operators_F );
-      ui_FH[ i ] = this->FilterSeparable( inputImages[ i ], Operators_H );
-      ui_FI[ i ] = this->FilterSeparable( inputImages[ i ], Operators_I );
-    }
-  }
-
-  /** TASK 3:
-   * Create iterators.
-   *
-   ************************************************************************* */
-
-  /** Create iterators over ui_F?. */
-  std::vector< CoefficientImageIteratorType > itA( ImageDimension ),
-    itB( ImageDimension ), itC( ImageDimension ),
-    itD( ImageDimension ), itE( ImageDimension ),
-    itF( ImageDimension ), itG( ImageDimension ),
-    itH( ImageDimension ), itI( ImageDimension );
-
-  /** Create iterators. */
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    /** Create iterators. */
-    itA[ i ] = CoefficientImageIteratorType( ui_FA[ i ], ui_FA[ i ]->GetLargestPossibleRegion() );
-    itB[ i ] = CoefficientImageIteratorType( ui_FB[ i ], ui_FB[ i ]->GetLargestPossibleRegion() );
-    itD[ i ] = CoefficientImageIteratorType( ui_FD[ i ], ui_FD[ i ]->GetLargestPossibleRegion() );
-    itE[ i ] = CoefficientImageIteratorType( ui_FE[ i ], ui_FE[ i ]->GetLargestPossibleRegion() );
-    itG[ i ] = CoefficientImageIteratorType( ui_FG[ i ], ui_FG[ i ]->GetLargestPossibleRegion() );
-    if ( ImageDimension == 3 )
-    {
-      itC[ i ] = CoefficientImageIteratorType( ui_FC[ i ], ui_FC[ i ]->GetLargestPossibleRegion() );
-      itF[ i ] = CoefficientImageIteratorType( ui_FF[ i ], ui_FF[ i ]->GetLargestPossibleRegion() );
-      itH[ i ] = CoefficientImageIteratorType( ui_FH[ i ], ui_FH[ i ]->GetLargestPossibleRegion() );
-      itI[ i ] = CoefficientImageIteratorType( ui_FI[ i ], ui_FI[ i ]->GetLargestPossibleRegion() );
-    }
-    /** Reset iterators. */
-    itA[ i ].GoToBegin(); itB[ i ].GoToBegin();
-    itD[ i ].GoToBegin(); itE[ i ].GoToBegin(); itG[ i ].GoToBegin();
-    if ( ImageDimension == 3 )
-    {
-      itC[ i ].GoToBegin(); itF[ i ].GoToBegin();
-      itH[ i ].GoToBegin(); itI[ i ].GoToBegin();
-    }
-  }
-
-  /** TASK 4A:
-   * Do the actual calculation of the rigidity penalty term value.
-   * Calculate the orthonormality term.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
-
-  if ( this->m_CalculateOrthonormalityCondition )
-  {
-    ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
-    while ( !itA[ 0 ].IsAtEnd() )
-    {
-      /** Copy values: this way we avoid calling Get() so many times.
-       * It also improves code readability.
-       */
-      mu1_A = itA[ 0 ].Get(); mu2_A = itA[ 1 ].Get();
-      mu1_B = itB[ 0 ].Get(); mu2_B = itB[ 1 ].Get();
-      if ( ImageDimension == 3 )
-      {
-        mu3_A = itA[ 2 ].Get(); mu3_B = itB[ 2 ].Get();
-        mu1_C = itC[ 0 ].Get(); mu2_C = itC[ 1 ].Get(); mu3_C = itC[ 2 ].Get();
-      }
-
-      if ( ImageDimension == 2 )
-      {
-        this->m_OrthonormalityConditionValue +=
-          it_RCI.Get() * (
-          vcl_pow(
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + mu2_A * mu2_A
-          - 1.0
-          , 2.0 )
-          + vcl_pow(
-          + mu1_B * mu1_B
-          + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          - 1.0
-          , 2.0 )
-          + vcl_pow(
-          + ( 1.0 + mu1_A ) * mu1_B
-          + mu2_A * ( 1.0 + mu2_B )
-          , 2.0 )
-          );
-      }
-      else if ( ImageDimension == 3 )
-      {
-        this->m_OrthonormalityConditionValue +=
-          it_RCI.Get() * (
-          vcl_pow(
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + mu2_A * mu2_A
-          + mu3_A * mu3_A
-          - 1.0
-          , 2.0 )
-          + vcl_pow(
-          + ( 1.0 + mu1_A ) * mu1_B
-          + mu2_A * ( 1.0 + mu2_B )
-          + mu3_A * mu3_B
-          , 2.0 )
-          + vcl_pow(
-          + ( 1.0 + mu1_A ) * mu1_C
-          + mu2_A * mu2_C
-          + mu3_A * ( 1.0 + mu3_C )
-          , 2.0 )
-          + vcl_pow(
-          + mu1_B * mu1_B
-          + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + mu3_B * mu3_B
-          - 1.0
-          , 2.0 )
-          + vcl_pow(
-          + mu1_B * mu1_C
-          + ( 1.0 + mu2_B ) * mu2_C
-          + mu3_B * ( 1.0 + mu3_C )
-          , 2.0 )
-          + vcl_pow(
-          + mu1_C * mu1_C
-          + mu2_C * mu2_C
-          + ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - 1.0
-          , 2.0 ) );
-      }
-
-      /** Increase all iterators. */
-      for ( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itA[ i ];++itB[ i ];
-        if ( ImageDimension == 3 ) ++itC[ i ];
-      }
-    } // end while
-  } // end if do orthonormality
-
-  /** TASK 4B:
-   * Do the actual calculation of the rigidity penalty term value.
-   * Calculate the properness term.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    itA[ i ].GoToBegin(); itB[ i ].GoToBegin();
-    if ( ImageDimension == 3 ) itC[ i ].GoToBegin();
-  }
-
-  if ( this->m_CalculatePropernessCondition )
-  {
-    ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
-    while ( !itA[ 0 ].IsAtEnd() )
-    {
-      /** Copy values: this way we avoid calling Get() so many times.
-       * It also improves code readability.
-       */
-      mu1_A = itA[ 0 ].Get(); mu2_A = itA[ 1 ].Get();
-      mu1_B = itB[ 0 ].Get(); mu2_B = itB[ 1 ].Get();
-      if ( ImageDimension == 3 )
-      {
-        mu3_A = itA[ 2 ].Get(); mu3_B = itB[ 2 ].Get();
-        mu1_C = itC[ 0 ].Get(); mu2_C = itC[ 1 ].Get(); mu3_C = itC[ 2 ].Get();
-      }
-
-      if ( ImageDimension == 2 )
-      {
-        this->m_PropernessConditionValue +=
-          it_RCI.Get() * (
-          vcl_pow(
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
-          - mu2_A * mu1_B
-          - 1.0
-          , 2.0 )
-          );
-      }
-      else if ( ImageDimension == 3 )
-      {
-        this->m_PropernessConditionValue +=
-          it_RCI.Get() * (
-          vcl_pow(
-          - mu1_C * ( 1.0 + mu2_B ) * mu3_A
-          + mu1_B * mu2_C * mu3_A
-          + mu1_C * mu2_A * mu3_B
-          - ( 1.0 + mu1_A ) * mu2_C * mu3_B
-          - mu1_B * mu2_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          - 1.0
-          , 2.0 )
-          );
-      }
-
-      /** Increase all iterators. */
-      for ( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itA[ i ];++itB[ i ];
-        if ( ImageDimension == 3 ) ++itC[ i ];
-      }
-
-    } // end while
-  } // end if do properness
-
-  /** TASK 4C:
-   * Do the actual calculation of the rigidity penalty term value.
-   * Calculate the linearity term.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
-
-  if ( this->m_CalculateLinearityCondition )
-  {
-    while ( !itD[ 0 ].IsAtEnd() )
-    {
-      /** Linearity condition part. */
-      for ( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        this->m_LinearityConditionValue +=
-          it_RCI.Get() * (
-          + itD[ i ].Get() * itD[ i ].Get()
-          + itE[ i ].Get() * itE[ i ].Get()
-          + itG[ i ].Get() * itG[ i ].Get()
-          );
-        if ( ImageDimension == 3 )
-        {
-          this->m_LinearityConditionValue +=
-            it_RCI.Get() * (
-            + itF[ i ].Get() * itF[ i ].Get()
-            + itH[ i ].Get() * itH[ i ].Get()
-            + itI[ i ].Get() * itI[ i ].Get()
-            );
-        }
-      } // end loop over i
-
-      /** Increase all iterators. */
-      for ( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itD[ i ];++itE[ i ];++itG[ i ];
-        if ( ImageDimension == 3 )
-        {
-          ++itF[ i ];++itH[ i ];++itI[ i ];
-        }
-      }
-
-    } // end while
-  } // end if do properness
-
-  /** TASK 5:
    * Do the actual calculation of the rigidity penalty term value.
    *
    ************************************************************************* */
@@ -907,7 +595,10 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   /** Set the parameters in the transform.
    * In this function, also the B-spline coefficient images are created.
    */
-  this->m_BSplineTransform->SetParameters( parameters );
+  if ( !this->GetTransformParametersAreSet() )
+  {
+    this->m_BSplineTransform->SetParameters( parameters );
+  }
 
   /** Sanity check. */
   if ( ImageDimension != 2 && ImageDimension != 3 )
@@ -915,16 +606,6 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
     itkExceptionMacro( << "ERROR: This filter is only implemented for dimension 2 and 3." );
   }
 
-  /** Get a handle to the B-spline coefficient images. */
-  std::vector< CoefficientImagePointer >  inputImages( ImageDimension );
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    inputImages[ i ] = this->m_BSplineTransform->GetCoefficientImage()[ i ];
-  }
-
-  /** Get the B-spline coefficient image spacing. */
-  CoefficientImageSpacingType spacing = inputImages[ 0 ]->GetSpacing();
-
   /** TASK 0:
    * Compute the rigidityCoefficientSum and check on it.
    *
@@ -951,1135 +632,1074 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   }
 
   /** TASK 1:
-   * Prepare for the calculation of the rigidity penalty term.
+   * Compute the first and second order derivatives of the B-spline
+   * coefficient images, the conditions and their subparts, and the
+   * filtered subparts that form the derivative, in a single sweep.
    *
    ************************************************************************* */
 
-  /** Create 1D neighbourhood operators. */
-  std::vector< NeighborhoodType > Operators_A( ImageDimension ),
-    Operators_B( ImageDimension ), Operators_C( ImageDimension ),
-    Operators_D( ImageDimension ), Operators_E( ImageDimension ),
-    Operators_F( ImageDimension ), Operators_G( ImageDimension ),
-    Operators_H( ImageDimension ), Operators_I( ImageDimension );
-
-  /** Create B-spline coefficient images that are filtered once. */
-  std::vector< CoefficientImagePointer > ui_FA( ImageDimension ),
-    ui_FB( ImageDimension ), ui_FC( ImageDimension ),
-    ui_FD( ImageDimension ), ui_FE( ImageDimension ),
-    ui_FF( ImageDimension ), ui_FG( ImageDimension ),
-    ui_FH( ImageDimension ), ui_FI( ImageDimension );
-
-  /** For all dimensions ... */
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    /** ... create the filtered images ... */
-    ui_FA[ i ] = CoefficientImageType::New();
-    ui_FB[ i ] = CoefficientImageType::New();
-    ui_FD[ i ] = CoefficientImageType::New();
-    ui_FE[ i ] = CoefficientImageType::New();
-    ui_FG[ i ] = CoefficientImageType::New();
-    if ( ImageDimension == 3 )
-    {
-      ui_FC[ i ] = CoefficientImageType::New();
-      ui_FF[ i ] = CoefficientImageType::New();
-      ui_FH[ i ] = CoefficientImageType::New();
-      ui_FI[ i ] = CoefficientImageType::New();
-    }
-    /** ... and the apropiate operators.
-     * The operators C, D and E from the paper are here created
-     * by Create1DOperator D, E and G, because of the 3D case and history.
-     */
-    this->Create1DOperator( Operators_A[ i ], "FA_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_B[ i ], "FB_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_D[ i ], "FD_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_E[ i ], "FE_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_G[ i ], "FG_xi", i + 1, spacing );
-    if ( ImageDimension == 3 )
-    {
-      this->Create1DOperator( Operators_C[ i ], "FC_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_F[ i ], "FF_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_H[ i ], "FH_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_I[ i ], "FI_xi", i + 1, spacing );
-    }
-  } // end for loop
+  RigidityPenaltyPerThreadStruct sums;
+  this->ComputeRigidity( &derivative, sums );
+  this->m_LinearityConditionValue = sums.st_LinearityConditionValue;
+  this->m_OrthonormalityConditionValue = sums.st_OrthonormalityConditionValue;
+  this->m_PropernessConditionValue = sums.st_PropernessConditionValue;
 
   /** TASK 2:
-   * Filter the B-spline coefficient images.
+   * Do the actual calculation of the rigidity penalty term value.
    *
    ************************************************************************* */
 
-  /** Filter the inputImages. */
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
+  /** Calculate the rigidity penalty term value. */
+  if ( this->m_CalculateLinearityCondition )
   {
-    ui_FA[ i ] = this->FilterSeparable( inputImages[ i ], Operators_A );
-    ui_FB[ i ] = this->FilterSeparable( inputImages[ i ], Operators_B );
-    ui_FD[ i ] = this->FilterSeparable( inputImages[ i ], Operators_D );
-    ui_FE[ i ] = this->FilterSeparable( inputImages[ i ], Operators_E );
-    ui_FG[ i ] = this->FilterSeparable( inputImages[ i ], Operators_G );
-    if ( ImageDimension == 3 )
-    {
-      ui_FC[ i ] = this->FilterSeparable( inputImages[ i ], Operators_C );
-      ui_FF[ i ] = this->FilterSeparable( inputImages[ i ], Operators_F );
-      ui_FH[ i ] = this->FilterSeparable( inputImages[ i ], Operators_H );
-      ui_FI[ i ] = this->FilterSeparable( inputImages[ i ], Operators_I );
-    }
+    this->m_LinearityConditionValue /= rigidityCoefficientSum;
+  }
+  if ( this->m_CalculateOrthonormalityCondition )
+  {
+    this->m_OrthonormalityConditionValue /= rigidityCoefficientSum;
+  }
+  if ( this->m_CalculatePropernessCondition )
+  {
+    this->m_PropernessConditionValue /= rigidityCoefficientSum;
+  }
+
+  if ( this->m_UseLinearityCondition )
+  {
+    this->m_RigidityPenaltyTermValue +=
+      this->m_LinearityConditionWeight * this->m_LinearityConditionValue;
+  }
+  if ( this->m_UseOrthonormalityCondition )
+  {
+    this->m_RigidityPenaltyTermValue +=
+      this->m_OrthonormalityConditionWeight * this->m_OrthonormalityConditionValue;
   }
+  if ( this->m_UsePropernessCondition )
+  {
+    this->m_RigidityPenaltyTermValue +=
+      this->m_PropernessConditionWeight * this->m_PropernessConditionValue;
+  }
+  value = this->m_RigidityPenaltyTermValue;
 
   /** TASK 3:
-   * Create subparts and iterators.
+   * Normalize the derivative and set the gradient magnitudes.
+   * NOTE: unlike the values, for the derivatives weight * derivative is returned.
    *
    ************************************************************************* */
 
-  /** Create iterators over ui_F?. */
-  std::vector< CoefficientImageIteratorType > itA( ImageDimension ),
-    itB( ImageDimension ), itC( ImageDimension ),
-    itD( ImageDimension ), itE( ImageDimension ),
-    itF( ImageDimension ), itG( ImageDimension ),
-    itH( ImageDimension ), itI( ImageDimension );
+  derivative /= rigidityCoefficientSum;
 
-  /** Create iterators. */
+  /** Set the gradient magnitudes of the several terms. */
+  const double rigidityCoefficientSumSqr = rigidityCoefficientSum * rigidityCoefficientSum;
+  this->m_LinearityConditionGradientMagnitude = vcl_sqrt(
+    sums.st_LinearityConditionGradientMagnitude / rigidityCoefficientSumSqr );
+  this->m_OrthonormalityConditionGradientMagnitude = vcl_sqrt(
+    sums.st_OrthonormalityConditionGradientMagnitude / rigidityCoefficientSumSqr );
+  this->m_PropernessConditionGradientMagnitude = vcl_sqrt(
+    sums.st_PropernessConditionGradientMagnitude / rigidityCoefficientSumSqr );
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * *********************** ComputeRigidity ****************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputeRigidity( DerivativeType * derivative,
+  RigidityPenaltyPerThreadStruct & sums ) const
+{
+  /** Get a handle to the B-spline coefficient images and their spacing. */
+  this->m_CoefficientBuffers.resize( ImageDimension );
   for ( unsigned int i = 0; i < ImageDimension; i++ )
   {
-    /** Create iterators. */
-    itA[ i ] = CoefficientImageIteratorType( ui_FA[ i ], ui_FA[ i ]->GetLargestPossibleRegion() );
-    itB[ i ] = CoefficientImageIteratorType( ui_FB[ i ], ui_FB[ i ]->GetLargestPossibleRegion() );
-    itD[ i ] = CoefficientImageIteratorType( ui_FD[ i ], ui_FD[ i ]->GetLargestPossibleRegion() );
-    itE[ i ] = CoefficientImageIteratorType( ui_FE[ i ], ui_FE[ i ]->GetLargestPossibleRegion() );
-    itG[ i ] = CoefficientImageIteratorType( ui_FG[ i ], ui_FG[ i ]->GetLargestPossibleRegion() );
-    if ( ImageDimension == 3 )
-    {
-      itC[ i ] = CoefficientImageIteratorType( ui_FC[ i ], ui_FC[ i ]->GetLargestPossibleRegion() );
-      itF[ i ] = CoefficientImageIteratorType( ui_FF[ i ], ui_FF[ i ]->GetLargestPossibleRegion() );
-      itH[ i ] = CoefficientImageIteratorType( ui_FH[ i ], ui_FH[ i ]->GetLargestPossibleRegion() );
-      itI[ i ] = CoefficientImageIteratorType( ui_FI[ i ], ui_FI[ i ]->GetLargestPossibleRegion() );
-    }
-    /** Reset iterators. */
-    itA[ i ].GoToBegin(); itB[ i ].GoToBegin();
-    itD[ i ].GoToBegin(); itE[ i ].GoToBegin(); itG[ i ].GoToBegin();
-    if ( ImageDimension == 3 )
-    {
-      itC[ i ].GoToBegin(); itF[ i ].GoToBegin();
-      itH[ i ].GoToBegin(); itI[ i ].GoToBegin();
-    }
+    this->m_CoefficientBuffers[ i ]
+      = this->m_BSplineTransform->GetCoefficientImage()[ i ]->GetBufferPointer();
   }
+  this->InitializeOperatorWeights(
+    this->m_BSplineTransform->GetCoefficientImage()[ 0 ]->GetSpacing() );
+  this->m_RigidityPenaltyDerivative = derivative;
 
-  /** Create orthonormality and properness parts. */
-  std::vector < std::vector< CoefficientImagePointer > > OCparts( ImageDimension );
-  std::vector < std::vector< CoefficientImagePointer > > PCparts( ImageDimension );
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
+  /** The control point grid is distributed over the threads
+   * by planes along the last dimension.
+   */
+  const unsigned long numberOfPlanes = this->m_RigidityCoefficientImage
+    ->GetBufferedRegion().GetSize()[ ImageDimension - 1 ];
+
+  /** Initialize the per-thread variables. The work buffers keep their memory. */
+  const unsigned int numberOfThreads
+    = this->UseMultiThreadedGetValueAndDerivative() ? this->GetNumberOfThreads() : 1;
+  this->m_RigidityPenaltyPerThreadVariables.resize( numberOfThreads );
+  for ( unsigned int t = 0; t < numberOfThreads; ++t )
   {
-    OCparts[ i ].resize( ImageDimension );
-    PCparts[ i ].resize( ImageDimension );
-    for ( unsigned int j = 0; j < ImageDimension; j++ )
-    {
-      OCparts[ i ][ j ] = CoefficientImageType::New();
-      OCparts[ i ][ j ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-      OCparts[ i ][ j ]->Allocate();
-      PCparts[ i ][ j ] = CoefficientImageType::New();
-      PCparts[ i ][ j ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-      PCparts[ i ][ j ]->Allocate();
-    }
+    RigidityPenaltyPerThreadStruct & perThread = this->m_RigidityPenaltyPerThreadVariables[ t ];
+    perThread.st_LinearityConditionValue = NumericTraits< MeasureType >::Zero;
+    perThread.st_OrthonormalityConditionValue = NumericTraits< MeasureType >::Zero;
+    perThread.st_PropernessConditionValue = NumericTraits< MeasureType >::Zero;
+    perThread.st_LinearityConditionGradientMagnitude = NumericTraits< MeasureType >::Zero;
+    perThread.st_OrthonormalityConditionGradientMagnitude = NumericTraits< MeasureType >::Zero;
+    perThread.st_PropernessConditionGradientMagnitude = NumericTraits< MeasureType >::Zero;
   }
 
-  /** Create linearity parts. */
-  unsigned int NofLParts = 3 * ImageDimension - 3;
-  std::vector < std::vector< CoefficientImagePointer > > LCparts( ImageDimension );
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
+  if ( numberOfThreads == 1 )
   {
-    LCparts[ i ].resize( NofLParts );
-    for ( unsigned int j = 0; j < NofLParts; j++ )
-    {
-      LCparts[ i ][ j ] = CoefficientImageType::New();
-      LCparts[ i ][ j ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-      LCparts[ i ][ j ]->Allocate();
-    }
+    /** Process all planes in this thread. */
+    this->ComputeRigidityForPlanes( 0, numberOfPlanes, derivative,
+      this->m_RigidityPenaltyPerThreadVariables[ 0 ] );
+  }
+  else
+  {
+    this->LaunchThreaderCallback( Self::ComputeRigidityThreaderCallback );
   }
 
-  /** Create iterators over all parts. */
-  std::vector< std::vector< CoefficientImageIteratorType > > itOCp( ImageDimension );
-  std::vector< std::vector< CoefficientImageIteratorType > > itPCp( ImageDimension );
-  std::vector< std::vector< CoefficientImageIteratorType > > itLCp( ImageDimension );
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
+  /** Add the results of the threads, in thread order, so that the
+   * result does not depend on the thread scheduling.
+   */
+  sums.st_LinearityConditionValue = NumericTraits< MeasureType >::Zero;
+  sums.st_OrthonormalityConditionValue = NumericTraits< MeasureType >::Zero;
+  sums.st_PropernessConditionValue = NumericTraits< MeasureType >::Zero;
+  sums.st_LinearityConditionGradientMagnitude = NumericTraits< MeasureType >::Zero;
+  sums.st_OrthonormalityConditionGradientMagnitude = NumericTraits< MeasureType >::Zero;
+  sums.st_PropernessConditionGradientMagnitude = NumericTraits< MeasureType >::Zero;
+  for ( unsigned int t = 0; t < numberOfThreads; ++t )
   {
-    itOCp[ i ].resize( ImageDimension );
-    itPCp[ i ].resize( ImageDimension );
-    itLCp[ i ].resize( NofLParts );
-    for ( unsigned int j = 0; j < ImageDimension; j++ )
-    {
-      itOCp[ i ][ j ] = CoefficientImageIteratorType( OCparts[ i ][ j ],
-        OCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      itOCp[ i ][ j ].GoToBegin();
-      itPCp[ i ][ j ] = CoefficientImageIteratorType( PCparts[ i ][ j ],
-        PCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      itPCp[ i ][ j ].GoToBegin();
-    }
-    for ( unsigned int j = 0; j < NofLParts; j++ )
-    {
-      itLCp[ i ][ j ] = CoefficientImageIteratorType( LCparts[ i ][ j ],
-        LCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      itLCp[ i ][ j ].GoToBegin();
-    }
+    const RigidityPenaltyPerThreadStruct & perThread = this->m_RigidityPenaltyPerThreadVariables[ t ];
+    sums.st_LinearityConditionValue += perThread.st_LinearityConditionValue;
+    sums.st_OrthonormalityConditionValue += perThread.st_OrthonormalityConditionValue;
+    sums.st_PropernessConditionValue += perThread.st_PropernessConditionValue;
+    sums.st_LinearityConditionGradientMagnitude
+      += perThread.st_LinearityConditionGradientMagnitude;
+    sums.st_OrthonormalityConditionGradientMagnitude
+      += perThread.st_OrthonormalityConditionGradientMagnitude;
+    sums.st_PropernessConditionGradientMagnitude
+      += perThread.st_PropernessConditionGradientMagnitude;
   }
 
-  /** TASK 4A:
-   * Do the calculation of the orthonormality subparts.
-   *
-   ************************************************************************* */
+  /** Release the data of this evaluation. */
+  this->m_RigidityPenaltyDerivative = 0;
 
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
+} // end ComputeRigidity()
 
-  if ( this->m_CalculateOrthonormalityCondition )
-  {
-    ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
-    ScalarType valueOC;
-    while ( !itOCp[ 0 ][ 0 ].IsAtEnd() )
-    {
-      /** Copy values: this way we avoid calling Get() so many times.
-       * It also improves code readability.
-       */
-      mu1_A = itA[ 0 ].Get(); mu2_A = itA[ 1 ].Get();
-      mu1_B = itB[ 0 ].Get(); mu2_B = itB[ 1 ].Get();
-      if ( ImageDimension == 3 )
-      {
-        mu3_A = itA[ 2 ].Get(); mu3_B = itB[ 2 ].Get();
-        mu1_C = itC[ 0 ].Get(); mu2_C = itC[ 1 ].Get(); mu3_C = itC[ 2 ].Get();
-      }
-      if ( ImageDimension == 2 )
-      {
-        /** Calculate the value of the orthonormality condition. */
-        this->m_OrthonormalityConditionValue +=
-          it_RCI.Get() * (
-          vcl_pow(
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + mu2_A * mu2_A
-          - 1.0
-          , 2.0 )
-          + vcl_pow(
-          + mu1_B * mu1_B
-          + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          - 1.0
-          , 2.0 )
-          + vcl_pow(
-          + ( 1.0 + mu1_A ) * mu1_B
-          + mu2_A * ( 1.0 + mu2_B )
-          , 2.0 )
-          );
-        /** Calculate the derivative of the orthonormality condition. */
-        /** mu1, part 1 */
-        valueOC =
-          + 2.0 * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + 2.0 * mu2_A * mu2_A * ( 1.0 + mu1_A )
-          - 2.0 * ( 1.0 + mu1_A )
-          + mu1_B * mu1_B * ( 1.0 + mu1_A )
-          + mu2_A * ( 1.0 + mu2_B ) * mu1_B;
-        itOCp[ 0 ][ 0 ].Set( 2.0 * valueOC );
-        /** mu1, part2*/
-        valueOC =
-          + mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu1_A )
-          + 2.0 * mu1_B * mu1_B * mu1_B
-          + 2.0 * mu1_B * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          - 2.0 * mu1_B;
-        itOCp[ 0 ][ 1 ].Set( 2.0 * valueOC );
-        /** mu2, part 1 */
-        valueOC =
-          + 2.0 * mu2_A * mu2_A * mu2_A
-          + 2.0 * mu2_A * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          - 2.0 * mu2_A
-          + mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B );
-        itOCp[ 1 ][ 0 ].Set( 2.0 * valueOC );
-        /** mu2, part2*/
-        valueOC =
-          + mu2_A * mu2_A * ( 1.0 + mu2_B )
-          + mu1_B * ( 1.0 + mu1_A ) * mu2_A
-          + 2.0 * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + 2.0 * mu1_B * mu1_B * ( 1.0 + mu2_B )
-          - 2.0 * ( 1.0 + mu2_B );
-        itOCp[ 1 ][ 1 ].Set( 2.0 * valueOC );
-      } // end if dim == 2
-      else if ( ImageDimension == 3 )
-      {
-        /** Calculate the value of the orthonormality condition. */
-        this->m_OrthonormalityConditionValue +=
-          it_RCI.Get() * (
-          vcl_pow(
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + mu2_A * mu2_A
-          + mu3_A * mu3_A
-          - 1.0
-          , 2.0 )
-          + vcl_pow(
-          + ( 1.0 + mu1_A ) * mu1_B
-          + mu2_A * ( 1.0 + mu2_B )
-          + mu3_A * mu3_B
-          , 2.0 )
-          + vcl_pow(
-          + ( 1.0 + mu1_A ) * mu1_C
-          + mu2_A * mu2_C
-          + mu3_A * ( 1.0 + mu3_C )
-          , 2.0 )
-          + vcl_pow(
-          + mu1_B * mu1_B
-          + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + mu3_B * mu3_B
-          - 1.0
-          , 2.0 )
-          + vcl_pow(
-          + mu1_B * mu1_C
-          + ( 1.0 + mu2_B ) * mu2_C
-          + mu3_B * ( 1.0 + mu3_C )
-          , 2.0 )
-          + vcl_pow(
-          + mu1_C * mu1_C
-          + mu2_C * mu2_C
-          + ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - 1.0
-          , 2.0 ) );
-        /** Calculate the derivative of the orthonormality condition. */
-        /** mu1, part 1 */
-        valueOC =
-          + 2.0 * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + 2.0 * mu2_A * mu2_A * ( 1.0 + mu1_A )
-          + 2.0 * ( 1.0 + mu1_A ) * mu3_A * mu3_A
-          - 2.0 * ( 1.0 + mu1_A )
-          + mu1_B * mu1_B * ( 1.0 + mu1_A )
-          + mu2_A * ( 1.0 + mu2_B ) * mu1_B
-          + mu1_B * mu3_A * mu3_B
-          + ( 1.0 + mu1_A ) * mu1_C * mu1_C
-          + mu1_C * mu2_A * mu2_C
-          + mu1_C * mu3_A * ( 1.0 + mu3_C );
-        itOCp[ 0 ][ 0 ].Set( 2.0 * valueOC );
-        /** mu1, part2 */
-        valueOC =
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu1_B
-          + ( 1.0 + mu1_A ) * mu2_A * mu3_B
-          + ( 1.0 + mu1_A ) * mu3_A * mu3_B
-          + mu1_B * mu1_B * mu1_B
-          + mu1_B * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + mu1_B * mu3_B * mu3_B
-          - mu1_B
-          + mu1_B * mu1_C * mu1_C
-          + mu1_C * ( 1.0 + mu2_B ) * mu2_C
-          + mu1_C * mu3_B * ( 1.0 + mu3_C );
-        itOCp[ 0 ][ 1 ].Set( 2.0 * valueOC );
-        /** mu1, part3 */
-        valueOC =
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu1_C
-          + ( 1.0 + mu1_A ) * mu2_A * mu2_C
-          + ( 1.0 + mu1_A ) * mu3_A * ( 1.0 + mu3_C )
-          + mu1_B * mu1_B * mu1_C
-          + mu1_B * ( 1.0 + mu2_B ) * mu2_C
-          + mu1_B * mu3_B * ( 1.0 + mu3_C )
-          + 2.0 * mu1_C * mu1_C * mu1_C
-          + 2.0 * mu1_C * mu2_C * mu2_C
-          + 2.0 * mu1_C * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - 2.0 * mu1_C;
-        itOCp[ 0 ][ 2 ].Set( 2.0 * valueOC );
-        /** mu2, part 1 */
-        valueOC =
-          + 2.0 * mu2_A * mu2_A * mu2_A
-          + 2.0 * mu2_A * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          - 2.0 * mu2_A
-          + 2.0 * mu2_A * mu3_A * mu3_A
-          + mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
-          + ( 1.0 + mu2_B ) * mu3_A * mu3_B
-          + mu2_A * mu2_C * mu2_C
-          + ( 1.0 + mu1_A ) * mu1_C * mu2_C
-          + mu2_C * mu3_A * ( 1.0 + mu3_C );
-        itOCp[ 1 ][ 0 ].Set( 2.0 * valueOC );
-        /** mu2, part2 */
-        valueOC =
-          + mu2_A * mu2_A * ( 1.0 + mu2_B )
-          + mu1_B * ( 1.0 + mu1_A ) * mu2_A
-          + mu2_A * mu3_A * mu3_B
-          + 2.0 * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + 2.0 * mu1_B * mu1_B * ( 1.0 + mu2_B )
-          - 2.0 * ( 1.0 + mu2_B )
-          + 2.0 * ( 1.0 + mu2_B ) * mu3_B * mu3_B
-          + ( 1.0 + mu2_B ) * mu2_C * mu2_C
-          + mu1_B * mu1_C * mu2_C
-          + mu2_C * mu3_B * ( 1.0 + mu3_C );
-        itOCp[ 1 ][ 1 ].Set( 2.0 * valueOC );
-        /** mu2, part 3 */
-        valueOC =
-          + mu2_A * mu2_A * mu2_C
-          + ( 1.0 + mu1_A ) * mu1_C * mu2_A
-          + mu2_A * mu3_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu2_C
-          + mu1_B * mu1_C * mu2_B
-          + ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
-          + 2.0 * mu2_C * mu2_C * mu2_C
-          + 2.0 * mu1_C * mu1_C * mu2_C
-          + 2.0 * mu2_C * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - 2.0 * mu2_C;
-        itOCp[ 1 ][ 2 ].Set( 2.0 * valueOC );
-        /** mu3, part 1 */
-        valueOC =
-          + 2.0 * mu3_A * mu3_A * mu3_A
-          + 2.0 * mu3_A * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          - 2.0 * mu3_A
-          + 2.0 * mu2_A * mu2_A * mu3_A
-          + mu3_A * mu3_B * mu3_B
-          + mu1_B * ( 1.0 + mu1_A ) * mu3_B
-          + ( 1.0 + mu2_B ) * mu2_A * mu3_B
-          + mu3_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu3_C )
-          + mu2_C * mu2_A * ( 1.0 + mu3_C );
-        itOCp[ 2 ][ 0 ].Set( 2.0 * valueOC );
-        /** mu3, part2 */
-        valueOC =
-          + mu3_A * mu3_A * mu3_B
-          + mu1_B * ( 1.0 + mu1_A ) * mu3_A
-          + mu2_A * mu3_A * ( 1.0 + mu2_B )
-          + 2.0 *  mu3_B *  mu3_B *  mu3_B
-          + 2.0 * mu1_B * mu1_B *  mu3_B
-          - 2.0 *  mu3_B
-          + 2.0 * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_B
-          + mu3_B * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          + mu1_B * mu1_C * ( 1.0 + mu3_C )
-          + mu2_C * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C );
-        itOCp[ 2 ][ 1 ].Set( 2.0 * valueOC );
-        /** mu3, part 3 */
-        valueOC =
-          + mu3_A * mu3_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu1_C * mu3_A
-          + mu2_A * mu3_A * mu2_C
-          + mu3_B * mu3_B * ( 1.0 + mu3_C )
-          + mu1_B * mu1_C * mu3_B
-          + ( 1.0 + mu2_B ) * mu3_B * mu2_C
-          + 2.0 * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          + 2.0 * mu1_C * mu1_C * ( 1.0 + mu3_C )
-          + 2.0 * mu2_C * mu2_C * ( 1.0 + mu3_C )
-          - 2.0 * ( 1.0 + mu3_C );
-        itOCp[ 2 ][ 2 ].Set( 2.0 * valueOC );
-      } // end if dim == 3
-
-      /** Increase all iterators. */
-      for ( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itA[ i ];++itB[ i ];
-        if ( ImageDimension == 3 ) ++itC[ i ];
-        for ( unsigned int j = 0; j < ImageDimension; j++ )
-        {
-          ++itOCp[ i ][ j ];
-        }
-      }
-    } // end while
-  } // end if do orthonormality
 
-  /** TASK 4B:
-   * Do the calculation of the properness parts.
-   *
-   ************************************************************************* */
+/**
+ * *********************** InitializeOperatorWeights ****************
+ */
 
-  /** Reset all iterators. */
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::InitializeOperatorWeights( const CoefficientImageSpacingType & spacing ) const
+{
+  /** The names of the operators, in the order of OperatorIndexType.
+   * The operators C, D and E from the paper are here created
+   * by D, E and G, because of the 3D case and history.
+   */
+  const char * names[ NumberOfOperators ]
+    = { "A", "B", "D", "E", "G", "C", "F", "H", "I" };
+  const unsigned int numberOfOperators = ImageDimension == 3 ? NumberOfOperators : 5;
+
+  for ( unsigned int op = 0; op < NumberOfOperators; ++op )
   {
-    itA[ i ].GoToBegin(); itB[ i ].GoToBegin();
-    if ( ImageDimension == 3 ) itC[ i ].GoToBegin();
+    for ( unsigned int k = 0; k < 27; ++k )
+    {
+      this->m_AdjointWeights[ op ][ k ] = NumericTraits< ScalarType >::Zero;
+      this->m_FilterWeights[ op ][ k / 9 ][ k % 3 ] = NumericTraits< ScalarType >::Zero;
+    }
   }
-  it_RCI.GoToBegin();
 
-  if ( this->m_CalculatePropernessCondition )
+  /** The weights are stored for a 3D grid (x, y, z), where x is the first
+   * and z is the last dimension. A 2D grid has a single row along y, so
+   * its y-operators are the identity.
+   */
+  for ( unsigned int op = 0; op < numberOfOperators; ++op )
   {
-    ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
-    ScalarType valuePC;
-    while ( !itPCp[ 0 ][ 0 ].IsAtEnd() )
+    /** The separable 1D operators, which compute the derivatives. */
+    for ( unsigned int i = 0; i < ImageDimension; i++ )
     {
-      /** Copy values: this way we avoid calling Get() so many times.
-       * It also improves code readability.
-       */
-      mu1_A = itA[ 0 ].Get(); mu2_A = itA[ 1 ].Get();
-      mu1_B = itB[ 0 ].Get(); mu2_B = itB[ 1 ].Get();
-      if ( ImageDimension == 3 )
+      NeighborhoodType F;
+      this->Create1DOperator( F, std::string( "F" ) + names[ op ] + "_xi", i + 1, spacing );
+      const unsigned int axis = ( i == ImageDimension - 1 ) ? 2 : i;
+      for ( unsigned int k = 0; k < 3; ++k )
       {
-        mu3_A = itA[ 2 ].Get(); mu3_B = itB[ 2 ].Get();
-        mu1_C = itC[ 0 ].Get(); mu2_C = itC[ 1 ].Get(); mu3_C = itC[ 2 ].Get();
+        this->m_FilterWeights[ op ][ axis ][ k ] = F[ k ];
       }
-      if ( ImageDimension == 2 )
-      {
-        /** Calculate the value of the properness condition. */
-        this->m_PropernessConditionValue +=
-          it_RCI.Get() * (
-          vcl_pow(
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
-          - mu2_A * mu1_B
-          - 1.0
-          , 2.0 )
-          );
-        /** Calculate the derivative of the properness condition. */
-        /** mu1, part 1 */
-        valuePC =
-          + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu1_A )
-          - mu2_A * ( 1.0 + mu2_B ) * mu1_B
-          - ( 1.0 + mu2_B );
-        itPCp[ 0 ][ 0 ].Set( 2.0 * valuePC );
-        /** mu1, part 2 */
-        valuePC =
-          + mu2_A
-          + mu2_A * mu2_A * mu1_B
-          - mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu1_A );
-        itPCp[ 0 ][ 1 ].Set( 2.0 * valuePC );
-        /** mu2, part 1 */
-        valuePC =
-          + mu1_B * mu1_B * mu2_A
-          - mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
-          + mu1_B;
-        itPCp[ 1 ][ 0 ].Set( 2.0 * valuePC );
-        /** mu2, part 2 */
-        valuePC =
-          - ( 1.0 + mu1_A )
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
-          - mu1_B * ( 1.0 + mu1_A ) * mu2_A;
-        itPCp[ 1 ][ 1 ].Set( 2.0 * valuePC );
-      } // end if dim == 2
-      else if ( ImageDimension ==3 )
-      {
-        /** Calculate the value of the properness condition. */
-        this->m_PropernessConditionValue +=
-          it_RCI.Get() * (
-          vcl_pow(
-          - mu1_C * ( 1.0 + mu2_B ) * mu3_A
-          + mu1_B * mu2_C * mu3_A
-          + mu1_C * mu2_A * mu3_B
-          - ( 1.0 + mu1_A ) * mu2_C * mu3_B
-          - mu1_B * mu2_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          - 1.0
-          , 2.0 )
-          );
-        /** Calculate the derivative of the properness condition. */
-        /** mu1, part 1 */
-        valuePC =
-          + ( 1.0 + mu1_A ) * mu2_C * mu2_C * mu3_B * mu3_B
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          + mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_B
-          - mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
-          - mu1_B * mu2_C * mu2_C * mu3_A * mu3_B
-          + mu1_B * ( 1.0 + mu2_B ) * mu2_C * mu3_A * ( 1.0 + mu3_C )
-          - mu1_C * mu2_A * mu2_C * mu3_B * mu3_B
-          + mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
-          + mu1_B * mu2_A * mu2_C * mu3_B * ( 1.0 + mu3_C )
-          - 2.0 * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_B * ( 1.0 + mu3_C )
-          + mu2_C * mu3_B
-          - mu1_B * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - ( 1.0 + mu2_B ) * ( 1.0 + mu3_C );
-        itPCp[ 0 ][ 0 ].Set( 2.0 * valuePC );
-        /** mu1, part 2 */
-        valuePC =
-          + mu1_B * mu2_C * mu2_C * mu3_A * mu3_A
-          + mu1_B * mu2_A * mu2_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_A
-          + mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
-          + mu1_C * mu2_A * mu2_C * mu3_A * mu3_B
-          - ( 1.0 + mu1_A ) * mu2_C * mu2_C * mu3_A * mu3_B
-          - 2.0 * mu1_B * mu2_A * mu2_C * mu3_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_A * ( 1.0 + mu3_C )
-          - mu2_C * mu3_A
-          - mu1_C * mu2_A * mu2_A * mu3_B * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu2_A * mu2_C * mu3_B * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          + mu2_A * ( 1.0 + mu3_C );
-        itPCp[ 0 ][ 1 ].Set( 2.0 * valuePC );
-        /** mu1, part 3 */
-        valuePC =
-          + mu1_C * ( 1.0 + mu2_B )* ( 1.0 + mu2_B ) * mu3_A * mu3_A
-          + mu1_C * mu2_A * mu2_A * mu3_B * mu3_B
-          - mu1_B * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_A
-          - 2.0 * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A * mu3_B
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_B
-          + mu1_B * mu2_A * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu2_B ) * mu3_A
-          + mu1_B * mu2_A * mu2_C * mu3_A * mu3_B
-          - ( 1.0 + mu1_A ) * mu2_A * mu2_C * mu3_B * mu3_B
-          - mu1_B * mu2_A * mu2_A * mu3_B * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu2_A * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
-          - mu2_A * mu3_B;
-        itPCp[ 0 ][ 2 ].Set( 2.0 * valuePC );
-        /** mu2, part 1 */
-        valuePC =
-          + mu1_C * mu1_C * mu2_A * mu3_B * mu3_B
-          + mu1_B * mu1_B * mu2_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - mu1_C * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_B
-          + mu1_B * mu1_C * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
-          + mu1_B * mu1_C * mu2_C * mu3_A * mu3_B
-          - mu1_B * mu1_B * mu2_C * mu3_A * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * mu1_C * mu2_C * mu3_B * mu3_B
-          - 2.0 * mu1_B * mu1_C * mu2_A * mu3_B * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
-          - mu1_C * mu3_B
-          + ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu3_B * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          + mu1_B * ( 1.0 + mu3_C );
-        itPCp[ 1 ][ 0 ].Set( 2.0 * valuePC );
-        /** mu2, part 2 */
-        valuePC =
-          + mu1_C * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_A
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - mu1_B * mu1_C * mu2_C * mu3_A * mu3_A
-          - mu1_C * mu1_C * mu2_A * mu3_A * mu3_B
-          + ( 1.0 + mu1_A ) * mu1_C * mu2_C * mu3_A * mu3_B
-          + mu1_B * mu1_C * mu2_A * mu3_A * ( 1.0 + mu3_C )
-          - 2.0 * ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
-          + mu1_C * mu3_A
-          + ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu3_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu1_C * mu2_A * mu3_B * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu2_C * mu3_B * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * mu1_B * mu2_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * ( 1.0 + mu3_C );
-        itPCp[ 1 ][ 1 ].Set( 2.0 * valuePC );
-        /** mu2, part 3 */
-        valuePC =
-          + mu1_B * mu1_B * mu2_C * mu3_A * mu3_A
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu2_C * mu3_B * mu3_B
-          - mu1_B * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_A
-          + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_B
-          + mu1_B * mu1_C * mu2_A * mu3_A * mu3_B
-          - 2.0 * ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu3_A * mu3_B
-          - mu1_B * mu1_B * mu2_A * mu3_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
-          - mu1_B * mu3_A
-          - ( 1.0 + mu1_A ) * mu1_C * mu2_A * mu3_B * mu3_B
-          + ( 1.0 + mu1_A ) * mu1_B * mu2_A * mu3_B * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu3_B;
-        itPCp[ 1 ][ 2 ].Set( 2.0 * valuePC );
-        /** mu3, part 1 */
-        valuePC =
-          + mu1_C * mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A
-          + mu1_B * mu1_B * mu2_C * mu2_C * mu3_A
-          - 2.0 * mu1_B * mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A
-          - mu1_C * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_B
-          + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_B
-          + mu1_B * mu1_C * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          + mu1_C * ( 1.0 + mu2_B )
-          + mu1_B * mu1_C * mu2_A * mu2_C * mu3_B
-          - ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu2_C * mu3_B
-          - mu1_B * mu1_B * mu2_A * mu2_C * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * mu2_C * ( 1.0 + mu3_C )
-          + mu1_B * mu2_C;
-        itPCp[ 2 ][ 0 ].Set( 2.0 * valuePC );
-        /** mu3, part 2 */
-        valuePC =
-          + mu1_C * mu1_C * mu2_A * mu2_A * mu3_B
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu2_C * mu2_C * mu3_B
-          - mu1_C * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A
-          + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A
-          + mu1_B * mu1_C * mu2_A * mu2_C * mu3_A
-          - ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu2_C * mu3_A
-          - 2.0 * ( 1.0 + mu1_A ) * mu1_C * mu2_A * mu2_C * mu3_B
-          - mu1_B * mu1_C * mu2_A * mu2_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu1_C * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          - mu1_C * mu2_A
-          + ( 1.0 + mu1_A ) * mu1_B * mu2_A * mu2_C * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu2_C;
-        itPCp[ 2 ][ 1 ].Set( 2.0 * valuePC );
-        /** mu3, part 3 */
-        valuePC =
-          + mu1_B * mu1_B * mu2_A * mu2_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          + mu1_B * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A
-          - ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A
-          - mu1_B * mu1_B * mu2_A * mu2_C * mu3_A
-          + ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * mu2_C * mu3_A
-          - mu1_B * mu1_C * mu2_A * mu2_A * mu3_B
-          + ( 1.0 + mu1_A ) * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_B
-          + ( 1.0 + mu1_A ) * mu1_B * mu2_A * mu2_C * mu3_B
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_B
-          - 2.0 * ( 1.0 + mu1_A ) * mu1_B * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          + mu1_B * mu2_A
-          - ( 1.0 + mu1_A ) * ( 1.0 + mu2_B );
-        itPCp[ 2 ][ 2 ].Set( 2.0 * valuePC );
-      } // end if dim == 3
-
-      /** Increase all iterators. */
-      for ( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itA[ i ];++itB[ i ];
-        if ( ImageDimension == 3 ) ++itC[ i ];
-        for ( unsigned int j = 0; j < ImageDimension; j++ )
-        {
-          ++itPCp[ i ][ j ];
-        }
-      }
-    } // end while
-  } // end if do properness
-
-  /** TASK 4C:
-   * Do the calculation of the linearity parts.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
-
-  if ( this->m_CalculateLinearityCondition )
-  {
-    while ( !itLCp[ 0 ][ 0 ].IsAtEnd() )
+    }
+    if ( ImageDimension == 2 )
     {
-      /** Linearity condition part. */
-      for ( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        /** Calculate the value of the linearity condition. */
-        this->m_LinearityConditionValue +=
-          it_RCI.Get() * (
-          + itD[ i ].Get() * itD[ i ].Get()
-          + itE[ i ].Get() * itE[ i ].Get()
-          + itG[ i ].Get() * itG[ i ].Get()
-          );
-        if ( ImageDimension == 3 )
-        {
-          this->m_LinearityConditionValue +=
-            it_RCI.Get() * (
-            + itF[ i ].Get() * itF[ i ].Get()
-            + itH[ i ].Get() * itH[ i ].Get()
-            + itI[ i ].Get() * itI[ i ].Get()
-            );
-        }
-      } // end loop over i
+      this->m_FilterWeights[ op ][ 1 ][ 1 ] = NumericTraits< ScalarType >::One;
+    }
 
-      /** Calculate the derivative of the linearity condition. */
-      if ( ImageDimension == 2 )
-      {
-        itLCp[ 0 ][ 0 ].Set( 2.0 * itD[ 0 ].Get() );
-        itLCp[ 0 ][ 1 ].Set( 2.0 * itE[ 0 ].Get() );
-        itLCp[ 0 ][ 2 ].Set( 2.0 * itG[ 0 ].Get() );
-        itLCp[ 1 ][ 0 ].Set( 2.0 * itD[ 1 ].Get() );
-        itLCp[ 1 ][ 1 ].Set( 2.0 * itE[ 1 ].Get() );
-        itLCp[ 1 ][ 2 ].Set( 2.0 * itG[ 1 ].Get() );
-      } // end if dim == 2
-      else if ( ImageDimension ==3 )
+    /** The ND operators, which filter the subparts of the derivative. */
+    NeighborhoodType F;
+    this->CreateNDOperator( F, std::string( "F" ) + names[ op ], spacing );
+    for ( unsigned int k = 0; k < 27; ++k )
+    {
+      if ( ImageDimension == 3 )
       {
-        itLCp[ 0 ][ 0 ].Set( 2.0 * itD[ 0 ].Get() );
-        itLCp[ 0 ][ 1 ].Set( 2.0 * itE[ 0 ].Get() );
-        itLCp[ 0 ][ 2 ].Set( 2.0 * itG[ 0 ].Get() );
-        itLCp[ 0 ][ 3 ].Set( 2.0 * itF[ 0 ].Get() );
-        itLCp[ 0 ][ 4 ].Set( 2.0 * itH[ 0 ].Get() );
-        itLCp[ 0 ][ 5 ].Set( 2.0 * itI[ 0 ].Get() );
-        itLCp[ 1 ][ 0 ].Set( 2.0 * itD[ 1 ].Get() );
-        itLCp[ 1 ][ 1 ].Set( 2.0 * itE[ 1 ].Get() );
-        itLCp[ 1 ][ 2 ].Set( 2.0 * itG[ 1 ].Get() );
-        itLCp[ 1 ][ 3 ].Set( 2.0 * itF[ 1 ].Get() );
-        itLCp[ 1 ][ 4 ].Set( 2.0 * itH[ 1 ].Get() );
-        itLCp[ 1 ][ 5 ].Set( 2.0 * itI[ 1 ].Get() );
-        itLCp[ 2 ][ 0 ].Set( 2.0 * itD[ 2 ].Get() );
-        itLCp[ 2 ][ 1 ].Set( 2.0 * itE[ 2 ].Get() );
-        itLCp[ 2 ][ 2 ].Set( 2.0 * itG[ 2 ].Get() );
-        itLCp[ 2 ][ 3 ].Set( 2.0 * itF[ 2 ].Get() );
-        itLCp[ 2 ][ 4 ].Set( 2.0 * itH[ 2 ].Get() );
-        itLCp[ 2 ][ 5 ].Set( 2.0 * itI[ 2 ].Get() );
-      } // end if dim == 3
-
-      /** Increase all iterators. */
-      for ( unsigned int i = 0; i < ImageDimension; i++ )
+        this->m_AdjointWeights[ op ][ k ] = F[ k ];
+      }
+      else if ( ( k / 3 ) % 3 == 1 )
       {
-        ++itD[ i ];++itE[ i ];++itG[ i ];
-        if ( ImageDimension == 3 )
-        {
-          ++itF[ i ]; ++itH[ i ]; ++itI[ i ];
-        }
-        for ( unsigned int j = 0; j < NofLParts; j++ )
-        {
-          ++itLCp[ i ][ j ];
-        }
+        this->m_AdjointWeights[ op ][ k ] = F[ k % 3 + 3 * ( k / 9 ) ];
       }
+    }
+  }
 
-    } // end while
-  } // end if do linearity
+} // end InitializeOperatorWeights()
 
-  /** TASK 5:
-   * Do the actual calculation of the rigidity penalty term value.
-   *
-   ************************************************************************* */
 
-  /** Calculate the rigidity penalty term value. */
-  if ( this->m_CalculateLinearityCondition )
-  {
-    this->m_LinearityConditionValue /= rigidityCoefficientSum;
-  }
-  if ( this->m_CalculateOrthonormalityCondition )
-  {
-    this->m_OrthonormalityConditionValue /= rigidityCoefficientSum;
-  }
-  if ( this->m_CalculatePropernessCondition )
-  {
-    this->m_PropernessConditionValue /= rigidityCoefficientSum;
-  }
+/**
+ * *********************** ComputeRigidityForPlanes ****************
+ */
 
-  if ( this->m_UseLinearityCondition )
-  {
-    this->m_RigidityPenaltyTermValue +=
-      this->m_LinearityConditionWeight * this->m_LinearityConditionValue;
-  }
-  if ( this->m_UseOrthonormalityCondition )
-  {
-    this->m_RigidityPenaltyTermValue +=
-      this->m_OrthonormalityConditionWeight * this->m_OrthonormalityConditionValue;
-  }
-  if ( this->m_UsePropernessCondition )
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputeRigidityForPlanes( unsigned long begin, unsigned long end,
+  DerivativeType * derivative, RigidityPenaltyPerThreadStruct & perThread ) const
+{
+  if ( begin >= end )
   {
-    this->m_RigidityPenaltyTermValue +=
-      this->m_PropernessConditionWeight * this->m_PropernessConditionValue;
+    return;
   }
-  value = this->m_RigidityPenaltyTermValue;
 
-  /** TASK 6:
-   * Create filtered versions of the subparts.
-   * Create all necessary iterators and operators.
-   ************************************************************************* */
+  /** The size of the control point grid, seen as a 3D grid. */
+  const typename CoefficientImageType::SizeType gridSize
+    = this->m_RigidityCoefficientImage->GetBufferedRegion().GetSize();
+  const unsigned long nx = gridSize[ 0 ];
+  const unsigned long ny = ImageDimension == 3 ? gridSize[ 1 ] : 1;
+  const unsigned long nz = gridSize[ ImageDimension - 1 ];
+  const unsigned long planeSize = nx * ny;
+  const unsigned long numberOfVoxels = planeSize * nz;
+  const unsigned int NofLParts = 3 * ImageDimension - 3;
+  const unsigned int numberOfParts = ImageDimension * ( 2 * ImageDimension + NofLParts );
 
-  /** Create filtered orthonormality, properness and linearity parts. */
-  std::vector< CoefficientImagePointer > OCpartsF( ImageDimension );
-  std::vector< CoefficientImagePointer > PCpartsF( ImageDimension );
-  std::vector< CoefficientImagePointer > LCpartsF( ImageDimension );
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    OCpartsF[ i ] = CoefficientImageType::New();
-    OCpartsF[ i ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-    OCpartsF[ i ]->Allocate();
-    PCpartsF[ i ] = CoefficientImageType::New();
-    PCpartsF[ i ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-    PCpartsF[ i ]->Allocate();
-    LCpartsF[ i ] = CoefficientImageType::New();
-    LCpartsF[ i ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-    LCpartsF[ i ]->Allocate();
-  }
-
-  /** Create neighborhood iterators over the subparts. */
-  std::vector< std::vector< NeighborhoodIteratorType > >  nitOCp( ImageDimension );
-  std::vector< std::vector< NeighborhoodIteratorType > >  nitPCp( ImageDimension );
-  std::vector< std::vector< NeighborhoodIteratorType > >  nitLCp( ImageDimension );
-  RadiusType radius;
-  radius.Fill( 1 );
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
+  /** Allocate the work buffers. */
+  perThread.st_ColumnSums.resize( nx * ImageDimension * NumberOfOperators );
+
+  /** Without derivative, only the condition values are needed. */
+  if ( derivative == 0 )
   {
-    nitOCp[ i ].resize( ImageDimension );
-    nitPCp[ i ].resize( ImageDimension );
-    nitLCp[ i ].resize( NofLParts );
-    for ( unsigned int j = 0; j < ImageDimension; j++ )
-    {
-      nitOCp[ i ][ j ] = NeighborhoodIteratorType( radius,
-        OCparts[ i ][ j ], OCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      nitOCp[ i ][ j ].GoToBegin();
-      nitPCp[ i ][ j ] = NeighborhoodIteratorType( radius,
-        PCparts[ i ][ j ], PCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      nitPCp[ i ][ j ].GoToBegin();
-    }
-    for ( unsigned int j = 0; j < NofLParts; j++ )
+    for ( unsigned long z = begin; z < end; ++z )
     {
-      nitLCp[ i ][ j ] = NeighborhoodIteratorType( radius,
-        LCparts[ i ][ j ], LCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      nitLCp[ i ][ j ].GoToBegin();
+      this->ComputeRigidityPlane( z, true, false, perThread );
     }
+    return;
   }
 
-  /** Create iterators over the filtered parts. */
-  std::vector< CoefficientImageIteratorType > itOCpf( ImageDimension );
-  std::vector< CoefficientImageIteratorType > itPCpf( ImageDimension );
-  std::vector< CoefficientImageIteratorType > itLCpf( ImageDimension );
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
+  /** The filtered subparts at plane z depend on the subparts at the planes
+   * z - 1, z and z + 1, which are kept in a window of three planes.
+   * The planes begin - 1 and end are also computed by the neighbouring
+   * threads, but only their subparts are used here.
+   */
+  perThread.st_Parts.resize( 3 * planeSize * numberOfParts );
+  const ScalarType * parts = &perThread.st_Parts[ 0 ];
+  if ( begin > 0 )
   {
-    itOCpf[ i ] = CoefficientImageIteratorType( OCpartsF[ i ],
-      OCpartsF[ i ]->GetLargestPossibleRegion() );
-    itOCpf[ i ].GoToBegin();
-    itPCpf[ i ] = CoefficientImageIteratorType( PCpartsF[ i ],
-      PCpartsF[ i ]->GetLargestPossibleRegion() );
-    itPCpf[ i ].GoToBegin();
-    itLCpf[ i ] = CoefficientImageIteratorType( LCpartsF[ i ],
-      LCpartsF[ i ]->GetLargestPossibleRegion() );
-    itLCpf[ i ].GoToBegin();
+    this->ComputeRigidityPlane( begin - 1, false, true, perThread );
   }
+  this->ComputeRigidityPlane( begin, true, true, perThread );
 
-  /** Create a neigborhood iterator over the rigidity image. */
-  NeighborhoodIteratorType nit_RCI( radius, this->m_RigidityCoefficientImage,
-    this->m_RigidityCoefficientImage->GetLargestPossibleRegion() );
-  nit_RCI.GoToBegin();
-  unsigned int neighborhoodSize = nit_RCI.Size();
+  /** The operators that filter each subpart. */
+  const unsigned int firstOrderOperators[ 3 ]
+    = { OperatorA, OperatorB, OperatorC };
+  const unsigned int linearityOperators[ 6 ]
+    = { OperatorD, OperatorE, OperatorG, OperatorF, OperatorH, OperatorI };
+  const unsigned int yBegin = ImageDimension == 3 ? 0 : 1;
+  const unsigned int yEnd = ImageDimension == 3 ? 3 : 2;
 
-  /** Create ND operators. */
-  NeighborhoodType Operator_A, Operator_B, Operator_C,
-    Operator_D, Operator_E, Operator_F,
-    Operator_G, Operator_H, Operator_I;
-  this->CreateNDOperator( Operator_A, "FA", spacing );
-  this->CreateNDOperator( Operator_B, "FB", spacing );
-  if ( ImageDimension == 3 )
+  /** Loop over the planes of this thread. */
+  for ( unsigned long z = begin; z < end; ++z )
   {
-    this->CreateNDOperator( Operator_C, "FC", spacing );
-  }
-
-  if ( this->m_CalculateLinearityCondition )
-  {
-    this->CreateNDOperator( Operator_D, "FD", spacing );
-    this->CreateNDOperator( Operator_E, "FE", spacing );
-    this->CreateNDOperator( Operator_G, "FG", spacing );
-    if ( ImageDimension == 3 )
+    if ( z + 1 < nz )
     {
-      this->CreateNDOperator( Operator_F, "FF", spacing );
-      this->CreateNDOperator( Operator_H, "FH", spacing );
-      this->CreateNDOperator( Operator_I, "FI", spacing );
+      this->ComputeRigidityPlane( z + 1, z + 1 < end, true, perThread );
     }
-  }
 
-  /** TASK 7A:
-   * Calculate the filtered versions of the orthonormality subparts.
-   * These are F_A * {subpart_0} + F_B * {subpart_1},
-   * and (for 3D) + F_C * {subpart_2}, for all dimensions.
-   ************************************************************************* */
+    /** The subparts of the planes z - 1, z and z + 1, where the planes
+     * outside the grid are replaced by the boundary plane.
+     */
+    const ScalarType * planeParts[ 3 ];
+    planeParts[ 0 ] = parts + ( ( z > 0 ? z - 1 : z ) % 3 ) * planeSize * numberOfParts;
+    planeParts[ 1 ] = parts + ( z % 3 ) * planeSize * numberOfParts;
+    planeParts[ 2 ] = parts + ( ( z + 1 < nz ? z + 1 : z ) % 3 ) * planeSize * numberOfParts;
 
-  if ( this->m_CalculateOrthonormalityCondition )
-  {
-    while ( !itOCpf[ 0 ].IsAtEnd() )
+    for ( unsigned long y = 0; y < ny; ++y )
     {
-      /** Create and reset tmp with zeros. */
-      std::vector<double> tmp( ImageDimension, 0.0 );
+      unsigned long rowOffsets[ 3 ];
+      rowOffsets[ 0 ] = ( y > 0 ? y - 1 : y ) * nx;
+      rowOffsets[ 1 ] = y * nx;
+      rowOffsets[ 2 ] = ( y + 1 < ny ? y + 1 : y ) * nx;
 
-      /** Loop over all dimensions. */
-      for ( unsigned int i = 0; i < ImageDimension; i++ )
+      for ( unsigned long x = 0; x < nx; ++x )
       {
-        /** Loop over the neighborhood. */
-        for ( unsigned int k = 0; k < neighborhoodSize; ++k )
+        unsigned long columns[ 3 ];
+        columns[ 0 ] = x > 0 ? x - 1 : x;
+        columns[ 1 ] = x;
+        columns[ 2 ] = x + 1 < nx ? x + 1 : x;
+
+        for ( unsigned int i = 0; i < ImageDimension; i++ )
         {
-          /** Calculation of the inner product. */
-          tmp[ i ] += Operator_A.GetElement( k ) *    // FA *
-            nitOCp[ i ][ 0 ].GetPixel( k ) *          // subpart[ i ][ 0 ]
-            nit_RCI.GetPixel( k );                    // c(k)
-          tmp[ i ] += Operator_B.GetElement( k ) *    // FB *
-            nitOCp[ i ][ 1 ].GetPixel( k ) *          // subpart[ i ][ 1 ]
-            nit_RCI.GetPixel( k );                    // c(k)
-          if ( ImageDimension == 3 )
+          /** Calculate the filtered versions of the subparts.
+           * These are F_A * {subpart_0} + F_B * {subpart_1},
+           * and (for 3D) + F_C * {subpart_2} for the orthonormality
+           * and properness conditions, and
+           * sum_{i=1}^{NofLParts} F_{D,E,G,F,H,I} * {subpart_i}
+           * for the linearity condition.
+           */
+          double tmpOC = 0.0;
+          double tmpPC = 0.0;
+          double tmpLC = 0.0;
+          for ( unsigned int c = 0; c < 3; ++c )
+          {
+            for ( unsigned int b = yBegin; b < yEnd; ++b )
+            {
+              for ( unsigned int a = 0; a < 3; ++a )
+              {
+                const unsigned int k = a + 3 * b + 9 * c;
+                const ScalarType * p = planeParts[ c ]
+                  + ( rowOffsets[ b ] + columns[ a ] ) * numberOfParts;
+                if ( this->m_CalculateOrthonormalityCondition )
+                {
+                  const ScalarType * pOC = p + i * ImageDimension;
+                  for ( unsigned int j = 0; j < ImageDimension; ++j )
+                  {
+                    tmpOC += this->m_AdjointWeights[ firstOrderOperators[ j ] ][ k ] * pOC[ j ];
+                  }
+                }
+                if ( this->m_CalculatePropernessCondition )
+                {
+                  const ScalarType * pPC = p + ( ImageDimension + i ) * ImageDimension;
+                  for ( unsigned int j = 0; j < ImageDimension; ++j )
+                  {
+                    tmpPC += this->m_AdjointWeights[ firstOrderOperators[ j ] ][ k ] * pPC[ j ];
+                  }
+                }
+                if ( this->m_CalculateLinearityCondition )
+                {
+                  const ScalarType * pLC = p
+                    + 2 * ImageDimension * ImageDimension + i * NofLParts;
+                  for ( unsigned int j = 0; j < NofLParts; ++j )
+                  {
+                    tmpLC += this->m_AdjointWeights[ linearityOperators[ j ] ][ k ] * pLC[ j ];
+                  }
+                }
+              } // end for a
+            } // end for b
+          } // end for c
+
+          /** Compute the gradient magnitudes and the derivative contribution. */
+          tmpLC *= this->m_LinearityConditionWeight;
+          tmpOC *= this->m_OrthonormalityConditionWeight;
+          tmpPC *= this->m_PropernessConditionWeight;
+          perThread.st_LinearityConditionGradientMagnitude += tmpLC * tmpLC;
+          perThread.st_OrthonormalityConditionGradientMagnitude += tmpOC * tmpOC;
+          perThread.st_PropernessConditionGradientMagnitude += tmpPC * tmpPC;
+
+          double tmpDIs = 0.0;
+          if ( this->m_UseLinearityCondition )
+          {
+            tmpDIs += tmpLC;
+          }
+          if ( this->m_UseOrthonormalityCondition )
           {
-            tmp[ i ] += Operator_C.GetElement( k ) *  // FC *
-              nitOCp[ i ][ 2 ].GetPixel( k ) *        // subpart[ i ][ 2 ]
-              nit_RCI.GetPixel( k );                  // c(k)
+            tmpDIs += tmpOC;
           }
-        } // end loop over neighborhood
+          if ( this->m_UsePropernessCondition )
+          {
+            tmpDIs += tmpPC;
+          }
+          ( *derivative )[ i * numberOfVoxels + z * planeSize + rowOffsets[ 1 ] + x ]
+            = tmpDIs;
 
-        /** Set the result in the filtered part. */
-        itOCpf[ i ].Set( tmp[ i ] );
+        } // end for i
+      } // end for x
+    } // end for y
+  } // end for z
 
-      } // end loop over dimension i
+} // end ComputeRigidityForPlanes()
 
-      /** Increase all iterators. */
-      ++nit_RCI;
-      for ( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itOCpf[ i ];
-        for ( unsigned int j = 0; j < ImageDimension; j++ )
-        {
-          ++nitOCp[ i ][ j ];
-        }
-      }
-    } // end while
-  } // end if do orthonormality
 
-  /** TASK 7B:
-   * Calculate the filtered versions of the properness subparts.
-   * These are F_A * {subpart_0} + F_B * {subpart_1},
-   * and (for 3D) + F_C * {subpart_2}, for all dimensions.
-   ************************************************************************* */
+/**
+ * *********************** ComputeRigidityPlane ****************
+ */
 
-  nit_RCI.GoToBegin();
-  if ( this->m_CalculatePropernessCondition )
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputeRigidityPlane( unsigned long z, bool addToValue, bool storeParts,
+  RigidityPenaltyPerThreadStruct & perThread ) const
+{
+  /** The size of the control point grid, seen as a 3D grid. */
+  const typename CoefficientImageType::SizeType gridSize
+    = this->m_RigidityCoefficientImage->GetBufferedRegion().GetSize();
+  const unsigned long nx = gridSize[ 0 ];
+  const unsigned long ny = ImageDimension == 3 ? gridSize[ 1 ] : 1;
+  const unsigned long nz = gridSize[ ImageDimension - 1 ];
+  const unsigned long planeSize = nx * ny;
+  const unsigned int NofLParts = 3 * ImageDimension - 3;
+  const unsigned int numberOfParts = ImageDimension * ( 2 * ImageDimension + NofLParts );
+  const unsigned int numberOfOperators = ImageDimension == 3 ? NumberOfOperators : 5;
+  const unsigned int yBegin = ImageDimension == 3 ? 0 : 1;
+  const unsigned int yEnd = ImageDimension == 3 ? 3 : 2;
+
+  const unsigned int firstOrderOperators[ 3 ]
+    = { OperatorA, OperatorB, OperatorC };
+  const unsigned int linearityOperators[ 6 ]
+    = { OperatorD, OperatorE, OperatorG, OperatorF, OperatorH, OperatorI };
+
+  /** Get handles to the buffers. */
+  const RigidityPixelType * rigidity
+    = this->m_RigidityCoefficientImage->GetBufferPointer() + z * planeSize;
+  ScalarType * columnSums = &perThread.st_ColumnSums[ 0 ];
+  ScalarType * parts = 0;
+  if ( storeParts )
+  {
+    parts = &perThread.st_Parts[ ( z % 3 ) * planeSize * numberOfParts ];
+  }
+
+  /** The offsets of the planes z - 1, z and z + 1, where the planes outside
+   * the grid are replaced by the boundary plane (zero flux Neumann boundary
+   * condition, like the neighborhood operator filters).
+   */
+  unsigned long planeOffsets[ 3 ];
+  planeOffsets[ 0 ] = ( z > 0 ? z - 1 : z ) * planeSize;
+  planeOffsets[ 1 ] = z * planeSize;
+  planeOffsets[ 2 ] = ( z + 1 < nz ? z + 1 : z ) * planeSize;
+
+  /** The derivatives A..I of all components, and the first order ones as mu. */
+  ScalarType derivatives[ 3 ][ NumberOfOperators ];
+  ScalarType mu[ 9 ];
+  for ( unsigned int k = 0; k < 9; ++k )
+  {
+    mu[ k ] = NumericTraits< ScalarType >::Zero;
+  }
+
+  for ( unsigned long y = 0; y < ny; ++y )
   {
-    while ( !itPCpf[ 0 ].IsAtEnd() )
+    unsigned long offsets[ 3 ][ 3 ];
+    for ( unsigned int c = 0; c < 3; ++c )
     {
-      /** Create and reset tmp with zeros. */
-      std::vector<double> tmp( ImageDimension, 0.0 );
+      offsets[ c ][ 0 ] = planeOffsets[ c ] + ( y > 0 ? y - 1 : y ) * nx;
+      offsets[ c ][ 1 ] = planeOffsets[ c ] + y * nx;
+      offsets[ c ][ 2 ] = planeOffsets[ c ] + ( y + 1 < ny ? y + 1 : y ) * nx;
+    }
 
-      /** Loop over all dimensions. */
+    /** Correlate the coefficients along z and y, for all columns of this row. */
+    for ( unsigned long x = 0; x < nx; ++x )
+    {
       for ( unsigned int i = 0; i < ImageDimension; i++ )
       {
-        /** Loop over the neighborhood. */
-        for ( unsigned int k = 0; k < neighborhoodSize; ++k )
+        const CoefficientPixelType * u = this->m_CoefficientBuffers[ i ] + x;
+        ScalarType * columnSum = columnSums + ( x * ImageDimension + i ) * NumberOfOperators;
+        for ( unsigned int op = 0; op < numberOfOperators; ++op )
         {
-          /** Calculation of the inner product. */
-          tmp[ i ] += Operator_A.GetElement( k ) *    // FA *
-            nitPCp[ i ][ 0 ].GetPixel( k ) *          // subpart[ i ][ 0 ]
-            nit_RCI.GetPixel( k );                    // c(k)
-          tmp[ i ] += Operator_B.GetElement( k ) *    // FB *
-            nitPCp[ i ][ 1 ].GetPixel( k ) *          // subpart[ i ][ 1 ]
-            nit_RCI.GetPixel( k );                    // c(k)
-          if ( ImageDimension == 3 )
+          ScalarType sum = NumericTraits< ScalarType >::Zero;
+          for ( unsigned int c = 0; c < 3; ++c )
           {
-            tmp[ i ] += Operator_C.GetElement( k ) *  // FC *
-              nitPCp[ i ][ 2 ].GetPixel( k ) *        // subpart[ i ][ 2 ]
-              nit_RCI.GetPixel( k );                  // c(k)
+            const ScalarType wz = this->m_FilterWeights[ op ][ 2 ][ c ];
+            for ( unsigned int b = yBegin; b < yEnd; ++b )
+            {
+              sum += wz * this->m_FilterWeights[ op ][ 1 ][ b ] * u[ offsets[ c ][ b ] ];
+            }
           }
-        } // end loop over neighborhood
-
-        /** Set the result in the filtered part. */
-        itPCpf[ i ].Set( tmp[ i ] );
-
-      } // end loop over dimension i
+          columnSum[ op ] = sum;
+        }
+      }
+    }
 
-      /** Increase all iterators. */
-      ++nit_RCI;
+    /** Correlate the column sums along x, and evaluate the conditions. */
+    for ( unsigned long x = 0; x < nx; ++x )
+    {
+      const ScalarType * columnSum[ 3 ];
+      columnSum[ 0 ] = columnSums + ( x > 0 ? x - 1 : x ) * ImageDimension * NumberOfOperators;
+      columnSum[ 1 ] = columnSums + x * ImageDimension * NumberOfOperators;
+      columnSum[ 2 ] = columnSums + ( x + 1 < nx ? x + 1 : x ) * ImageDimension * NumberOfOperators;
       for ( unsigned int i = 0; i < ImageDimension; i++ )
       {
-        ++itPCpf[ i ];
-        for ( unsigned int j = 0; j < ImageDimension; j++ )
+        for ( unsigned int op = 0; op < numberOfOperators; ++op )
+        {
+          const unsigned int m = i * NumberOfOperators + op;
+          derivatives[ i ][ op ]
+            = this->m_FilterWeights[ op ][ 0 ][ 0 ] * columnSum[ 0 ][ m ]
+            + this->m_FilterWeights[ op ][ 0 ][ 1 ] * columnSum[ 1 ][ m ]
+            + this->m_FilterWeights[ op ][ 0 ][ 2 ] * columnSum[ 2 ][ m ];
+        }
+        for ( unsigned int j = 0; j < ImageDimension; ++j )
         {
-          ++nitPCp[ i ][ j ];
+          mu[ 3 * i + j ] = derivatives[ i ][ firstOrderOperators[ j ] ];
         }
       }
-    } // end while
-  } // end if do properness
 
-  /** TASK 7C:
-   * Calculate the filtered versions of the linearity subparts.
-   * These are sum_{i=1}^{NofLParts} F_{D,E,G,F,H,I} * {subpart_i}.
-   ************************************************************************* */
+      /** The rigidity coefficient c(x) weights the conditions, and the subparts. */
+      const unsigned long voxel = y * nx + x;
+      const ScalarType rigidityCoefficient = rigidity[ voxel ];
+      ScalarType * voxelParts = storeParts ? parts + voxel * numberOfParts : 0;
+      MeasureType conditionValue;
 
-  nit_RCI.GoToBegin();
-  if ( this->m_CalculateLinearityCondition )
-  {
-    while ( !itLCpf[ 0 ].IsAtEnd() )
-    {
-      /** Create and reset tmp with zeros. */
-      std::vector<double> tmp( ImageDimension, 0.0 );
+      /** Calculate the orthonormality condition and its subparts. */
+      if ( this->m_CalculateOrthonormalityCondition )
+      {
+        this->EvaluateOrthonormalityCondition( mu, conditionValue, voxelParts );
+        if ( addToValue )
+        {
+          perThread.st_OrthonormalityConditionValue += rigidityCoefficient * conditionValue;
+        }
+      }
 
-      /** Loop over all dimensions. */
-      for ( unsigned int i = 0; i < ImageDimension; i++ )
+      /** Calculate the properness condition and its subparts. */
+      if ( this->m_CalculatePropernessCondition )
+      {
+        this->EvaluatePropernessCondition( mu, conditionValue,
+          storeParts ? voxelParts + ImageDimension * ImageDimension : 0 );
+        if ( addToValue )
+        {
+          perThread.st_PropernessConditionValue += rigidityCoefficient * conditionValue;
+        }
+      }
+
+      /** Calculate the linearity condition and its subparts. */
+      if ( this->m_CalculateLinearityCondition )
       {
-        /** Loop over the neighborhood. */
-        for ( unsigned int k = 0; k < neighborhoodSize; ++k )
+        conditionValue = NumericTraits< MeasureType >::Zero;
+        for ( unsigned int i = 0; i < ImageDimension; i++ )
         {
-          /** Calculation of the inner product. */
-          tmp[ i ] += Operator_D.GetElement( k ) *    // FD *
-            nitLCp[ i ][ 0 ].GetPixel( k ) *          // subpart[ i ][ 0 ]
-            nit_RCI.GetPixel( k );                    // c(k)
-          tmp[ i ] += Operator_E.GetElement( k ) *    // FE *
-            nitLCp[ i ][ 1 ].GetPixel( k ) *          // subpart[ i ][ 1 ]
-            nit_RCI.GetPixel( k );                    // c(k)
-          tmp[ i ] += Operator_G.GetElement( k ) *    // FG *
-            nitLCp[ i ][ 2 ].GetPixel( k ) *          // subpart[ i ][ 1 ]
-            nit_RCI.GetPixel( k );                    // c(k)
-          if ( ImageDimension == 3 )
+          for ( unsigned int j = 0; j < NofLParts; ++j )
           {
-            tmp[ i ] += Operator_F.GetElement( k ) *  // FF *
-              nitLCp[ i ][ 3 ].GetPixel( k ) *        // subpart[ i ][ 1 ]
-              nit_RCI.GetPixel( k );                  // c(k)
-            tmp[ i ] += Operator_H.GetElement( k ) *  // FH *
-              nitLCp[ i ][ 4 ].GetPixel( k ) *        // subpart[ i ][ 1 ]
-              nit_RCI.GetPixel( k );                  // c(k)
-            tmp[ i ] += Operator_I.GetElement( k ) *  // FI *
-              nitLCp[ i ][ 5 ].GetPixel( k ) *        // subpart[ i ][ 1 ]
-              nit_RCI.GetPixel( k );                  // c(k)
+            const ScalarType d2 = derivatives[ i ][ linearityOperators[ j ] ];
+            conditionValue += d2 * d2;
+            if ( storeParts )
+            {
+              voxelParts[ 2 * ImageDimension * ImageDimension + i * NofLParts + j ] = 2.0 * d2;
+            }
           }
-        } // end loop over neighborhood
-
-        /** Set the result in the filtered part. */
-        itLCpf[ i ].Set( tmp[ i ] );
-
-      } // end loop over dimension i
+        }
+        if ( addToValue )
+        {
+          perThread.st_LinearityConditionValue += rigidityCoefficient * conditionValue;
+        }
+      }
 
-      /** Increase all iterators. */
-      ++nit_RCI;
-      for ( unsigned int i = 0; i < ImageDimension; i++ )
+      /** Weight the subparts with c(x). */
+      if ( storeParts )
       {
-        ++itLCpf[ i ];
-        for ( unsigned int j = 0; j < NofLParts; j++ )
+        for ( unsigned int k = 0; k < numberOfParts; ++k )
         {
-          ++nitLCp[ i ][ j ];
+          voxelParts[ k ] *= rigidityCoefficient;
         }
       }
-    } // end while
-  } // end if do linearity
+    } // end for x
+  } // end for y
 
-  /** TASK 8:
-   * Add it all to create the final derivative images.
-   ************************************************************************* */
+} // end ComputeRigidityPlane()
 
-  /** Create derivative images, each holding a component of the vector field. */
-  std::vector< CoefficientImagePointer > derivativeImages( ImageDimension );
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    derivativeImages[ i ] = CoefficientImageType::New();
-    derivativeImages[ i ]->SetRegions( inputImages[ i ]->GetLargestPossibleRegion() );
-    derivativeImages[ i ]->Allocate();
-  }
 
-  /** Create iterators over the derivative images. */
-  std::vector< CoefficientImageIteratorType > itDIs( ImageDimension );
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    itDIs[ i ] = CoefficientImageIteratorType( derivativeImages[ i ],
-      derivativeImages[ i ]->GetLargestPossibleRegion() );
-    itDIs[ i ].GoToBegin();
-    itOCpf[ i ].GoToBegin();
-    itPCpf[ i ].GoToBegin();
-    itLCpf[ i ].GoToBegin();
-  }
+/**
+ * *********************** EvaluateOrthonormalityCondition ****************
+ */
 
-  /** Do the addition. */
-  // NOTE: unlike the values, for the derivatives weight * derivative is returned.
-  MeasureType gradMagLC = NumericTraits<MeasureType>::Zero;
-  MeasureType gradMagOC = NumericTraits<MeasureType>::Zero;
-  MeasureType gradMagPC = NumericTraits<MeasureType>::Zero;
-  double rigidityCoefficientSumSqr = rigidityCoefficientSum * rigidityCoefficientSum;
-  while ( !itDIs[ 0 ].IsAtEnd() )
-  {
-    for ( unsigned int i = 0; i < ImageDimension; i++ )
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::EvaluateOrthonormalityCondition( const ScalarType * mu,
+  MeasureType & value, ScalarType * parts ) const
+{
+  /** Copy values: this improves code readability. */
+  const ScalarType mu1_A = mu[ 0 ]; const ScalarType mu1_B = mu[ 1 ]; const ScalarType mu1_C = mu[ 2 ];
+  const ScalarType mu2_A = mu[ 3 ]; const ScalarType mu2_B = mu[ 4 ]; const ScalarType mu2_C = mu[ 5 ];
+  const ScalarType mu3_A = mu[ 6 ]; const ScalarType mu3_B = mu[ 7 ]; const ScalarType mu3_C = mu[ 8 ];
+  ScalarType valueOC;
+
+  if ( ImageDimension == 2 )
+  {
+    /** Calculate the value of the orthonormality condition. */
+    value = (
+      vcl_pow(
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+      + mu2_A * mu2_A
+      - 1.0
+      , 2.0 )
+      + vcl_pow(
+      + mu1_B * mu1_B
+      + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+      - 1.0
+      , 2.0 )
+      + vcl_pow(
+      + ( 1.0 + mu1_A ) * mu1_B
+      + mu2_A * ( 1.0 + mu2_B )
+      , 2.0 )
+      );
+    if ( parts == 0 )
     {
-      ScalarType tmpDIs = NumericTraits<ScalarType>::Zero;
+      return;
+    }
 
-      /** Compute gradient magnitude of LC. */
-      ScalarType tmpLC = this->m_LinearityConditionWeight * itLCpf[ i ].Get();
-      gradMagLC += tmpLC * tmpLC / rigidityCoefficientSumSqr;
+    /** Calculate the derivative of the orthonormality condition. */
+    /** mu1, part 1 */
+    valueOC =
+      + 2.0 * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+      + 2.0 * mu2_A * mu2_A * ( 1.0 + mu1_A )
+      - 2.0 * ( 1.0 + mu1_A )
+      + mu1_B * mu1_B * ( 1.0 + mu1_A )
+      + mu2_A * ( 1.0 + mu2_B ) * mu1_B;
+    parts[ 0 ] = 2.0 * valueOC;
+    /** mu1, part2*/
+    valueOC =
+      + mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+      + mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu1_A )
+      + 2.0 * mu1_B * mu1_B * mu1_B
+      + 2.0 * mu1_B * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+      - 2.0 * mu1_B;
+    parts[ 1 ] = 2.0 * valueOC;
+    /** mu2, part 1 */
+    valueOC =
+      + 2.0 * mu2_A * mu2_A * mu2_A
+      + 2.0 * mu2_A * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+      - 2.0 * mu2_A
+      + mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+      + mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B );
+    parts[ 2 ] = 2.0 * valueOC;
+    /** mu2, part2*/
+    valueOC =
+      + mu2_A * mu2_A * ( 1.0 + mu2_B )
+      + mu1_B * ( 1.0 + mu1_A ) * mu2_A
+      + 2.0 * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+      + 2.0 * mu1_B * mu1_B * ( 1.0 + mu2_B )
+      - 2.0 * ( 1.0 + mu2_B );
+    parts[ 3 ] = 2.0 * valueOC;
+  } // end if dim == 2
+  else if ( ImageDimension == 3 )
+  {
+    /** Calculate the value of the orthonormality condition. */
+    value = (
+      vcl_pow(
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+      + mu2_A * mu2_A
+      + mu3_A * mu3_A
+      - 1.0
+      , 2.0 )
+      + vcl_pow(
+      + ( 1.0 + mu1_A ) * mu1_B
+      + mu2_A * ( 1.0 + mu2_B )
+      + mu3_A * mu3_B
+      , 2.0 )
+      + vcl_pow(
+      + ( 1.0 + mu1_A ) * mu1_C
+      + mu2_A * mu2_C
+      + mu3_A * ( 1.0 + mu3_C )
+      , 2.0 )
+      + vcl_pow(
+      + mu1_B * mu1_B
+      + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+      + mu3_B * mu3_B
+      - 1.0
+      , 2.0 )
+      + vcl_pow(
+      + mu1_B * mu1_C
+      + ( 1.0 + mu2_B ) * mu2_C
+      + mu3_B * ( 1.0 + mu3_C )
+      , 2.0 )
+      + vcl_pow(
+      + mu1_C * mu1_C
+      + mu2_C * mu2_C
+      + ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      - 1.0
+      , 2.0 ) );
+    if ( parts == 0 )
+    {
+      return;
+    }
 
-      /** Compute gradient magnitude of OC. */
-      ScalarType tmpOC = this->m_OrthonormalityConditionWeight * itOCpf[ i ].Get();
-      gradMagOC += tmpOC * tmpOC / rigidityCoefficientSumSqr;
+    /** Calculate the derivative of the orthonormality condition. */
+    /** mu1, part 1 */
+    valueOC =
+      + 2.0 * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+      + 2.0 * mu2_A * mu2_A * ( 1.0 + mu1_A )
+      + 2.0 * ( 1.0 + mu1_A ) * mu3_A * mu3_A
+      - 2.0 * ( 1.0 + mu1_A )
+      + mu1_B * mu1_B * ( 1.0 + mu1_A )
+      + mu2_A * ( 1.0 + mu2_B ) * mu1_B
+      + mu1_B * mu3_A * mu3_B
+      + ( 1.0 + mu1_A ) * mu1_C * mu1_C
+      + mu1_C * mu2_A * mu2_C
+      + mu1_C * mu3_A * ( 1.0 + mu3_C );
+    parts[ 0 ] = 2.0 * valueOC;
+    /** mu1, part2 */
+    valueOC =
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu1_B
+      + ( 1.0 + mu1_A ) * mu2_A * mu3_B
+      + ( 1.0 + mu1_A ) * mu3_A * mu3_B
+      + mu1_B * mu1_B * mu1_B
+      + mu1_B * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+      + mu1_B * mu3_B * mu3_B
+      - mu1_B
+      + mu1_B * mu1_C * mu1_C
+      + mu1_C * ( 1.0 + mu2_B ) * mu2_C
+      + mu1_C * mu3_B * ( 1.0 + mu3_C );
+    parts[ 1 ] = 2.0 * valueOC;
+    /** mu1, part3 */
+    valueOC =
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu1_C
+      + ( 1.0 + mu1_A ) * mu2_A * mu2_C
+      + ( 1.0 + mu1_A ) * mu3_A * ( 1.0 + mu3_C )
+      + mu1_B * mu1_B * mu1_C
+      + mu1_B * ( 1.0 + mu2_B ) * mu2_C
+      + mu1_B * mu3_B * ( 1.0 + mu3_C )
+      + 2.0 * mu1_C * mu1_C * mu1_C
+      + 2.0 * mu1_C * mu2_C * mu2_C
+      + 2.0 * mu1_C * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      - 2.0 * mu1_C;
+    parts[ 2 ] = 2.0 * valueOC;
+    /** mu2, part 1 */
+    valueOC =
+      + 2.0 * mu2_A * mu2_A * mu2_A
+      + 2.0 * mu2_A * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+      - 2.0 * mu2_A
+      + 2.0 * mu2_A * mu3_A * mu3_A
+      + mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+      + mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
+      + ( 1.0 + mu2_B ) * mu3_A * mu3_B
+      + mu2_A * mu2_C * mu2_C
+      + ( 1.0 + mu1_A ) * mu1_C * mu2_C
+      + mu2_C * mu3_A * ( 1.0 + mu3_C );
+    parts[ 3 ] = 2.0 * valueOC;
+    /** mu2, part2 */
+    valueOC =
+      + mu2_A * mu2_A * ( 1.0 + mu2_B )
+      + mu1_B * ( 1.0 + mu1_A ) * mu2_A
+      + mu2_A * mu3_A * mu3_B
+      + 2.0 * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+      + 2.0 * mu1_B * mu1_B * ( 1.0 + mu2_B )
+      - 2.0 * ( 1.0 + mu2_B )
+      + 2.0 * ( 1.0 + mu2_B ) * mu3_B * mu3_B
+      + ( 1.0 + mu2_B ) * mu2_C * mu2_C
+      + mu1_B * mu1_C * mu2_C
+      + mu2_C * mu3_B * ( 1.0 + mu3_C );
+    parts[ 4 ] = 2.0 * valueOC;
+    /** mu2, part 3 */
+    valueOC =
+      + mu2_A * mu2_A * mu2_C
+      + ( 1.0 + mu1_A ) * mu1_C * mu2_A
+      + mu2_A * mu3_A * ( 1.0 + mu3_C )
+      + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu2_C
+      + mu1_B * mu1_C * mu2_B
+      + ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
+      + 2.0 * mu2_C * mu2_C * mu2_C
+      + 2.0 * mu1_C * mu1_C * mu2_C
+      + 2.0 * mu2_C * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      - 2.0 * mu2_C;
+    parts[ 5 ] = 2.0 * valueOC;
+    /** mu3, part 1 */
+    valueOC =
+      + 2.0 * mu3_A * mu3_A * mu3_A
+      + 2.0 * mu3_A * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+      - 2.0 * mu3_A
+      + 2.0 * mu2_A * mu2_A * mu3_A
+      + mu3_A * mu3_B * mu3_B
+      + mu1_B * ( 1.0 + mu1_A ) * mu3_B
+      + ( 1.0 + mu2_B ) * mu2_A * mu3_B
+      + mu3_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu3_C )
+      + mu2_C * mu2_A * ( 1.0 + mu3_C );
+    parts[ 6 ] = 2.0 * valueOC;
+    /** mu3, part2 */
+    valueOC =
+      + mu3_A * mu3_A * mu3_B
+      + mu1_B * ( 1.0 + mu1_A ) * mu3_A
+      + mu2_A * mu3_A * ( 1.0 + mu2_B )
+      + 2.0 *  mu3_B *  mu3_B *  mu3_B
+      + 2.0 * mu1_B * mu1_B *  mu3_B
+      - 2.0 *  mu3_B
+      + 2.0 * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_B
+      + mu3_B * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      + mu1_B * mu1_C * ( 1.0 + mu3_C )
+      + mu2_C * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C );
+    parts[ 7 ] = 2.0 * valueOC;
+    /** mu3, part 3 */
+    valueOC =
+      + mu3_A * mu3_A * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * mu1_C * mu3_A
+      + mu2_A * mu3_A * mu2_C
+      + mu3_B * mu3_B * ( 1.0 + mu3_C )
+      + mu1_B * mu1_C * mu3_B
+      + ( 1.0 + mu2_B ) * mu3_B * mu2_C
+      + 2.0 * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      + 2.0 * mu1_C * mu1_C * ( 1.0 + mu3_C )
+      + 2.0 * mu2_C * mu2_C * ( 1.0 + mu3_C )
+      - 2.0 * ( 1.0 + mu3_C );
+    parts[ 8 ] = 2.0 * valueOC;
+  } // end if dim == 3
+
+} // end EvaluateOrthonormalityCondition()
 
-      /** Compute gradient magnitude of PC. */
-      ScalarType tmpPC = this->m_PropernessConditionWeight * itPCpf[ i ].Get();
-      gradMagPC += tmpPC * tmpPC / rigidityCoefficientSumSqr;
 
-      /** Compute derivative contribution. */
-      if ( this->m_UseLinearityCondition )
-      {
-        tmpDIs += tmpLC;
-      }
-      if ( this->m_UseOrthonormalityCondition )
-      {
-        tmpDIs += tmpOC;
-      }
-      if ( this->m_UsePropernessCondition )
-      {
-        tmpDIs += tmpPC;
-      }
-      itDIs[ i ].Set( tmpDIs );
+/**
+ * *********************** EvaluatePropernessCondition ****************
+ */
 
-      /** Update iterators. */
-      ++itDIs[ i ]; ++itOCpf[ i ]; ++itPCpf[ i ]; ++itLCpf[ i ];
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::EvaluatePropernessCondition( const ScalarType * mu,
+  MeasureType & value, ScalarType * parts ) const
+{
+  /** Copy values: this improves code readability. */
+  const ScalarType mu1_A = mu[ 0 ]; const ScalarType mu1_B = mu[ 1 ]; const ScalarType mu1_C = mu[ 2 ];
+  const ScalarType mu2_A = mu[ 3 ]; const ScalarType mu2_B = mu[ 4 ]; const ScalarType mu2_C = mu[ 5 ];
+  const ScalarType mu3_A = mu[ 6 ]; const ScalarType mu3_B = mu[ 7 ]; const ScalarType mu3_C = mu[ 8 ];
+  ScalarType valuePC;
+
+  if ( ImageDimension == 2 )
+  {
+    /** Calculate the value of the properness condition. */
+    value = (
+      vcl_pow(
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
+      - mu2_A * mu1_B
+      - 1.0
+      , 2.0 )
+      );
+    if ( parts == 0 )
+    {
+      return;
     }
-  } // end while
 
-  /** Set the gradient magnitudes of the several terms. */
-  this->m_LinearityConditionGradientMagnitude = vcl_sqrt( gradMagLC );
-  this->m_OrthonormalityConditionGradientMagnitude = vcl_sqrt( gradMagOC );
-  this->m_PropernessConditionGradientMagnitude = vcl_sqrt( gradMagPC );
-
-  /** Rearrange to create a derivative. */
-  unsigned int j = 0;
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    itDIs[ i ].GoToBegin();
-    while ( !itDIs[ i ].IsAtEnd() )
+    /** Calculate the derivative of the properness condition. */
+    /** mu1, part 1 */
+    valuePC =
+      + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu1_A )
+      - mu2_A * ( 1.0 + mu2_B ) * mu1_B
+      - ( 1.0 + mu2_B );
+    parts[ 0 ] = 2.0 * valuePC;
+    /** mu1, part 2 */
+    valuePC =
+      + mu2_A
+      + mu2_A * mu2_A * mu1_B
+      - mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu1_A );
+    parts[ 1 ] = 2.0 * valuePC;
+    /** mu2, part 1 */
+    valuePC =
+      + mu1_B * mu1_B * mu2_A
+      - mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
+      + mu1_B;
+    parts[ 2 ] = 2.0 * valuePC;
+    /** mu2, part 2 */
+    valuePC =
+      - ( 1.0 + mu1_A )
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
+      - mu1_B * ( 1.0 + mu1_A ) * mu2_A;
+    parts[ 3 ] = 2.0 * valuePC;
+  } // end if dim == 2
+  else if ( ImageDimension == 3 )
+  {
+    /** Calculate the value of the properness condition. */
+    value = (
+      vcl_pow(
+      - mu1_C * ( 1.0 + mu2_B ) * mu3_A
+      + mu1_B * mu2_C * mu3_A
+      + mu1_C * mu2_A * mu3_B
+      - ( 1.0 + mu1_A ) * mu2_C * mu3_B
+      - mu1_B * mu2_A * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
+      - 1.0
+      , 2.0 )
+      );
+    if ( parts == 0 )
     {
-      derivative[ j ] = itDIs[ i ].Get() / rigidityCoefficientSum;
-      ++itDIs[ i ];
-      j++;
-    } // end while
-  } // end for
+      return;
+    }
 
-} // end GetValueAndDerivative()
+    /** Calculate the derivative of the properness condition. */
+    /** mu1, part 1 */
+    valuePC =
+      + ( 1.0 + mu1_A ) * mu2_C * mu2_C * mu3_B * mu3_B
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      + mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_B
+      - mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
+      - mu1_B * mu2_C * mu2_C * mu3_A * mu3_B
+      + mu1_B * ( 1.0 + mu2_B ) * mu2_C * mu3_A * ( 1.0 + mu3_C )
+      - mu1_C * mu2_A * mu2_C * mu3_B * mu3_B
+      + mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
+      + mu1_B * mu2_A * mu2_C * mu3_B * ( 1.0 + mu3_C )
+      - 2.0 * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_B * ( 1.0 + mu3_C )
+      + mu2_C * mu3_B
+      - mu1_B * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      - ( 1.0 + mu2_B ) * ( 1.0 + mu3_C );
+    parts[ 0 ] = 2.0 * valuePC;
+    /** mu1, part 2 */
+    valuePC =
+      + mu1_B * mu2_C * mu2_C * mu3_A * mu3_A
+      + mu1_B * mu2_A * mu2_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      - mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_A
+      + mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
+      + mu1_C * mu2_A * mu2_C * mu3_A * mu3_B
+      - ( 1.0 + mu1_A ) * mu2_C * mu2_C * mu3_A * mu3_B
+      - 2.0 * mu1_B * mu2_A * mu2_C * mu3_A * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_A * ( 1.0 + mu3_C )
+      - mu2_C * mu3_A
+      - mu1_C * mu2_A * mu2_A * mu3_B * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * mu2_A * mu2_C * mu3_B * ( 1.0 + mu3_C )
+      - ( 1.0 + mu1_A ) * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      + mu2_A * ( 1.0 + mu3_C );
+    parts[ 1 ] = 2.0 * valuePC;
+    /** mu1, part 3 */
+    valuePC =
+      + mu1_C * ( 1.0 + mu2_B )* ( 1.0 + mu2_B ) * mu3_A * mu3_A
+      + mu1_C * mu2_A * mu2_A * mu3_B * mu3_B
+      - mu1_B * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_A
+      - 2.0 * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A * mu3_B
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_B
+      + mu1_B * mu2_A * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
+      - ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
+      + ( 1.0 + mu2_B ) * mu3_A
+      + mu1_B * mu2_A * mu2_C * mu3_A * mu3_B
+      - ( 1.0 + mu1_A ) * mu2_A * mu2_C * mu3_B * mu3_B
+      - mu1_B * mu2_A * mu2_A * mu3_B * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * mu2_A * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
+      - mu2_A * mu3_B;
+    parts[ 2 ] = 2.0 * valuePC;
+    /** mu2, part 1 */
+    valuePC =
+      + mu1_C * mu1_C * mu2_A * mu3_B * mu3_B
+      + mu1_B * mu1_B * mu2_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      - mu1_C * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_B
+      + mu1_B * mu1_C * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
+      + mu1_B * mu1_C * mu2_C * mu3_A * mu3_B
+      - mu1_B * mu1_B * mu2_C * mu3_A * ( 1.0 + mu3_C )
+      - ( 1.0 + mu1_A ) * mu1_C * mu2_C * mu3_B * mu3_B
+      - 2.0 * mu1_B * mu1_C * mu2_A * mu3_B * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
+      - mu1_C * mu3_B
+      + ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu3_B * ( 1.0 + mu3_C )
+      - ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      + mu1_B * ( 1.0 + mu3_C );
+    parts[ 3 ] = 2.0 * valuePC;
+    /** mu2, part 2 */
+    valuePC =
+      + mu1_C * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_A
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      - mu1_B * mu1_C * mu2_C * mu3_A * mu3_A
+      - mu1_C * mu1_C * mu2_A * mu3_A * mu3_B
+      + ( 1.0 + mu1_A ) * mu1_C * mu2_C * mu3_A * mu3_B
+      + mu1_B * mu1_C * mu2_A * mu3_A * ( 1.0 + mu3_C )
+      - 2.0 * ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
+      + mu1_C * mu3_A
+      + ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu3_A * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * mu1_C * mu2_A * mu3_B * ( 1.0 + mu3_C )
+      - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu2_C * mu3_B * ( 1.0 + mu3_C )
+      - ( 1.0 + mu1_A ) * mu1_B * mu2_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      - ( 1.0 + mu1_A ) * ( 1.0 + mu3_C );
+    parts[ 4 ] = 2.0 * valuePC;
+    /** mu2, part 3 */
+    valuePC =
+      + mu1_B * mu1_B * mu2_C * mu3_A * mu3_A
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu2_C * mu3_B * mu3_B
+      - mu1_B * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_A
+      + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_B
+      + mu1_B * mu1_C * mu2_A * mu3_A * mu3_B
+      - 2.0 * ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu3_A * mu3_B
+      - mu1_B * mu1_B * mu2_A * mu3_A * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
+      - mu1_B * mu3_A
+      - ( 1.0 + mu1_A ) * mu1_C * mu2_A * mu3_B * mu3_B
+      + ( 1.0 + mu1_A ) * mu1_B * mu2_A * mu3_B * ( 1.0 + mu3_C )
+      - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * mu3_B;
+    parts[ 5 ] = 2.0 * valuePC;
+    /** mu3, part 1 */
+    valuePC =
+      + mu1_C * mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A
+      + mu1_B * mu1_B * mu2_C * mu2_C * mu3_A
+      - 2.0 * mu1_B * mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A
+      - mu1_C * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_B
+      + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_B
+      + mu1_B * mu1_C * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
+      - ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
+      + mu1_C * ( 1.0 + mu2_B )
+      + mu1_B * mu1_C * mu2_A * mu2_C * mu3_B
+      - ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu2_C * mu3_B
+      - mu1_B * mu1_B * mu2_A * mu2_C * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * mu2_C * ( 1.0 + mu3_C )
+      + mu1_B * mu2_C;
+    parts[ 6 ] = 2.0 * valuePC;
+    /** mu3, part 2 */
+    valuePC =
+      + mu1_C * mu1_C * mu2_A * mu2_A * mu3_B
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu2_C * mu2_C * mu3_B
+      - mu1_C * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A
+      + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A
+      + mu1_B * mu1_C * mu2_A * mu2_C * mu3_A
+      - ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu2_C * mu3_A
+      - 2.0 * ( 1.0 + mu1_A ) * mu1_C * mu2_A * mu2_C * mu3_B
+      - mu1_B * mu1_C * mu2_A * mu2_A * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * mu1_C * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
+      - mu1_C * mu2_A
+      + ( 1.0 + mu1_A ) * mu1_B * mu2_A * mu2_C * ( 1.0 + mu3_C )
+      - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * mu2_C;
+    parts[ 7 ] = 2.0 * valuePC;
+    /** mu3, part 3 */
+    valuePC =
+      + mu1_B * mu1_B * mu2_A * mu2_A * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
+      + mu1_B * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A
+      - ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A
+      - mu1_B * mu1_B * mu2_A * mu2_C * mu3_A
+      + ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * mu2_C * mu3_A
+      - mu1_B * mu1_C * mu2_A * mu2_A * mu3_B
+      + ( 1.0 + mu1_A ) * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_B
+      + ( 1.0 + mu1_A ) * mu1_B * mu2_A * mu2_C * mu3_B
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_B
+      - 2.0 * ( 1.0 + mu1_A ) * mu1_B * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
+      + mu1_B * mu2_A
+      - ( 1.0 + mu1_A ) * ( 1.0 + mu2_B );
+    parts[ 8 ] = 2.0 * valuePC;
+  } // end if dim == 3
+
+} // end EvaluatePropernessCondition()
+
+
+/**
+ * ************************ ThreadedComputeRigidity *************************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ThreadedComputeRigidity( unsigned int threadID ) const
+{
+  /** Select this thread's planes of the control point grid. */
+  const unsigned long numberOfPlanes = this->m_RigidityCoefficientImage
+    ->GetBufferedRegion().GetSize()[ ImageDimension - 1 ];
+  unsigned long begin = 0;
+  unsigned long end = 0;
+  this->GetSampleRangeForThread( threadID, numberOfPlanes, begin, end );
+
+  this->ComputeRigidityForPlanes( begin, end, this->m_RigidityPenaltyDerivative,
+    this->m_RigidityPenaltyPerThreadVariables[ threadID ] );
+
+} // end ThreadedComputeRigidity()
+
+
+/**
+ * ************************ ComputeRigidityThreaderCallback *************************
+ */
+
+template< class TFixedImage, class TScalarType >
+ITK_THREAD_RETURN_TYPE
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputeRigidityThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  const unsigned int threadID = static_cast<unsigned int>( infoStruct->ThreadID );
+  const Self * metric = static_cast< const Self * >( infoStruct->UserData );
+
+  metric->ThreadedComputeRigidity( threadID );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ComputeRigidityThreaderCallback()
 
 
 /**
@@ -2312,41 +1932,6 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
 } // end Create1DOperator()
 
 
-/**
- * ************************** FilterSeparable ********************
- */
-
-template< class TFixedImage, class TScalarType >
-typename TransformRigidityPenaltyTerm< TFixedImage, TScalarType >::CoefficientImagePointer
-TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
-::FilterSeparable(
-  const CoefficientImageType * image,
-  const std::vector< NeighborhoodType > &Operators ) const
-{
-  /** Create filters, supply them with boundary conditions and operators. */
-  std::vector< typename NOIFType::Pointer > filters( ImageDimension );
-  for ( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    filters[ i ] = NOIFType::New();
-    filters[ i ]->SetOperator( Operators[ i ] );
-  }
-
-  /** Set up the mini-pipline. */
-  filters[ 0 ]->SetInput( image );
-  for ( unsigned int i = 1; i < ImageDimension; i++ )
-  {
-    filters[ i ]->SetInput( filters[ i - 1 ]->GetOutput() );
-  }
-
-  /** Execute the mini-pipeline. */
-  filters[ ImageDimension - 1 ]->Update();
-
-  /** Return the filtered image. */
-  return filters[ ImageDimension - 1 ]->GetOutput();
-
-} // end FilterSeparable()
-
-
 /**
  * ************************ CreateNDOperator *********************
  */
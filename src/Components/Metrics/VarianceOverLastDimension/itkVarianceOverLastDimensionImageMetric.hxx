@@ -459,9 +459,10 @@ namespace itk
         }
         else
         {
-          dMTdmu[ d ] = DerivativeType( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+          /** Reuse the storage of the previous samples. */
+          dMTdmu[ d ].SetSize( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
           dMTdmu[ d ].Fill( itk::NumericTraits< DerivativeValueType >::Zero );
-          nzjis[ d ] = NonZeroJacobianIndicesType( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices(), 0 );
+          nzjis[ d ].assign( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices(), 0 );
         } // end if sampleOk
       }
 
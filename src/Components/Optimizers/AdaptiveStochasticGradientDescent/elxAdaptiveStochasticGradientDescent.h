@@ -22,6 +22,8 @@
 #include "elxProgressCommand.h"
 #include "itkAdvancedTransform.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkMultiThreader.h"
+#include "itkBlockSparseCovarianceMatrix.h"
 
 namespace elastix
 {
@@ -158,6 +160,21 @@ namespace elastix
   *   Default/recommended: 100000. This works in general. If the image is smaller, the number
   *   of samples is automatically reduced. In principle, the more the better, but the slower.
   *   The parameter has only influence when AutomaticParameterEstimation is used.
+  * \parameter UseMultiThreadingForParameterEstimation: Whether to use multiple threads
+  *   to compute the Jacobian terms of the automatic parameter estimation. The number of
+  *   threads is set by the -threads command line argument of elastix.\n
+  *   example: <tt>(UseMultiThreadingForParameterEstimation "false")</tt>\n
+  *   Default: "true". The parameter can be specified for each resolution.
+  *   The parameter has only influence when AutomaticParameterEstimation is used.
+  * \parameter AutomaticParameterEstimationCacheFile: A file in which the automatically
+  *   estimated SP_a, SP_alpha, SigmoidMax, SigmoidMin and SigmoidScale are stored for each
+  *   resolution. If the file already contains settings for the current resolution, which
+  *   were estimated with the same number of parameters, MaximumStepLength, SP_A and
+  *   SigmoidScaleFactor, these settings are used, and the estimation is skipped. This is
+  *   useful when the same registration protocol is applied repeatedly to similar images.\n
+  *   example: <tt>(AutomaticParameterEstimationCacheFile "/data/asgd_settings.txt")</tt>\n
+  *   Default: "", i.e. no caching.
+  *   The parameter has only influence when AutomaticParameterEstimation is used.
   *
   * \todo: this class contains a lot of functional code, which actually does not belong here.
   *
@@ -290,6 +307,15 @@ protected:
   typedef ProgressCommand                             ProgressCommandType;
   typedef typename ProgressCommand::Pointer           ProgressCommandPointer;
 
+  /** Typedefs for the covariance matrix of the Jacobian terms. */
+  typedef BlockSparseCovarianceMatrix                 CovarianceMatrixType;
+  typedef CovarianceMatrixType::ValueType             CovarianceValueType;
+  typedef CovarianceMatrixType::MatrixType            DenseCovarianceMatrixType;
+
+  /** Typedefs for multi-threading. */
+  typedef itk::MultiThreader                          ThreaderType;
+  typedef ThreaderType::ThreadInfoStruct              ThreadInfoType;
+
   /** Typedefs for support of sparse Jacobians and AdvancedTransforms. */
   typedef JacobianType                                TransformJacobianType;
   itkStaticConstMacro( FixedImageDimension, unsigned int, FixedImageType::ImageDimension );
@@ -302,6 +328,31 @@ protected:
   typedef typename
     AdvancedTransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
 
+  /** The data shared by the threads that compute the Jacobian terms. */
+  struct JacobianTermsThreadStruct
+  {
+    Self *                              st_Self;
+    const ImageSampleContainerType *    st_SampleContainer;
+    unsigned int                        st_OutputDimension;
+    std::vector<CovarianceMatrixType>   st_Covariances;
+    ProgressCommandType *               st_Progress;
+    std::vector<double>                 st_MaxJJ;
+    std::vector<double>                 st_MaxJCJ;
+  };
+
+  /** A line of the AutomaticParameterEstimationCacheFile. The settings are
+   * only reused when the resolution and the other fields match.
+   */
+  struct CachedSettingsType
+  {
+    unsigned int  m_Level;
+    unsigned long m_NumberOfParameters;
+    double        m_MaximumStepLength;
+    double        m_SigmoidScaleFactor;
+    SettingsType  m_Settings;
+  };
+  typedef std::vector<CachedSettingsType>             CachedSettingsVectorType;
+
   AdaptiveStochasticGradientDescent();
   virtual ~AdaptiveStochasticGradientDescent() {};
 
@@ -360,6 +411,32 @@ protected:
   virtual void ComputeJacobianTerms( double & TrC, double & TrCC,
     double & maxJJ, double & maxJCJ );
 
+  /** Accumulate C = 1/n \sum_j J_j^T J_j over the samples of thread threadID,
+   * in the covariance matrix of that thread. Used by ComputeJacobianTerms.
+   */
+  virtual void AccumulateCovariance( unsigned int threadID,
+    unsigned int numberOfThreads, JacobianTermsThreadStruct & data );
+
+  /** Compute maxJJ and maxJCJ over the samples of thread threadID, using
+   * the merged covariance matrix of thread 0. Used by ComputeJacobianTerms.
+   */
+  virtual void ComputeMaxJacobianTerms( unsigned int threadID,
+    unsigned int numberOfThreads, JacobianTermsThreadStruct & data );
+
+  /** Launch the threads for the Jacobian terms. */
+  virtual void LaunchJacobianTermsThreaderCallback(
+    ThreadFunctionType callback, JacobianTermsThreadStruct & data );
+
+  /** The threader callbacks of the Jacobian terms. */
+  static ITK_THREAD_RETURN_TYPE AccumulateCovarianceThreaderCallback( void * arg );
+  static ITK_THREAD_RETURN_TYPE ComputeMaxJacobianTermsThreaderCallback( void * arg );
+
+  /** Read and write the AutomaticParameterEstimationCacheFile. Reading
+   * returns false if the file could not be opened.
+   */
+  virtual bool ReadSettingsCache( CachedSettingsVectorType & cache ) const;
+  virtual void WriteSettingsCache( const CachedSettingsVectorType & cache ) const;
+
   /** Helper function, which calls GetScaledValueAndDerivative and does
    * some exception handling. Used by SampleGradients.
    */
@@ -385,9 +462,12 @@ private:
   unsigned long m_PreviousErrorAtIteration;
   bool          m_AutomaticParameterEstimationDone;
 
-  /** Private variables for band size estimation of covariance matrix. */
-  unsigned long m_MaxBandCovSize;
-  unsigned long m_NumberOfBandStructureSamples;
+  /** Private variables for multi-threading and caching of the automatic
+   * parameter estimation.
+   */
+  bool                    m_UseMultiThread;
+  ThreaderType::Pointer   m_Threader;
+  std::string             m_ParameterEstimationCacheFile;
 
 }; // end class AdaptiveStochasticGradientDescent
 
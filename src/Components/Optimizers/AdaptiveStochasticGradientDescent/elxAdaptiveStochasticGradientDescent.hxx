@@ -22,10 +22,9 @@
 #include <sstream>
 #include <algorithm>
 #include <utility>
+#include <fstream>
 #include "vnl/vnl_math.h"
 #include "vnl/vnl_fastops.h"
-#include "vnl/vnl_diag_matrix.h"
-#include "vnl/vnl_sparse_matrix.h"
 #include "vnl/vnl_matlab_filewrite.h"
 #include "itkAdvancedImageToImageMetric.h"
 #include "elxTimer.h"
@@ -58,6 +57,9 @@ AdaptiveStochasticGradientDescent<TElastix>
   this->m_RandomGenerator = RandomGeneratorType::New();
   this->m_AdvancedTransform = 0;
 
+  this->m_UseMultiThread = true;
+  this->m_Threader = ThreaderType::New();
+
 } // Constructor
 
 
@@ -126,16 +128,6 @@ void AdaptiveStochasticGradientDescent<TElastix>
     "SigmoidInitialTime", this->GetComponentLabel(), level, 0 );
   this->SetInitialTime( initialTime );
 
-  /** Set the maximum band size of the covariance matrix. */
-  this->m_MaxBandCovSize = 192;
-  this->GetConfiguration()->ReadParameter( this->m_MaxBandCovSize,
-    "MaxBandCovSize", this->GetComponentLabel(), level, 0 );
-
-  /** Set the number of random samples used to estimate the structure of the covariance matrix. */
-  this->m_NumberOfBandStructureSamples = 10;
-  this->GetConfiguration()->ReadParameter( this->m_NumberOfBandStructureSamples,
-    "NumberOfBandStructureSamples", this->GetComponentLabel(), level, 0 );
-
   /** Set/Get whether the adaptive step size mechanism is desired. Default: true
    * NB: the setting is turned of in case of UseRandomSampleRegion=true.
    * Deprecated alias UseCruzAcceleration is also still supported.
@@ -213,6 +205,16 @@ void AdaptiveStochasticGradientDescent<TElastix>
         "SigmoidScaleFactor", this->GetComponentLabel(), level, 0 );
       this->m_SigmoidScaleFactor = sigmoidScaleFactor;
 
+    /** Set whether to use multiple threads to compute the Jacobian terms. */
+    this->m_UseMultiThread = true;
+    this->GetConfiguration()->ReadParameter( this->m_UseMultiThread,
+      "UseMultiThreadingForParameterEstimation", this->GetComponentLabel(), level, 0 );
+
+    /** Set the file in which the estimated settings are cached. Default: none. */
+    this->m_ParameterEstimationCacheFile = "";
+    this->GetConfiguration()->ReadParameter( this->m_ParameterEstimationCacheFile,
+      "AutomaticParameterEstimationCacheFile", this->GetComponentLabel(), 0, 0, false );
+
   } // end if automatic parameter estimation
   else
   {
@@ -480,6 +482,42 @@ AdaptiveStochasticGradientDescent<TElastix>
   /** Get the user input. */
   const double delta = this->GetMaximumStepLength();
 
+  /** Check if the settings of this resolution were cached by an earlier
+   * registration with the same protocol.
+   */
+  const unsigned int level = static_cast<unsigned int>(
+    this->m_Registration->GetAsITKBaseType()->GetCurrentLevel() );
+  const unsigned long numberOfParameters = this->GetScaledCurrentPosition().GetSize();
+  CachedSettingsVectorType cache;
+  unsigned int cacheIndex = 0;
+  if ( !this->m_ParameterEstimationCacheFile.empty() )
+  {
+    this->ReadSettingsCache( cache );
+    for ( cacheIndex = 0; cacheIndex < cache.size(); ++cacheIndex )
+    {
+      if ( cache[ cacheIndex ].m_Level == level ) break;
+    }
+    if ( cacheIndex < cache.size()
+      && cache[ cacheIndex ].m_NumberOfParameters == numberOfParameters
+      && cache[ cacheIndex ].m_MaximumStepLength == delta
+      && cache[ cacheIndex ].m_Settings.A == this->GetParam_A()
+      && cache[ cacheIndex ].m_SigmoidScaleFactor == this->m_SigmoidScaleFactor )
+    {
+      const SettingsType & settings = cache[ cacheIndex ].m_Settings;
+      this->SetParam_a( settings.a );
+      this->SetParam_alpha( settings.alpha );
+      this->SetSigmoidMax( settings.fmax );
+      this->SetSigmoidMin( settings.fmin );
+      this->SetSigmoidScale( settings.omega );
+
+      timer1->StopTimer();
+      elxout << "  Using the settings of resolution " << level
+        << " from the AutomaticParameterEstimationCacheFile \""
+        << this->m_ParameterEstimationCacheFile << "\"." << std::endl;
+      return;
+    }
+  }
+
   /** Compute the Jacobian terms. */
   double TrC = 0.0;
   double TrCC = 0.0;
@@ -575,6 +613,33 @@ AdaptiveStochasticGradientDescent<TElastix>
   this->SetSigmoidMin( fmin );
   this->SetSigmoidScale( omega );
 
+  /** Store the settings in the cache file, replacing an entry of this
+   * resolution that was estimated for a different protocol.
+   */
+  if ( !this->m_ParameterEstimationCacheFile.empty() )
+  {
+    CachedSettingsType cachedSettings;
+    cachedSettings.m_Level = level;
+    cachedSettings.m_NumberOfParameters = numberOfParameters;
+    cachedSettings.m_MaximumStepLength = delta;
+    cachedSettings.m_SigmoidScaleFactor = this->m_SigmoidScaleFactor;
+    cachedSettings.m_Settings.a = a;
+    cachedSettings.m_Settings.A = A;
+    cachedSettings.m_Settings.alpha = alpha;
+    cachedSettings.m_Settings.fmax = fmax;
+    cachedSettings.m_Settings.fmin = fmin;
+    cachedSettings.m_Settings.omega = omega;
+    if ( cacheIndex < cache.size() )
+    {
+      cache[ cacheIndex ] = cachedSettings;
+    }
+    else
+    {
+      cache.push_back( cachedSettings );
+    }
+    this->WriteSettingsCache( cache );
+  }
+
   /** Print the elapsed time. */
   timer1->StopTimer();
   elxout << "Automatic parameter estimation took "
@@ -793,15 +858,6 @@ AdaptiveStochasticGradientDescent<TElastix>
    * Term 4: maxJCJ, see (54)
    */
 
-  typedef double                                      CovarianceValueType;
-  typedef Array2D<CovarianceValueType>                CovarianceMatrixType;
-  typedef vnl_sparse_matrix<CovarianceValueType>      SparseCovarianceMatrixType;
-  typedef typename SparseCovarianceMatrixType::row    SparseRowType;
-  typedef typename SparseCovarianceMatrixType::pair_t SparseCovarianceElementType;
-  typedef Array<unsigned int>           NonZeroJacobianIndicesExpandedType;
-  typedef vnl_diag_matrix<CovarianceValueType>        DiagCovarianceMatrixType;
-  typedef vnl_vector<CovarianceValueType>             JacobianColumnType;
-
   /** Initialize. */
   TrC = TrCC = maxJJ = maxJCJ = 0.0;
 
@@ -811,7 +867,6 @@ AdaptiveStochasticGradientDescent<TElastix>
   ImageSampleContainerPointer sampleContainer = 0;
   this->SampleFixedImageForJacobianTerms( sampleContainer );
   const unsigned int nrofsamples = sampleContainer->Size();
-  const double n = static_cast<double>( nrofsamples );
 
   /** Get the number of parameters. */
   const unsigned int P = static_cast<unsigned int>(
@@ -823,33 +878,12 @@ AdaptiveStochasticGradientDescent<TElastix>
   transform->SetParameters( this->GetCurrentPosition() );
   const unsigned int outdim = transform->GetOutputSpaceDimension();
 
-  /** Get scales vector */
-  const ScalesType & scales = this->m_ScaledCostFunction->GetScales();
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end = sampleContainer->End();
-  unsigned int samplenr = 0;
-
   /** Variables for nonzerojacobian indices and the Jacobian. */
   const unsigned int sizejacind
     = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
   JacobianType jacj( outdim, sizejacind );
   jacj.Fill( 0.0 );
   NonZeroJacobianIndicesType jacind( sizejacind );
-  jacind[ 0 ] = 0;
-  if ( sizejacind > 1 ) jacind[ 1 ] = 0;
-  NonZeroJacobianIndicesType prevjacind = jacind;
-
-  /** Initialize covariance matrix. Sparse, diagonal, and band form. */
-  SparseCovarianceMatrixType cov( P, P );
-  DiagCovarianceMatrixType diagcov( P, 0.0 );
-  CovarianceMatrixType bandcov;
-
-  /** For temporary storage of J'J. */
-  CovarianceMatrixType jactjac( sizejacind, sizejacind );
-  jactjac.Fill( 0.0 );
 
   /** Prepare for progress printing. */
   ProgressCommandPointer progressObserver = ProgressCommandType::New();
@@ -857,106 +891,43 @@ AdaptiveStochasticGradientDescent<TElastix>
   progressObserver->SetStartString( "  Progress: " );
   elxout << "  Computing JacobianTerms ..." << std::endl;
 
-  /** Variables for the band cov matrix. */
-  const unsigned int maxbandcovsize = m_MaxBandCovSize;
-  const unsigned int nrOfBandStructureSamples = m_NumberOfBandStructureSamples;
-
-  /** DifHist is a histogram of absolute parameterNrDifferences that
-   * occur in the nonzerojacobianindex vectors.
-   * DifHist2 is another way of storing the histogram, as a vector
-   * of pairs. pair.first = Frequency, pair.second = parameterNrDifference.
-   * This is useful for sorting.
-   */
-  typedef std::vector<unsigned int>             DifHistType;
-  typedef std::pair<unsigned int, unsigned int> FreqPairType;
-  typedef std::vector<FreqPairType>             DifHist2Type;
-  DifHistType difHist( P, 0 );
-  DifHist2Type difHist2;
-
-  /** Try to guess the band structure of the covariance matrix.
-   * A 'band' is a series of elements cov(p,q) with constant q-p.
-   * In the loop below, on a few positions in the image the Jacobian
-   * is computed. The nonzerojacobianindices are inspected to figure out
-   * which values of q-p occur often. This is done by making a histogram.
-   * The histogram is then sorted and the most occurring bands
-   * are determined. The covariance elements in these bands will not
-   * be stored in the sparse matrix structure 'cov', but in the band
-   * matrix 'bandcov', which is much faster.
-   * Only after the bandcov and cov have been filled (by looping over
-   * all Jacobian measurements in the sample container, the bandcov
-   * matrix is injected in the cov matrix, for easy further calculations,
-   * and the bandcov matrix is deleted.
+  /** Determine the block structure of the covariance matrix C from the
+   * nonzero Jacobian indices of the first valid sample. For B-spline
+   * transforms a block contains the outdim parameters of a control point,
+   * and the elements of C are stored per pair of interacting control points.
    */
-  unsigned int onezero = 0;
-  for ( unsigned int s = 0; s < nrOfBandStructureSamples; ++s )
+  unsigned int blockSize = 1;
+  for ( unsigned int samplenr = 0; samplenr < nrofsamples; ++samplenr )
   {
-    /** Semi-randomly get some samples from the sample container. */
-    const unsigned int samplenr = ( s + 1 ) * nrofsamples
-      / ( nrOfBandStructureSamples + 2 + onezero );
-    onezero = 1 - onezero; // introduces semi-randomness
-
-    /** Read fixed coordinates and get Jacobian J_j. */
     const FixedImagePointType & point
-      = sampleContainer->GetElement(samplenr).m_ImageCoordinates;
+      = sampleContainer->GetElement( samplenr ).m_ImageCoordinates;
     this->m_AdvancedTransform->GetJacobian( point, jacj, jacind );
-
-    /** Skip invalid Jacobians in the beginning, if any. */
-    if ( sizejacind > 1 )
+    if ( sizejacind < 2 || jacind[ 0 ] != jacind[ 1 ] )
     {
-      if ( jacind[ 0 ] == jacind[ 1 ] )
-      {
-        continue;
-      }
-    }
-
-    /** Fill the histogram of parameter nr differences. */
-    for ( unsigned int i = 0; i < sizejacind; ++i )
-    {
-      const int jacindi = static_cast<int>( jacind[ i ] );
-      for ( unsigned int j = i; j < sizejacind; ++j )
-      {
-        const int jacindj = static_cast<int>( jacind[ j ] );
-        difHist[ static_cast<unsigned int>( vcl_abs( jacindj - jacindi ) ) ]++;
-      }
+      blockSize = CovarianceMatrixType::DetectBlockSize( jacind, P, outdim );
+      break;
     }
   }
 
-  /** Copy the nonzero elements of the difHist to a vector pairs. */
-  for ( unsigned int p = 0; p < P; ++p )
-  {
-    const unsigned int freq = difHist[ p ];
-    if ( freq != 0 )
-    {
-      difHist2.push_back( FreqPairType( freq, p ) );
-    }
-  }
-  difHist.resize( 0 );
-
-  /** Compute the number of bands. */
-  elxout << "  Estimated band size covariance matrix: " << difHist2.size() << std::endl;
-  const unsigned int bandcovsize = vnl_math_min( maxbandcovsize,
-    static_cast<unsigned int>(difHist2.size()) );
-  elxout << "  Used band size covariance matrix: " << bandcovsize << std::endl;
-  /** Maps parameterNrDifference (q-p) to colnr in bandcov. */
-  std::vector<unsigned int> bandcovMap( P, bandcovsize );
-  /** Maps colnr in bandcov to parameterNrDifference (q-p). */
-  std::vector<unsigned int> bandcovMap2( bandcovsize, P );
-
-  /** Sort the difHist2 based on the frequencies. */
-  std::sort( difHist2.begin(), difHist2.end() );
-
-  /** Determine the bands that are expected to be most dominant. */
-  DifHist2Type::iterator difHist2It = difHist2.end();
-  for ( unsigned int b = 0; b < bandcovsize; ++b )
+  /** The data shared by the threads. Without multi-threading,
+   * the thread functions are called once with threadID 0.
+   */
+  const bool useMultiThread = this->m_UseMultiThread
+    && this->m_Threader->GetNumberOfThreads() > 1;
+  const unsigned int numberOfThreads = useMultiThread
+    ? static_cast<unsigned int>( this->m_Threader->GetNumberOfThreads() ) : 1;
+  JacobianTermsThreadStruct threadData;
+  threadData.st_Self = this;
+  threadData.st_SampleContainer = sampleContainer.GetPointer();
+  threadData.st_OutputDimension = outdim;
+  threadData.st_Covariances.resize( numberOfThreads );
+  for ( unsigned int t = 0; t < numberOfThreads; ++t )
   {
-    --difHist2It;
-    bandcovMap[ difHist2It->second ] = b;
-    bandcovMap2[ b ] = difHist2It->second;
+    threadData.st_Covariances[ t ].Initialize( P, blockSize );
   }
-
-  /** Initialize band matrix. */
-  bandcov = CovarianceMatrixType( P, bandcovsize );
-  bandcov.Fill( 0.0 );
+  threadData.st_Progress = progressObserver.GetPointer();
+  threadData.st_MaxJJ.assign( numberOfThreads, 0.0 );
+  threadData.st_MaxJCJ.assign( numberOfThreads, 0.0 );
 
   /**
    *    TERM 1
@@ -965,19 +936,127 @@ AdaptiveStochasticGradientDescent<TElastix>
    * Compute C = 1/n \sum_i J_i^T J_i
    * Possibly apply scaling afterwards.
    */
-  jacind[ 0 ] = 0;
-  if ( sizejacind > 1 ) jacind[ 1 ] = 0;
-  for ( iter = begin; iter != end; ++iter )
+  if ( useMultiThread )
+  {
+    this->LaunchJacobianTermsThreaderCallback(
+      Self::AccumulateCovarianceThreaderCallback, threadData );
+  }
+  else
+  {
+    this->AccumulateCovariance( 0, 1, threadData );
+  }
+
+  /** Add the matrices of the other threads to that of thread 0,
+   * in a fixed order.
+   */
+  CovarianceMatrixType & cov = threadData.st_Covariances[ 0 ];
+  for ( unsigned int t = 1; t < numberOfThreads; ++t )
+  {
+    cov.Merge( threadData.st_Covariances[ t ] );
+    threadData.st_Covariances[ t ].Initialize( 0, 1 );
+  }
+  elxout << "  Number of " << blockSize << "x" << blockSize
+    << " blocks in the covariance matrix: " << cov.GetNumberOfBlocks() << std::endl;
+
+  /** Apply scales. */
+  if ( this->GetUseScales() )
+  {
+    cov.Scale( this->m_ScaledCostFunction->GetScales() );
+  }
+
+  /** Compute TrC = trace(C). */
+  TrC = cov.GetTrace();
+
+  /**
+   *    TERM 2
+   *
+   * Compute TrCC = ||C||_F^2.
+   */
+  TrCC = cov.GetSquaredFrobeniusNorm();
+
+  /**
+   *    TERM 3 and 4
+   *
+   * Compute maxJJ and maxJCJ
+   * \li maxJJ = max_j [ ||J_j||_F^2 + 2\sqrt{2} || J_j J_j^T ||_F ]
+   * \li maxJCJ = max_j [ Tr( J_j C J_j^T ) + 2\sqrt{2} || J_j C J_j^T ||_F ]
+   */
+  if ( useMultiThread )
+  {
+    this->LaunchJacobianTermsThreaderCallback(
+      Self::ComputeMaxJacobianTermsThreaderCallback, threadData );
+  }
+  else
+  {
+    this->ComputeMaxJacobianTerms( 0, 1, threadData );
+  }
+
+  /** Max over the threads. */
+  maxJJ = 0.0;
+  maxJCJ = 0.0;
+  for ( unsigned int t = 0; t < numberOfThreads; ++t )
+  {
+    maxJJ = vnl_math_max( maxJJ, threadData.st_MaxJJ[ t ] );
+    maxJCJ = vnl_math_max( maxJCJ, threadData.st_MaxJCJ[ t ] );
+  }
+
+  /** Finalize progress information. */
+  progressObserver->PrintProgress( 1.0 );
+
+} // end ComputeJacobianTerms()
+
+
+/**
+ * ******************** AccumulateCovariance **********************
+ */
+
+template <class TElastix>
+void
+AdaptiveStochasticGradientDescent<TElastix>
+::AccumulateCovariance( unsigned int threadID,
+  unsigned int numberOfThreads, JacobianTermsThreadStruct & data )
+{
+  /** The samples are divided in contiguous ranges over the threads.
+   * Each thread adds to its own covariance matrix.
+   */
+  const ImageSampleContainerType & samples = *data.st_SampleContainer;
+  CovarianceMatrixType & cov = data.st_Covariances[ threadID ];
+  const unsigned int outdim = data.st_OutputDimension;
+  const unsigned int nrofsamples = samples.Size();
+  const double n = static_cast<double>( nrofsamples );
+  const unsigned int sampleBegin = static_cast<unsigned int>(
+    ( static_cast<unsigned long>( threadID ) * nrofsamples ) / numberOfThreads );
+  const unsigned int sampleEnd = static_cast<unsigned int>(
+    ( static_cast<unsigned long>( threadID + 1 ) * nrofsamples ) / numberOfThreads );
+
+  /** Variables for nonzerojacobian indices and the Jacobian. */
+  const unsigned int sizejacind
+    = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  JacobianType jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  NonZeroJacobianIndicesType jacind( sizejacind );
+  NonZeroJacobianIndicesType prevjacind( sizejacind );
+  bool havePrevious = false;
+
+  /** For temporary storage of the sum of J_j^T J_j over consecutive
+   * samples with the same nonzero Jacobian indices.
+   */
+  DenseCovarianceMatrixType jactjac( sizejacind, sizejacind );
+  jactjac.fill( 0.0 );
+
+  for ( unsigned int samplenr = sampleBegin; samplenr < sampleEnd; ++samplenr )
   {
     /** Print progress 0-50%. */
-    progressObserver->UpdateAndPrintProgress( samplenr );
-    ++samplenr;
+    if ( threadID == 0 )
+    {
+      data.st_Progress->UpdateAndPrintProgress( samplenr * numberOfThreads );
+    }
 
     /** Read fixed coordinates and get Jacobian J_j. */
-    const FixedImagePointType & point = (*iter).Value().m_ImageCoordinates;
-    this->m_AdvancedTransform->GetJacobian( point, jacj, jacind  );
+    const FixedImagePointType & point = samples.ElementAt( samplenr ).m_ImageCoordinates;
+    this->m_AdvancedTransform->GetJacobian( point, jacj, jacind );
 
-    /** Skip invalid Jacobians in the beginning, if any. */
+    /** Skip invalid Jacobians, if any. */
     if ( sizejacind > 1 )
     {
       if ( jacind[ 0 ] == jacind[ 1 ] )
@@ -986,169 +1065,83 @@ AdaptiveStochasticGradientDescent<TElastix>
       }
     }
 
-    if ( jacind == prevjacind )
+    if ( havePrevious && jacind == prevjacind )
     {
-      /** Update sum of J_j^T J_j. */
+      /** Update the sum of J_j^T J_j. */
       vnl_fastops::inc_X_by_AtA( jactjac, jacj );
     }
     else
     {
-      /** The following should only be done after the first sample. */
-      if ( iter != begin )
+      /** A new set of nonzero Jacobian indices: store the sum of
+       * J_j^T J_j of the previous set in C.
+       */
+      if ( havePrevious )
       {
-        /** Update covariance matrix. */
-        for ( unsigned int pi = 0; pi < sizejacind; ++pi )
-        {
-          const unsigned int p = prevjacind[ pi ];
-
-          for ( unsigned int qi = 0; qi < sizejacind; ++qi )
-          {
-            const unsigned int q = prevjacind[ qi ];
-            /** Exploit symmetry: only fill upper triangular part. */
-            if ( q >= p )
-            {
-              const double tempval = jactjac( pi, qi ) / n;
-              if ( vcl_abs( tempval ) > 1e-14 )
-              {
-                const unsigned int bandindex = bandcovMap[ q - p ];
-                if ( bandindex < bandcovsize )
-                {
-                  bandcov( p, bandindex ) +=tempval;
-                }
-                else
-                {
-                  cov( p, q ) += tempval;
-                }
-              }
-            }
-          } // qi
-        } // pi
-      } // end if
+        cov.Add( prevjacind, jactjac, 1.0 / n );
+      }
 
       /** Initialize jactjac by J_j^T J_j. */
       vnl_fastops::AtA( jactjac, jacj );
 
       /** Remember nonzerojacobian indices. */
       prevjacind = jacind;
-    } // end else
+      havePrevious = true;
+    }
 
-  } // end iter loop: end computation of covariance matrix
+  } // end loop over the samples
 
-  /** Update covariance matrix once again to include last jactjac updates
-   * \todo: a bit ugly that this loop is copied from above.
-   */
-  for ( unsigned int pi = 0; pi < sizejacind; ++pi )
-  {
-    const unsigned int p = prevjacind[ pi ];
-    for ( unsigned int qi = 0; qi < sizejacind; ++qi )
-    {
-      const unsigned int q = prevjacind[ qi ];
-      if ( q >= p )
-      {
-        const double tempval = jactjac( pi, qi ) / n;
-        if ( vcl_abs( tempval ) > 1e-14 )
-        {
-           const unsigned int bandindex  = bandcovMap[ q - p ];
-           if ( bandindex < bandcovsize )
-           {
-             bandcov( p, bandindex ) +=tempval;
-           }
-           else
-           {
-             cov( p, q ) += tempval;
-           }
-        }
-      }
-    } // qi
-  } // pi
-
-  /** Copy the bandmatrix into the sparse matrix and empty the bandcov matrix.
-   * \todo: perhaps work further with this bandmatrix instead.
-   */
-  for( unsigned int p = 0; p < P; ++p )
+  /** Store the last set. */
+  if ( havePrevious )
   {
-    for ( unsigned int b = 0; b < bandcovsize; ++b )
-    {
-      const double tempval = bandcov( p, b );
-      if ( vcl_abs( tempval ) > 1e-14 )
-      {
-        const unsigned int q = p + bandcovMap2[ b ];
-        cov( p, q ) = tempval;
-      }
-    }
+    cov.Add( prevjacind, jactjac, 1.0 / n );
   }
-  bandcov.set_size( 0, 0 );
 
-  /** Apply scales. */
-  if ( this->GetUseScales() )
-  {
-    for ( unsigned int p = 0; p < P; ++p )
-    {
-      cov.scale_row( p, 1.0 / scales[ p ] );
-    }
-    /**  \todo: this might be faster with get_row instead of the iterator */
-    cov.reset();
-    bool notfinished = cov.next();
-    while ( notfinished )
-    {
-      const int col = cov.getcolumn();
-      cov( cov.getrow(), col ) /= scales[ col ];
-      notfinished = cov.next();
-    }
-  }
+} // end AccumulateCovariance()
 
-  /** Compute TrC = trace(C), and diagcov. */
-  for ( unsigned int p = 0; p < P; ++p )
-  {
-    if ( !cov.empty_row( p ) )
-    {
-      //avoid creation of element if the row is empty
-      CovarianceValueType & covpp = cov( p, p );
-      TrC += covpp;
-      diagcov[ p ] = covpp;
-    }
-  }
 
-  /**
-   *    TERM 2
-   *
-   * Compute TrCC = ||C||_F^2.
+/**
+ * ******************** ComputeMaxJacobianTerms **********************
+ */
+
+template <class TElastix>
+void
+AdaptiveStochasticGradientDescent<TElastix>
+::ComputeMaxJacobianTerms( unsigned int threadID,
+  unsigned int numberOfThreads, JacobianTermsThreadStruct & data )
+{
+  /** The samples are divided in contiguous ranges over the threads.
+   * The covariance matrix is only read.
    */
-  cov.reset();
-  bool notfinished2 = cov.next();
-  while ( notfinished2 )
-  {
-    TrCC += vnl_math_sqr( cov.value() );
-    notfinished2 = cov.next();
-  }
+  const ImageSampleContainerType & samples = *data.st_SampleContainer;
+  const CovarianceMatrixType & cov = data.st_Covariances[ 0 ];
+  const unsigned int outdim = data.st_OutputDimension;
+  const unsigned int nrofsamples = samples.Size();
+  const ScalesType & scales = this->m_ScaledCostFunction->GetScales();
+  const unsigned int sampleBegin = static_cast<unsigned int>(
+    ( static_cast<unsigned long>( threadID ) * nrofsamples ) / numberOfThreads );
+  const unsigned int sampleEnd = static_cast<unsigned int>(
+    ( static_cast<unsigned long>( threadID + 1 ) * nrofsamples ) / numberOfThreads );
 
-  /** Symmetry: multiply by 2 and subtract sumsqr(diagcov). */
-  TrCC *= 2.0;
-  TrCC -= diagcov.diagonal().squared_magnitude();
+  /** Variables for nonzerojacobian indices and the Jacobian. */
+  const unsigned int sizejacind
+    = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  JacobianType jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  NonZeroJacobianIndicesType jacind( sizejacind );
 
-  /**
-   *    TERM 3 and 4
-   *
-   * Compute maxJJ and maxJCJ
-   * \li maxJJ = max_j [ ||J_j||_F^2 + 2\sqrt{2} || J_j J_j^T ||_F ]
-   * \li maxJCJ = max_j [ Tr( J_j C J_j^T ) + 2\sqrt{2} || J_j C J_j^T ||_F ]
-   */
-  maxJJ = 0.0;
-  maxJCJ = 0.0;
+  double maxJJ = 0.0;
+  double maxJCJ = 0.0;
   const double sqrt2 = vcl_sqrt( static_cast<double>( 2.0 ) );
   JacobianType jacjjacj( outdim, outdim );
   JacobianType jacjcov( outdim, sizejacind );
-  DiagCovarianceMatrixType diagcovsparse( sizejacind );
-  JacobianType jacjdiagcov( outdim, sizejacind );
-  JacobianType jacjdiagcovjacj( outdim, outdim );
   JacobianType jacjcovjacj( outdim, outdim );
-  NonZeroJacobianIndicesExpandedType jacindExpanded( P );
+  DenseCovarianceMatrixType covj( sizejacind, sizejacind );
+  CovarianceMatrixType::BlockListType blockList;
 
-  samplenr = 0;
-  for ( iter = begin; iter != end; ++iter )
+  for ( unsigned int samplenr = sampleBegin; samplenr < sampleEnd; ++samplenr )
   {
     /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = (*iter).Value().m_ImageCoordinates;
+    const FixedImagePointType & point = samples.ElementAt( samplenr ).m_ImageCoordinates;
     this->m_AdvancedTransform->GetJacobian( point, jacj, jacind  );
 
     /** Apply scales, if necessary. */
@@ -1171,68 +1164,16 @@ AdaptiveStochasticGradientDescent<TElastix>
     /** Max_j [JJ_j]. */
     maxJJ = vnl_math_max( maxJJ, JJ_j );
 
-    /** Compute JCJ_j. */
-    double JCJ_j = 0.0;
-
-    /** J_j C = jacjC. */
-    jacjcov.Fill( 0.0 );
-
-    /** Store the nonzero Jacobian indices in a different format
-     * and create the sparse diagcov.
-     */
-    jacindExpanded.Fill( sizejacind );
-    for ( unsigned int pi = 0; pi < sizejacind; ++pi )
-    {
-      const unsigned int p = jacind[ pi ];
-      jacindExpanded[ p ] = pi;
-      diagcovsparse[ pi ] = diagcov[ p ];
-    }
-
-    /** We below calculate jacjC = J_j cov^T, but later we will correct
-     * for this using:
-     * J C J' = J (cov + cov' - diag(cov')) J'.
-     * (NB: cov now still contains only the upper triangular part of C)
-     */
-    for ( unsigned int pi = 0; pi < sizejacind; ++pi )
-    {
-      const unsigned int p = jacind[ pi ];
-      if ( !cov.empty_row( p ) )
-      {
-        SparseRowType & covrowp = cov.get_row( p );
-        typename SparseRowType::iterator covrowpit;
-
-        /** Loop over row p of the sparse cov matrix. */
-        for ( covrowpit = covrowp.begin(); covrowpit != covrowp.end(); ++covrowpit )
-        {
-          const unsigned int q = (*covrowpit).first;
-          const unsigned int qi = jacindExpanded[ q ];
-
-          if ( qi < sizejacind )
-          {
-            /** If found, update the jacjC matrix. */
-            const CovarianceValueType covElement = (*covrowpit).second;
-            for ( unsigned int dx = 0; dx < outdim; ++dx )
-            {
-              jacjcov[ dx ][ pi ] += jacj[ dx ][ qi ] * covElement;
-            } //dx
-          } // if qi < sizejacind
-        } // for covrow
-
-      } // if not empty row
-    } // pi
-
-    /** J_j C J_j^T  = jacjCjacj.
-     * But note that we actually compute J_j cov' J_j^T
+    /** Compute JCJ_j = J_j C_j J_j^T, with C_j the dense submatrix of C
+     * of the nonzero Jacobian indices. C_j is symmetric, so that
+     * J_j C_j = J_j C_j^T.
      */
+    cov.GetSubMatrix( jacind, covj, blockList );
+    vnl_fastops::ABt( jacjcov, jacj, covj );
     vnl_fastops::ABt( jacjcovjacj, jacjcov, jacj );
 
-    /** jacjCjacj = jacjCjacj+ jacjCjacj' - jacjdiagcovjacj */
-    jacjdiagcov = jacj * diagcovsparse;
-    vnl_fastops::ABt( jacjdiagcovjacj, jacjdiagcov, jacj );
-    jacjcovjacj += jacjcovjacj.transpose();
-    jacjcovjacj -= jacjdiagcovjacj;
-
     /** Compute 1st part of JCJ: Tr( J_j C J_j^T ). */
+    double JCJ_j = 0.0;
     for ( unsigned int d = 0; d < outdim; ++d )
     {
       JCJ_j += jacjcovjacj[ d ][ d ];
@@ -1245,15 +1186,156 @@ AdaptiveStochasticGradientDescent<TElastix>
     maxJCJ = vnl_math_max( maxJCJ, JCJ_j );
 
     /** Show progress 50-100%. */
-    progressObserver->UpdateAndPrintProgress( samplenr + nrofsamples );
-    ++samplenr;
+    if ( threadID == 0 )
+    {
+      data.st_Progress->UpdateAndPrintProgress(
+        nrofsamples + samplenr * numberOfThreads );
+    }
 
   } // end loop over sample container
 
-  /** Finalize progress information. */
-  progressObserver->PrintProgress( 1.0 );
+  data.st_MaxJJ[ threadID ] = maxJJ;
+  data.st_MaxJCJ[ threadID ] = maxJCJ;
 
-} // end ComputeJacobianTerms()
+} // end ComputeMaxJacobianTerms()
+
+
+/**
+ * **************** LaunchJacobianTermsThreaderCallback *******************
+ */
+
+template <class TElastix>
+void
+AdaptiveStochasticGradientDescent<TElastix>
+::LaunchJacobianTermsThreaderCallback(
+  ThreadFunctionType callback, JacobianTermsThreadStruct & data )
+{
+  this->m_Threader->SetSingleMethod( callback, &data );
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchJacobianTermsThreaderCallback()
+
+
+/**
+ * **************** AccumulateCovarianceThreaderCallback *******************
+ */
+
+template <class TElastix>
+ITK_THREAD_RETURN_TYPE
+AdaptiveStochasticGradientDescent<TElastix>
+::AccumulateCovarianceThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  const unsigned int threadID = static_cast<unsigned int>( infoStruct->ThreadID );
+  const unsigned int numberOfThreads
+    = static_cast<unsigned int>( infoStruct->NumberOfThreads );
+  JacobianTermsThreadStruct * data
+    = static_cast< JacobianTermsThreadStruct * >( infoStruct->UserData );
+
+  data->st_Self->AccumulateCovariance( threadID, numberOfThreads, *data );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end AccumulateCovarianceThreaderCallback()
+
+
+/**
+ * **************** ComputeMaxJacobianTermsThreaderCallback *******************
+ */
+
+template <class TElastix>
+ITK_THREAD_RETURN_TYPE
+AdaptiveStochasticGradientDescent<TElastix>
+::ComputeMaxJacobianTermsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  const unsigned int threadID = static_cast<unsigned int>( infoStruct->ThreadID );
+  const unsigned int numberOfThreads
+    = static_cast<unsigned int>( infoStruct->NumberOfThreads );
+  JacobianTermsThreadStruct * data
+    = static_cast< JacobianTermsThreadStruct * >( infoStruct->UserData );
+
+  data->st_Self->ComputeMaxJacobianTerms( threadID, numberOfThreads, *data );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ComputeMaxJacobianTermsThreaderCallback()
+
+
+/**
+ * **************** ReadSettingsCache *******************
+ */
+
+template <class TElastix>
+bool
+AdaptiveStochasticGradientDescent<TElastix>
+::ReadSettingsCache( CachedSettingsVectorType & cache ) const
+{
+  cache.clear();
+  std::ifstream file( this->m_ParameterEstimationCacheFile.c_str() );
+  if ( !file.is_open() )
+  {
+    return false;
+  }
+
+  /** Each line contains the fields of a CachedSettingsType;
+   * lines starting with "//" are comments.
+   */
+  std::string line;
+  while ( std::getline( file, line ) )
+  {
+    if ( line.empty() || line.compare( 0, 2, "//" ) == 0 ) continue;
+    std::istringstream lineStream( line );
+    CachedSettingsType entry;
+    lineStream >> entry.m_Level >> entry.m_NumberOfParameters
+      >> entry.m_MaximumStepLength >> entry.m_SigmoidScaleFactor
+      >> entry.m_Settings.a >> entry.m_Settings.A >> entry.m_Settings.alpha
+      >> entry.m_Settings.fmax >> entry.m_Settings.fmin >> entry.m_Settings.omega;
+    if ( !lineStream.fail() )
+    {
+      cache.push_back( entry );
+    }
+  }
+
+  return true;
+
+} // end ReadSettingsCache()
+
+
+/**
+ * **************** WriteSettingsCache *******************
+ */
+
+template <class TElastix>
+void
+AdaptiveStochasticGradientDescent<TElastix>
+::WriteSettingsCache( const CachedSettingsVectorType & cache ) const
+{
+  std::ofstream file( this->m_ParameterEstimationCacheFile.c_str() );
+  if ( !file.is_open() )
+  {
+    xl::xout["warning"] << "WARNING: could not write the "
+      << "AutomaticParameterEstimationCacheFile \""
+      << this->m_ParameterEstimationCacheFile << "\"." << std::endl;
+    return;
+  }
+
+  /** Write with enough digits to read back the exact values. */
+  file << "// Settings of " << this->elxGetClassName() << ":\n"
+    << "// resolution nrOfParameters MaximumStepLength SigmoidScaleFactor "
+    << "SP_a SP_A SP_alpha SigmoidMax SigmoidMin SigmoidScale\n";
+  file << std::setprecision( 17 );
+  for ( unsigned int i = 0; i < cache.size(); ++i )
+  {
+    const CachedSettingsType & entry = cache[ i ];
+    file << entry.m_Level << " " << entry.m_NumberOfParameters
+      << " " << entry.m_MaximumStepLength << " " << entry.m_SigmoidScaleFactor
+      << " " << entry.m_Settings.a << " " << entry.m_Settings.A
+      << " " << entry.m_Settings.alpha << " " << entry.m_Settings.fmax
+      << " " << entry.m_Settings.fmin << " " << entry.m_Settings.omega << "\n";
+  }
+
+} // end WriteSettingsCache()
 
 
 /**
@@ -0,0 +1,375 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkBlockSparseCovarianceMatrix_cxx
+#define __itkBlockSparseCovarianceMatrix_cxx
+
+#include "itkBlockSparseCovarianceMatrix.h"
+#include "vnl/vnl_math.h"
+
+#include <algorithm>
+
+namespace itk
+{
+
+  const unsigned long BlockSparseCovarianceMatrix::NotPresent
+    = static_cast<unsigned long>( -1 );
+
+  /**
+   * ************************* Constructor ************************
+   */
+
+  BlockSparseCovarianceMatrix
+    ::BlockSparseCovarianceMatrix()
+  {
+    this->m_NumberOfParameters = 0;
+    this->m_NumberOfBlockRows = 0;
+    this->m_BlockSize = 1;
+
+  } // end Constructor
+
+
+  /**
+   * ************************* Initialize ************************
+   */
+
+  void BlockSparseCovarianceMatrix
+    ::Initialize( const unsigned long numberOfParameters,
+    const unsigned int blockSize )
+  {
+    this->m_NumberOfParameters = numberOfParameters;
+    this->m_BlockSize = blockSize;
+    this->m_NumberOfBlockRows = numberOfParameters / blockSize;
+    this->m_Rows.clear();
+    this->m_Rows.resize( this->m_NumberOfBlockRows );
+    std::vector< ValueType >().swap( this->m_Values );
+
+  } // end Initialize()
+
+
+  /**
+   * ************************* DetectBlockSize ************************
+   */
+
+  unsigned int BlockSparseCovarianceMatrix
+    ::DetectBlockSize( const IndexVectorType & indices,
+    const unsigned long numberOfParameters, const unsigned int outputDimension )
+  {
+    const unsigned long m = indices.size();
+    if ( outputDimension < 2 || m == 0
+      || numberOfParameters % outputDimension != 0 || m % outputDimension != 0 )
+    {
+      return 1;
+    }
+
+    /** Check that indices[ d * mb + k ] == indices[ k ] + d * N. */
+    const unsigned long N = numberOfParameters / outputDimension;
+    const unsigned long mb = m / outputDimension;
+    for ( unsigned int d = 1; d < outputDimension; ++d )
+    {
+      for ( unsigned long k = 0; k < mb; ++k )
+      {
+        if ( indices[ d * mb + k ] != indices[ k ] + d * N )
+        {
+          return 1;
+        }
+      }
+    }
+
+    return outputDimension;
+
+  } // end DetectBlockSize()
+
+
+  /**
+   * ************************* ComputeBlockList ************************
+   */
+
+  void BlockSparseCovarianceMatrix
+    ::ComputeBlockList( const IndexVectorType & indices,
+    BlockListType & blockList ) const
+  {
+    const unsigned long m = indices.size();
+    const unsigned int B = this->m_BlockSize;
+    const unsigned long N = this->m_NumberOfBlockRows;
+
+    /** Sort the pairs ( parameter index, position ) on the block number.
+     * For B-spline transforms the indices of each component are already
+     * in increasing order, so this is cheap.
+     */
+    blockList.m_SortBuffer.resize( m );
+    for ( unsigned long pi = 0; pi < m; ++pi )
+    {
+      const unsigned long p = indices[ pi ];
+      blockList.m_SortBuffer[ pi ].first = ( p % N ) * B + p / N;
+      blockList.m_SortBuffer[ pi ].second = pi;
+    }
+    std::sort( blockList.m_SortBuffer.begin(), blockList.m_SortBuffer.end() );
+
+    /** Collect the blocks and the positions of their components. */
+    blockList.m_Blocks.clear();
+    blockList.m_Positions.clear();
+    for ( unsigned long k = 0; k < m; ++k )
+    {
+      const unsigned long block = blockList.m_SortBuffer[ k ].first / B;
+      const unsigned long component = blockList.m_SortBuffer[ k ].first % B;
+      if ( blockList.m_Blocks.empty() || blockList.m_Blocks.back() != block )
+      {
+        blockList.m_Blocks.push_back( block );
+        blockList.m_Positions.resize( blockList.m_Positions.size() + B, NotPresent );
+      }
+      blockList.m_Positions[ ( blockList.m_Blocks.size() - 1 ) * B + component ]
+        = blockList.m_SortBuffer[ k ].second;
+    }
+
+  } // end ComputeBlockList()
+
+
+  /**
+   * ************************* GetOrCreateBlock ************************
+   */
+
+  unsigned long BlockSparseCovarianceMatrix
+    ::GetOrCreateBlock( const unsigned long i,
+    const unsigned long j, unsigned long & start )
+  {
+    RowType & row = this->m_Rows[ i ];
+    RowType::iterator it = std::lower_bound( row.begin() + start, row.end(), j );
+    if ( it == row.end() || it->m_Column != j )
+    {
+      EntryType entry;
+      entry.m_Column = j;
+      entry.m_Offset = this->m_Values.size();
+      this->m_Values.resize( this->m_Values.size() + this->m_BlockSize * this->m_BlockSize, 0.0 );
+      it = row.insert( it, entry );
+    }
+    start = static_cast<unsigned long>( it - row.begin() ) + 1;
+    return it->m_Offset;
+
+  } // end GetOrCreateBlock()
+
+
+  /**
+   * ************************* Add ************************
+   */
+
+  void BlockSparseCovarianceMatrix
+    ::Add( const IndexVectorType & indices, const MatrixType & values,
+    const ValueType factor )
+  {
+    this->ComputeBlockList( indices, this->m_BlockList );
+    const std::vector< unsigned long > & blocks = this->m_BlockList.m_Blocks;
+    const std::vector< unsigned long > & positions = this->m_BlockList.m_Positions;
+    const unsigned int B = this->m_BlockSize;
+    const unsigned long numberOfBlocks = blocks.size();
+
+    /** Visit the blocks ( i, j ) with i <= j; the columns of each row in
+     * increasing order.
+     */
+    for ( unsigned long u = 0; u < numberOfBlocks; ++u )
+    {
+      unsigned long start = 0;
+      for ( unsigned long v = u; v < numberOfBlocks; ++v )
+      {
+        const unsigned long offset
+          = this->GetOrCreateBlock( blocks[ u ], blocks[ v ], start );
+        ValueType * block = &( this->m_Values[ offset ] );
+        for ( unsigned int c = 0; c < B; ++c )
+        {
+          const unsigned long pi = positions[ u * B + c ];
+          if ( pi == NotPresent ) continue;
+          for ( unsigned int e = 0; e < B; ++e )
+          {
+            const unsigned long qi = positions[ v * B + e ];
+            if ( qi == NotPresent ) continue;
+            block[ c * B + e ] += factor * values( pi, qi );
+          }
+        }
+      }
+    }
+
+  } // end Add()
+
+
+  /**
+   * ************************* Merge ************************
+   */
+
+  void BlockSparseCovarianceMatrix
+    ::Merge( const Self & other )
+  {
+    const unsigned int BB = this->m_BlockSize * this->m_BlockSize;
+    for ( unsigned long i = 0; i < this->m_NumberOfBlockRows; ++i )
+    {
+      const RowType & otherRow = other.m_Rows[ i ];
+      unsigned long start = 0;
+      for ( unsigned long k = 0; k < otherRow.size(); ++k )
+      {
+        const unsigned long offset
+          = this->GetOrCreateBlock( i, otherRow[ k ].m_Column, start );
+        const ValueType * otherBlock = &( other.m_Values[ otherRow[ k ].m_Offset ] );
+        ValueType * block = &( this->m_Values[ offset ] );
+        for ( unsigned int b = 0; b < BB; ++b )
+        {
+          block[ b ] += otherBlock[ b ];
+        }
+      }
+    }
+
+  } // end Merge()
+
+
+  /**
+   * ************************* Scale ************************
+   */
+
+  void BlockSparseCovarianceMatrix
+    ::Scale( const VectorType & scales )
+  {
+    const unsigned int B = this->m_BlockSize;
+    const unsigned long N = this->m_NumberOfBlockRows;
+    for ( unsigned long i = 0; i < N; ++i )
+    {
+      const RowType & row = this->m_Rows[ i ];
+      for ( unsigned long k = 0; k < row.size(); ++k )
+      {
+        const unsigned long j = row[ k ].m_Column;
+        ValueType * block = &( this->m_Values[ row[ k ].m_Offset ] );
+        for ( unsigned int c = 0; c < B; ++c )
+        {
+          const ValueType sp = scales[ c * N + i ];
+          for ( unsigned int e = 0; e < B; ++e )
+          {
+            block[ c * B + e ] /= sp * scales[ e * N + j ];
+          }
+        }
+      }
+    }
+
+  } // end Scale()
+
+
+  /**
+   * ************************* GetSubMatrix ************************
+   */
+
+  void BlockSparseCovarianceMatrix
+    ::GetSubMatrix( const IndexVectorType & indices, MatrixType & subMatrix,
+    BlockListType & blockList ) const
+  {
+    const unsigned long m = indices.size();
+    if ( subMatrix.rows() != m || subMatrix.cols() != m )
+    {
+      subMatrix.set_size( m, m );
+    }
+    subMatrix.fill( 0.0 );
+
+    this->ComputeBlockList( indices, blockList );
+    const std::vector< unsigned long > & blocks = blockList.m_Blocks;
+    const std::vector< unsigned long > & positions = blockList.m_Positions;
+    const unsigned int B = this->m_BlockSize;
+    const unsigned long numberOfBlocks = blocks.size();
+
+    for ( unsigned long u = 0; u < numberOfBlocks; ++u )
+    {
+      const RowType & row = this->m_Rows[ blocks[ u ] ];
+      RowType::const_iterator it = row.begin();
+      for ( unsigned long v = u; v < numberOfBlocks; ++v )
+      {
+        it = std::lower_bound( it, row.end(), blocks[ v ] );
+        if ( it == row.end() ) break;
+        if ( it->m_Column != blocks[ v ] ) continue;
+
+        /** Copy block ( u, v ) and its transpose. */
+        const ValueType * block = &( this->m_Values[ it->m_Offset ] );
+        for ( unsigned int c = 0; c < B; ++c )
+        {
+          const unsigned long pi = positions[ u * B + c ];
+          if ( pi == NotPresent ) continue;
+          for ( unsigned int e = 0; e < B; ++e )
+          {
+            const unsigned long qi = positions[ v * B + e ];
+            if ( qi == NotPresent ) continue;
+            subMatrix( pi, qi ) = block[ c * B + e ];
+            subMatrix( qi, pi ) = block[ c * B + e ];
+          }
+        }
+      }
+    }
+
+  } // end GetSubMatrix()
+
+
+  /**
+   * ************************* GetTrace ************************
+   */
+
+  BlockSparseCovarianceMatrix::ValueType
+    BlockSparseCovarianceMatrix
+    ::GetTrace( void ) const
+  {
+    const unsigned int B = this->m_BlockSize;
+    ValueType trace = 0.0;
+    for ( unsigned long i = 0; i < this->m_NumberOfBlockRows; ++i )
+    {
+      const RowType & row = this->m_Rows[ i ];
+      if ( row.empty() || row[ 0 ].m_Column != i ) continue;
+
+      /** The diagonal block is the first of the row. */
+      const ValueType * block = &( this->m_Values[ row[ 0 ].m_Offset ] );
+      for ( unsigned int c = 0; c < B; ++c )
+      {
+        trace += block[ c * B + c ];
+      }
+    }
+    return trace;
+
+  } // end GetTrace()
+
+
+  /**
+   * ************************* GetSquaredFrobeniusNorm ************************
+   */
+
+  BlockSparseCovarianceMatrix::ValueType
+    BlockSparseCovarianceMatrix
+    ::GetSquaredFrobeniusNorm( void ) const
+  {
+    /** The diagonal blocks are stored completely; the off-diagonal
+     * blocks ( i, j ) also represent their transposes ( j, i ).
+     */
+    const unsigned int BB = this->m_BlockSize * this->m_BlockSize;
+    ValueType sumsqr = 0.0;
+    for ( unsigned long i = 0; i < this->m_NumberOfBlockRows; ++i )
+    {
+      const RowType & row = this->m_Rows[ i ];
+      for ( unsigned long k = 0; k < row.size(); ++k )
+      {
+        const ValueType * block = &( this->m_Values[ row[ k ].m_Offset ] );
+        ValueType blocksumsqr = 0.0;
+        for ( unsigned int b = 0; b < BB; ++b )
+        {
+          blocksumsqr += vnl_math_sqr( block[ b ] );
+        }
+        sumsqr += row[ k ].m_Column == i ? blocksumsqr : 2.0 * blocksumsqr;
+      }
+    }
+    return sumsqr;
+
+  } // end GetSquaredFrobeniusNorm()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBlockSparseCovarianceMatrix_cxx
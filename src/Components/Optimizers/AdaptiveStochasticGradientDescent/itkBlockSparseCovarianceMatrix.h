@@ -0,0 +1,168 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkBlockSparseCovarianceMatrix_h
+#define __itkBlockSparseCovarianceMatrix_h
+
+#include "vnl/vnl_matrix.h"
+#include "vnl/vnl_vector.h"
+
+#include <vector>
+
+namespace itk
+{
+
+  /**
+   * \class BlockSparseCovarianceMatrix
+   * \brief A symmetric sparse matrix, stored as blocks of parameters.
+   *
+   * This class accumulates the covariance matrix C = 1/n \sum_j J_j^T J_j
+   * of the automatic parameter estimation of the
+   * AdaptiveStochasticGradientDescent optimizer.
+   *
+   * The parameters are grouped in blocks of BlockSize parameters: parameter
+   * p belongs to block p % N and is component p / N of that block, with N
+   * the number of blocks. For a B-spline transform with BlockSize equal to
+   * the space dimension, a block contains the parameters of one control
+   * point. The matrix stores the dense BlockSize x BlockSize blocks (i,j),
+   * with i <= j, of the pairs of blocks that were added, in a compressed
+   * row structure: per block row a sorted list of block columns. The memory
+   * and the time of an addition are therefore bounded by the number of
+   * interacting control point pairs, and do not depend on the order in
+   * which the elements are added.
+   *
+   * A matrix can be filled per thread, and the results can be added with
+   * Merge().
+   */
+
+  class BlockSparseCovarianceMatrix
+  {
+  public:
+
+    /** Typedefs. */
+    typedef BlockSparseCovarianceMatrix   Self;
+    typedef double                        ValueType;
+    typedef std::vector< unsigned long >  IndexVectorType;
+    typedef vnl_matrix< ValueType >       MatrixType;
+    typedef vnl_vector< ValueType >       VectorType;
+
+    /** Workspace for the blocks of a set of parameter indices. m_Blocks
+     * contains the sorted blocks; m_Positions[ u * BlockSize + c ] the
+     * position in the index vector of component c of block m_Blocks[ u ],
+     * or NotPresent.
+     */
+    struct BlockListType
+    {
+      std::vector< unsigned long >  m_Blocks;
+      std::vector< unsigned long >  m_Positions;
+      std::vector< std::pair< unsigned long, unsigned long > > m_SortBuffer;
+    };
+
+    /** Marks a component that is not in the index vector. */
+    static const unsigned long NotPresent;
+
+    /** Constructor, creates an empty matrix. */
+    BlockSparseCovarianceMatrix();
+
+    /** Set the number of parameters and the block size, and clear the
+     * matrix. The block size should divide the number of parameters.
+     */
+    void Initialize( const unsigned long numberOfParameters,
+      const unsigned int blockSize );
+
+    /** Find the largest block size that fits the structure of indices:
+     * outputDimension if the indices consist of outputDimension equal
+     * groups of control points, and 1 otherwise.
+     */
+    static unsigned int DetectBlockSize( const IndexVectorType & indices,
+      const unsigned long numberOfParameters, const unsigned int outputDimension );
+
+    /** Add factor * values( pi, qi ) to C( indices[ pi ], indices[ qi ] ),
+     * for all pi and qi. The values should be symmetric.
+     */
+    void Add( const IndexVectorType & indices, const MatrixType & values,
+      const ValueType factor );
+
+    /** Add the matrix other, which must have the same size and block size. */
+    void Merge( const Self & other );
+
+    /** Multiply C( p, q ) by 1 / ( scales[ p ] * scales[ q ] ). */
+    void Scale( const VectorType & scales );
+
+    /** Get the dense submatrix C( indices[ pi ], indices[ qi ] ).
+     * Elements that were never added are zero.
+     */
+    void GetSubMatrix( const IndexVectorType & indices, MatrixType & subMatrix,
+      BlockListType & blockList ) const;
+
+    /** Get the trace of C. */
+    ValueType GetTrace( void ) const;
+
+    /** Get the squared Frobenius norm of C, i.e. trace( C^T C ). */
+    ValueType GetSquaredFrobeniusNorm( void ) const;
+
+    /** Get the number of stored blocks. */
+    unsigned long GetNumberOfBlocks( void ) const
+    {
+      return this->m_Values.size() / ( this->m_BlockSize * this->m_BlockSize );
+    }
+
+    /** Get the block size. */
+    unsigned int GetBlockSize( void ) const
+    {
+      return this->m_BlockSize;
+    }
+
+  protected:
+
+    /** An element of a block row: the block column and the start of the
+     * values of the block in m_Values.
+     */
+    struct EntryType
+    {
+      unsigned long m_Column;
+      unsigned long m_Offset;
+      bool operator<( const unsigned long column ) const
+      {
+        return this->m_Column < column;
+      }
+    };
+    typedef std::vector< EntryType >    RowType;
+
+    /** Compute the block list of a set of indices. */
+    void ComputeBlockList( const IndexVectorType & indices,
+      BlockListType & blockList ) const;
+
+    /** Get the offset of block ( i, j ) in m_Values, creating the block if
+     * it does not exist yet. Searches the row from position start, which is
+     * updated, so that the columns can be visited in increasing order.
+     */
+    unsigned long GetOrCreateBlock( const unsigned long i,
+      const unsigned long j, unsigned long & start );
+
+  private:
+
+    unsigned long                 m_NumberOfParameters;
+    unsigned long                 m_NumberOfBlockRows;
+    unsigned int                  m_BlockSize;
+    std::vector< RowType >        m_Rows;
+    std::vector< ValueType >      m_Values;
+    BlockListType                 m_BlockList;
+
+  }; // end class BlockSparseCovarianceMatrix
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBlockSparseCovarianceMatrix_h
@@ -87,6 +87,27 @@ using namespace itk;
  *    example: <tt>(Metric0Use "false" "true")</tt> \n
  *    example: <tt>(Metric1Use "true" "false")</tt> \n
  *    The default is "true".
+ * \parameter ConcurrentMetricEvaluation: Whether the metrics are evaluated
+ *    concurrently, each in its own thread, instead of one after the other. \n
+ *    The threads are divided over the metrics. This is only safe for
+ *    metrics that share nothing but the transform. \n
+ *    example: <tt>(ConcurrentMetricEvaluation "true")</tt> \n
+ *    The default is "false".
+ * \parameter ShareTransformedSamples: Whether metrics that use the same image
+ *    sampler share their mapped points and transform Jacobians. Each sample
+ *    is then transformed once per iteration, instead of once per metric. \n
+ *    This is ignored when ConcurrentMetricEvaluation is "true". It costs
+ *    memory for one sparse Jacobian per sample, so it is meant for random
+ *    samplers rather than the full sampler. \n
+ *    example: <tt>(ShareTransformedSamples "true")</tt> \n
+ *    The default is "false".
+ *
+ * The iteration info shows per metric the wall clock time, Time\<i\>[ms],
+ * and the CPU time of all threads that computed the metric, CPUTime\<i\>[ms].
+ * With concurrent evaluation the slowest metric determines the time per
+ * iteration. The CPU time per metric is then measured with a CPU clock per
+ * thread. Systems without such a clock (e.g. Mac OS X) report the CPU time
+ * of the whole process instead, which is not meaningful per metric.
  *
  * \ingroup Registrations
  */
@@ -236,6 +257,11 @@ protected:
   /** Read the components from m_Elastix and set them in the Registration class. */
   virtual void SetComponents( void );
 
+  /** Give the metrics that use the same image sampler a shared cache of
+   * transformed samples, or remove the caches if share is false.
+   */
+  virtual void SetTransformedSampleCaches( bool share );
+
   bool m_ShowExactMetricValue;
 
 private:
@@ -76,6 +76,13 @@ MultiMetricMultiResolutionRegistration<TElastix>
     this->SetFixedImageRegion( this->GetElastix()->GetFixedImage(i)->GetBufferedRegion(), i );
   }
 
+  /** Set whether the metrics are evaluated concurrently. */
+  bool concurrentMetricEvaluation = false;
+  this->m_Configuration->ReadParameter( concurrentMetricEvaluation,
+    "ConcurrentMetricEvaluation", 0 );
+  this->GetCombinationMetric()->SetUseConcurrentMetricEvaluation(
+    concurrentMetricEvaluation );
+
   /** Add the target cells "Metric<i>" and "||Gradient<i>||" to xout["iteration"]
    * and format as floats.
    */
@@ -96,7 +103,26 @@ MultiMetricMultiResolutionRegistration<TElastix>
     makestring3 << "Time" << i << "[ms]";
     xout["iteration"].AddTargetCell( makestring3.str().c_str() );
     xl::xout["iteration"][ makestring3.str().c_str() ] << std::showpoint << std::fixed;
+
+    std::ostringstream makestring4;
+    makestring4 << "CPUTime" << i << "[ms]";
+    xout["iteration"].AddTargetCell( makestring4.str().c_str() );
+    xl::xout["iteration"][ makestring4.str().c_str() ] << std::showpoint << std::fixed;
+  }
+
+  /** Set whether metrics with the same sampler share the transformed samples.
+   * Concurrently evaluated metrics would fill the shared cache simultaneously.
+   */
+  bool shareTransformedSamples = false;
+  this->m_Configuration->ReadParameter( shareTransformedSamples,
+    "ShareTransformedSamples", 0 );
+  if ( shareTransformedSamples && concurrentMetricEvaluation )
+  {
+    xl::xout["warning"] << "WARNING: ShareTransformedSamples is ignored, "
+      << "because ConcurrentMetricEvaluation is \"true\"." << std::endl;
+    shareTransformedSamples = false;
   }
+  this->SetTransformedSampleCaches( shareTransformedSamples );
 
 } // end BeforeRegistration()
 
@@ -128,6 +154,11 @@ MultiMetricMultiResolutionRegistration<TElastix>
     makestring3 << "Time" << i << "[ms]";
     xl::xout["iteration"][ makestring3.str().c_str() ] <<
       this->GetCombinationMetric()->GetMetricComputationTime( i );
+
+    std::ostringstream makestring4;
+    makestring4 << "CPUTime" << i << "[ms]";
+    xl::xout["iteration"][ makestring4.str().c_str() ] <<
+      this->GetCombinationMetric()->GetMetricComputationCPUTime( i );
   }
   
   if ( this->m_ShowExactMetricValue )
@@ -343,6 +374,79 @@ MultiMetricMultiResolutionRegistration<TElastix>
 } // end SetComponents()
 
 
+/**
+ * *********************** SetTransformedSampleCaches ************************
+ */
+
+template <class TElastix>
+void
+MultiMetricMultiResolutionRegistration<TElastix>
+::SetTransformedSampleCaches( bool share )
+{
+  typedef typename ElastixType::MetricBaseType          MetricBaseType;
+  typedef typename MetricBaseType::AdvancedMetricType   AdvancedMetricType;
+  typedef typename MetricBaseType::ImageSamplerBaseType ImageSamplerBaseType;
+  typedef typename AdvancedMetricType::TransformedSampleCacheType
+    TransformedSampleCacheType;
+
+  /** Find the advanced metrics and their samplers. */
+  const unsigned int nrOfMetrics = this->GetElastix()->GetNumberOfMetrics();
+  std::vector< AdvancedMetricType * > metrics( nrOfMetrics, 0 );
+  std::vector< ImageSamplerBaseType * > samplers( nrOfMetrics, 0 );
+  for ( unsigned int i = 0; i < nrOfMetrics; ++i )
+  {
+    MetricBaseType * elxMetric = this->GetElastix()->GetElxMetricBase( i );
+    metrics[ i ] = dynamic_cast<AdvancedMetricType *>( elxMetric->GetAsITKBaseType() );
+    samplers[ i ] = elxMetric->GetAdvancedMetricImageSampler();
+    if ( metrics[ i ] )
+    {
+      metrics[ i ]->SetTransformedSampleCache( 0 );
+    }
+  }
+
+  if ( !share )
+  {
+    return;
+  }
+
+  /** Give each metric the cache of the first earlier metric with the same
+   * sampler. A cache is only created when at least two metrics share it.
+   */
+  unsigned int nrOfSharingMetrics = 0;
+  for ( unsigned int i = 0; i < nrOfMetrics; ++i )
+  {
+    if ( metrics[ i ] == 0 || samplers[ i ] == 0 )
+    {
+      continue;
+    }
+    for ( unsigned int j = 0; j < i; ++j )
+    {
+      if ( metrics[ j ] == 0 || samplers[ j ] != samplers[ i ] )
+      {
+        continue;
+      }
+      if ( !metrics[ j ]->GetTransformedSampleCache() )
+      {
+        typename TransformedSampleCacheType::Pointer cache
+          = TransformedSampleCacheType::New();
+        cache->SetSampleSource( samplers[ j ] );
+        metrics[ j ]->SetTransformedSampleCache( cache );
+        ++nrOfSharingMetrics;
+      }
+      metrics[ i ]->SetTransformedSampleCache(
+        metrics[ j ]->GetTransformedSampleCache() );
+      ++nrOfSharingMetrics;
+      break;
+    }
+  }
+
+  elxout << "  " << nrOfSharingMetrics
+    << " metrics share their transformed samples with another metric."
+    << std::endl;
+
+} // end SetTransformedSampleCaches()
+
+
 /**
  * ************************* UpdateFixedMasks ************************
  */
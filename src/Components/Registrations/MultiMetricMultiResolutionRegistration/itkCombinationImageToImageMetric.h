@@ -17,6 +17,7 @@
 
 #include "itkAdvancedImageToImageMetric.h"
 #include "itkSingleValuedPointSetToPointSetMetric.h"
+#include "elxTimer.h"
 
 namespace itk
 {
@@ -47,6 +48,14 @@ namespace itk
  * why we chose to reimplement the Get{Transform,Interpolator}()
  * methods.
  *
+ * The sub metrics are evaluated one after the other, unless
+ * UseConcurrentMetricEvaluation is set. Then every sub metric is evaluated
+ * in its own thread, into its own value and derivative, and the results are
+ * combined afterwards. The transform parameters are set once before the
+ * threads are started, and the sub metrics are told not to set them again.
+ * The threads of this metric are divided over the sub metrics. This is only
+ * safe if the sub metrics do not modify other shared objects.
+ *
  *
  * \ingroup RegistrationMetrics
  *
@@ -214,9 +223,22 @@ public:
   /** Get the last computed derivative magnitude for metric i. */
   double GetMetricDerivativeMagnitude( unsigned int pos ) const;
 
-  /** Get the last computed derivative magnitude for metric i. */
+  /** Get the last computed wall clock time for metric i, in ms. */
   std::size_t GetMetricComputationTime( unsigned int pos ) const;
 
+  /** Get the last computed CPU time for metric i, in ms. This is the CPU time
+   * of all threads, including the ones started by metric i. When the metrics
+   * are evaluated concurrently, it is the CPU time of the thread that
+   * evaluated metric i, plus that of the threads started by metric i.
+   */
+  std::size_t GetMetricComputationCPUTime( unsigned int pos ) const;
+
+  /** Set and Get whether the sub metrics are evaluated concurrently.
+   * The default is false.
+   */
+  itkSetMacro( UseConcurrentMetricEvaluation, bool );
+  itkGetConstMacro( UseConcurrentMetricEvaluation, bool );
+
   /**
    * Set/Get functions for the metric components
    */
@@ -401,15 +423,54 @@ protected:
   mutable std::vector< DerivativeType >             m_MetricDerivatives;
   mutable std::vector< double >                     m_MetricDerivativesMagnitude;
   mutable std::vector< std::size_t >                m_MetricComputationTime;
+  mutable std::vector< std::size_t >                m_MetricComputationCPUTime;
+  bool                                              m_UseConcurrentMetricEvaluation;
 
   /** Dummy image region and derivatives. */
   FixedImageRegionType        m_NullFixedImageRegion;
   DerivativeType              m_NullDerivative;
 
+  /** Typedefs for the concurrent evaluation of the sub metrics. */
+  typedef typename Superclass::ThreaderType               ThreaderType;
+  typedef typename Superclass::ThreadInfoType             ThreadInfoType;
+
+  /** What to compute for the sub metrics in ComputeMetrics(). */
+  enum MetricEvaluationType
+  {
+    ComputeValue,
+    ComputeDerivative,
+    ComputeValueAndDerivative
+  };
+
+  /** Compute the value and/or derivative of all sub metrics, and store them
+   * together with the computation times. Depending on
+   * m_UseConcurrentMetricEvaluation the sub metrics are evaluated one after
+   * the other or concurrently.
+   */
+  virtual void ComputeMetrics( const ParametersType & parameters,
+    MetricEvaluationType evaluation ) const;
+
+  /** Compute the value and/or derivative of sub metric pos. */
+  virtual void ComputeMetric( unsigned int pos ) const;
+
+  /** The static callback function passed to the threader. Thread i
+   * evaluates sub metric i.
+   */
+  static ITK_THREAD_RETURN_TYPE ComputeMetricThreaderCallback( void * arg );
+
 private:
   CombinationImageToImageMetric(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
 
+  /** The threader and the state of the current evaluation, which are
+   * shared with the threads.
+   */
+  typename ThreaderType::Pointer                    m_MetricThreader;
+  mutable std::vector< tmr::Timer::Pointer >        m_MetricTimers;
+  mutable std::vector< std::string >                m_MetricErrors;
+  mutable const ParametersType *                    m_MetricParameters;
+  mutable MetricEvaluationType                      m_MetricEvaluation;
+
 }; // end class CombinationImageToImageMetric
 
 } // end namespace itk
@@ -162,6 +162,10 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
 {
   this->m_NumberOfMetrics = 0;
   this->m_UseRelativeWeights = false;
+  this->m_UseConcurrentMetricEvaluation = false;
+  this->m_MetricThreader = ThreaderType::New();
+  this->m_MetricParameters = 0;
+  this->m_MetricEvaluation = ComputeValue;
   this->ComputeGradientOff();
 
 } // end Constructor
@@ -193,7 +197,10 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
     os << indent << "MetricDerivativesMagnitude: "  << this->m_MetricDerivativesMagnitude[ i ] << "\n";
     os << indent << "UseMetric: " << ( this->m_UseMetric[ i ] ? "true\n" : "false\n" );
     os << indent << "MetricComputationTime: " << this->m_MetricComputationTime[ i ] << "\n";
+    os << indent << "MetricComputationCPUTime: " << this->m_MetricComputationCPUTime[ i ] << "\n";
   }
+  os << indent << "UseConcurrentMetricEvaluation: "
+    << ( this->m_UseConcurrentMetricEvaluation ? "true" : "false" ) << std::endl;
 
 } // end PrintSelf()
 
@@ -282,6 +289,9 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
     this->m_MetricDerivatives.resize( count );
     this->m_MetricDerivativesMagnitude.resize( count );
     this->m_MetricComputationTime.resize( count );
+    this->m_MetricComputationCPUTime.resize( count );
+    this->m_MetricTimers.resize( count );
+    this->m_MetricErrors.resize( count );
     this->Modified();
   }
 
@@ -571,6 +581,27 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
 } // end GetMetricComputationTime()
 
 
+/**
+ * ********************* GetMetricComputationCPUTime ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+std::size_t
+CombinationImageToImageMetric<TFixedImage,TMovingImage>
+::GetMetricComputationCPUTime( unsigned int pos ) const
+{
+  if ( pos >= this->GetNumberOfMetrics() )
+  {
+    return 0;
+  }
+  else
+  {
+    return this->m_MetricComputationCPUTime[ pos ];
+  }
+
+} // end GetMetricComputationCPUTime()
+
+
 /**
  * **************** GetNumberOfPixelsCounted ************************
  */
@@ -654,23 +685,12 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
   /** Initialise. */
   MeasureType measure = NumericTraits< MeasureType >::Zero;
 
-  /** Compute, store and combine all metric values. */
+  /** Compute and store all metric values. */
+  this->ComputeMetrics( parameters, ComputeValue );
+
+  /** Combine all metric values. */
   for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
   {
-    /** Time the computation per metric. */
-    typename tmr::Timer::Pointer timer = tmr::Timer::New();
-    timer->StartTimer();
-
-    /** Compute ... */
-    MeasureType tmpValue = this->m_Metrics[ i ]->GetValue( parameters );
-    timer->StopTimer();
-
-    /** store ... */
-    this->m_MetricValues[ i ] = tmpValue;
-    this->m_MetricComputationTime[ i ] = static_cast<std::size_t>(
-      Math::Round<double>( timer->GetElapsedClockSec() * 1000.0 ) );
-
-    /** and combine. */
     if ( this->m_UseMetric[ i ] )
     {
       if ( !this->m_UseRelativeWeights )
@@ -714,29 +734,15 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
   DerivativeType & derivative ) const
 {
   /** Initialise. */
-  DerivativeType tmpDerivative = DerivativeType( this->GetNumberOfParameters() );
   derivative = DerivativeType( this->GetNumberOfParameters() );
   derivative.Fill( NumericTraits< MeasureType >::Zero );
 
-  /** Compute, store and combine all metric derivatives. */
+  /** Compute and store all metric derivatives. */
+  this->ComputeMetrics( parameters, ComputeDerivative );
+
+  /** Combine all metric derivatives. */
   for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
   {
-    /** Time the computation per metric. */
-    typename tmr::Timer::Pointer timer = tmr::Timer::New();
-    timer->StartTimer();
-
-    /** Compute ... */
-    tmpDerivative.Fill( NumericTraits< MeasureType >::Zero );
-    this->m_Metrics[ i ]->GetDerivative( parameters, tmpDerivative );
-    timer->StopTimer();
-
-    /** store ... */
-    this->m_MetricDerivatives[ i ] = tmpDerivative;
-    this->m_MetricDerivativesMagnitude[ i ] = tmpDerivative.magnitude();
-    this->m_MetricComputationTime[ i ] = static_cast<std::size_t>(
-      Math::Round<double>( timer->GetElapsedClockSec() * 1000.0 ) );
-
-    /** and combine. */
     if ( this->m_UseMetric[ i ] )
     {
       if ( !this->m_UseRelativeWeights )
@@ -779,34 +785,16 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
   DerivativeType & derivative ) const
 {
   /** Initialise. */
-  MeasureType tmpValue = NumericTraits< MeasureType >::Zero;
   value = NumericTraits< MeasureType >::Zero;
-
-  DerivativeType tmpDerivative = DerivativeType( this->GetNumberOfParameters() );
   derivative = DerivativeType( this->GetNumberOfParameters() );
   derivative.Fill( NumericTraits< MeasureType >::Zero );
 
-  /** Compute, store and combine all metric values and derivatives. */
+  /** Compute and store all metric values and derivatives. */
+  this->ComputeMetrics( parameters, ComputeValueAndDerivative );
+
+  /** Combine all metric values and derivatives. */
   for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
   {
-    /** Time the computation per metric. */
-    typename tmr::Timer::Pointer timer = tmr::Timer::New();
-    timer->StartTimer();
-
-    /** Compute ... */
-    tmpValue = NumericTraits< MeasureType >::Zero;
-    tmpDerivative.Fill( NumericTraits< MeasureType >::Zero );
-    this->m_Metrics[ i ]->GetValueAndDerivative( parameters, tmpValue, tmpDerivative );
-    timer->StopTimer();
-
-    /** store ... */
-    this->m_MetricValues[ i ] = tmpValue;
-    this->m_MetricDerivatives[ i ] = tmpDerivative;
-    this->m_MetricDerivativesMagnitude[ i ] = tmpDerivative.magnitude();
-    this->m_MetricComputationTime[ i ] = static_cast<std::size_t>(
-      Math::Round<double>( timer->GetElapsedClockSec() * 1000.0 ) );
-
-    /** and combine. */
     if ( this->m_UseMetric[ i ] )
     {
       if ( !this->m_UseRelativeWeights )
@@ -838,6 +826,233 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
 } // end GetValueAndDerivative()
 
 
+/**
+ * ********************* ComputeMetrics ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage,TMovingImage>
+::ComputeMetrics( const ParametersType & parameters,
+  MetricEvaluationType evaluation ) const
+{
+  /** Store what to compute, so that the threads can access it. */
+  this->m_MetricParameters = &parameters;
+  this->m_MetricEvaluation = evaluation;
+
+  /** Create the timers here, since creating objects is not thread safe. */
+  for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    if ( this->m_MetricTimers[ i ].IsNull() )
+    {
+      this->m_MetricTimers[ i ] = tmr::Timer::New();
+    }
+  }
+
+  /** Compute the metrics one after the other. */
+  if ( !this->m_UseConcurrentMetricEvaluation || this->m_NumberOfMetrics < 2 )
+  {
+    for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+    {
+      this->ComputeMetric( i );
+    }
+    return;
+  }
+
+  /** Set the transform parameters before the threads are started, and let
+   * the sub metrics skip setting them, so that the shared transform is only
+   * read by the threads.
+   */
+  this->SetTransformParameters( parameters );
+
+  /** Divide the threads of this metric over the sub metrics, instead of
+   * letting every sub metric start all threads. The original settings are
+   * restored afterwards.
+   */
+  const unsigned int numberOfThreads = this->GetNumberOfThreads();
+  std::vector< unsigned int > originalNumberOfThreads( this->m_NumberOfMetrics, 1 );
+  for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    ImageMetricType * imageMetric
+      = dynamic_cast<ImageMetricType *>( this->m_Metrics[ i ].GetPointer() );
+    PointSetMetricType * pointSetMetric
+      = dynamic_cast<PointSetMetricType *>( this->m_Metrics[ i ].GetPointer() );
+    if ( imageMetric )
+    {
+      originalNumberOfThreads[ i ] = imageMetric->GetNumberOfThreads();
+      const unsigned int share = numberOfThreads / this->m_NumberOfMetrics
+        + ( i < numberOfThreads % this->m_NumberOfMetrics ? 1 : 0 );
+      imageMetric->SetNumberOfThreads( vnl_math_max( 1u, share ) );
+      imageMetric->SetTransformParametersAreSet( true );
+    }
+    else if ( pointSetMetric )
+    {
+      pointSetMetric->SetTransformParametersAreSet( true );
+    }
+    this->m_MetricErrors[ i ] = "";
+  }
+
+  /** Compute the metrics concurrently, one metric per thread. */
+  Self * thisNonConst = const_cast< Self * >( this );
+  this->m_MetricThreader->SetNumberOfThreads( this->m_NumberOfMetrics );
+  this->m_MetricThreader->SetSingleMethod(
+    Self::ComputeMetricThreaderCallback, thisNonConst );
+  this->m_MetricThreader->SingleMethodExecute();
+
+  /** Restore the settings of the sub metrics. */
+  for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    ImageMetricType * imageMetric
+      = dynamic_cast<ImageMetricType *>( this->m_Metrics[ i ].GetPointer() );
+    PointSetMetricType * pointSetMetric
+      = dynamic_cast<PointSetMetricType *>( this->m_Metrics[ i ].GetPointer() );
+    if ( imageMetric )
+    {
+      imageMetric->SetNumberOfThreads( originalNumberOfThreads[ i ] );
+      imageMetric->SetTransformParametersAreSet( false );
+    }
+    else if ( pointSetMetric )
+    {
+      pointSetMetric->SetTransformParametersAreSet( false );
+    }
+  }
+
+  /** Exceptions cannot cross the threads; pass them on now. */
+  std::ostringstream errors;
+  bool failed = false;
+  for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    if ( !this->m_MetricErrors[ i ].empty() )
+    {
+      errors << "Metric " << i << ": " << this->m_MetricErrors[ i ] << "\n";
+      failed = true;
+    }
+  }
+  if ( failed )
+  {
+    itkExceptionMacro( << "ERROR: the computation of the metrics failed.\n"
+      << errors.str() );
+  }
+
+} // end ComputeMetrics()
+
+
+/**
+ * ********************* ComputeMetric ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage,TMovingImage>
+::ComputeMetric( unsigned int pos ) const
+{
+  const ParametersType & parameters = *this->m_MetricParameters;
+
+  /** Time the computation. When the metrics are evaluated concurrently,
+   * the CPU time of the process also contains that of the other metrics.
+   * Then the CPU time of this thread and of the threads started by the
+   * metric is measured instead.
+   */
+  const bool concurrent
+    = this->m_UseConcurrentMetricEvaluation && this->m_NumberOfMetrics > 1;
+  const ImageMetricType * imageMetric
+    = dynamic_cast<const ImageMetricType *>( this->m_Metrics[ pos ].GetPointer() );
+  double startThreadCPUTime = 0.0;
+  double startThreadsCPUTime = 0.0;
+  if ( concurrent )
+  {
+    startThreadCPUTime = tmr::Timer::GetThreadCPUTimeSec();
+    startThreadsCPUTime = imageMetric ? imageMetric->GetThreadsCPUTime() : 0.0;
+  }
+  tmr::Timer * timer = this->m_MetricTimers[ pos ];
+  timer->StartTimer();
+
+  /** Compute and store the value and/or derivative. Every metric has its
+   * own derivative, which is passed to the metric directly.
+   */
+  if ( this->m_MetricEvaluation == ComputeValue )
+  {
+    this->m_MetricValues[ pos ] = this->m_Metrics[ pos ]->GetValue( parameters );
+  }
+  else
+  {
+    DerivativeType & metricDerivative = this->m_MetricDerivatives[ pos ];
+    if ( metricDerivative.GetSize() != this->GetNumberOfParameters() )
+    {
+      metricDerivative.SetSize( this->GetNumberOfParameters() );
+    }
+    metricDerivative.Fill( NumericTraits< MeasureType >::Zero );
+
+    if ( this->m_MetricEvaluation == ComputeDerivative )
+    {
+      this->m_Metrics[ pos ]->GetDerivative( parameters, metricDerivative );
+    }
+    else
+    {
+      MeasureType metricValue = NumericTraits< MeasureType >::Zero;
+      this->m_Metrics[ pos ]->GetValueAndDerivative(
+        parameters, metricValue, metricDerivative );
+      this->m_MetricValues[ pos ] = metricValue;
+    }
+    this->m_MetricDerivativesMagnitude[ pos ] = metricDerivative.magnitude();
+  }
+  timer->StopTimer();
+
+  /** Store the wall clock time and the CPU time. */
+  double cpuTime = timer->GetElapsedCPUTimeSec();
+  if ( concurrent )
+  {
+    cpuTime = tmr::Timer::GetThreadCPUTimeSec() - startThreadCPUTime;
+    if ( imageMetric )
+    {
+      cpuTime += imageMetric->GetThreadsCPUTime() - startThreadsCPUTime;
+    }
+  }
+  this->m_MetricComputationTime[ pos ] = static_cast<std::size_t>(
+    Math::Round<double>( timer->GetElapsedClockSec() * 1000.0 ) );
+  this->m_MetricComputationCPUTime[ pos ] = static_cast<std::size_t>(
+    Math::Round<double>( cpuTime * 1000.0 ) );
+
+} // end ComputeMetric()
+
+
+/**
+ * ****************** ComputeMetricThreaderCallback *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+ITK_THREAD_RETURN_TYPE
+CombinationImageToImageMetric<TFixedImage,TMovingImage>
+::ComputeMetricThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  const unsigned int threadID = static_cast<unsigned int>( infoStruct->ThreadID );
+  const unsigned int numberOfThreads
+    = static_cast<unsigned int>( infoStruct->NumberOfThreads );
+  const Self * metric = static_cast< const Self * >( infoStruct->UserData );
+
+  /** The threader may use less threads than metrics. */
+  for ( unsigned int i = threadID; i < metric->m_NumberOfMetrics; i += numberOfThreads )
+  {
+    try
+    {
+      metric->ComputeMetric( i );
+    }
+    catch ( ExceptionObject & excp )
+    {
+      metric->m_MetricErrors[ i ] = excp.GetDescription();
+    }
+    catch ( std::exception & excp )
+    {
+      metric->m_MetricErrors[ i ] = excp.what();
+    }
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ComputeMetricThreaderCallback()
+
+
 /**
  * ********************* GetSelfHessian ****************************
  */
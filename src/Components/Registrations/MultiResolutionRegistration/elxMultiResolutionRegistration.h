@@ -36,6 +36,15 @@ using namespace itk;
    * \parameter NumberOfResolutions: the number of resolutions used. \n
    *    example: <tt>(NumberOfResolutions 4)</tt> \n
    *    The default is 3.
+   * \parameter ComputePyramidLevelsOnDemand: compute the pyramid images of
+   *    a resolution just before that resolution starts, instead of all
+   *    resolutions at the start of the registration. Only one resolution of
+   *    each pyramid is then kept in memory. This works for the
+   *    FixedSmoothingImagePyramid, FixedShrinkingImagePyramid and their
+   *    moving counterparts; the recursive pyramids compute all resolutions
+   *    at the start anyway. \n
+   *    example: <tt>(ComputePyramidLevelsOnDemand "true")</tt> \n
+   *    The default is "false".
    *
    * \ingroup Registrations
    */
@@ -38,6 +38,12 @@ using namespace itk;
     this->m_Configuration->ReadParameter( numberOfResolutions, "NumberOfResolutions", 0 );
     this->SetNumberOfLevels( numberOfResolutions );
 
+    /** Set whether the pyramid images are computed per resolution. */
+    bool computePyramidLevelsOnDemand = false;
+    this->m_Configuration->ReadParameter( computePyramidLevelsOnDemand,
+      "ComputePyramidLevelsOnDemand", 0 );
+    this->SetComputePyramidLevelsOnDemand( computePyramidLevelsOnDemand );
+
     /** Set the FixedImageRegion. */
 
     /** Make sure the fixed image is up to date. */
@@ -15,7 +15,7 @@
 #ifndef __elxBSplineResampleInterpolator_h
 #define __elxBSplineResampleInterpolator_h
 
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkCachedBSplineInterpolateImageFunction.h"
 #include "elxIncludes.h"
 
 namespace elastix
@@ -33,12 +33,26 @@ namespace elastix
   *    the deformed moving image; possible values: (0-5) \n
   *    example: <tt>(FinalBSplineInterpolationOrder 3) </tt> \n
   *    Default: 3.
+  * \parameter CacheBSplineCoefficients: whether to keep the B-spline coefficients of the
+  *    moving image in memory, so that they are not recomputed when the image is resampled
+  *    again, for example after each resolution or for the next parameter file. \n
+  *    example: <tt>(CacheBSplineCoefficients "true")</tt> \n
+  *    Default: "false".
+  * \parameter BSplineCoefficientCacheDirectory: a directory where the B-spline coefficients
+  *    are stored, in files named after a hash of the image and the spline order, so that
+  *    later runs of elastix and transformix on the same image can reuse them. \n
+  *    example: <tt>(BSplineCoefficientCacheDirectory "/tmp/coefficients")</tt> \n
+  *    Default: "", which disables the coefficient files.
   *
   * The transform parameters necessary for transformix, additionally defined by this class, are:
   * \transformparameter FinalBSplineInterpolationOrder: the order of the B-spline used to resample
   *    the deformed moving image; possible values: (0-5) \n
   *    example: <tt>(FinalBSplineInterpolationOrder 3) </tt> \n
   *    Default: 3.
+  * \transformparameter CacheBSplineCoefficients: see above. Only written when "true". \n
+  *    example: <tt>(CacheBSplineCoefficients "true")</tt> \n
+  * \transformparameter BSplineCoefficientCacheDirectory: see above. Only written when set. \n
+  *    example: <tt>(BSplineCoefficientCacheDirectory "/tmp/coefficients")</tt> \n
   *
   * With very large images, memory problems may be avoided by using the BSplineResampleInterpolatorFloat.
   * The differences of the result are generally negligible.
@@ -52,7 +66,7 @@ namespace elastix
   template < class TElastix >
   class BSplineResampleInterpolator :
     public
-    BSplineInterpolateImageFunction<
+    CachedBSplineInterpolateImageFunction<
     ITK_TYPENAME ResampleInterpolatorBase<TElastix>::InputImageType,
     ITK_TYPENAME ResampleInterpolatorBase<TElastix>::CoordRepType,
     double >, //CoefficientType
@@ -62,7 +76,7 @@ namespace elastix
 
     /** Standard ITK-stuff. */
     typedef BSplineResampleInterpolator           Self;
-    typedef BSplineInterpolateImageFunction<
+    typedef CachedBSplineInterpolateImageFunction<
       typename ResampleInterpolatorBase<TElastix>::InputImageType,
       typename ResampleInterpolatorBase<TElastix>::CoordRepType,
       double >                                    Superclass1;
@@ -74,7 +88,7 @@ namespace elastix
     itkNewMacro( Self );
 
     /** Run-time type information (and related methods). */
-    itkTypeMacro( BSplineResampleInterpolator, BSplineInterpolateImageFunction );
+    itkTypeMacro( BSplineResampleInterpolator, CachedBSplineInterpolateImageFunction );
 
     /** Name of this class.
     * Use this name in the parameter file to select this specific resample interpolator. \n
@@ -109,6 +123,7 @@ namespace elastix
 
     /** Execute stuff before the actual registration:
     * \li Set the spline order.
+    * \li Set the coefficient caches.
     */
     virtual void BeforeRegistration( void );
 
@@ -42,6 +42,18 @@ BSplineResampleInterpolator<TElastix>
   /** Set the splineOrder in the superclass. */
   this->SetSplineOrder( splineOrder );
 
+  /** Read whether the coefficients should be kept in memory. */
+  bool cacheCoefficients = false;
+  this->m_Configuration->ReadParameter( cacheCoefficients,
+    "CacheBSplineCoefficients", 0, false );
+  this->SetUseCoefficientCache( cacheCoefficients );
+
+  /** Read the directory of the coefficient files. */
+  std::string cacheDirectory = "";
+  this->m_Configuration->ReadParameter( cacheDirectory,
+    "BSplineCoefficientCacheDirectory", 0, false );
+  this->SetCoefficientCacheDirectory( cacheDirectory.c_str() );
+
 } // end BeforeRegistration()
 
 
@@ -69,6 +81,18 @@ BSplineResampleInterpolator<TElastix>
   /** Set the splineOrder in the superclass. */
   this->SetSplineOrder( splineOrder );
 
+  /** Read whether the coefficients should be kept in memory. */
+  bool cacheCoefficients = false;
+  this->m_Configuration->ReadParameter( cacheCoefficients,
+    "CacheBSplineCoefficients", 0, false );
+  this->SetUseCoefficientCache( cacheCoefficients );
+
+  /** Read the directory of the coefficient files. */
+  std::string cacheDirectory = "";
+  this->m_Configuration->ReadParameter( cacheDirectory,
+    "BSplineCoefficientCacheDirectory", 0, false );
+  this->SetCoefficientCacheDirectory( cacheDirectory.c_str() );
+
 } // end ReadFromFile()
 
 
@@ -90,6 +114,18 @@ BSplineResampleInterpolator<TElastix>
   xout["transpar"] << "(FinalBSplineInterpolationOrder "
     << this->GetSplineOrder() << ")" << std::endl;
 
+  /** Write the coefficient cache settings, so that transformix uses them too. */
+  if ( this->GetUseCoefficientCache() )
+  {
+    xout["transpar"] << "(CacheBSplineCoefficients \"true\")" << std::endl;
+  }
+  const std::string cacheDirectory = this->GetCoefficientCacheDirectory();
+  if ( !cacheDirectory.empty() )
+  {
+    xout["transpar"] << "(BSplineCoefficientCacheDirectory \""
+      << cacheDirectory << "\")" << std::endl;
+  }
+
 } // end WriteToFile()
 
 
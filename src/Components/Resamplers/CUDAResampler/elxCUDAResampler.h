@@ -30,9 +30,20 @@ using namespace itk;
  * a single third order B-spline transform is supported for 3D
  * images together with third order B-spline interpolation.
  *
+ * If elastix is compiled without CUDA, if no CUDA device is found, or if
+ * UseCUDA is false, the same algorithm runs multi-threaded on the CPU,
+ * see itk::CubicBSplineResampleImageFilter. Other configurations are
+ * resampled as by the DefaultResampler.
+ *
  * The parameters used in this class are:
  * \parameter Resampler: Select this resampler as follows:\n
  *    <tt>(Resampler "CUDAResampler")</tt>
+ * \parameter UseCUDA: Whether to resample on the GPU. \n
+ *    example: <tt>(UseCUDA "true")</tt> \n
+ *    The default is "false", which selects the CPU implementation.
+ * \parameter UseFastCUDAKernel: Whether to use the fast or the accurate CUDA kernel. \n
+ *    example: <tt>(UseFastCUDAKernel "true")</tt> \n
+ *    The default is "false".
  *
  * \ingroup Resamplers
  */
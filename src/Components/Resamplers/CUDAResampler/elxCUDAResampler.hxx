@@ -29,14 +29,18 @@ int
 CUDAResampler<TElastix>
 ::BeforeAll( void )
 {
+#ifdef _ELASTIX_USE_CUDA
+  /** Without a CUDA device the CPU implementation of the CUDA kernel is used. */
   int res = Superclass1::CudaResampleImageFilterType::checkExecutionParameters();
   if ( res != 0 )
   {
-    itkExceptionMacro( "ERROR: no valid CUDA devices found!" );
+    xl::xout["warning"] << "WARNING: no valid CUDA devices found!\n"
+      << "  The CUDAResampler uses the CPU implementation of the CUDA kernel."
+      << std::endl;
   }
-  return res;
+#endif
 
-  // implement checks for CUDA cards available.
+  return 0;
 
 } // end BeforeAll()
 
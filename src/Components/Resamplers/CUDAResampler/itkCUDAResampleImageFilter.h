@@ -14,12 +14,10 @@
 #ifndef __itkCUDAResamplerImageFilter_h
 #define __itkCUDAResamplerImageFilter_h
 
-#include "itkImage.h"
-#include "itkResampleImageFilter.h"
-#include "itkAdvancedCombinationTransform.h"
-#include "itkAdvancedBSplineDeformableTransform.h"
-#include "itkBSplineDeformableTransform.h"
+#include "itkCubicBSplineResampleImageFilter.h"
+#ifdef _ELASTIX_USE_CUDA
 #include "cudaResampleImageFilter.cuh"
+#endif
 
 namespace itk
 {
@@ -29,6 +27,12 @@ namespace itk
  *
  * This class is an ITK wrap around a pure CUDA resampling class.
  *
+ * When the GPU can not be used, because elastix was compiled without
+ * CUDA (ELASTIX_USE_CUDA OFF), because no CUDA device is found, or because
+ * UseCuda is off, the CPU implementation of the CUDA kernel in the
+ * superclass is used instead. Configurations that the kernel does not
+ * support are resampled by the ResampleImageFilter.
+ *
  * \warning The implementation is currently very limited: only
  * a single third order B-spline transform is supported for 3D
  * images together with third order B-spline interpolation.
@@ -38,12 +42,12 @@ namespace itk
 
 template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType = float>
 class ITK_EXPORT itkCUDAResampleImageFilter:
-  public ResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+  public CubicBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
 {
 public:
   /** Standard class typedefs. */
   typedef itkCUDAResampleImageFilter                          Self;
-  typedef ResampleImageFilter<
+  typedef CubicBSplineResampleImageFilter<
     TInputImage,TOutputImage,TInterpolatorPrecisionType>      Superclass;
   typedef SmartPointer<Self>                                  Pointer;
   typedef SmartPointer<const Self>                            ConstPointer;
@@ -52,7 +56,7 @@ public:
   itkNewMacro( Self );
 
   /** Run-time type information (and related methods). */
-  itkTypeMacro( itkCUDAResampleImageFilter, ResampleImageFilter );
+  itkTypeMacro( itkCUDAResampleImageFilter, CubicBSplineResampleImageFilter );
 
   /** Typedefs from Superclass. */
   typedef typename Superclass::InputImageType           InputImageType;
@@ -79,17 +83,18 @@ public:
   typedef typename Superclass::ImageBaseType            ImageBaseType;
 
   /** Typedefs. */
-  typedef AdvancedCombinationTransform<
-    TInterpolatorPrecisionType, 3 >                     InternalComboTransformType;
-  typedef AdvancedBSplineDeformableTransform<
-    TInterpolatorPrecisionType, 3, 3 >                  InternalAdvancedBSplineTransformType;
-  typedef typename InternalAdvancedBSplineTransformType::Pointer ValidTransformPointer;
-  typedef typename InternalAdvancedBSplineTransformType::ConstPointer ValidTransformConstPointer;
-  typedef BSplineDeformableTransform<
-    TInterpolatorPrecisionType, 3, 3 >                  InternalBSplineTransformType;
+  typedef typename Superclass::InternalComboTransformType   InternalComboTransformType;
+  typedef typename Superclass::InternalAdvancedBSplineTransformType
+    InternalAdvancedBSplineTransformType;
+  typedef typename Superclass::ValidTransformPointer        ValidTransformPointer;
+  typedef typename Superclass::ValidTransformConstPointer   ValidTransformConstPointer;
+  typedef typename Superclass::InternalBSplineTransformType InternalBSplineTransformType;
+  typedef typename Superclass::WarningReportType            WarningReportType;
+#ifdef _ELASTIX_USE_CUDA
   typedef cuda::CUDAResampleImageFilter<
     typename InternalBSplineTransformType::ParametersValueType,
     typename TInputImage::PixelType, float >            CudaResampleImageFilterType;
+#endif
 
   /** Set whether to use the GPU. */
   itkSetMacro( UseCuda, bool );
@@ -106,42 +111,16 @@ public:
   itkGetConstMacro( UseFastCUDAKernel, bool );
   itkBooleanMacro( UseFastCUDAKernel );
 
-  /** Implements GPU resampling. */
-  virtual void GenerateData( void );
-
-  /** For reporting warnings. */
-  class WarningReportType
-  {
-  public:
-    std::vector<std::string>  m_Warnings;
-
-    void ResetWarningReport( void )
-    {
-      this->m_Warnings.resize( 0 );
-    }
-    std::string GetWarningReportAsString( void ) const
-    {
-      std::string warnings = "\n---------------------------------\n";
-      for ( std::size_t i = 0; i < this->m_Warnings.size(); i++ )
-      {
-        warnings += "itkCUDAResampleImageFilter: " + this->m_Warnings[ i ];
-        warnings += "\n---------------------------------\n";
-      }
-      return warnings;
-    }
-  };
-  //itkGetConstReferenceMacro( WarningReport, WarningReportType );
-  virtual const WarningReportType & GetWarningReport( void ) const
-  {
-    return this->m_WarningReport;
-  }
-
 protected:
   itkCUDAResampleImageFilter();
   ~itkCUDAResampleImageFilter();
 
+  /** Check the configuration as in the superclass, and whether the GPU can be used. */
   virtual void CheckForValidConfiguration( ValidTransformPointer & bSplineTransform );
 
+  /** Implements GPU resampling, or calls the CPU implementation in the superclass. */
+  virtual void GenerateDataForValidConfiguration( ValidTransformPointer bSplineTransform );
+
 private:
 
   /** Private members. */
@@ -149,28 +128,12 @@ private:
   bool      m_UseGPUToCastData;
   bool      m_UseFastCUDAKernel;
 
+#ifdef _ELASTIX_USE_CUDA
   CudaResampleImageFilterType m_CudaResampleImageFilter;
-  WarningReportType           m_WarningReport;
-
-  /** Helper function to check for a valid transform.
-   * Currently, only GPU resampling of 3D images for 3-rd order B-splines is supported,
-   * and only for one transform, so no concatenations.
-   */
-  bool CheckForValidTransform( ValidTransformPointer & bSplineTransform ) const;
-
-  /** Helper function to check for a valid interpolator.
-   * Currently, only GPU resampling using 3-rd order B-spline interpolation is supported.
-   */
-  bool CheckForValidInterpolator( void ) const;
-
-  /** Helper function to check for a valid direction cosines.
-   * Currently, only GPU resampling using identity cosines is supported.
-   */
-  bool CheckForValidDirectionCosines( ValidTransformPointer bSplineTransform ) ;//const;
-  // NOTE: const can be added again in ITK4. It's due to GetInput() being not const-correct.
 
   /** Helper function to copy data. */
   void CopyParameters( ValidTransformPointer bSplineTransform );
+#endif
 
 }; // end class itkCUDAResampleImageFilter
 
@@ -14,9 +14,10 @@
 #ifndef __itkCUDAResamplerImageFilter_txx
 #define __itkCUDAResamplerImageFilter_txx
 
+#ifdef _ELASTIX_USE_CUDA
 #include <cuda_runtime.h>
+#endif
 #include "itkCUDAResampleImageFilter.h"
-#include "itkBSplineInterpolateImageFunction.h"
 
 namespace itk
 {
@@ -44,13 +45,17 @@ template <typename TInputImage, typename TOutputImage, typename TInterpolatorPre
 itkCUDAResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
 ::~itkCUDAResampleImageFilter()
 {
+#ifdef _ELASTIX_USE_CUDA
   if ( this->m_UseCuda )
   {
     this->m_CudaResampleImageFilter.cudaUnInit();
   }
+#endif
 }
 
 
+#ifdef _ELASTIX_USE_CUDA
+
 /**
  * ******************* CopyParameters ***********************
  */
@@ -110,266 +115,92 @@ itkCUDAResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType
 
 } // end CopyParameters()
 
-
-/**
- * ******************* CheckForValidTransform ***********************
- */
-
-template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
-bool
-itkCUDAResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
-::CheckForValidTransform( ValidTransformPointer & bSplineTransform ) const
-{
-  /** First check if the Transform is valid for CUDA. */
-  typename InternalBSplineTransformType::Pointer testPtr1a
-    = const_cast<InternalBSplineTransformType *>(
-    dynamic_cast<const InternalBSplineTransformType *>( this->GetTransform() ) );
-  typename InternalAdvancedBSplineTransformType::Pointer testPtr1b
-    = const_cast<InternalAdvancedBSplineTransformType *>(
-    dynamic_cast<const InternalAdvancedBSplineTransformType *>( this->GetTransform() ) );
-  typename InternalComboTransformType::Pointer testPtr2a
-    = const_cast<InternalComboTransformType *>(
-    dynamic_cast<const InternalComboTransformType *>( this->GetTransform() ) );
-
-  bool transformIsValid = false;
-  if ( testPtr1a )
-  {
-    /** The transform is of type BSplineDeformableTransform. */
-    //transformIsValid = true;
-    transformIsValid = false; // \todo: not yet supported
-    //bSplineTransform = testPtr1a;
-  }
-  else if ( testPtr1b )
-  {
-    /** The transform is of type AdvancedBSplineDeformableTransform. */
-    transformIsValid = true;
-    bSplineTransform = testPtr1b;
-  }
-  else if ( testPtr2a )
-  {
-    // Check that the comboT has no initial transform and that current = B-spline
-    // and that B-spline = 3rd order
-
-    /** The transform is of type AdvancedCombinationTransform. */
-    if ( !testPtr2a->GetInitialTransform() )
-    {
-      typename InternalAdvancedBSplineTransformType::Pointer testPtr2b
-        = dynamic_cast<InternalAdvancedBSplineTransformType *>(
-        testPtr2a->GetCurrentTransform() );
-      if ( testPtr2b )
-      {
-        /** The current transform is of type AdvancedBSplineDeformableTransform. */
-        transformIsValid = true;
-        bSplineTransform = testPtr2b;
-      }
-    }
-  } // end if combo transform
-
-  return transformIsValid;
-
-} // end CheckForValidTransform()
-
-
-/**
- * ******************* CheckForValidInterpolator ***********************
- */
-
-template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
-bool
-itkCUDAResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
-::CheckForValidInterpolator( void ) const
-{
-  /** Check if the interpolator is valid for CUDA. */
-  // ImageType = ElastixType::MovingImageType = InputImageType
-  // CoordRepType = ElastixType::CoordRepType = TInterpolatorPrecisionType
-  // CoefficientType = float or double, does not matter
-  typedef BSplineInterpolateImageFunction<
-    InputImageType, TInterpolatorPrecisionType, float >   ValidInterpolatorFloatType;
-  typedef BSplineInterpolateImageFunction<
-    InputImageType, TInterpolatorPrecisionType, double >  ValidInterpolatorDoubleType;
-
-  typename ValidInterpolatorFloatType::Pointer testPtr1
-    = const_cast<ValidInterpolatorFloatType *>(
-    dynamic_cast<const ValidInterpolatorFloatType *>( this->GetInterpolator() ) );
-  typename ValidInterpolatorDoubleType::Pointer testPtr2
-    = const_cast<ValidInterpolatorDoubleType *>(
-    dynamic_cast<const ValidInterpolatorDoubleType *>( this->GetInterpolator() ) );
-
-  bool interpolatorIsValid = false;
-  if ( testPtr1 )
-  {
-    if ( testPtr1->GetSplineOrder() == 3 )
-    {
-      interpolatorIsValid = true;
-    }
-  }
-  else if ( testPtr2 )
-  {
-    if ( testPtr2->GetSplineOrder() == 3 )
-    {
-      interpolatorIsValid = true;
-    }
-  }
-
-  return interpolatorIsValid;
-
-} // end CheckForValidInterpolator()
+#endif // end #ifdef _ELASTIX_USE_CUDA
 
 
 /**
- * ******************* CheckForValidDirectionCosines ***********************
+ * ******************* CheckForValidConfiguration ***********************
  */
 
 template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
-bool
+void
 itkCUDAResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
-::CheckForValidDirectionCosines( ValidTransformPointer bSplineTransform )// const
+::CheckForValidConfiguration( ValidTransformPointer & bSplineTransform )
 {
-  /** Check if the direction cosines are valid for CUDA. */
-  bool directionCosinesAreValid = true;
-  DirectionType identityDC; identityDC.SetIdentity();
-  typedef typename InternalAdvancedBSplineTransformType::DirectionType GridDirectionType;
-  GridDirectionType identityDCGrid; identityDCGrid.SetIdentity();
-
-  /** Check input image direction cosines. */
-  DirectionType inputImageDC = this->GetInput()->GetDirection();
-  if ( inputImageDC != identityDC )
+  /** Check the transform, the interpolator and the direction cosines. */
+  this->Superclass::CheckForValidConfiguration( bSplineTransform );
+  if ( !this->GetConfigurationIsValid() )
   {
-    directionCosinesAreValid = false;
+    this->m_UseCuda = false;
   }
-
-  /** Check output image direction cosines. */
-  DirectionType outputImageDC = this->GetOutputDirection();
-  if ( outputImageDC != identityDC )
+  if ( !this->m_UseCuda )
   {
-    directionCosinesAreValid = false;
+    return;
   }
 
-  /** Check B-spline grid direction cosines. */
-  GridDirectionType bsplineGridDC = bSplineTransform->GetGridDirection();
-  if ( bsplineGridDC != identityDCGrid )
+#ifdef _ELASTIX_USE_CUDA
+  /** Check if proper CUDA device. */
+  bool cuda_device = ( CudaResampleImageFilterType::checkExecutionParameters() == 0 );
+  if ( !cuda_device )
   {
-    directionCosinesAreValid = false;
-  }
-
-  return directionCosinesAreValid;
-
-} // end CheckForValidDirectionCosines()
-
-
-/**
- * ******************* CheckForValidConfiguration ***********************
- */
-
-template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
-void
-itkCUDAResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
-::CheckForValidConfiguration( ValidTransformPointer & bSplineTransform )// const
-{
-  try // why try/catch?
-  {
-    this->m_WarningReport.ResetWarningReport();
-
-    /** Check for valid transform: 3rd order B-spline, no initial transform, dimension 3. */
-    bool transformIsValid = this->CheckForValidTransform( bSplineTransform );
-    if ( !transformIsValid )
-    {
-      this->m_UseCuda = false;
-      std::string message = "WARNING: No valid transform set:\n"
-        + std::string( "The transform should be 3rd order B-spline, 3D image, no initial transform.\n" )
-        + std::string( "Falling back to CPU implementation." );
-      this->m_WarningReport.m_Warnings.push_back( message );
-    }
-
-    /** Check for valid interpolator: 3rd order B-spline. */
-    bool interpolatorIsValid = this->CheckForValidInterpolator();
-    if ( !interpolatorIsValid )
-    {
-      this->m_UseCuda = false;
-      std::string message = "WARNING: No valid interpolator set:\n"
-        + std::string( "The interpolator should be 3rd order B-spline, 3D image\n" )
-        + std::string( "Falling back to CPU implementation." );
-      this->m_WarningReport.m_Warnings.push_back( message );
-    }
-
-    /** Check for identity cosines. */
-    if ( transformIsValid )
-    {
-      bool directionCosinesAreValid = this->CheckForValidDirectionCosines( bSplineTransform );
-      if ( !directionCosinesAreValid )
-      {
-        this->m_UseCuda = false;
-        std::string message = "WARNING: No valid direction cosines:\n"
-          + std::string( "The input image, output image, and B-spline grid direction should all be the identity.\n" )
-          + std::string( "Falling back to CPU implementation." );
-        this->m_WarningReport.m_Warnings.push_back( message );
-      }
-    }
-
-    /** Check if proper CUDA device. */
-    bool cuda_device = ( CudaResampleImageFilterType::checkExecutionParameters() == 0 );
-    if ( !cuda_device )
-    {
-      this->m_UseCuda = false;
-      std::string message = "WARNING: No valid GPU found:\n"
-        + std::string( "The GPU should support CUDA, and the driver should be up-to-date.\n" )
-        + std::string( "Falling back to CPU implementation." );
-      this->m_WarningReport.m_Warnings.push_back( message );
-    }
-  }
-  catch ( itk::ExceptionObject & excep )
-  {
-    // FIXME: no printing
-    std::cerr << excep << std::endl;
     this->m_UseCuda = false;
+    std::string message = "WARNING: No valid GPU found:\n"
+      + std::string( "The GPU should support CUDA, and the driver should be up-to-date.\n" )
+      + std::string( "Falling back to the CPU implementation of the CUDA kernel." );
+    this->m_WarningReport.m_Warnings.push_back( message );
   }
+#else
+  /** The GPU code is not compiled in. */
+  this->m_UseCuda = false;
+  std::string message = "WARNING: No CUDA support:\n"
+    + std::string( "elastix was compiled with ELASTIX_USE_CUDA OFF.\n" )
+    + std::string( "Falling back to the CPU implementation of the CUDA kernel." );
+  this->m_WarningReport.m_Warnings.push_back( message );
+#endif
 
 } // end CheckForValidConfiguration()
 
 
 /**
- * ******************* GenerateData ***********************
+ * ******************* GenerateDataForValidConfiguration ***********************
  */
 
 template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
 void
 itkCUDAResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
-::GenerateData( void )
+::GenerateDataForValidConfiguration( ValidTransformPointer bSplineTransform )
 {
-  /** If we are not using CUDA simply use the CPU implementation. */
-  if ( !this->m_UseCuda )
+#ifdef _ELASTIX_USE_CUDA
+  /** The CUDA kernel resamples the whole output image at once,
+   * so the pieces of a streamed output are resampled on the CPU.
+   */
+  if ( this->m_UseCuda && this->GetOutput()->GetRequestedRegion()
+    == this->GetOutput()->GetLargestPossibleRegion() )
   {
-    return Superclass::GenerateData();
+    /** Initialize CUDA device. */
+    this->m_CudaResampleImageFilter.cudaInit();
+    this->m_CudaResampleImageFilter.SetCastOnGPU(
+      this->m_UseGPUToCastData );
+    this->m_CudaResampleImageFilter.SetUseFastCUDAKernel(
+      this->m_UseFastCUDAKernel );
+
+    /** Copy the parameters to the GPU. */
+    this->CopyParameters( bSplineTransform );
+
+    /** Allocate host memory for the output and copy/cast the result back to the host. */
+    this->AllocateOutputs();
+    InputPixelType* data = this->GetOutput()->GetBufferPointer();
+
+    /** Run the CUDA resampler. */
+    this->m_CudaResampleImageFilter.GenerateData( data );
+    return;
   }
+#endif
 
-  /** Checks! */
-  ValidTransformPointer tempTransform = NULL;
-  this->CheckForValidConfiguration( tempTransform );
-  
-  /** The GPU can't be used. Use CPU instead. */
-  if ( !this->m_UseCuda )
-  {
-    return this->Superclass::GenerateData();
-  }
-
-  /** Initialize CUDA device. */
-  this->m_CudaResampleImageFilter.cudaInit();
-  this->m_CudaResampleImageFilter.SetCastOnGPU(
-    this->m_UseGPUToCastData );
-  this->m_CudaResampleImageFilter.SetUseFastCUDAKernel(
-    this->m_UseFastCUDAKernel );
-
-  /** Copy the parameters to the GPU. */
-  this->CopyParameters( tempTransform );
-
-  /** Allocate host memory for the output and copy/cast the result back to the host. */
-  this->AllocateOutputs();
-  InputPixelType* data = this->GetOutput()->GetBufferPointer();
-
-  /** Run the CUDA resampler. */
-  this->m_CudaResampleImageFilter.GenerateData( data );
+  /** Use the CPU implementation of the CUDA kernel. */
+  this->Superclass::GenerateDataForValidConfiguration( bSplineTransform );
 
-} // end GenerateData()
+} // end GenerateDataForValidConfiguration()
 
 
 }; // end namespace itk
@@ -15,7 +15,7 @@
 #ifndef __elxMyStandardResampler_h
 #define __elxMyStandardResampler_h
 
-#include "itkResampleImageFilter.h"
+#include "itkTiledResampleImageFilter.h"
 #include "elxIncludes.h"
 
 namespace elastix
@@ -26,23 +26,48 @@ namespace elastix
    * \class MyStandardResampler
    * \brief A resampler based on the itk::ResampleImageFilter.
    *
+   * Optionally the output is processed in tiles, with the
+   * itk::TiledResampleImageFilter, which is faster for large images and
+   * B-spline transforms.
+   *
    * The parameters used in this class are:
    * \parameter Resampler: Select this resampler as follows:\n
    *    <tt>(Resampler "DefaultResampler")</tt>
+   * \parameter ResampleInTiles: Whether to resample the output in tiles, which
+   *    keeps the B-spline coefficients and the moving image voxels in the cache.
+   *    Only used for nonlinear transforms.\n
+   *    example: <tt>(ResampleInTiles "true")</tt>\n
+   *    The default is "false".
+   * \parameter ResampleTileSize: The size of the tiles, in voxels, for each
+   *    dimension. A zero means that the tiles follow the cells of the B-spline
+   *    grid, or have the size of a cell if the grid is not aligned with the
+   *    output image. For other transforms it means 32.\n
+   *    example: <tt>(ResampleTileSize 32 16 16)</tt>\n
+   *    The default is 0 for each dimension.
+   *
+   * The transform parameters used in this class are:
+   * \transformparameter ResampleInTiles: as above.
+   * \transformparameter ResampleTileSize: as above.
    *
    * \ingroup Resamplers
    */
 
   template < class TElastix >
     class MyStandardResampler :
-      public ResamplerBase<TElastix>::ITKBaseType,
+      public TiledResampleImageFilter<
+        ITK_TYPENAME ResamplerBase<TElastix>::InputImageType,
+        ITK_TYPENAME ResamplerBase<TElastix>::OutputImageType,
+        ITK_TYPENAME ResamplerBase<TElastix>::CoordRepType >,
       public ResamplerBase<TElastix>
   {
   public:
 
     /** Standard ITK-stuff. */
     typedef MyStandardResampler                             Self;
-    typedef typename ResamplerBase<TElastix>::ITKBaseType   Superclass1;
+    typedef TiledResampleImageFilter<
+      typename ResamplerBase<TElastix>::InputImageType,
+      typename ResamplerBase<TElastix>::OutputImageType,
+      typename ResamplerBase<TElastix>::CoordRepType >      Superclass1;
     typedef ResamplerBase<TElastix>                         Superclass2;
     typedef SmartPointer<Self>                              Pointer;
     typedef SmartPointer<const Self>                        ConstPointer;
@@ -51,7 +76,7 @@ namespace elastix
     itkNewMacro(Self);
 
     /** Run-time type information (and related methods). */
-    itkTypeMacro( MyStandardResampler, ResampleImageFilter );
+    itkTypeMacro( MyStandardResampler, TiledResampleImageFilter );
 
     /** Name of this class.
      * Use this name in the parameter file to select this specific resampler. \n
@@ -86,7 +111,17 @@ namespace elastix
     typedef typename Superclass2::RegistrationPointer   RegistrationPointer;
     typedef typename Superclass2::ITKBaseType           ITKBaseType;
 
-    /* Nothing to add. In the baseclass already everything is done what should be done. */
+    /** The image dimension. */
+    itkStaticConstMacro( ImageDimension, unsigned int, Superclass2::ImageDimension );
+
+    /** Read the tiling parameters. */
+    virtual void BeforeRegistration( void );
+
+    /** Function to read parameters from a file. */
+    virtual void ReadFromFile( void );
+
+    /** Function to write parameters to a file. */
+    virtual void WriteToFile( void ) const;
 
   protected:
 
@@ -95,6 +130,9 @@ namespace elastix
     /** The destructor. */
     virtual ~MyStandardResampler() {}
 
+    /** Read the ResampleInTiles and ResampleTileSize parameters. */
+    virtual void ReadTilingParameters( void );
+
   private:
 
     /** The private constructor. */
@@ -17,7 +17,101 @@
 
 #include "elxMyStandardResampler.h"
 
-//nothing
+namespace elastix
+{
 
-#endif
+/**
+ * ******************* BeforeRegistration ***********************
+ */
 
+template <class TElastix>
+void
+MyStandardResampler<TElastix>
+::BeforeRegistration( void )
+{
+  this->ReadTilingParameters();
+
+} // end BeforeRegistration()
+
+
+/*
+ * ******************* ReadFromFile  ****************************
+ */
+
+template <class TElastix>
+void
+MyStandardResampler<TElastix>
+::ReadFromFile( void )
+{
+  /** Call ReadFromFile of the ResamplerBase. */
+  this->Superclass2::ReadFromFile();
+
+  /** MyStandardResampler specific. */
+  this->ReadTilingParameters();
+
+} // end ReadFromFile()
+
+
+/**
+ * ************************* WriteToFile ************************
+ */
+
+template <class TElastix>
+void
+MyStandardResampler<TElastix>
+::WriteToFile( void ) const
+{
+  /** Call the WriteToFile from the ResamplerBase. */
+  this->Superclass2::WriteToFile();
+
+  /** Only write the tiling parameters when tiles are used,
+   * so that the default transform parameter file is unchanged.
+   */
+  if ( !this->GetUseTiles() )
+  {
+    return;
+  }
+
+  /** Add some MyStandardResampler specific lines. */
+  xout["transpar"] << std::endl << "// MyStandardResampler specific" << std::endl;
+  xout["transpar"] << "(ResampleInTiles \"true\")" << std::endl;
+  xout["transpar"] << "(ResampleTileSize";
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    xout["transpar"] << " " << this->GetTileSize()[ i ];
+  }
+  xout["transpar"] << ")" << std::endl;
+
+} // end WriteToFile()
+
+
+/**
+ * ******************* ReadTilingParameters ***********************
+ */
+
+template <class TElastix>
+void
+MyStandardResampler<TElastix>
+::ReadTilingParameters( void )
+{
+  /** Resample in tiles? */
+  bool useTiles = false;
+  this->m_Configuration->ReadParameter( useTiles, "ResampleInTiles", 0, false );
+  this->SetUseTiles( useTiles );
+
+  /** The tile size; zero means automatic. */
+  SizeType tileSize;
+  tileSize.Fill( 0 );
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    this->m_Configuration->ReadParameter( tileSize[ i ],
+      "ResampleTileSize", i, false );
+  }
+  this->SetTileSize( tileSize );
+
+} // end ReadTilingParameters()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef __elxMyStandardResampler_hxx
@@ -132,6 +132,21 @@ public:
     WeightsType & weights,
     ParameterIndexArrayType & indices ) const;
 
+  /** Transform a batch of points. The fast path of the superclass assumes a
+   * contiguous support region, so here TransformPoint() is called per point.
+   */
+  virtual void TransformPoints(
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints,
+    const unsigned long numberOfPoints ) const;
+
+  /** Compute the sparse Jacobians of a batch of points, per point. */
+  virtual void GetJacobians(
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const unsigned long numberOfPoints ) const;
+
   /** Compute the spatial Jacobian of the transformation. */
   virtual void GetSpatialJacobian(
     const InputPointType & ipp,
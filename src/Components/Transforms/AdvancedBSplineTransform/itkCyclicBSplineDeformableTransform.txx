@@ -403,6 +403,54 @@ CyclicBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
 }
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+CyclicBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints,
+  const unsigned long numberOfPoints ) const
+{
+  /** The single-point TransformPoint() of the superclass calls the
+   * cyclic version of the full TransformPoint().
+   */
+  for ( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    outputPoints[ i ] = this->Superclass::TransformPoint( inputPoints[ i ] );
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* GetJacobians ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+CyclicBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::GetJacobians(
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const unsigned long numberOfPoints ) const
+{
+  /** The sparse GetJacobian() of the superclass uses the cyclic
+   * ComputeNonZeroJacobianIndices().
+   */
+  for ( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    this->Superclass::GetJacobian( inputPoints[ i ],
+      jacobians[ i ], nonZeroJacobianIndices[ i ] );
+  }
+
+} // end GetJacobians()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -64,6 +64,15 @@ using namespace itk;
    *    CheckNumberOfSamples. \n
    *    example: <tt>(RequiredRatioOfValidSamples 0.1)</tt> \n
    *    The default is 0.25.
+   * \parameter UseMultiThreadingForMetrics: Whether the metric distributes
+   *    its loop over the samples over multiple threads. The number of threads
+   *    is bounded by the -threads command line argument. Only used by metrics
+   *    that support it. Can be given for each resolution or for all
+   *    resolutions at once. The threads share the moving image interpolator
+   *    and the moving mask, which are not thread-safe for all interpolator
+   *    and mask types, so only enable this with a thread-safe configuration. \n
+   *    example: <tt>(UseMultiThreadingForMetrics "true")</tt> \n
+   *    The default is "false".
    *
    * \ingroup Metrics
    * \ingroup ComponentBaseClasses
@@ -119,6 +119,12 @@ MetricBase<TElastix>
     {
       thisAsAdvanced->SetRequiredRatioOfValidSamples( ratio );
     }
+
+    /** Should the metric use multiple threads to loop over the samples? */
+    bool useMultiThreading = false;
+    this->GetConfiguration()->ReadParameter( useMultiThreading,
+      "UseMultiThreadingForMetrics", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetUseMultiThread( useMultiThreading );
   } // end Advanced metric
 
 } // end BeforeEachResolutionBase()
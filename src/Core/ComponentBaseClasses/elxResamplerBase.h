@@ -21,6 +21,10 @@
 #include "elxBaseComponentSE.h"
 #include "itkResampleImageFilter.h"
 #include "elxProgressCommand.h"
+#include "itkImageIOBase.h"
+#include "itkMultiThreader.h"
+
+#include <vector>
 
 namespace elastix
 {
@@ -47,10 +51,11 @@ namespace elastix
    *    The default is "mhd".
    * \parameter ResultImagePixelType: parameter to set the pixel type,
    *    used for resampling the moving image. If this is different from
-   *    the input pixel type you are casting your data. This is done
-   *    using standard c-style casts, so TAKE CARE that you are not
-   *    throwing away data (for example when going from unsigned to signed,
-   *    or from float to char).\n
+   *    the input pixel type you are casting your data. Values outside the
+   *    range of the pixel type are clamped to that range, and for integer
+   *    types the values are rounded to the nearest integer, so TAKE CARE
+   *    that you are not throwing away data (for example when going from
+   *    float to char).\n
    *    Choose from (unsigned) char, (unsigned) short, float, double, etc.\n
    *    example: <tt>(ResultImagePixelType "unsigned short")</tt> \n
    *    The default is "short".
@@ -58,6 +63,30 @@ namespace elastix
    *    of the written image is desired.\n
    *    example: <tt>(CompressResultImage "true")</tt> \n
    *    The default is "false".
+   * \parameter FlattenTransformBeforeResampling: parameter to simplify the transform,
+   *    including its initial transforms, before the result image is resampled.
+   *    Choose from "None", "Linear" and "DeformationField". "Linear" replaces every
+   *    linear part of the chain of transforms, e.g. Euler -> Affine, by a single
+   *    matrix transform. "DeformationField" in addition samples the whole transform
+   *    on a deformation field of the size of the result image, which is then used for
+   *    the resampling. This takes one evaluation of the transform per voxel and
+   *    memory for a vector image, so it is mainly useful to compare the timings.
+   *    The time of the flattening is reported. If the flattened transform does not
+   *    reproduce the original one, the original is used.\n
+   *    example: <tt>(FlattenTransformBeforeResampling "Linear")</tt> \n
+   *    The default is "None".
+   * \parameter MaximumOutputImageMemory: The maximum amount of memory, in megabytes,
+   *    used for the result image, counting both the resampled image and its cast to
+   *    the ResultImagePixelType. If the image does not fit, it is resampled, cast and
+   *    written in slabs. This requires an image format that supports streamed writing,
+   *    such as uncompressed mhd, and is not done when CompressResultImage is "true".\n
+   *    example: <tt>(MaximumOutputImageMemory 1024)</tt> \n
+   *    The default is 0, which means that the image is generated at once.
+   *
+   * In transformix, a list of images can be resampled with the same transform by
+   * the command line option "-inlist", see WriteResultImages(). The FinalBSplineInterpolationOrder
+   * and ResultImagePixelType of the transform parameter file are then the defaults,
+   * which can be overridden per image.
    *
    * \ingroup Resamplers
    * \ingroup ComponentBaseClasses
@@ -155,6 +184,27 @@ namespace elastix
     /** Function to write the result output image to a file. */
     virtual void WriteResultImage( const char * filename );
 
+    /** Function to resample a list of input images with the transform of
+     * the resampler, and write them to the output directory. The list file
+     * contains one image per line:
+     *   inputImage [interpolationOrder] [resultImagePixelType]
+     * Empty lines and lines starting with "//" are skipped. The images are
+     * resampled with a B-spline interpolator of the given order (0 is
+     * nearest neighbour, 1 is linear), and written as
+     * result.<input name>.<ResultImageFormat>. The transform is flattened
+     * once, so a deformation field is shared by all images. Several images
+     * are processed concurrently, each with a part of the threads, which
+     * needs memory for all of them.
+     */
+    virtual void WriteResultImages( const char * inputImageListFileName );
+
+    /** Get the number of slabs in which an image of the size of the
+     * resampler output is generated and written, given the number of bytes
+     * per pixel and the MaximumOutputImageMemory parameter.
+     */
+    virtual unsigned int GetNumberOfStreamDivisions(
+      const unsigned long numberOfBytesPerPixel ) const;
+
   protected:
 
     /** The constructor. */
@@ -165,6 +215,68 @@ namespace elastix
     /** Method that sets the transform, the interpolator and the inputImage. */
     virtual void SetComponents(void);
 
+    /** Replace the transform of the resampler by a flattened version,
+     * according to the FlattenTransformBeforeResampling parameter.
+     * The caller should restore the original transform afterwards.
+     */
+    virtual void FlattenTransform( void );
+
+    /** The process objects of a pipeline, which are kept alive until the
+     * last one, the writer, has been updated.
+     */
+    typedef std::vector< ProcessObject::Pointer >     PipelineType;
+
+    /** Append a caster to the result pixel type and a writer of the image
+     * to the pipeline. The writer writes in slabs if the image does not fit
+     * in the MaximumOutputImageMemory. The image is the end of the
+     * resampling pipeline, which is executed per slab.
+     */
+    template <class TResultPixel>
+    void CreateCastResultImageWriter( OutputImageType * image,
+      const char * filename, const bool doCompression,
+      const TResultPixel & dummy, ImageIOBase * imageIO,
+      PipelineType & pipeline ) const;
+
+    /** Call CreateCastResultImageWriter for the pixel type given by its name,
+     * e.g. "unsigned_short". Throws an exception for unsupported types.
+     */
+    void CreateCastResultImageWriter( OutputImageType * image,
+      const char * filename, const std::string & resultImagePixelType,
+      const bool doCompression, ImageIOBase * imageIO,
+      PipelineType & pipeline ) const;
+
+    /** Cast an image to the result pixel type, given by its name, and write it. */
+    void WriteCastResultImage( OutputImageType * image, const char * filename,
+      const std::string & resultImagePixelType, const bool doCompression ) const;
+
+    /** The settings and the status of one image of WriteResultImages(). */
+    struct BatchImageType
+    {
+      std::string           m_InputFileName;
+      std::string           m_OutputFileName;
+      unsigned int          m_InterpolationOrder;
+      std::string           m_ResultImagePixelType;
+      ImageIOBase::Pointer  m_InputImageIO;
+      ImageIOBase::Pointer  m_OutputImageIO;
+      PipelineType          m_Pipeline;
+      std::string           m_ErrorMessage;
+    };
+
+    /** Create the pipeline that resamples, casts and writes one image of
+     * WriteResultImages(), using the given number of threads. The pipeline
+     * is created before the threads are started, because the object
+     * factories are not thread safe; the threads only update it.
+     */
+    virtual void CreateBatchPipeline( BatchImageType & batchImage,
+      const bool doCompression, const unsigned int numberOfThreads ) const;
+
+    /** The callback of the threads of WriteResultImages(). Thread t
+     * updates the pipelines of the images t, t + T, t + 2T, etc., with T
+     * the number of concurrent images. The user data is the vector of
+     * BatchImageType's.
+     */
+    static ITK_THREAD_RETURN_TYPE BatchThreaderCallback( void * arg );
+
   private:
 
     /** The private constructor. */
@@ -16,11 +16,27 @@
 #define __elxResamplerBase_hxx
 
 #include "elxResamplerBase.h"
-#include "itkImageFileCastWriter.h"
+#include "itkImageFileWriter.h"
+#include "itkImageFileReader.h"
+#include "itkImageIOFactory.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itksys/SystemTools.hxx"
+#include "itkClampCastImageFilter.h"
+#include "vnl/vnl_math.h"
+#include "vcl_cmath.h"
 #include "itkChangeInformationImageFilter.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "itkAdvancedCombinationTransformFlattener.h"
+#include "itkTransformToDeformationFieldSource.h"
+#include "DeformationFieldTransform/itkDeformationFieldInterpolatingTransform.h"
 #include "elxTimer.h"
 
+#include <fstream>
+#include <sstream>
+#include <set>
+
 namespace elastix
 {
 using namespace itk;
@@ -239,6 +255,13 @@ void
 ResamplerBase<TElastix>
 ::WriteResultImage( const char * filename )
 {
+  /** Possibly replace the transform by a flattened one. */
+  typename TransformType::ConstPointer originalTransform
+    = this->GetAsITKBaseType()->GetTransform();
+  this->FlattenTransform();
+  const bool transformIsFlattened
+    = this->GetAsITKBaseType()->GetTransform() != originalTransform.GetPointer();
+
   /** Make sure the resampler is updated. */
   this->GetAsITKBaseType()->Modified();
 
@@ -248,23 +271,6 @@ ResamplerBase<TElastix>
   progressObserver->SetStartString( "  Progress: " );
   progressObserver->SetEndString( "%" );
 
-  /** Do the resampling. */
-  try
-  {
-    this->GetAsITKBaseType()->Update();
-  }
-  catch( itk::ExceptionObject & excp )
-  {
-    /** Add information to the exception. */
-    excp.SetLocation( "ResamplerBase - WriteResultImage()" );
-    std::string err_str = excp.GetDescription();
-    err_str += "\nError occurred while resampling the image.\n";
-    excp.SetDescription( err_str );
-
-    /** Pass the exception to an higher level. */
-    throw excp;
-  }
-
   /** Check if ResampleInterpolator is the RayCastResampleInterpolator */
   typedef itk::AdvancedRayCastInterpolateImageFunction<  InputImageType, 
   CoordRepType > RayCastInterpolatorType;
@@ -295,8 +301,6 @@ ResamplerBase<TElastix>
     doCompression, "CompressResultImage", 0, false );
 
   /** Typedef's for writing the output image. */
-  typedef ImageFileCastWriter< OutputImageType >  WriterType;
-  typedef typename WriterType::Pointer            WriterPointer;
   typedef ChangeInformationImageFilter<
     OutputImageType >                             ChangeInfoFilterType;
 
@@ -310,31 +314,32 @@ ResamplerBase<TElastix>
   infoChanger->SetOutputDirection( originalDirection );
   infoChanger->SetChangeDirection( retdc & !this->GetElastix()->GetUseDirectionCosines() );
   infoChanger->SetInput( this->GetAsITKBaseType()->GetOutput() );
+  infoChanger->ReleaseDataFlagOn();
 
-  /** Create writer. */
-  WriterPointer writer = WriterType::New();
-
-  /** Setup the pipeline. */
-  writer->SetInput( infoChanger->GetOutput() );
-  writer->SetFileName( filename );
-  writer->SetOutputComponentType( resultImagePixelType.c_str() );
-  writer->SetUseCompression( doCompression );
-
-  /** Do the writing. */
+  /** Resample, cast and write the image. The writer drives the pipeline,
+   * so that the resampler is executed once, per slab if streaming.
+   */
   xl::xout["coutonly"] << std::flush;
-  xl::xout["coutonly"] << "\n  Writing image ..." << std::endl;
+  xl::xout["coutonly"] << "\n  Resampling and writing image ..." << std::endl;
   try
   {
-    writer->Update();
+    this->WriteCastResultImage( infoChanger->GetOutput(), filename,
+      resultImagePixelType, doCompression );
   }
   catch( itk::ExceptionObject & excp )
   {
     /** Add information to the exception. */
-    excp.SetLocation( "ResamplerBase - AfterRegistrationBase()" );
+    excp.SetLocation( "ResamplerBase - WriteResultImage()" );
     std::string err_str = excp.GetDescription();
-    err_str += "\nError occurred while writing resampled image.\n";
+    err_str += "\nError occurred while resampling and writing the image.\n";
     excp.SetDescription( err_str );
 
+    /** Restore the original transform. */
+    if ( transformIsFlattened )
+    {
+      this->GetAsITKBaseType()->SetTransform( originalTransform );
+    }
+
     /** Pass the exception to an higher level. */
     throw excp;
   }
@@ -342,9 +347,666 @@ ResamplerBase<TElastix>
   /** Disconnect from the resampler. */
   progressObserver->DisconnectObserver( this->GetAsITKBaseType() );
 
+  /** Restore the original transform. */
+  if ( transformIsFlattened )
+  {
+    this->GetAsITKBaseType()->SetTransform( originalTransform );
+  }
+
 } // end WriteResultImage()
 
 
+/*
+ * ******************* WriteResultImages ********************
+ */
+
+template<class TElastix>
+void
+ResamplerBase<TElastix>
+::WriteResultImages( const char * inputImageListFileName )
+{
+  /** The defaults for the interpolation order and the pixel type. */
+  unsigned int defaultInterpolationOrder = 3;
+  this->m_Configuration->ReadParameter( defaultInterpolationOrder,
+    "FinalBSplineInterpolationOrder", 0, false );
+  std::string defaultResultImagePixelType = "short";
+  this->m_Configuration->ReadParameter( defaultResultImagePixelType,
+    "ResultImagePixelType", 0, false );
+  std::basic_string<char>::size_type pos = defaultResultImagePixelType.find( " " );
+  const std::basic_string<char>::size_type npos = std::basic_string<char>::npos;
+  if ( pos != npos ) defaultResultImagePixelType.replace( pos, 1, "_" );
+
+  std::string resultImageFormat = "mhd";
+  this->m_Configuration->ReadParameter( resultImageFormat,
+    "ResultImageFormat", 0, false );
+  bool doCompression = false;
+  this->m_Configuration->ReadParameter(
+    doCompression, "CompressResultImage", 0, false );
+  const std::string outputDirectory
+    = this->m_Configuration->GetCommandLineArgument( "-out" );
+
+  /** Read the list of images. */
+  std::ifstream listFile( inputImageListFileName );
+  if ( !listFile.is_open() )
+  {
+    itkExceptionMacro( << "ERROR: the list of input images \""
+      << inputImageListFileName << "\" could not be opened." );
+  }
+
+  std::vector< BatchImageType > batchImages;
+  std::set< std::string > outputFileNames;
+  std::string line;
+  unsigned int lineNumber = 0;
+  while ( std::getline( listFile, line ) )
+  {
+    ++lineNumber;
+    std::istringstream lineStream( line );
+    BatchImageType batchImage;
+    if ( !( lineStream >> batchImage.m_InputFileName )
+      || batchImage.m_InputFileName.compare( 0, 2, "//" ) == 0 )
+    {
+      continue;
+    }
+
+    /** The optional interpolation order and pixel type. */
+    batchImage.m_InterpolationOrder = defaultInterpolationOrder;
+    batchImage.m_ResultImagePixelType = defaultResultImagePixelType;
+    std::string order = "";
+    if ( lineStream >> order )
+    {
+      std::istringstream orderStream( order );
+      if ( !( orderStream >> batchImage.m_InterpolationOrder )
+        || batchImage.m_InterpolationOrder > 5 )
+      {
+        itkExceptionMacro( << "ERROR: invalid interpolation order \"" << order
+          << "\" at line " << lineNumber << " of \"" << inputImageListFileName
+          << "\". Choose from 0 to 5." );
+      }
+      lineStream >> batchImage.m_ResultImagePixelType;
+    }
+
+    /** The result is named after the input image, and numbered if that
+     * name was already used.
+     */
+    const std::string baseName = itksys::SystemTools::GetFilenameWithoutExtension(
+      batchImage.m_InputFileName );
+    std::ostringstream makeFileName( "" );
+    makeFileName << outputDirectory << "result." << baseName << "." << resultImageFormat;
+    if ( outputFileNames.count( makeFileName.str() ) > 0 )
+    {
+      makeFileName.str( "" );
+      makeFileName << outputDirectory << "result." << baseName << "."
+        << batchImages.size() << "." << resultImageFormat;
+    }
+    batchImage.m_OutputFileName = makeFileName.str();
+    outputFileNames.insert( batchImage.m_OutputFileName );
+
+    /** The image IO's are created here, because the object factories are
+     * not thread safe.
+     */
+    batchImage.m_InputImageIO = ImageIOFactory::CreateImageIO(
+      batchImage.m_InputFileName.c_str(), ImageIOFactory::ReadMode );
+    batchImage.m_OutputImageIO = ImageIOFactory::CreateImageIO(
+      batchImage.m_OutputFileName.c_str(), ImageIOFactory::WriteMode );
+    if ( batchImage.m_InputImageIO.IsNull() )
+    {
+      itkExceptionMacro( << "ERROR: the input image \""
+        << batchImage.m_InputFileName << "\" could not be read." );
+    }
+    if ( batchImage.m_OutputImageIO.IsNull() )
+    {
+      itkExceptionMacro( << "ERROR: the ResultImageFormat \""
+        << resultImageFormat << "\" is not supported." );
+    }
+
+    batchImages.push_back( batchImage );
+  }
+  listFile.close();
+
+  if ( batchImages.empty() )
+  {
+    xl::xout["warning"] << "WARNING: the list of input images \""
+      << inputImageListFileName << "\" is empty." << std::endl;
+    return;
+  }
+
+  /** Flatten the transform once for all images, so that a deformation
+   * field is computed only once.
+   */
+  typename TransformType::ConstPointer originalTransform
+    = this->GetAsITKBaseType()->GetTransform();
+  this->FlattenTransform();
+
+  /** Divide the threads over the images. */
+  const unsigned int numberOfThreads = this->GetAsITKBaseType()->GetNumberOfThreads();
+  const unsigned int numberOfConcurrentImages = vnl_math_max( 1u,
+    vnl_math_min( numberOfThreads, static_cast<unsigned int>( batchImages.size() ) ) );
+
+  const unsigned int numberOfThreadsPerImage
+    = vnl_math_max( 1u, numberOfThreads / numberOfConcurrentImages );
+
+  /** Create all pipelines before starting the threads. An image of which
+   * the pipeline can not be created is reported as failed.
+   */
+  for ( unsigned int i = 0; i < batchImages.size(); ++i )
+  {
+    try
+    {
+      this->CreateBatchPipeline( batchImages[ i ],
+        doCompression, numberOfThreadsPerImage );
+    }
+    catch ( itk::ExceptionObject & excp )
+    {
+      batchImages[ i ].m_Pipeline.clear();
+      batchImages[ i ].m_ErrorMessage = excp.GetDescription();
+    }
+  }
+
+  elxout << "  Resampling " << batchImages.size() << " images, "
+    << numberOfConcurrentImages << " at a time ..." << std::endl;
+
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads( numberOfConcurrentImages );
+  threader->SetSingleMethod( Self::BatchThreaderCallback, &batchImages );
+  threader->SingleMethodExecute();
+
+  /** Restore the original transform. */
+  this->GetAsITKBaseType()->SetTransform( originalTransform );
+
+  /** Report the results. */
+  unsigned int numberOfFailures = 0;
+  for ( unsigned int i = 0; i < batchImages.size(); ++i )
+  {
+    if ( batchImages[ i ].m_ErrorMessage == "" )
+    {
+      elxout << "  " << batchImages[ i ].m_InputFileName << " -> "
+        << batchImages[ i ].m_OutputFileName << std::endl;
+    }
+    else
+    {
+      xl::xout["error"] << "ERROR: resampling " << batchImages[ i ].m_InputFileName
+        << " failed:\n" << batchImages[ i ].m_ErrorMessage << std::endl;
+      ++numberOfFailures;
+    }
+  }
+
+  if ( numberOfFailures > 0 )
+  {
+    itkExceptionMacro( << "ERROR: " << numberOfFailures << " of the "
+      << batchImages.size() << " images of \"" << inputImageListFileName
+      << "\" could not be resampled." );
+  }
+
+} // end WriteResultImages()
+
+
+/*
+ * ******************* BatchThreaderCallback ********************
+ */
+
+template<class TElastix>
+ITK_THREAD_RETURN_TYPE
+ResamplerBase<TElastix>
+::BatchThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * infoStruct
+    = static_cast<MultiThreader::ThreadInfoStruct *>( arg );
+  const unsigned int threadId = infoStruct->ThreadID;
+  const unsigned int numberOfThreads = infoStruct->NumberOfThreads;
+  std::vector< BatchImageType > & batchImages
+    = *static_cast< std::vector< BatchImageType > * >( infoStruct->UserData );
+
+  for ( unsigned int i = threadId; i < batchImages.size(); i += numberOfThreads )
+  {
+    BatchImageType & batchImage = batchImages[ i ];
+    if ( batchImage.m_Pipeline.empty() )
+    {
+      continue;
+    }
+
+    /** The writer drives the pipeline. */
+    try
+    {
+      batchImage.m_Pipeline.back()->Update();
+    }
+    catch ( itk::ExceptionObject & excp )
+    {
+      batchImage.m_ErrorMessage = excp.GetDescription();
+    }
+    catch ( std::exception & excp )
+    {
+      batchImage.m_ErrorMessage = excp.what();
+    }
+
+    /** Release the memory of this image, before starting the next one. */
+    batchImage.m_Pipeline.clear();
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end BatchThreaderCallback()
+
+
+/*
+ * ******************* CreateBatchPipeline ********************
+ */
+
+template<class TElastix>
+void
+ResamplerBase<TElastix>
+::CreateBatchPipeline( BatchImageType & batchImage,
+  const bool doCompression, const unsigned int numberOfThreads ) const
+{
+  /** Typedef's. */
+  typedef ImageFileReader< InputImageType >           ReaderType;
+  typedef ChangeInformationImageFilter<
+    OutputImageType >                                 ChangeInfoFilterType;
+  typedef NearestNeighborInterpolateImageFunction<
+    InputImageType, CoordRepType >                    NearestNeighborInterpolatorType;
+  typedef LinearInterpolateImageFunction<
+    InputImageType, CoordRepType >                    LinearInterpolatorType;
+  typedef BSplineInterpolateImageFunction<
+    InputImageType, CoordRepType, double >            BSplineInterpolatorType;
+
+  /** Read the image, and ignore its direction cosines as for "-in",
+   * if UseDirectionCosines is false.
+   */
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( batchImage.m_InputFileName.c_str() );
+  reader->SetImageIO( batchImage.m_InputImageIO );
+
+  typename ChangeInfoFilterType::Pointer inputInfoChanger = ChangeInfoFilterType::New();
+  DirectionType identity;
+  identity.SetIdentity();
+  inputInfoChanger->SetOutputDirection( identity );
+  inputInfoChanger->SetChangeDirection( !this->GetElastix()->GetUseDirectionCosines() );
+  inputInfoChanger->SetInput( reader->GetOutput() );
+
+  /** The interpolator of the requested order. Orders 0 and 1 are
+   * equivalent to, but slower than, nearest neighbour and linear interpolation.
+   */
+  typename InterpolatorType::Pointer interpolator;
+  if ( batchImage.m_InterpolationOrder == 0 )
+  {
+    interpolator = NearestNeighborInterpolatorType::New();
+  }
+  else if ( batchImage.m_InterpolationOrder == 1 )
+  {
+    interpolator = LinearInterpolatorType::New();
+  }
+  else
+  {
+    typename BSplineInterpolatorType::Pointer bsplineInterpolator
+      = BSplineInterpolatorType::New();
+    bsplineInterpolator->SetSplineOrder( batchImage.m_InterpolationOrder );
+    interpolator = bsplineInterpolator;
+  }
+
+  /** A resampler with the output geometry and the (shared) transform
+   * of this resampler.
+   */
+  const ITKBaseType * thisResampler = this->GetAsITKBaseType();
+  typename ITKBaseType::Pointer resampler = ITKBaseType::New();
+  resampler->SetInput( inputInfoChanger->GetOutput() );
+  resampler->SetTransform( thisResampler->GetTransform() );
+  resampler->SetInterpolator( interpolator );
+  resampler->SetSize( thisResampler->GetSize() );
+  resampler->SetOutputStartIndex( thisResampler->GetOutputStartIndex() );
+  resampler->SetOutputSpacing( thisResampler->GetOutputSpacing() );
+  resampler->SetOutputOrigin( thisResampler->GetOutputOrigin() );
+  resampler->SetOutputDirection( thisResampler->GetOutputDirection() );
+  resampler->SetDefaultPixelValue( thisResampler->GetDefaultPixelValue() );
+  resampler->SetNumberOfThreads( numberOfThreads );
+
+  /** Possibly change the direction cosines of the result to their original
+   * value, as in WriteResultImage().
+   */
+  typename ChangeInfoFilterType::Pointer infoChanger = ChangeInfoFilterType::New();
+  DirectionType originalDirection;
+  bool retdc = this->GetElastix()->GetOriginalFixedImageDirection( originalDirection );
+  infoChanger->SetOutputDirection( originalDirection );
+  infoChanger->SetChangeDirection( retdc & !this->GetElastix()->GetUseDirectionCosines() );
+  infoChanger->SetInput( resampler->GetOutput() );
+  infoChanger->ReleaseDataFlagOn();
+
+  /** Keep the pipeline alive, and append the caster and the writer. */
+  batchImage.m_Pipeline.clear();
+  batchImage.m_Pipeline.push_back( reader.GetPointer() );
+  batchImage.m_Pipeline.push_back( inputInfoChanger.GetPointer() );
+  batchImage.m_Pipeline.push_back( resampler.GetPointer() );
+  batchImage.m_Pipeline.push_back( infoChanger.GetPointer() );
+  this->CreateCastResultImageWriter( infoChanger->GetOutput(),
+    batchImage.m_OutputFileName.c_str(), batchImage.m_ResultImagePixelType,
+    doCompression, batchImage.m_OutputImageIO, batchImage.m_Pipeline );
+
+} // end CreateBatchPipeline()
+
+
+/*
+ * ******************* CreateCastResultImageWriter ********************
+ */
+
+template<class TElastix>
+template<class TResultPixel>
+void
+ResamplerBase<TElastix>
+::CreateCastResultImageWriter( OutputImageType * image, const char * filename,
+  const bool doCompression, const TResultPixel & itkNotUsed( dummy ),
+  ImageIOBase * imageIO, PipelineType & pipeline ) const
+{
+  /** Typedef's. */
+  typedef Image< TResultPixel,
+    itkGetStaticConstMacro( ImageDimension ) >    ResultImageType;
+  typedef ClampCastImageFilter<
+    OutputImageType, ResultImageType >            CasterType;
+  typedef ImageFileWriter< ResultImageType >      WriterType;
+
+  /** Cast per thread, with clamping and rounding. */
+  typename CasterType::Pointer caster = CasterType::New();
+  caster->SetInput( image );
+  caster->ReleaseDataFlagOn();
+
+  /** Compressed images can not be written in slabs. */
+  unsigned int numberOfStreamDivisions = 1;
+  if ( !doCompression )
+  {
+    numberOfStreamDivisions = this->GetNumberOfStreamDivisions(
+      sizeof( OutputPixelType ) + sizeof( TResultPixel ) );
+  }
+
+  /** The writer. */
+  typename WriterType::Pointer writer = WriterType::New();
+  writer->SetInput( caster->GetOutput() );
+  writer->SetFileName( filename );
+  writer->SetUseCompression( doCompression );
+  writer->SetNumberOfStreamDivisions( numberOfStreamDivisions );
+  if ( imageIO )
+  {
+    writer->SetImageIO( imageIO );
+  }
+
+  pipeline.push_back( caster.GetPointer() );
+  pipeline.push_back( writer.GetPointer() );
+
+} // end CreateCastResultImageWriter()
+
+
+/*
+ * ******************* CreateCastResultImageWriter ********************
+ */
+
+template<class TElastix>
+void
+ResamplerBase<TElastix>
+::CreateCastResultImageWriter( OutputImageType * image, const char * filename,
+  const std::string & resultImagePixelType, const bool doCompression,
+  ImageIOBase * imageIO, PipelineType & pipeline ) const
+{
+  if ( resultImagePixelType == "char" )
+  {
+    this->CreateCastResultImageWriter( image, filename, doCompression,
+      static_cast<char>( 0 ), imageIO, pipeline );
+  }
+  else if ( resultImagePixelType == "unsigned_char" )
+  {
+    this->CreateCastResultImageWriter( image, filename, doCompression,
+      static_cast<unsigned char>( 0 ), imageIO, pipeline );
+  }
+  else if ( resultImagePixelType == "short" )
+  {
+    this->CreateCastResultImageWriter( image, filename, doCompression,
+      static_cast<short>( 0 ), imageIO, pipeline );
+  }
+  else if ( resultImagePixelType == "unsigned_short" )
+  {
+    this->CreateCastResultImageWriter( image, filename, doCompression,
+      static_cast<unsigned short>( 0 ), imageIO, pipeline );
+  }
+  else if ( resultImagePixelType == "int" )
+  {
+    this->CreateCastResultImageWriter( image, filename, doCompression,
+      static_cast<int>( 0 ), imageIO, pipeline );
+  }
+  else if ( resultImagePixelType == "unsigned_int" )
+  {
+    this->CreateCastResultImageWriter( image, filename, doCompression,
+      static_cast<unsigned int>( 0 ), imageIO, pipeline );
+  }
+  else if ( resultImagePixelType == "long" )
+  {
+    this->CreateCastResultImageWriter( image, filename, doCompression,
+      static_cast<long>( 0 ), imageIO, pipeline );
+  }
+  else if ( resultImagePixelType == "unsigned_long" )
+  {
+    this->CreateCastResultImageWriter( image, filename, doCompression,
+      static_cast<unsigned long>( 0 ), imageIO, pipeline );
+  }
+  else if ( resultImagePixelType == "float" )
+  {
+    this->CreateCastResultImageWriter( image, filename, doCompression,
+      static_cast<float>( 0 ), imageIO, pipeline );
+  }
+  else if ( resultImagePixelType == "double" )
+  {
+    this->CreateCastResultImageWriter( image, filename, doCompression,
+      static_cast<double>( 0 ), imageIO, pipeline );
+  }
+  else
+  {
+    itkExceptionMacro( << "ERROR: the ResultImagePixelType \""
+      << resultImagePixelType << "\" is not supported." );
+  }
+
+} // end CreateCastResultImageWriter()
+
+
+/*
+ * ******************* WriteCastResultImage ********************
+ */
+
+template<class TElastix>
+void
+ResamplerBase<TElastix>
+::WriteCastResultImage( OutputImageType * image, const char * filename,
+  const std::string & resultImagePixelType, const bool doCompression ) const
+{
+  PipelineType pipeline;
+  this->CreateCastResultImageWriter( image, filename,
+    resultImagePixelType, doCompression, 0, pipeline );
+  pipeline.back()->Update();
+
+} // end WriteCastResultImage()
+
+
+/*
+ * ******************* GetNumberOfStreamDivisions ********************
+ */
+
+template<class TElastix>
+unsigned int
+ResamplerBase<TElastix>
+::GetNumberOfStreamDivisions( const unsigned long numberOfBytesPerPixel ) const
+{
+  /** Read the memory limit, in megabytes. */
+  unsigned long maximumOutputImageMemory = 0;
+  this->m_Configuration->ReadParameter( maximumOutputImageMemory,
+    "MaximumOutputImageMemory", 0, false );
+  if ( maximumOutputImageMemory == 0 )
+  {
+    return 1;
+  }
+
+  /** The image is split along the last dimension, so the number of
+   * slabs is at most the size in that dimension.
+   */
+  const SizeType size = this->GetAsITKBaseType()->GetSize();
+  double imageMemory = static_cast<double>( numberOfBytesPerPixel );
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    imageMemory *= static_cast<double>( size[ i ] );
+  }
+  const double memoryLimit = static_cast<double>( maximumOutputImageMemory ) * 1024.0 * 1024.0;
+  const unsigned long numberOfDivisions = vnl_math_min(
+    static_cast<unsigned long>( vcl_ceil( imageMemory / memoryLimit ) ),
+    static_cast<unsigned long>( size[ ImageDimension - 1 ] ) );
+
+  return static_cast<unsigned int>( vnl_math_max( 1ul, numberOfDivisions ) );
+
+} // end GetNumberOfStreamDivisions()
+
+
+/*
+ * ******************* FlattenTransform ********************
+ */
+
+template<class TElastix>
+void
+ResamplerBase<TElastix>
+::FlattenTransform( void )
+{
+  /** Read the desired flattening. */
+  std::string flattening = "None";
+  this->m_Configuration->ReadParameter( flattening,
+    "FlattenTransformBeforeResampling", 0, false );
+  if ( flattening != "Linear" && flattening != "DeformationField" )
+  {
+    return;
+  }
+
+  /** The RayCastResampleInterpolator uses its own transform. */
+  typedef AdvancedRayCastInterpolateImageFunction<
+    InputImageType, CoordRepType >                RayCastInterpolatorType;
+  if ( dynamic_cast<const RayCastInterpolatorType *>(
+    this->GetAsITKBaseType()->GetInterpolator() ) != 0 )
+  {
+    return;
+  }
+
+  /** Only the elastix transforms can be flattened. */
+  typedef AdvancedTransform< CoordRepType,
+    ImageDimension, ImageDimension >              AdvancedTransformType;
+  const AdvancedTransformType * transform
+    = dynamic_cast<const AdvancedTransformType *>(
+    this->GetAsITKBaseType()->GetTransform() );
+  if ( transform == 0 )
+  {
+    return;
+  }
+
+  /** Time the flattening. */
+  typedef tmr::Timer TimerType;
+  TimerType::Pointer timer = TimerType::New();
+  timer->StartTimer();
+
+  /** Merge the linear parts of the transform. */
+  typedef AdvancedCombinationTransformFlattener<
+    CoordRepType, ImageDimension >                FlattenerType;
+  typedef typename FlattenerType::LinearTransformType LinearTransformType;
+  typename FlattenerType::Pointer flattener = FlattenerType::New();
+  flattener->SetTransform( transform );
+  flattener->Compute();
+
+  typename TransformType::ConstPointer flattenedTransform = transform;
+  if ( flattener->GetFlattenedTransform() != transform )
+  {
+    /** Check the flattened transform on the corners and the centre of
+     * the output grid, since elastix transforms may override TransformPoint().
+     */
+    const SizeType size = this->GetAsITKBaseType()->GetSize();
+    const IndexType start = this->GetAsITKBaseType()->GetOutputStartIndex();
+    const SpacingType spacing = this->GetAsITKBaseType()->GetOutputSpacing();
+    const OriginPointType origin = this->GetAsITKBaseType()->GetOutputOrigin();
+    const DirectionType direction = this->GetAsITKBaseType()->GetOutputDirection();
+    typename FlattenerType::PointListType points;
+    for ( unsigned int c = 0; c <= ( 1u << ImageDimension ); ++c )
+    {
+      typename FlattenerType::InputPointType point;
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+        point[ i ] = origin[ i ];
+      }
+      for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+        /** The last point is the centre. */
+        double index = start[ j ] + 0.5 * ( size[ j ] - 1.0 );
+        if ( c < ( 1u << ImageDimension ) )
+        {
+          index = ( c >> j ) & 1 ? start[ j ] + size[ j ] - 1.0 : start[ j ];
+        }
+        for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+          point[ i ] += direction[ i ][ j ] * spacing[ j ] * index;
+        }
+      }
+      points.push_back( point );
+    }
+
+    double minimumSpacing = spacing[ 0 ];
+    for ( unsigned int i = 1; i < ImageDimension; ++i )
+    {
+      minimumSpacing = vnl_math_min( minimumSpacing, static_cast<double>( spacing[ i ] ) );
+    }
+    const double difference = flattener->ComputeMaximumDifference( points );
+    if ( difference <= 1e-3 * minimumSpacing )
+    {
+      flattenedTransform = flattener->GetFlattenedTransform();
+      elxout << "  Merged " << flattener->GetNumberOfMergedTransforms()
+        << " linear transforms into matrix transforms." << std::endl;
+    }
+    else
+    {
+      xl::xout["warning"] << "WARNING: the flattened transform differs "
+        << difference << " from the original transform.\n"
+        << "  The original transform is used for resampling." << std::endl;
+    }
+  }
+
+  /** Sample a remaining nonlinear transform on a deformation field. */
+  if ( flattening == "DeformationField"
+    && dynamic_cast<const LinearTransformType *>( flattenedTransform.GetPointer() ) == 0 )
+  {
+    typedef itk::Vector< float, ImageDimension >    DeformationVectorType;
+    typedef itk::Image<
+      DeformationVectorType, ImageDimension >       DeformationFieldType;
+    typedef TransformToDeformationFieldSource<
+      DeformationFieldType, CoordRepType >          DeformationFieldGeneratorType;
+    typedef DeformationFieldInterpolatingTransform<
+      CoordRepType, ImageDimension, float >         DeformationFieldTransformType;
+
+    typename DeformationFieldGeneratorType::Pointer generator
+      = DeformationFieldGeneratorType::New();
+    generator->SetOutputSize( this->GetAsITKBaseType()->GetSize() );
+    generator->SetOutputSpacing( this->GetAsITKBaseType()->GetOutputSpacing() );
+    generator->SetOutputOrigin( this->GetAsITKBaseType()->GetOutputOrigin() );
+    generator->SetOutputIndex( this->GetAsITKBaseType()->GetOutputStartIndex() );
+    generator->SetOutputDirection( this->GetAsITKBaseType()->GetOutputDirection() );
+    generator->SetTransform( flattenedTransform );
+    generator->Update();
+
+    /** The field is sampled at the output voxels, so the default nearest
+     * neighbour interpolation of the field is exact.
+     */
+    typename DeformationFieldTransformType::Pointer fieldTransform
+      = DeformationFieldTransformType::New();
+    fieldTransform->SetDeformationField( generator->GetOutput() );
+    flattenedTransform = fieldTransform.GetPointer();
+    elxout << "  Sampled the transform on a deformation field." << std::endl;
+  }
+
+  /** Report the time of the flattening, to compare with the resampling time. */
+  timer->StopTimer();
+  elxout << std::setprecision( 2 );
+  elxout << "  Flattening the transform took "
+    << timer->GetElapsedClockSec() << " s" << std::endl;
+  elxout << std::setprecision(
+    this->m_Elastix->GetDefaultOutputPrecision() );
+
+  this->GetAsITKBaseType()->SetTransform( flattenedTransform );
+
+} // end FlattenTransform()
+
+
 /*
  * ************************* ReadFromFile ***********************
  */
@@ -474,6 +1136,13 @@ ResamplerBase<TElastix>
   xl::xout["transpar"] << "(CompressResultImage \""
     << doCompression << "\")" << std::endl;
 
+  /** Write the transform flattening. */
+  std::string flattening = "None";
+  this->m_Configuration->ReadParameter(
+    flattening, "FlattenTransformBeforeResampling", 0, false );
+  xl::xout["transpar"] << "(FlattenTransformBeforeResampling \""
+    << flattening << "\")" << std::endl;
+
 } // end WriteToFile()
 
 
@@ -23,9 +23,11 @@
 #include "itkAdvancedCombinationTransform.h"
 #include "elxComponentDatabase.h"
 #include "elxProgressCommand.h"
+#include "itkMultiThreader.h"
 
 #include <fstream>
 #include <iomanip>
+#include <vector>
 
 namespace elastix
 {
@@ -104,6 +106,24 @@ namespace elastix
  * The location is relative to the path from where elastix/transformix is started!\n
  * Default: "NoInitialTransform", which (obviously) means that there is no initial transform
  * to be loaded.
+ * \transformparameter MaximumOutputImageMemory: The maximum amount of memory, in megabytes,
+ * used for the deformation field and the (determinant of the) spatial Jacobian images
+ * that transformix computes with <tt>-def all</tt>, <tt>-jac all</tt> and <tt>-jacmat all</tt>.
+ * If the image does not fit, it is generated and written in slabs. This requires an image
+ * format that supports streamed writing, such as uncompressed mhd; otherwise the whole image
+ * is still generated at once.\n
+ * example <tt>(MaximumOutputImageMemory 1024)</tt>\n
+ * Default: 0, which means that the images are generated at once.
+ * \transformparameter OutputPointsFormat: The format of the points that transformix computes
+ * with <tt>-def inputPoints.txt</tt>. "Text" writes outputpoints.txt, "Binary" writes
+ * outputpoints.bin, and "TextAndBinary" writes both. The binary file is in native byte order
+ * and starts with the 8 characters "elxopp01", the dimension and a flag that is 1 if the
+ * output indices in the moving image are present (both 32 bit unsigned integers), and the
+ * number of points (a 64 bit unsigned integer). It is followed by the arrays InputIndex,
+ * InputPoint, OutputIndexFixed, OutputPoint, Deformation and, if present, OutputIndexMoving,
+ * each stored point after point, with 64 bit integers for the indices and doubles otherwise.\n
+ * example <tt>(OutputPointsFormat "Binary")</tt>\n
+ * Default: "Text".
  *
  * The command line arguments used by this class are:
  * \commandlinearg -t0: optional argument for elastix for specifying an initial transform
@@ -301,6 +321,28 @@ protected:
    */
   void AutomaticScalesEstimation( ScalesType & scales ) const;
 
+  /** Get the number of slabs in which an output image of the size of the
+   * resampler output is generated and written, given the number of bytes
+   * per pixel and the MaximumOutputImageMemory parameter.
+   */
+  unsigned int GetNumberOfStreamDivisions( const unsigned long numberOfBytesPerPixel ) const;
+
+  /** The data shared by the threads that transform the input points. */
+  struct TransformPointsThreadStruct
+  {
+    const ITKBaseType *     m_Transform;
+    const InputPointType *  m_InputPoints;
+    OutputPointType *       m_OutputPoints;
+    unsigned long           m_NumberOfPoints;
+  };
+
+  /** Transform a contiguous range of the input points per thread. */
+  static ITK_THREAD_RETURN_TYPE TransformPointsThreaderCallback( void * arg );
+
+  /** Write an array of values in binary format. */
+  template <class TValue>
+  static void WriteBinaryArray( std::ostream & os, const std::vector< TValue > & values );
+
   /** Member variables. */
   ParametersType *      m_TransformParametersPointer;
   std::string           m_TransformParametersFileName;
@@ -21,6 +21,7 @@
 #include "itkDefaultStaticMeshTraits.h"
 #include "itkTransformixInputPointFileReader.h"
 #include "vnl/vnl_math.h"
+#include "vxl_config.h"
 #include <itksys/SystemTools.hxx>
 #include "itkVector.h"
 #include "itkTransformToDeformationFieldSource.h"
@@ -965,13 +966,27 @@ TransformBase<TElastix>
     }
   }
 
-  /** Apply the transform. */
+  /** Apply the transform. The points are distributed over the threads,
+   * which each transform a contiguous range with the batch TransformPoints().
+   */
   elxout << "  The input points are transformed." << std::endl;
+  if ( nrofpoints > 0 )
+  {
+    TransformPointsThreadStruct threadStruct;
+    threadStruct.m_Transform = this->GetAsITKBaseType();
+    threadStruct.m_InputPoints = &( inputpointvec[ 0 ] );
+    threadStruct.m_OutputPoints = &( outputpointvec[ 0 ] );
+    threadStruct.m_NumberOfPoints = nrofpoints;
+
+    itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+    threader->SetNumberOfThreads( vnl_math_min(
+      static_cast<unsigned int>( threader->GetNumberOfThreads() ), nrofpoints ) );
+    threader->SetSingleMethod( Self::TransformPointsThreaderCallback, &threadStruct );
+    threader->SingleMethodExecute();
+  }
+
   for ( unsigned int j = 0; j < nrofpoints; j++ )
   {
-    /** Call TransformPoint. */
-    outputpointvec[ j ] = this->GetAsITKBaseType()->TransformPoint( inputpointvec[ j ] );
-
     /** Transform back to index in fixed image domain. */
     dummyImage->TransformPhysicalPointToContinuousIndex(
       outputpointvec[ j ], fixedcindex );
@@ -997,73 +1012,200 @@ TransformBase<TElastix>
     deformationvec[ j ].CastFrom( outputpointvec[ j ] - inputpointvec[ j ] );
   }
 
-  /** Create filename and file stream. */
-  std::string outputPointsFileName = this->m_Configuration
+  /** Get the output format. */
+  std::string outputPointsFormat = "Text";
+  this->m_Configuration->ReadParameter( outputPointsFormat,
+    "OutputPointsFormat", 0, false );
+  const bool writeText = outputPointsFormat != "Binary";
+  const bool writeBinary = outputPointsFormat == "Binary"
+    || outputPointsFormat == "TextAndBinary";
+  if ( writeText && outputPointsFormat != "Text"
+    && outputPointsFormat != "TextAndBinary" )
+  {
+    xl::xout["warning"] << "WARNING: unknown OutputPointsFormat \""
+      << outputPointsFormat << "\", the points are written as text." << std::endl;
+  }
+  const std::string outputDirectory = this->m_Configuration
     ->GetCommandLineArgument( "-out" );
-  outputPointsFileName += "outputpoints.txt";
-  std::ofstream outputPointsFile( outputPointsFileName.c_str() );
-  outputPointsFile << std::showpoint << std::fixed;
-  elxout << "  The transformed points are saved in: "
-    <<  outputPointsFileName << std::endl;
-  //\todo do not write opp to log file, but only to outputPointsFile.
-  elxout.AddOutput( "opp", &outputPointsFile );
 
-  /** Print the results. */
-  for ( unsigned int j = 0; j < nrofpoints; j++ )
+  if ( writeText )
   {
-    /** The input index. */
-    elxout << "Point\t" << j << "\t; InputIndex = [ ";
-    for ( unsigned int i = 0; i < FixedImageDimension; i++ )
+    /** Create filename and file stream. The points are not written to the
+     * log file, which for many points would take very long.
+     */
+    std::string outputPointsFileName = outputDirectory + "outputpoints.txt";
+    std::ofstream outputPointsFile( outputPointsFileName.c_str() );
+    outputPointsFile << std::showpoint << std::fixed;
+    elxout << "  The transformed points are saved in: "
+      <<  outputPointsFileName << std::endl;
+
+    /** Print the results. */
+    for ( unsigned int j = 0; j < nrofpoints; j++ )
     {
-      elxout << inputindexvec[ j ][ i ] << " ";
-    }
+      /** The input index. */
+      outputPointsFile << "Point\t" << j << "\t; InputIndex = [ ";
+      for ( unsigned int i = 0; i < FixedImageDimension; i++ )
+      {
+        outputPointsFile << inputindexvec[ j ][ i ] << " ";
+      }
 
-    /** The input point. */
-    elxout << "]\t; InputPoint = [ ";
-    for ( unsigned int i = 0; i < FixedImageDimension; i++ )
+      /** The input point. */
+      outputPointsFile << "]\t; InputPoint = [ ";
+      for ( unsigned int i = 0; i < FixedImageDimension; i++ )
+      {
+        outputPointsFile << inputpointvec[ j ][ i ] << " ";
+      }
+
+      /** The output index in fixed image. */
+      outputPointsFile << "]\t; OutputIndexFixed = [ ";
+      for ( unsigned int i = 0; i < FixedImageDimension; i++ )
+      {
+        outputPointsFile << outputindexfixedvec[ j ][ i ] << " ";
+      }
+
+      /** The output point. */
+      outputPointsFile << "]\t; OutputPoint = [ ";
+      for ( unsigned int i = 0; i < FixedImageDimension; i++ )
+      {
+        outputPointsFile << outputpointvec[ j ][ i ] << " ";
+      }
+
+      /** The output point minus the input point. */
+      outputPointsFile << "]\t; Deformation = [ ";
+      for ( unsigned int i = 0; i < MovingImageDimension; i++ )
+      {
+        outputPointsFile << deformationvec[ j ][ i ] << " ";
+      }
+
+      if ( alsoMovingIndices )
+      {
+        /** The output index in moving image. */
+        outputPointsFile << "]\t; OutputIndexMoving = [ ";
+        for ( unsigned int i = 0; i < MovingImageDimension; i++ )
+        {
+          outputPointsFile << outputindexmovingvec[ j ][ i ] << " ";
+        }
+      }
+
+      outputPointsFile << "]\n";
+    } // end for nrofpoints
+    outputPointsFile.close();
+  }
+
+  if ( writeBinary )
+  {
+    std::string outputPointsFileName = outputDirectory + "outputpoints.bin";
+    std::ofstream outputPointsFile( outputPointsFileName.c_str(),
+      std::ios::out | std::ios::binary );
+    elxout << "  The transformed points are saved in: "
+      <<  outputPointsFileName << std::endl;
+
+    /** The header. */
+    const vxl_uint_32 dimension = FixedImageDimension;
+    const vxl_uint_32 flags = alsoMovingIndices ? 1 : 0;
+    const vxl_uint_64 numberOfPoints = nrofpoints;
+    outputPointsFile.write( "elxopp01", 8 );
+    outputPointsFile.write( reinterpret_cast<const char *>( &dimension ), sizeof( dimension ) );
+    outputPointsFile.write( reinterpret_cast<const char *>( &flags ), sizeof( flags ) );
+    outputPointsFile.write( reinterpret_cast<const char *>( &numberOfPoints ), sizeof( numberOfPoints ) );
+
+    /** The arrays, converted to a fixed width per array. */
+    const unsigned long n = nrofpoints * FixedImageDimension;
+    std::vector< vxl_int_64 > indexBuffer( n );
+    std::vector< double > pointBuffer( n );
+    for ( unsigned int k = 0; k < n; ++k )
     {
-      elxout << inputpointvec[ j ][ i ] << " ";
+      indexBuffer[ k ] = inputindexvec[ k / FixedImageDimension ][ k % FixedImageDimension ];
     }
-
-    /** The output index in fixed image. */
-    elxout << "]\t; OutputIndexFixed = [ ";
-    for ( unsigned int i = 0; i < FixedImageDimension; i++ )
+    Self::WriteBinaryArray( outputPointsFile, indexBuffer );
+    for ( unsigned int k = 0; k < n; ++k )
     {
-      elxout << outputindexfixedvec[ j ][ i ] << " ";
+      pointBuffer[ k ] = inputpointvec[ k / FixedImageDimension ][ k % FixedImageDimension ];
     }
-
-    /** The output point. */
-    elxout << "]\t; OutputPoint = [ ";
-    for ( unsigned int i = 0; i < FixedImageDimension; i++ )
+    Self::WriteBinaryArray( outputPointsFile, pointBuffer );
+    for ( unsigned int k = 0; k < n; ++k )
     {
-      elxout << outputpointvec[ j ][ i ] << " ";
+      indexBuffer[ k ] = outputindexfixedvec[ k / FixedImageDimension ][ k % FixedImageDimension ];
     }
-
-    /** The output point minus the input point. */
-    elxout << "]\t; Deformation = [ ";
-    for ( unsigned int i = 0; i < MovingImageDimension; i++ )
+    Self::WriteBinaryArray( outputPointsFile, indexBuffer );
+    for ( unsigned int k = 0; k < n; ++k )
     {
-      elxout << deformationvec[ j ][ i ] << " ";
+      pointBuffer[ k ] = outputpointvec[ k / FixedImageDimension ][ k % FixedImageDimension ];
     }
-
+    Self::WriteBinaryArray( outputPointsFile, pointBuffer );
+    for ( unsigned int k = 0; k < n; ++k )
+    {
+      pointBuffer[ k ] = deformationvec[ k / FixedImageDimension ][ k % FixedImageDimension ];
+    }
+    Self::WriteBinaryArray( outputPointsFile, pointBuffer );
     if ( alsoMovingIndices )
     {
-      /** The output index in moving image. */
-      elxout << "]\t; OutputIndexMoving = [ ";
-      for ( unsigned int i = 0; i < MovingImageDimension; i++ )
+      for ( unsigned int k = 0; k < n; ++k )
       {
-        elxout << outputindexmovingvec[ j ][ i ] << " ";
+        indexBuffer[ k ] = outputindexmovingvec[ k / FixedImageDimension ][ k % FixedImageDimension ];
       }
+      Self::WriteBinaryArray( outputPointsFile, indexBuffer );
     }
 
-    elxout << "]" << std::endl;
-  } // end for nrofpoints
-
-  /** Stop writing to the output file. */
-  elxout.RemoveOutput( "opp" );
+    if ( !outputPointsFile )
+    {
+      xl::xout["error"] << "ERROR: could not write " << outputPointsFileName << std::endl;
+    }
+    outputPointsFile.close();
+  }
 
 } // end TransformPointsSomePoints()
 
+
+/**
+ * ************** TransformPointsThreaderCallback *********************
+ */
+
+template <class TElastix>
+ITK_THREAD_RETURN_TYPE
+TransformBase<TElastix>
+::TransformPointsThreaderCallback( void * arg )
+{
+  itk::MultiThreader::ThreadInfoStruct * infoStruct
+    = static_cast<itk::MultiThreader::ThreadInfoStruct *>( arg );
+  const unsigned long threadID = infoStruct->ThreadID;
+  const unsigned long numberOfThreads = infoStruct->NumberOfThreads;
+  const TransformPointsThreadStruct * userData
+    = static_cast<TransformPointsThreadStruct *>( infoStruct->UserData );
+
+  /** Thread t takes the points [ t * n / T, ( t + 1 ) * n / T ). */
+  const unsigned long n = userData->m_NumberOfPoints;
+  const unsigned long begin = ( threadID * n ) / numberOfThreads;
+  const unsigned long end = ( ( threadID + 1 ) * n ) / numberOfThreads;
+  if ( end > begin )
+  {
+    userData->m_Transform->TransformPoints( userData->m_InputPoints + begin,
+      userData->m_OutputPoints + begin, end - begin );
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end TransformPointsThreaderCallback()
+
+
+/**
+ * ************** WriteBinaryArray *********************
+ */
+
+template <class TElastix>
+template <class TValue>
+void
+TransformBase<TElastix>
+::WriteBinaryArray( std::ostream & os, const std::vector< TValue > & values )
+{
+  if ( !values.empty() )
+  {
+    os.write( reinterpret_cast<const char *>( &( values[ 0 ] ) ),
+      values.size() * sizeof( TValue ) );
+  }
+
+} // end WriteBinaryArray()
+
 /**
  * ************** TransformPointsSomePointsVTK *********************
  *
@@ -1215,11 +1357,15 @@ void TransformBase<TElastix>
   makeFileName << this->m_Configuration->GetCommandLineArgument( "-out" )
     << "deformationField." << resultImageFormat;
 
-  /** Write outputImage to disk. */
+  /** Write outputImage to disk. Generate the image in slabs if it
+   * would exceed the MaximumOutputImageMemory.
+   */
   typename DeformationFieldWriterType::Pointer defWriter
     = DeformationFieldWriterType::New();
   defWriter->SetInput( infoChanger->GetOutput() );
   defWriter->SetFileName( makeFileName.str().c_str() );
+  defWriter->SetNumberOfStreamDivisions(
+    this->GetNumberOfStreamDivisions( sizeof( VectorPixelType ) ) );
 
   /** Do the writing. */
   elxout << "  Computing and writing the deformation field ..." << std::endl;
@@ -1312,10 +1458,14 @@ TransformBase<TElastix>
   makeFileName << this->m_Configuration->GetCommandLineArgument( "-out" )
     << "spatialJacobian." << resultImageFormat;
 
-  /** Write outputImage to disk. */
+  /** Write outputImage to disk. Generate the image in slabs if it
+   * would exceed the MaximumOutputImageMemory.
+   */
   typename JacobianWriterType::Pointer jacWriter = JacobianWriterType::New();
   jacWriter->SetInput( infoChanger->GetOutput() );
   jacWriter->SetFileName( makeFileName.str().c_str() );
+  jacWriter->SetNumberOfStreamDivisions( this->GetNumberOfStreamDivisions(
+    sizeof( typename JacobianImageType::PixelType ) ) );
 
   /** Do the writing. */
   elxout << "  Computing and writing the spatial Jacobian determinant..." << std::endl;
@@ -1415,10 +1565,14 @@ TransformBase<TElastix>
   makeFileName << this->m_Configuration->GetCommandLineArgument( "-out" )
     << "fullSpatialJacobian." << resultImageFormat;
 
-  /** Write outputImage to disk. */
+  /** Write outputImage to disk. Generate the image in slabs if it
+   * would exceed the MaximumOutputImageMemory.
+   */
   typename JacobianWriterType::Pointer jacWriter = JacobianWriterType::New();
   jacWriter->SetInput( infoChanger->GetOutput() );
   jacWriter->SetFileName( makeFileName.str().c_str() );
+  jacWriter->SetNumberOfStreamDivisions( this->GetNumberOfStreamDivisions(
+    sizeof( typename JacobianImageType::PixelType ) ) );
   /** Hack to change the pixel type to vector. Not necessary for mhd. */
   typename PixelTypeChangeCommandType::Pointer jacStartWriteCommand =
     PixelTypeChangeCommandType::New();
@@ -1448,6 +1602,22 @@ TransformBase<TElastix>
 } // end ComputeSpatialJacobian()
 
 
+/**
+ * ************** GetNumberOfStreamDivisions **********************
+ */
+
+template <class TElastix>
+unsigned int
+TransformBase<TElastix>
+::GetNumberOfStreamDivisions( const unsigned long numberOfBytesPerPixel ) const
+{
+  /** The images have the size of the resampler output. */
+  return this->m_Elastix->GetElxResamplerBase()
+    ->GetNumberOfStreamDivisions( numberOfBytesPerPixel );
+
+} // end GetNumberOfStreamDivisions()
+
+
 /**
  * ************** SetTransformParametersFileName ****************
  */
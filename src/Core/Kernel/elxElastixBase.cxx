@@ -265,6 +265,13 @@ int ElastixBase::BeforeAllTransformixBase( void )
     elxout << "-in       unspecified, so no input image specified" << std::endl;
   }
 
+  /** Print the list of input images for the batch mode, if given. */
+  check = this->GetConfiguration()->GetCommandLineArgument( "-inlist" );
+  if ( check != "" )
+  {
+    elxout << "-inlist   " << check << std::endl;
+  }
+
   /** Check for appearance of "-out". */
   check = this->GetConfiguration()->GetCommandLineArgument( "-out" );
   if ( check == "" )
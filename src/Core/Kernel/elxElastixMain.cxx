@@ -105,6 +105,42 @@ int xoutSetup( const char * logfilename )
 } // end xoutSetup()
 
 
+/**
+ * ********************* xoutSetLogFile *************************
+ *
+ * NB: this function is a global function, not part of the ElastixMain
+ * class!!
+ */
+
+int xoutSetLogFile( const char * logfilename, const bool append )
+{
+  /** Close the current logfile; the outputs of xout keep pointing
+   * to the same stream.
+   */
+  if ( g_LogFileStream.is_open() )
+  {
+    g_LogFileStream.close();
+  }
+  g_LogFileStream.clear();
+
+  /** Open the new logfile. */
+  std::ios_base::openmode mode = std::ios_base::out;
+  if ( append )
+  {
+    mode |= std::ios_base::app;
+  }
+  g_LogFileStream.open( logfilename, mode );
+  if ( !g_LogFileStream.is_open() )
+  {
+    std::cerr << "ERROR: LogFile cannot be opened!" << std::endl;
+    return 1;
+  }
+
+  return 0;
+
+} // end xoutSetLogFile()
+
+
 /**
  * ********************* Constructor ****************************
  */
@@ -48,6 +48,17 @@ using namespace itk;
  */
 extern int xoutSetup( const char * logfilename );
 
+/**
+ * function xoutSetLogFile
+ * Redirect the logfile output of xl::xout, as configured by xoutSetup,
+ * to another file. This is used by the batch mode of elastix, which
+ * writes a logfile per registration. If append is true, the messages
+ * are appended to an existing file.
+ *
+ * It returns 0 if everything went ok. 1 otherwise.
+ */
+extern int xoutSetLogFile( const char * logfilename, const bool append = false );
+
 /**
  * \class ElastixMain
  * \brief A class with all functionality to configure elastix.
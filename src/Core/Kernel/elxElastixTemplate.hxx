@@ -425,6 +425,23 @@ int ElastixTemplate<TFixedImage, TMovingImage>
     elxout << std::setprecision( this->GetDefaultOutputPrecision() );
   }
 
+  /** Resample the list of images given by "-inlist", if any. */
+  const std::string inputImageList
+    = this->GetConfiguration()->GetCommandLineArgument( "-inlist" );
+  if ( inputImageList != "" )
+  {
+    timer->StartTimer();
+    elxout << "Resampling list of images and writing to disk ..." << std::endl;
+
+    this->GetElxResamplerBase()->WriteResultImages( inputImageList.c_str() );
+
+    timer->StopTimer();
+    elxout << std::setprecision( 2 );
+    elxout << "  Resampling the list of images took "
+      << timer->GetElapsedClockSec() << " s" << std::endl;
+    elxout << std::setprecision( this->GetDefaultOutputPrecision() );
+  }
+
   /** Return a value. */
   return 0;
 
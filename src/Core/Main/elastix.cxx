@@ -57,37 +57,25 @@ int main( int argc, char **argv )
 
   /** Some typedef's. */
   typedef elx::ElastixMain                            ElastixMainType;
-  typedef ElastixMainType::Pointer                    ElastixMainPointer;
-  typedef std::vector<ElastixMainPointer>             ElastixMainVectorType;
-  typedef ElastixMainType::ObjectPointer              ObjectPointer;
   typedef ElastixMainType::DataObjectContainerPointer DataObjectContainerPointer;
   typedef ElastixMainType::FlatDirectionCosinesType   FlatDirectionCosinesType;
 
   typedef ElastixMainType::ArgumentMapType            ArgumentMapType;
   typedef ArgumentMapType::value_type                 ArgumentMapEntryType;
 
-  typedef std::pair< std::string, std::string >       ArgPairType;
-  typedef std::queue< ArgPairType >                   ParameterFileListType;
-  typedef ParameterFileListType::value_type           ParameterFileListEntryType;
-
   /** Some declarations and initialisations. */
-  ElastixMainVectorType elastices;
-
-  ObjectPointer transform = 0;
   DataObjectContainerPointer fixedImageContainer = 0;
-  DataObjectContainerPointer movingImageContainer = 0;
   DataObjectContainerPointer fixedMaskContainer = 0;
-  DataObjectContainerPointer movingMaskContainer = 0;
   FlatDirectionCosinesType  fixedImageOriginalDirection;
   int returndummy = 0;
   unsigned long nrOfParameterFiles = 0;
   ArgumentMapType argMap;
-  ParameterFileListType parameterFileList;
+  std::vector< std::string > parameterFileNames;
   bool outFolderPresent = false;
   std::string outFolder = "";
   std::string logFileName = "";
 
-  /** Put command line parameters into parameterFileList. */
+  /** Put command line parameters into parameterFileNames. */
   for ( unsigned int i = 1; static_cast<long>(i) < ( argc - 1 ); i += 2 )
   {
     std::string key( argv[ i ] );
@@ -97,8 +85,7 @@ int main( int argc, char **argv )
     {
       /** Queue the ParameterFileNames. */
       nrOfParameterFiles++;
-      parameterFileList.push(
-        ParameterFileListEntryType( key.c_str(), value.c_str() ) );
+      parameterFileNames.push_back( value );
       /** The different '-p' are stored in the argMap, with
        * keys p(1), p(2), etc. */
       std::ostringstream tempPname("");
@@ -162,8 +149,12 @@ int main( int argc, char **argv )
     }
     else
     {
-      /** Setup xout. */
+      /** Setup xout. A batch worker process has its own logfile. */
       logFileName = outFolder + "elastix.log";
+      if ( argMap.count( "-batchworker" ) )
+      {
+        logFileName = outFolder + "elastix.batch." + argMap[ "-batchworker" ] + ".log";
+      }
       int returndummy2 = elx::xoutSetup( logFileName.c_str() );
       if ( returndummy2 )
       {
@@ -209,9 +200,70 @@ int main( int argc, char **argv )
   /**
    * ********************* START REGISTRATION *********************
    *
-   * Do the (possibly multiple) registration(s).
+   * Do the (possibly multiple) registration(s), or the batch of
+   * registrations given by "-batch".
    */
 
+  if ( argMap.count( "-batch" ) )
+  {
+    std::vector< std::string > commandLine( argv, argv + argc );
+    returndummy = RunBatch( argMap, parameterFileNames, commandLine );
+  }
+  else
+  {
+    returndummy = RunElastix( argMap, parameterFileNames,
+      fixedImageContainer, fixedMaskContainer, fixedImageOriginalDirection );
+  }
+
+  elxout << "-------------------------------------------------------------------------" << "\n" << std::endl;
+
+  /** Stop totaltimer and print it. */
+  totaltimer->StopTimer();
+  elxout << "Total time elapsed: " << totaltimer->PrintElapsedTimeDHMS() << ".\n" << std::endl;
+
+  /**
+   * Make sure all the components that are defined in a Module (.DLL/.so)
+   * are deleted before the modules are closed.
+   */
+  fixedImageContainer = 0;
+  fixedMaskContainer = 0;
+
+  /** Close the modules. */
+  ElastixMainType::UnloadComponents();
+
+  /** Exit and return the error code. */
+  return returndummy;
+
+} // end main
+
+
+/**
+ * *********************** RunElastix ****************************
+ */
+
+int RunElastix( elx::ElastixMain::ArgumentMapType & argMap,
+  const std::vector< std::string > & parameterFileNames,
+  elx::ElastixMain::DataObjectContainerPointer & fixedImageContainer,
+  elx::ElastixMain::DataObjectContainerPointer & fixedMaskContainer,
+  elx::ElastixMain::FlatDirectionCosinesType & fixedImageOriginalDirection )
+{
+  /** Some typedef's. */
+  typedef elx::ElastixMain                            ElastixMainType;
+  typedef ElastixMainType::Pointer                    ElastixMainPointer;
+  typedef std::vector<ElastixMainPointer>             ElastixMainVectorType;
+  typedef ElastixMainType::ObjectPointer              ObjectPointer;
+  typedef ElastixMainType::DataObjectContainerPointer DataObjectContainerPointer;
+  typedef ElastixMainType::ArgumentMapType            ArgumentMapType;
+  typedef ArgumentMapType::value_type                 ArgumentMapEntryType;
+
+  /** Some declarations and initialisations. */
+  const unsigned int nrOfParameterFiles = parameterFileNames.size();
+  ElastixMainVectorType elastices;
+  ObjectPointer transform = 0;
+  DataObjectContainerPointer movingImageContainer = 0;
+  DataObjectContainerPointer movingMaskContainer = 0;
+  int returndummy = 0;
+
   for ( unsigned int i = 0; i < nrOfParameterFiles; i++ )
   {
     /** Create another instance of ElastixMain. */
@@ -235,12 +287,8 @@ int main( int argc, char **argv )
       argMap.erase( "-p" );
     }
 
-    /** Read the first parameterFileName in the queue. */
-    ArgPairType argPair = parameterFileList.front();
-    parameterFileList.pop();
-
-    /** Put it in the ArgumentMap. */
-    argMap.insert( ArgumentMapEntryType( argPair.first, argPair.second ) );
+    /** Put the current parameterFileName in the ArgumentMap. */
+    argMap.insert( ArgumentMapEntryType( "-p", parameterFileNames[ i ] ) );
 
     /** Print a start message. */
     elxout << "-------------------------------------------------------------------------" << "\n" << std::endl;
@@ -287,35 +335,297 @@ int main( int argc, char **argv )
 
   } // end loop over registrations
 
-  elxout << "-------------------------------------------------------------------------" << "\n" << std::endl;
+  return returndummy;
 
-  /** Stop totaltimer and print it. */
-  totaltimer->StopTimer();
-  elxout << "Total time elapsed: " << totaltimer->PrintElapsedTimeDHMS() << ".\n" << std::endl;
+} // end RunElastix()
 
-  /**
-   * Make sure all the components that are defined in a Module (.DLL/.so)
-   * are deleted before the modules are closed.
+
+/**
+ * *********************** RunBatch ****************************
+ */
+
+int RunBatch( const elx::ElastixMain::ArgumentMapType & argMap,
+  const std::vector< std::string > & parameterFileNames,
+  const std::vector< std::string > & commandLine )
+{
+  /** Some typedef's. */
+  typedef elx::ElastixMain                            ElastixMainType;
+  typedef ElastixMainType::DataObjectContainerPointer DataObjectContainerPointer;
+  typedef ElastixMainType::FlatDirectionCosinesType   FlatDirectionCosinesType;
+  typedef ElastixMainType::ArgumentMapType            ArgumentMapType;
+  typedef ArgumentMapType::const_iterator             ArgumentMapConstIteratorType;
+
+  /** Get the command line arguments of the batch mode. */
+  ArgumentMapConstIteratorType it = argMap.find( "-batch" );
+  const std::string batchFileName = it->second;
+  const std::string outFolder = argMap.find( "-out" )->second;
+  unsigned int numberOfJobs = 1;
+  it = argMap.find( "-jobs" );
+  if ( it != argMap.end() )
+  {
+    numberOfJobs = static_cast<unsigned int>(
+      vnl_math_max( 1, atoi( it->second.c_str() ) ) );
+  }
+  int worker = -1;
+  it = argMap.find( "-batchworker" );
+  if ( it != argMap.end() )
+  {
+    worker = atoi( it->second.c_str() );
+  }
+
+  /** Read the registrations. */
+  std::vector< BatchRegistrationType > registrations;
+  if ( ReadBatchFile( batchFileName, registrations ) != 0 )
+  {
+    return 1;
+  }
+  if ( registrations.empty() )
+  {
+    xl::xout["error"] << "ERROR: the batch file \"" << batchFileName
+      << "\" contains no registrations." << std::endl;
+    return 1;
+  }
+  numberOfJobs = vnl_math_min( numberOfJobs,
+    static_cast<unsigned int>( registrations.size() ) );
+
+  /** Registrations with the same fixed image and mask are done one after
+   * the other, by the same process, so that their fixed image is read once.
+   */
+  std::vector< unsigned int > order( registrations.size() );
+  for ( unsigned int i = 0; i < order.size(); ++i )
+  {
+    order[ i ] = i;
+  }
+  std::stable_sort( order.begin(), order.end(),
+    BatchRegistrationCompare( registrations ) );
+
+  /** The main process starts the worker processes, which each do a part
+   * of the registrations, and waits for them.
    */
+  if ( worker < 0 && numberOfJobs > 1 )
+  {
+    elxout << "Running " << registrations.size() << " registrations of \""
+      << batchFileName << "\" in " << numberOfJobs << " processes.\n"
+      << "The log of each process is written to "
+      << outFolder << "elastix.batch.<process>.log." << std::endl;
+
+    /** The threads are divided over the processes, unless specified. */
+    std::string threadsPerJob = "";
+    if ( argMap.count( "-threads" ) == 0 )
+    {
+      std::ostringstream makeThreads( "" );
+      makeThreads << vnl_math_max( 1u, static_cast<unsigned int>(
+        itk::MultiThreader::GetGlobalDefaultNumberOfThreads() ) / numberOfJobs );
+      threadsPerJob = makeThreads.str();
+    }
 
-  for ( unsigned int i = 0; i < nrOfParameterFiles; i++ )
+    std::vector< itksysProcess * > processes( numberOfJobs );
+    for ( unsigned int k = 0; k < numberOfJobs; ++k )
+    {
+      std::ostringstream makeWorker( "" );
+      makeWorker << k;
+      std::vector< std::string > workerCommandLine( commandLine );
+      workerCommandLine.push_back( "-batchworker" );
+      workerCommandLine.push_back( makeWorker.str() );
+      if ( threadsPerJob != "" )
+      {
+        workerCommandLine.push_back( "-threads" );
+        workerCommandLine.push_back( threadsPerJob );
+      }
+      std::vector< const char * > command;
+      for ( unsigned int i = 0; i < workerCommandLine.size(); ++i )
+      {
+        command.push_back( workerCommandLine[ i ].c_str() );
+      }
+      command.push_back( 0 );
+
+      processes[ k ] = itksysProcess_New();
+      itksysProcess_SetCommand( processes[ k ], &command[ 0 ] );
+      itksysProcess_SetPipeShared( processes[ k ], itksysProcess_Pipe_STDOUT, 1 );
+      itksysProcess_SetPipeShared( processes[ k ], itksysProcess_Pipe_STDERR, 1 );
+      itksysProcess_Execute( processes[ k ] );
+    }
+
+    int returndummy = 0;
+    for ( unsigned int k = 0; k < numberOfJobs; ++k )
+    {
+      itksysProcess_WaitForExit( processes[ k ], 0 );
+      const int state = itksysProcess_GetState( processes[ k ] );
+      if ( state != itksysProcess_State_Exited
+        || itksysProcess_GetExitValue( processes[ k ] ) != 0 )
+      {
+        xl::xout["error"] << "ERROR: batch process " << k << " failed. See "
+          << outFolder << "elastix.batch." << k << ".log." << std::endl;
+        returndummy = 1;
+      }
+      itksysProcess_Delete( processes[ k ] );
+    }
+
+    return returndummy;
+
+  } // end if main process
+
+  /** The registrations of this process. */
+  const unsigned int process = worker < 0 ? 0 : static_cast<unsigned int>( worker );
+  const unsigned int first = process * registrations.size() / numberOfJobs;
+  const unsigned int last = ( process + 1 ) * registrations.size() / numberOfJobs;
+  const std::string logFileName = worker < 0
+    ? outFolder + "elastix.log"
+    : outFolder + "elastix.batch." + argMap.find( "-batchworker" )->second + ".log";
+
+  /** The fixed image and mask of the previous registration. */
+  DataObjectContainerPointer fixedImageContainer = 0;
+  DataObjectContainerPointer fixedMaskContainer = 0;
+  FlatDirectionCosinesType fixedImageOriginalDirection;
+  std::string cachedFixedImage = "";
+  std::string cachedFixedMask = "";
+
+  unsigned int numberOfFailures = 0;
+  for ( unsigned int j = first; j < last; ++j )
   {
-    elastices[ i ] = 0;
+    const BatchRegistrationType & registration = registrations[ order[ j ] ];
+
+    /** Reuse the fixed image and mask of the previous registration. */
+    const bool reuseFixedImage = fixedImageContainer.IsNotNull()
+      && registration.m_FixedImage == cachedFixedImage
+      && registration.m_FixedMask == cachedFixedMask;
+    if ( !reuseFixedImage )
+    {
+      fixedImageContainer = 0;
+      fixedMaskContainer = 0;
+      fixedImageOriginalDirection.clear();
+    }
+
+    /** The command line arguments of this registration. The images and
+     * masks come from the batch file only, so that a "-" in the batch file
+     * does not fall back to a mask given on the command line.
+     */
+    ArgumentMapType registrationArgMap( argMap );
+    registrationArgMap[ "-f" ] = registration.m_FixedImage;
+    registrationArgMap[ "-m" ] = registration.m_MovingImage;
+    registrationArgMap[ "-out" ] = registration.m_OutputFolder;
+    if ( registration.m_FixedMask != "" )
+    {
+      registrationArgMap[ "-fMask" ] = registration.m_FixedMask;
+    }
+    else
+    {
+      registrationArgMap.erase( "-fMask" );
+    }
+    if ( registration.m_MovingMask != "" )
+    {
+      registrationArgMap[ "-mMask" ] = registration.m_MovingMask;
+    }
+    else
+    {
+      registrationArgMap.erase( "-mMask" );
+    }
+
+    elxout << "Registration " << order[ j ] << ": " << registration.m_MovingImage
+      << " to " << registration.m_FixedImage << ( reuseFixedImage ? " (fixed image reused)" : "" )
+      << ", output in " << registration.m_OutputFolder << std::endl;
+
+    /** Run the registration, with its own logfile. */
+    tmr::Timer::Pointer timer = tmr::Timer::New();
+    timer->StartTimer();
+    int returndummy = 1;
+    if ( itksys::SystemTools::MakeDirectory( registration.m_OutputFolder.c_str() )
+      && elx::xoutSetLogFile( ( registration.m_OutputFolder + "elastix.log" ).c_str() ) == 0 )
+    {
+      returndummy = RunElastix( registrationArgMap, parameterFileNames,
+        fixedImageContainer, fixedMaskContainer, fixedImageOriginalDirection );
+    }
+    timer->StopTimer();
+    elx::xoutSetLogFile( logFileName.c_str(), true );
+
+    if ( returndummy == 0 )
+    {
+      cachedFixedImage = registration.m_FixedImage;
+      cachedFixedMask = registration.m_FixedMask;
+      elxout << "  finished in " << timer->PrintElapsedTimeDHMS() << "." << std::endl;
+    }
+    else
+    {
+      fixedImageContainer = 0;
+      fixedMaskContainer = 0;
+      xl::xout["error"] << "  ERROR: registration " << order[ j ] << " failed. See "
+        << registration.m_OutputFolder << "elastix.log." << std::endl;
+      ++numberOfFailures;
+    }
   }
 
-  transform = 0;
-  fixedImageContainer = 0;
-  movingImageContainer = 0;
-  fixedMaskContainer = 0;
-  movingMaskContainer = 0;
+  elxout << ( last - first - numberOfFailures ) << " of the " << ( last - first )
+    << " registrations finished successfully." << std::endl;
 
-  /** Close the modules. */
-  ElastixMainType::UnloadComponents();
+  return numberOfFailures > 0 ? 1 : 0;
 
-  /** Exit and return the error code. */
-  return returndummy;
+} // end RunBatch()
 
-} // end main
+
+/**
+ * *********************** ReadBatchFile ****************************
+ */
+
+int ReadBatchFile( const std::string & batchFileName,
+  std::vector< BatchRegistrationType > & registrations )
+{
+  std::ifstream batchFile( batchFileName.c_str() );
+  if ( !batchFile.is_open() )
+  {
+    xl::xout["error"] << "ERROR: the batch file \"" << batchFileName
+      << "\" could not be opened." << std::endl;
+    return 1;
+  }
+
+  std::string line;
+  unsigned int lineNumber = 0;
+  while ( std::getline( batchFile, line ) )
+  {
+    ++lineNumber;
+    std::istringstream lineStream( line );
+    std::vector< std::string > words;
+    std::string word;
+    while ( lineStream >> word )
+    {
+      words.push_back( word );
+    }
+
+    /** Skip empty lines and comments. */
+    if ( words.empty() || words[ 0 ].compare( 0, 2, "//" ) == 0 )
+    {
+      continue;
+    }
+    if ( words.size() < 3 || words.size() > 5 )
+    {
+      xl::xout["error"] << "ERROR: line " << lineNumber << " of the batch file \""
+        << batchFileName << "\" should contain: fixedImage movingImage "
+        << "outputDirectory [fixedMask] [movingMask]" << std::endl;
+      return 1;
+    }
+
+    BatchRegistrationType registration;
+    registration.m_FixedImage = words[ 0 ];
+    registration.m_MovingImage = words[ 1 ];
+    registration.m_OutputFolder = words[ 2 ];
+    if ( registration.m_OutputFolder.find_last_of( "/" )
+      != registration.m_OutputFolder.size() - 1 )
+    {
+      registration.m_OutputFolder.append( "/" );
+    }
+    if ( words.size() > 3 && words[ 3 ] != "-" )
+    {
+      registration.m_FixedMask = words[ 3 ];
+    }
+    if ( words.size() > 4 && words[ 4 ] != "-" )
+    {
+      registration.m_MovingMask = words[ 4 ];
+    }
+    registrations.push_back( registration );
+  }
+
+  return 0;
+
+} // end ReadBatchFile()
 
 
 /**
@@ -350,7 +660,16 @@ void PrintHelp( void )
   std::cout << "-t0       parameter file for initial transform\n";
   std::cout << "-priority set the process priority to high, abovenormal, normal (default),\n"
                "          belownormal, or idle (Windows only option)\n";
-  std::cout << "-threads  set the maximum number of threads of elastix\n"
+  std::cout << "-threads  set the maximum number of threads of elastix\n";
+  std::cout << "-batch    text file with a batch of registrations, one per line, as:\n"
+               "          fixedImage movingImage outputDirectory [fixedMask] [movingMask]\n"
+               "          where \"-\" means no mask. Instead of -f, -m, etc., each registration\n"
+               "          is done with its own images and output directory, which is created\n"
+               "          if needed, and with the same parameter files. A fixed image that is\n"
+               "          used by several registrations is read once per process. The options\n"
+               "          -f, -m, -fMask and -mMask are ignored.\n";
+  std::cout << "-jobs     the number of processes that run the batch concurrently;\n"
+               "          by default the threads are divided over them. Default: 1.\n"
     << std::endl;
 
   /** The parameter file.*/
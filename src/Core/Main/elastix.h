@@ -24,10 +24,16 @@
 #include <string>
 #include <vector>
 #include <queue>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
 #include "itkObject.h"
 #include "itkDataObject.h"
+#include "itkMultiThreader.h"
+#include "vnl/vnl_math.h"
 #include <itksys/SystemTools.hxx>
 #include <itksys/SystemInformation.hxx>
+#include <itksys/Process.h>
 
 #include "elxTimer.h"
 
@@ -43,5 +49,67 @@
    */
   void PrintHelp(void);
 
+  /** Run elastix with each of the parameter files in turn, for the images
+   * given in the argument map. The fixed image and mask containers, and
+   * the original direction of the fixed image, are used if not empty, and
+   * contain those of the last registration on return.
+   */
+  int RunElastix( elx::ElastixMain::ArgumentMapType & argMap,
+    const std::vector< std::string > & parameterFileNames,
+    elx::ElastixMain::DataObjectContainerPointer & fixedImageContainer,
+    elx::ElastixMain::DataObjectContainerPointer & fixedMaskContainer,
+    elx::ElastixMain::FlatDirectionCosinesType & fixedImageOriginalDirection );
+
+  /** Run the batch of registrations given by "-batch".
+   *
+   * \commandlinearg -batch: optional argument for elastix, a text file with one
+   *    registration per line: fixedImage movingImage outputDirectory [fixedMask] [movingMask].
+   *    A "-" means no mask. The command line arguments "-f", "-m", "-fMask" and "-mMask"
+   *    are ignored. All registrations use the parameter files given by "-p".
+   *    Registrations with the same fixed image and mask are run after each other, and
+   *    reuse the fixed image and mask that were read for the first of them.
+   *    The components are loaded once. Each registration has its own elastix.log. \n
+   *    example: <tt>elastix -batch cohort.txt -p par.txt -out batchdir -jobs 4</tt> \n
+   * \commandlinearg -jobs: optional argument for elastix, the number of processes that
+   *    run the batch concurrently. Unless "-threads" is given, the threads are divided
+   *    over the processes. The default is 1. \n
+   */
+  int RunBatch( const elx::ElastixMain::ArgumentMapType & argMap,
+    const std::vector< std::string > & parameterFileNames,
+    const std::vector< std::string > & commandLine );
+
+  /** One registration of the batch mode. */
+  struct BatchRegistrationType
+  {
+    std::string m_FixedImage;
+    std::string m_MovingImage;
+    std::string m_OutputFolder;
+    std::string m_FixedMask;
+    std::string m_MovingMask;
+  };
+
+  /** Read the registrations of the batch mode. Returns 0 if everything went ok. */
+  int ReadBatchFile( const std::string & batchFileName,
+    std::vector< BatchRegistrationType > & registrations );
+
+  /** Orders the registrations by fixed image and fixed mask. */
+  class BatchRegistrationCompare
+  {
+  public:
+    BatchRegistrationCompare( const std::vector< BatchRegistrationType > & registrations )
+      : m_Registrations( registrations ) {}
+
+    bool operator()( const unsigned int i, const unsigned int j ) const
+    {
+      const BatchRegistrationType & a = this->m_Registrations[ i ];
+      const BatchRegistrationType & b = this->m_Registrations[ j ];
+      return a.m_FixedImage < b.m_FixedImage
+        || ( a.m_FixedImage == b.m_FixedImage && a.m_FixedMask < b.m_FixedMask );
+    }
+
+  private:
+    const std::vector< BatchRegistrationType > & m_Registrations;
+  };
+
 #endif
 
@@ -119,13 +119,14 @@ int main( int argc, char **argv )
 
   /** Check that at least one of the following options is given. */
   if ( argMap.count( "-in" ) == 0
+    && argMap.count( "-inlist" ) == 0
     && argMap.count( "-ipp" ) == 0
     && argMap.count( "-def" ) == 0
     && argMap.count( "-jac" ) == 0
     && argMap.count( "-jacmat" ) == 0 )
   {
     std::cerr << "ERROR: At least one of the CommandLine options \"-in\",	"
-      << "\"-def\", \"-jac\", or \"-jacmat\" should be given!" << std::endl;
+      << "\"-inlist\", \"-def\", \"-jac\", or \"-jacmat\" should be given!" << std::endl;
     returndummy |= -1;
   }
 
@@ -250,6 +251,13 @@ void PrintHelp( void )
   /** Optional arguments. */
   std::cout << "Optional extra commands:\n";
   std::cout << "-in       input image to deform\n";
+  std::cout << "-inlist   text file with a list of input images to deform, one per line,\n"
+               "          as: inputImage [interpolationOrder] [resultImagePixelType]\n"
+               "          e.g. \"label.mhd 0 unsigned_char\". The defaults are given by the\n"
+               "          FinalBSplineInterpolationOrder and ResultImagePixelType of the\n"
+               "          transform-parameter file. The images are written to the output\n"
+               "          directory as result.<input name>.<ResultImageFormat>, and are\n"
+               "          processed concurrently, with the same transform.\n";
   std::cout << "-def      file containing input-image points; the point are transformed\n"
                "          according to the specified transform-parameter file\n";
   std::cout << "          use \"-def all\" to transform all points from the input-image, which\n"
@@ -261,7 +269,7 @@ void PrintHelp( void )
   std::cout << "-priority set the process priority to high, abovenormal, normal (default),\n"
                "          belownormal, or idle (Windows only option)\n";
   std::cout << "-threads  set the maximum number of threads of transformix\n";
-  std::cout << "\nAt least one of the options \"-in\", \"-def\", \"-jac\", or \"-jacmat\" should be given.\n"
+  std::cout << "\nAt least one of the options \"-in\", \"-inlist\", \"-def\", \"-jac\", or \"-jacmat\" should be given.\n"
     << std::endl;
 
   /** The parameter file. */
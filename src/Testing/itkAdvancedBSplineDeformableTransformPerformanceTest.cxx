@@ -0,0 +1,292 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkBSplineDeformableTransform.h" // original ITK
+#include "vnl/vnl_math.h"
+#include "vnl/vnl_random.h"
+
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+/** Helper function to print the throughput of a timed loop. */
+void PrintThroughput( const std::string & name,
+  const unsigned long numberOfPoints, const clock_t elapsedClocks )
+{
+  const double seconds = static_cast<double>( elapsedClocks ) / CLOCKS_PER_SEC;
+  std::cerr << std::setw( 40 ) << std::left << name;
+  if ( seconds > 0.0 )
+  {
+    std::cerr << std::setw( 14 ) << std::right << std::fixed << std::setprecision( 0 )
+      << numberOfPoints / seconds << " points/s" << std::endl;
+  }
+  else
+  {
+    std::cerr << "  too fast to measure" << std::endl;
+  }
+
+} // end PrintThroughput()
+
+//-------------------------------------------------------------------------------------
+
+// Measure the throughput of TransformPoint() and the sparse GetJacobian()
+// of the advanced B-spline transform, with the original ITK B-spline
+// transform as a reference.
+int main( int argc, char *argv[] )
+{
+  /** Some basic type definitions.
+   * NOTE: the grid is the same as in itkAdvancedBSplineDeformableTransformTest,
+   * so that the same parameter file can be used.
+   */
+  const unsigned int Dimension = 3;
+  const unsigned int SplineOrder = 3;
+  typedef double CoordinateRepresentationType;
+
+  /** The number of points to transform. Distinguish between
+   * Debug and Release mode.
+   */
+#ifndef NDEBUG
+  const unsigned long N = static_cast<unsigned long>( 1e3 );
+#else
+  const unsigned long N = static_cast<unsigned long>( 1e6 );
+#endif
+  std::cerr << "N = " << N << std::endl;
+
+  /** Check. */
+  if ( argc != 2 )
+  {
+    std::cerr << "ERROR: You should specify a text file with the B-spline "
+      << "transformation parameters." << std::endl;
+    return 1;
+  }
+
+  /** Other typedefs. */
+  typedef itk::AdvancedBSplineDeformableTransform<
+    CoordinateRepresentationType, Dimension, SplineOrder >    TransformType;
+  typedef itk::BSplineDeformableTransform<
+    CoordinateRepresentationType, Dimension, SplineOrder >    ITKTransformType;
+  typedef TransformType::JacobianType                   JacobianType;
+  typedef TransformType::NonZeroJacobianIndicesType     NonZeroJacobianIndicesType;
+  typedef TransformType::InputPointType                 InputPointType;
+  typedef TransformType::OutputPointType                OutputPointType;
+  typedef TransformType::ParametersType                 ParametersType;
+  typedef itk::Image< CoordinateRepresentationType,
+    Dimension >                                         InputImageType;
+  typedef InputImageType::RegionType    RegionType;
+  typedef InputImageType::SizeType      SizeType;
+  typedef InputImageType::IndexType     IndexType;
+  typedef InputImageType::SpacingType   SpacingType;
+  typedef InputImageType::PointType     OriginType;
+  typedef InputImageType::DirectionType DirectionType;
+
+  /** Create the transforms. */
+  TransformType::Pointer transform = TransformType::New();
+  ITKTransformType::Pointer transformITK = ITKTransformType::New();
+
+  /** Setup the B-spline transform. */
+  SizeType gridSize;
+  gridSize[ 0 ] = 44; gridSize[ 1 ] = 43; gridSize[ 2 ] = 35;
+  IndexType gridIndex;
+  gridIndex.Fill( 0 );
+  RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  gridRegion.SetIndex( gridIndex );
+  SpacingType gridSpacing;
+  gridSpacing[ 0 ] = 10.7832773148;
+  gridSpacing[ 1 ] = 11.2116431394;
+  gridSpacing[ 2 ] = 11.8648235177;
+  OriginType gridOrigin;
+  gridOrigin[ 0 ] = -237.6759555555;
+  gridOrigin[ 1 ] = -239.9488431747;
+  gridOrigin[ 2 ] = -344.2315805162;
+  DirectionType gridDirection;
+  gridDirection.SetIdentity();
+
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridDirection( gridDirection );
+
+  transformITK->SetGridOrigin( gridOrigin );
+  transformITK->SetGridSpacing( gridSpacing );
+  transformITK->SetGridRegion( gridRegion );
+  transformITK->SetGridDirection( gridDirection );
+
+  /** Now read the parameters. */
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  std::ifstream input( argv[ 1 ] );
+  if ( input.is_open() )
+  {
+    for ( unsigned int i = 0; i < parameters.GetSize(); ++i )
+    {
+      input >> parameters[ i ];
+    }
+  }
+  else
+  {
+    std::cerr << "ERROR: could not open the text file containing the "
+      << "parameter values." << std::endl;
+    return 1;
+  }
+  transform->SetParameters( parameters );
+  transformITK->SetParameters( parameters );
+
+  /** Generate random points, such that the support region lies
+   * within the grid. A fixed seed makes the runs comparable.
+   */
+  vnl_random randomGenerator( 12345 );
+  std::vector< InputPointType > points( N );
+  for ( unsigned long i = 0; i < N; ++i )
+  {
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const double cindex = randomGenerator.drand64(
+        2.0, static_cast<double>( gridSize[ d ] ) - 3.0 );
+      points[ i ][ d ] = gridOrigin[ d ] + cindex * gridSpacing[ d ];
+    }
+  }
+
+  /** Declare variables. */
+  OutputPointType outputPoint;
+  const unsigned long nonzji = transform->GetNumberOfNonZeroJacobianIndices();
+  JacobianType jacobian( Dimension, nonzji );
+  NonZeroJacobianIndicesType nzji( nonzji );
+
+  /** Time the original ITK TransformPoint(), as a reference. */
+  double checksumITK = 0.0;
+  clock_t startClock = clock();
+  for ( unsigned long i = 0; i < N; ++i )
+  {
+    outputPoint = transformITK->TransformPoint( points[ i ] );
+    checksumITK += outputPoint[ 0 ];
+  }
+  PrintThroughput( "ITK TransformPoint():", N, clock() - startClock );
+
+  /** Time the advanced TransformPoint(). */
+  double checksum = 0.0;
+  startClock = clock();
+  for ( unsigned long i = 0; i < N; ++i )
+  {
+    outputPoint = transform->TransformPoint( points[ i ] );
+    checksum += outputPoint[ 0 ];
+  }
+  PrintThroughput( "Advanced TransformPoint():", N, clock() - startClock );
+
+  /** Time the advanced sparse GetJacobian(). */
+  startClock = clock();
+  for ( unsigned long i = 0; i < N; ++i )
+  {
+    transform->GetJacobian( points[ i ], jacobian, nzji );
+  }
+  PrintThroughput( "Advanced sparse GetJacobian():", N, clock() - startClock );
+
+  /** Time TransformPoint() and GetJacobian() together, as in the metrics. */
+  startClock = clock();
+  for ( unsigned long i = 0; i < N; ++i )
+  {
+    outputPoint = transform->TransformPoint( points[ i ] );
+    transform->GetJacobian( points[ i ], jacobian, nzji );
+  }
+  PrintThroughput( "Advanced TransformPoint+GetJacobian:", N, clock() - startClock );
+
+  /** Time the batch functions, in batches as used by the metrics. */
+  const unsigned long batchSize = 64;
+  std::vector< OutputPointType > outputPoints( batchSize );
+  std::vector< JacobianType > jacobians( batchSize );
+  std::vector< NonZeroJacobianIndicesType > nzjis( batchSize );
+  double checksumBatch = 0.0;
+  startClock = clock();
+  for ( unsigned long first = 0; first < N; first += batchSize )
+  {
+    const unsigned long n = vnl_math_min( batchSize, N - first );
+    transform->TransformPoints( &points[ first ], &outputPoints[ 0 ], n );
+    checksumBatch += outputPoints[ 0 ][ 0 ];
+  }
+  PrintThroughput( "Advanced TransformPoints():", N, clock() - startClock );
+
+  startClock = clock();
+  for ( unsigned long first = 0; first < N; first += batchSize )
+  {
+    const unsigned long n = vnl_math_min( batchSize, N - first );
+    transform->GetJacobians( &points[ first ], &jacobians[ 0 ], &nzjis[ 0 ], n );
+  }
+  PrintThroughput( "Advanced GetJacobians():", N, clock() - startClock );
+
+  /** The timed loops should have computed the same points. */
+  if ( vcl_abs( checksum - checksumITK ) > 1e-6 * vcl_abs( checksumITK ) + 1e-6 )
+  {
+    std::cerr << "ERROR: checksum of the advanced TransformPoint() ("
+      << checksum << ") differs from the ITK checksum ("
+      << checksumITK << ")." << std::endl;
+    return 1;
+  }
+
+  /** The batch functions should give exactly the same results. */
+  const unsigned long numberOfCheckedBatches
+    = vnl_math_min( N, 1000ul ) / batchSize;
+  for ( unsigned long b = 0; b < numberOfCheckedBatches; ++b )
+  {
+    const InputPointType * batchPoints = &points[ b * batchSize ];
+    transform->TransformPoints( batchPoints, &outputPoints[ 0 ], batchSize );
+    transform->GetJacobians( batchPoints, &jacobians[ 0 ], &nzjis[ 0 ], batchSize );
+    for ( unsigned long i = 0; i < batchSize; ++i )
+    {
+      transform->GetJacobian( batchPoints[ i ], jacobian, nzji );
+      if ( outputPoints[ i ] != transform->TransformPoint( batchPoints[ i ] )
+        || jacobians[ i ] != jacobian || nzjis[ i ] != nzji )
+      {
+        std::cerr << "ERROR: Advanced B-spline batch functions returning "
+          << "a different result for point " << batchPoints[ i ] << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  /** Check the results on a subset of the points. */
+  const unsigned long numberOfCheckedPoints = vnl_math_min( N, 1000ul );
+  for ( unsigned long i = 0; i < numberOfCheckedPoints; ++i )
+  {
+    const OutputPointType opp1 = transform->TransformPoint( points[ i ] );
+    const OutputPointType opp2 = transformITK->TransformPoint( points[ i ] );
+    if ( opp1.EuclideanDistanceTo( opp2 ) > 1e-10 )
+    {
+      std::cerr << "ERROR: Advanced B-spline TransformPoint() returning "
+        << "incorrect result for point " << points[ i ] << std::endl;
+      return 1;
+    }
+
+    /** Compare the sparse Jacobian with the full ITK Jacobian. */
+    transform->GetJacobian( points[ i ], jacobian, nzji );
+    const JacobianType & jacobianITK = transformITK->GetJacobian( points[ i ] );
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      for ( unsigned long mu = 0; mu < nonzji; ++mu )
+      {
+        if ( vcl_abs( jacobian( d, mu ) - jacobianITK( d, nzji[ mu ] ) ) > 1e-10 )
+        {
+          std::cerr << "ERROR: Advanced B-spline sparse GetJacobian() returning "
+            << "incorrect result for point " << points[ i ] << std::endl;
+          return 1;
+        }
+      }
+    }
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
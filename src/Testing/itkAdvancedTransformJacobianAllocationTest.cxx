@@ -0,0 +1,421 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "itkImageFullSampler.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkSimpleFastMutexLock.h"
+#include "vnl/vnl_math.h"
+#include "vnl/vnl_random.h"
+
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+/** Count the calls to the global operator new, but only when asked to.
+ * The array versions of operator new forward to this one.
+ */
+namespace
+{
+  bool                      countAllocations = false;
+  unsigned long             numberOfAllocations = 0;
+  itk::SimpleFastMutexLock  allocationMutex;
+
+  void StartCounting( void )
+  {
+    numberOfAllocations = 0;
+    countAllocations = true;
+  }
+
+  unsigned long StopCounting( void )
+  {
+    countAllocations = false;
+    return numberOfAllocations;
+  }
+}
+
+void * operator new( std::size_t size ) throw ( std::bad_alloc )
+{
+  if ( countAllocations )
+  {
+    allocationMutex.Lock();
+    ++numberOfAllocations;
+    allocationMutex.Unlock();
+  }
+
+  void * p = std::malloc( size > 0 ? size : 1 );
+  if ( !p )
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete( void * p ) throw ()
+{
+  std::free( p );
+}
+
+//-------------------------------------------------------------------------------------
+
+/** Some basic type definitions. */
+const unsigned int Dimension = 3;
+const unsigned int SplineOrder = 3;
+typedef double CoordinateRepresentationType;
+
+typedef itk::AdvancedTransform<
+  CoordinateRepresentationType, Dimension, Dimension >    AdvancedTransformType;
+typedef itk::AdvancedBSplineDeformableTransform<
+  CoordinateRepresentationType, Dimension, SplineOrder >  BSplineTransformType;
+typedef itk::AdvancedMatrixOffsetTransformBase<
+  CoordinateRepresentationType, Dimension, Dimension >    AffineTransformType;
+typedef itk::AdvancedCombinationTransform<
+  CoordinateRepresentationType, Dimension >               CombinationTransformType;
+
+typedef AdvancedTransformType::ParametersType                 ParametersType;
+typedef AdvancedTransformType::InputPointType                 InputPointType;
+typedef AdvancedTransformType::JacobianType                   JacobianType;
+typedef AdvancedTransformType::NonZeroJacobianIndicesType     NonZeroJacobianIndicesType;
+typedef AdvancedTransformType::SpatialJacobianType            SpatialJacobianType;
+typedef AdvancedTransformType::SpatialHessianType             SpatialHessianType;
+typedef AdvancedTransformType::JacobianOfSpatialJacobianType  JacobianOfSpatialJacobianType;
+typedef AdvancedTransformType::JacobianOfSpatialHessianType   JacobianOfSpatialHessianType;
+typedef AdvancedTransformType::JacobianWorkspaceType          JacobianWorkspaceType;
+
+typedef itk::Image< float, Dimension >                        ImageType;
+
+//-------------------------------------------------------------------------------------
+
+/** Create a B-spline transform on the domain [0, 60]^3 with small random
+ * coefficients. The parameters should outlive the transform.
+ */
+BSplineTransformType::Pointer CreateBSplineTransform(
+  ParametersType & parameters, vnl_random & randomGenerator )
+{
+  BSplineTransformType::Pointer transform = BSplineTransformType::New();
+
+  BSplineTransformType::RegionType gridRegion;
+  BSplineTransformType::SizeType gridSize;
+  gridSize.Fill( 10 );
+  BSplineTransformType::IndexType gridIndex;
+  gridIndex.Fill( 0 );
+  gridRegion.SetSize( gridSize );
+  gridRegion.SetIndex( gridIndex );
+  BSplineTransformType::SpacingType gridSpacing;
+  gridSpacing.Fill( 10.0 );
+  BSplineTransformType::OriginType gridOrigin;
+  gridOrigin.Fill( -20.0 );
+
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+
+  parameters.SetSize( transform->GetNumberOfParameters() );
+  for ( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = randomGenerator.drand64( -1.0, 1.0 );
+  }
+  transform->SetParameters( parameters );
+
+  return transform;
+
+} // end CreateBSplineTransform()
+
+//-------------------------------------------------------------------------------------
+
+/** Evaluate all sparse derivative functions of the transform in a loop over
+ * the points, with containers that are created outside the loop, and
+ * return the number of heap allocations in the loop. The overloads of
+ * GetJacobianOfSpatialHessian() without a workspace are only included
+ * on request, because a combination transform with an initial transform
+ * that has a nonzero spatial Hessian needs a temporary workspace for them.
+ */
+unsigned long CountAllocationsInJacobianLoop(
+  const AdvancedTransformType * transform,
+  const std::vector< InputPointType > & points,
+  const bool withoutWorkspace )
+{
+  JacobianType jacobian;
+  NonZeroJacobianIndicesType nzji;
+  SpatialJacobianType sj;
+  SpatialHessianType sh;
+  JacobianOfSpatialJacobianType jsj;
+  JacobianOfSpatialHessianType jsh;
+  JacobianWorkspaceType workspace;
+
+  /** Warm up: the containers get their size in the first call. */
+  transform->GetJacobian( points[ 0 ], jacobian, nzji );
+  transform->GetJacobianOfSpatialJacobian( points[ 0 ], sj, jsj, nzji );
+  transform->GetJacobianOfSpatialHessian( points[ 0 ], sh, jsh, nzji, workspace );
+
+  StartCounting();
+  for ( unsigned long i = 0; i < points.size(); ++i )
+  {
+    transform->TransformPoint( points[ i ] );
+    transform->GetJacobian( points[ i ], jacobian, nzji );
+    transform->GetSpatialJacobian( points[ i ], sj );
+    transform->GetSpatialHessian( points[ i ], sh );
+    transform->GetJacobianOfSpatialJacobian( points[ i ], jsj, nzji );
+    transform->GetJacobianOfSpatialJacobian( points[ i ], sj, jsj, nzji );
+    transform->GetJacobianOfSpatialHessian( points[ i ], jsh, nzji, workspace );
+    transform->GetJacobianOfSpatialHessian( points[ i ], sh, jsh, nzji, workspace );
+    if ( withoutWorkspace )
+    {
+      transform->GetJacobianOfSpatialHessian( points[ i ], jsh, nzji );
+      transform->GetJacobianOfSpatialHessian( points[ i ], sh, jsh, nzji );
+    }
+  }
+  return StopCounting();
+
+} // end CountAllocationsInJacobianLoop()
+
+//-------------------------------------------------------------------------------------
+
+/** Create an image on the domain [0, 60]^3 with a smooth pattern. */
+ImageType::Pointer CreateImage( const unsigned int size, const double shift )
+{
+  ImageType::Pointer image = ImageType::New();
+  ImageType::RegionType region;
+  ImageType::SizeType imageSize;
+  imageSize.Fill( size );
+  region.SetSize( imageSize );
+  ImageType::SpacingType spacing;
+  spacing.Fill( 60.0 / static_cast<double>( size ) );
+  image->SetRegions( region );
+  image->SetSpacing( spacing );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, region );
+  ImageType::PointType point;
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    image->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+    it.Set( static_cast<float>( 100.0 * vcl_sin( ( point[ 0 ] + shift ) / 10.0 )
+      * vcl_cos( point[ 1 ] / 12.0 ) + point[ 2 ] ) );
+  }
+
+  return image;
+
+} // end CreateImage()
+
+//-------------------------------------------------------------------------------------
+
+/** Return the number of heap allocations in a call to GetValueAndDerivative
+ * of the mean squares metric, with images of the given size.
+ */
+unsigned long CountAllocationsInMetric(
+  const unsigned int imageSize, const unsigned int numberOfThreads )
+{
+  typedef itk::AdvancedMeanSquaresImageToImageMetric<
+    ImageType, ImageType >                                  MetricType;
+  typedef itk::ImageFullSampler< ImageType >                SamplerType;
+  typedef itk::LinearInterpolateImageFunction<
+    ImageType, CoordinateRepresentationType >               InterpolatorType;
+
+  ImageType::Pointer fixedImage = CreateImage( imageSize, 0.0 );
+  ImageType::Pointer movingImage = CreateImage( imageSize, 2.0 );
+
+  vnl_random randomGenerator( 12345 );
+  ParametersType bsplineParameters;
+  BSplineTransformType::Pointer bsplineTransform
+    = CreateBSplineTransform( bsplineParameters, randomGenerator );
+  CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( bsplineTransform );
+
+  MetricType::Pointer metric = MetricType::New();
+  metric->SetFixedImage( fixedImage );
+  metric->SetMovingImage( movingImage );
+  metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( InterpolatorType::New() );
+  metric->SetImageSampler( SamplerType::New() );
+  metric->SetNumberOfThreads( numberOfThreads );
+  metric->Initialize();
+
+  ParametersType parameters = bsplineParameters;
+  MetricType::MeasureType value;
+  MetricType::DerivativeType derivative;
+
+  /** Warm up: the sampler and the per-thread variables are initialized. */
+  metric->GetValueAndDerivative( parameters, value, derivative );
+  metric->GetValueAndDerivative( parameters, value, derivative );
+
+  StartCounting();
+  metric->GetValueAndDerivative( parameters, value, derivative );
+  return StopCounting();
+
+} // end CountAllocationsInMetric()
+
+//-------------------------------------------------------------------------------------
+
+// Check that the sparse derivative functions of the advanced transforms,
+// and the sample loop of a metric, do not allocate heap memory per point.
+int main( int argc, char *argv[] )
+{
+  /** Generate random points, such that the support region lies
+   * within the grid of the B-spline transforms.
+   */
+  const unsigned long N = 1000;
+  vnl_random randomGenerator( 12345 );
+  std::vector< InputPointType > points( N );
+  for ( unsigned long i = 0; i < N; ++i )
+  {
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      points[ i ][ d ] = randomGenerator.drand64( 5.0, 45.0 );
+    }
+  }
+
+  /** Create the transforms: a B-spline transform, a composition of an
+   * identity and a B-spline transform, a composition of an affine and a
+   * B-spline transform, and a composition of two B-spline transforms. The
+   * last one has an initial transform with a nonzero spatial Hessian, for
+   * which the workspace is used.
+   */
+  ParametersType bsplineParameters0, bsplineParameters1;
+  BSplineTransformType::Pointer bsplineTransform
+    = CreateBSplineTransform( bsplineParameters1, randomGenerator );
+  BSplineTransformType::Pointer initialBSplineTransform
+    = CreateBSplineTransform( bsplineParameters0, randomGenerator );
+
+  AffineTransformType::Pointer identityTransform = AffineTransformType::New();
+  AffineTransformType::Pointer affineTransform = AffineTransformType::New();
+  ParametersType affineParameters( affineTransform->GetNumberOfParameters() );
+  for ( unsigned int i = 0; i < affineParameters.GetSize(); ++i )
+  {
+    affineParameters[ i ] = randomGenerator.drand64( -0.05, 0.05 );
+  }
+  for ( unsigned int d = 0; d < Dimension; ++d )
+  {
+    affineParameters[ d * ( Dimension + 1 ) ] += 1.0;
+  }
+  affineTransform->SetParameters( affineParameters );
+
+  CombinationTransformType::Pointer identityBSpline = CombinationTransformType::New();
+  identityBSpline->SetUseComposition( true );
+  identityBSpline->SetInitialTransform( identityTransform );
+  identityBSpline->SetCurrentTransform( bsplineTransform );
+
+  CombinationTransformType::Pointer affineBSpline = CombinationTransformType::New();
+  affineBSpline->SetUseComposition( true );
+  affineBSpline->SetInitialTransform( affineTransform );
+  affineBSpline->SetCurrentTransform( bsplineTransform );
+
+  CombinationTransformType::Pointer bsplineBSpline = CombinationTransformType::New();
+  bsplineBSpline->SetUseComposition( true );
+  bsplineBSpline->SetInitialTransform( initialBSplineTransform );
+  bsplineBSpline->SetCurrentTransform( bsplineTransform );
+
+  /** Check that the in-place composition gives the same result as the
+   * B-spline transform itself, when the initial transform is the identity.
+   */
+  JacobianOfSpatialJacobianType jsj0, jsj1;
+  JacobianOfSpatialHessianType jsh0, jsh1;
+  NonZeroJacobianIndicesType nzji0, nzji1;
+  JacobianWorkspaceType workspace;
+  for ( unsigned long i = 0; i < 100; ++i )
+  {
+    bsplineTransform->GetJacobianOfSpatialJacobian( points[ i ], jsj0, nzji0 );
+    identityBSpline->GetJacobianOfSpatialJacobian( points[ i ], jsj1, nzji1 );
+    bsplineTransform->GetJacobianOfSpatialHessian( points[ i ], jsh0, nzji0 );
+    identityBSpline->GetJacobianOfSpatialHessian( points[ i ], jsh1, nzji1, workspace );
+    if ( nzji0 != nzji1 || jsj0.size() != jsj1.size() || jsh0.size() != jsh1.size() )
+    {
+      std::cerr << "ERROR: composition with the identity returns a different "
+        << "number of nonzero Jacobian indices." << std::endl;
+      return 1;
+    }
+    for ( unsigned int mu = 0; mu < jsj0.size(); ++mu )
+    {
+      double diff = ( jsj0[ mu ].GetVnlMatrix() - jsj1[ mu ].GetVnlMatrix() ).frobenius_norm();
+      for ( unsigned int d = 0; d < Dimension; ++d )
+      {
+        diff += ( jsh0[ mu ][ d ].GetVnlMatrix() - jsh1[ mu ][ d ].GetVnlMatrix() ).frobenius_norm();
+      }
+      if ( diff > 1e-10 )
+      {
+        std::cerr << "ERROR: composition with the identity returns a different "
+          << "Jacobian of the spatial Jacobian or Hessian for point "
+          << points[ i ] << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  /** The workspace variants should give the same result as the others. */
+  for ( unsigned long i = 0; i < 100; ++i )
+  {
+    bsplineBSpline->GetJacobianOfSpatialHessian( points[ i ], jsh0, nzji0 );
+    bsplineBSpline->GetJacobianOfSpatialHessian( points[ i ], jsh1, nzji1, workspace );
+    for ( unsigned int mu = 0; mu < jsh0.size(); ++mu )
+    {
+      for ( unsigned int d = 0; d < Dimension; ++d )
+      {
+        if ( ( jsh0[ mu ][ d ].GetVnlMatrix() - jsh1[ mu ][ d ].GetVnlMatrix() ).frobenius_norm() > 1e-10 )
+        {
+          std::cerr << "ERROR: GetJacobianOfSpatialHessian() with a workspace "
+            << "returns a different result for point " << points[ i ] << std::endl;
+          return 1;
+        }
+      }
+    }
+  }
+
+  /** Count the heap allocations in the loops over the points. */
+  const AdvancedTransformType * transforms[ 4 ] = {
+    bsplineTransform, identityBSpline, affineBSpline, bsplineBSpline };
+  const char * names[ 4 ] = {
+    "B-spline", "identity o B-spline", "affine o B-spline", "B-spline o B-spline" };
+  const bool withoutWorkspace[ 4 ] = { true, true, true, false };
+  for ( unsigned int t = 0; t < 4; ++t )
+  {
+    const unsigned long count = CountAllocationsInJacobianLoop(
+      transforms[ t ], points, withoutWorkspace[ t ] );
+    std::cerr << "Allocations in the Jacobian loop of the "
+      << names[ t ] << " transform: " << count << std::endl;
+    if ( count != 0 )
+    {
+      std::cerr << "ERROR: the Jacobian functions of the " << names[ t ]
+        << " transform allocate memory in the loop over the points." << std::endl;
+      return 1;
+    }
+  }
+
+  /** For the metric, the number of allocations per call should not
+   * depend on the number of samples.
+   */
+  for ( unsigned int threads = 1; threads <= 2; ++threads )
+  {
+    const unsigned long countSmall = CountAllocationsInMetric( 16, threads );
+    const unsigned long countLarge = CountAllocationsInMetric( 32, threads );
+    std::cerr << "Allocations in GetValueAndDerivative() with " << threads
+      << " thread(s): " << countSmall << " (16^3 samples), "
+      << countLarge << " (32^3 samples)" << std::endl;
+    if ( countSmall != countLarge )
+    {
+      std::cerr << "ERROR: the number of allocations in the metric depends "
+        << "on the number of samples." << std::endl;
+      return 1;
+    }
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
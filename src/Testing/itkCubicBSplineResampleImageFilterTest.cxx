@@ -0,0 +1,224 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "itkCubicBSplineResampleImageFilter.h"
+#include "itkResampleImageFilter.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "elxTimer.h"
+#include "vnl/vnl_math.h"
+#include "vnl/vnl_random.h"
+
+#include <cstdlib>
+#include <iomanip>
+
+//-------------------------------------------------------------------------------------
+
+// Compare the CubicBSplineResampleImageFilter, the CPU implementation of the
+// CUDA resampler, with the ResampleImageFilter, for a B-spline transform
+// and third order B-spline interpolation. Away from the image border both
+// should give the same image, up to single precision rounding errors.
+// The image size (the number of voxels along each dimension) can be given
+// on the command line; the default is 128 in Release mode.
+int main( int argc, char *argv[] )
+{
+  /** Some basic type definitions. */
+  const unsigned int Dimension = 3;
+  const unsigned int SplineOrder = 3;
+  typedef double CoordinateRepresentationType;
+  typedef itk::Image< float, Dimension >                    ImageType;
+  typedef itk::CubicBSplineResampleImageFilter<
+    ImageType, ImageType, CoordinateRepresentationType >    CubicResamplerType;
+  typedef itk::ResampleImageFilter<
+    ImageType, ImageType, CoordinateRepresentationType >    ResamplerType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    CoordinateRepresentationType, Dimension, SplineOrder >  BSplineTransformType;
+  typedef itk::AdvancedCombinationTransform<
+    CoordinateRepresentationType, Dimension >               CombinationTransformType;
+  typedef itk::BSplineInterpolateImageFunction<
+    ImageType, CoordinateRepresentationType, double >       InterpolatorType;
+  typedef BSplineTransformType::ParametersType              ParametersType;
+  typedef ImageType::RegionType                             RegionType;
+  typedef ImageType::SizeType                               SizeType;
+  typedef ImageType::IndexType                              IndexType;
+  typedef ImageType::SpacingType                            SpacingType;
+  typedef ImageType::PointType                              OriginType;
+  typedef ImageType::DirectionType                          DirectionType;
+  typedef itk::ImageRegionIteratorWithIndex< ImageType >    IteratorType;
+
+  /** The image size. Distinguish between Debug and Release mode. */
+#ifndef NDEBUG
+  unsigned long imageSize = 32;
+#else
+  unsigned long imageSize = 128;
+#endif
+  if ( argc > 1 )
+  {
+    imageSize = static_cast<unsigned long>( atol( argv[ 1 ] ) );
+  }
+  std::cerr << "Image size: " << imageSize << "^" << Dimension << std::endl;
+
+  /** Create a moving image with a smooth pattern, and a non-trivial geometry. */
+  SizeType size;
+  size.Fill( imageSize );
+  IndexType index;
+  index.Fill( 0 );
+  RegionType region( index, size );
+  SpacingType spacing;
+  spacing[ 0 ] = 1.0; spacing[ 1 ] = 1.5; spacing[ 2 ] = 2.0;
+  OriginType origin;
+  origin[ 0 ] = -10.0; origin[ 1 ] = 5.0; origin[ 2 ] = 20.0;
+  DirectionType direction;
+  direction.SetIdentity();
+
+  ImageType::Pointer movingImage = ImageType::New();
+  movingImage->SetRegions( region );
+  movingImage->SetSpacing( spacing );
+  movingImage->SetOrigin( origin );
+  movingImage->SetDirection( direction );
+  movingImage->Allocate();
+  IteratorType it( movingImage, region );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const IndexType & voxel = it.GetIndex();
+    it.Set( static_cast<float>( 100.0 * vcl_sin( voxel[ 0 ] / 7.0 )
+      + 100.0 * vcl_cos( voxel[ 1 ] / 5.0 ) + voxel[ 2 ] ) );
+  }
+
+  /** Create a B-spline transform with a grid spacing of 8 voxels that covers
+   * the image with two extra grid cells, and with random displacements of
+   * at most 2 mm.
+   */
+  vnl_random randomGenerator( 12345 );
+  const double gridSpacingInVoxels = 8.0;
+  BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+  SizeType gridSize;
+  SpacingType gridSpacing;
+  OriginType gridOrigin;
+  for ( unsigned int d = 0; d < Dimension; ++d )
+  {
+    gridSpacing[ d ] = gridSpacingInVoxels * spacing[ d ];
+    gridSize[ d ] = static_cast<unsigned long>(
+      vcl_ceil( imageSize / gridSpacingInVoxels ) ) + SplineOrder + 2;
+    gridOrigin[ d ] = origin[ d ] - 2.0 * gridSpacing[ d ];
+  }
+  bsplineTransform->SetGridOrigin( gridOrigin );
+  bsplineTransform->SetGridSpacing( gridSpacing );
+  bsplineTransform->SetGridRegion( RegionType( index, gridSize ) );
+  bsplineTransform->SetGridDirection( direction );
+
+  ParametersType parameters( bsplineTransform->GetNumberOfParameters() );
+  for ( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = randomGenerator.drand64( -2.0, 2.0 );
+  }
+  bsplineTransform->SetParameters( parameters );
+
+  /** As in elastix, the B-spline transform is the current transform
+   * of a combination transform.
+   */
+  CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( bsplineTransform );
+
+  /** Set up the resamplers. */
+  InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  interpolator->SetSplineOrder( SplineOrder );
+
+  CubicResamplerType::Pointer cubicResampler = CubicResamplerType::New();
+  cubicResampler->SetInput( movingImage );
+  cubicResampler->SetTransform( transform );
+  cubicResampler->SetInterpolator( interpolator );
+  cubicResampler->SetSize( size );
+  cubicResampler->SetOutputSpacing( spacing );
+  cubicResampler->SetOutputOrigin( origin );
+  cubicResampler->SetOutputDirection( direction );
+  cubicResampler->SetDefaultPixelValue( 0 );
+
+  ResamplerType::Pointer resampler = ResamplerType::New();
+  resampler->SetInput( movingImage );
+  resampler->SetTransform( transform );
+  resampler->SetInterpolator( interpolator );
+  resampler->SetSize( size );
+  resampler->SetOutputSpacing( spacing );
+  resampler->SetOutputOrigin( origin );
+  resampler->SetOutputDirection( direction );
+  resampler->SetDefaultPixelValue( 0 );
+
+  /** Run both resamplers. */
+  tmr::Timer::Pointer timer = tmr::Timer::New();
+  double seconds[ 2 ];
+  try
+  {
+    timer->StartTimer();
+    resampler->Update();
+    timer->StopTimer();
+    seconds[ 0 ] = timer->GetElapsedClockSec();
+
+    timer->StartTimer();
+    cubicResampler->Update();
+    timer->StopTimer();
+    seconds[ 1 ] = timer->GetElapsedClockSec();
+  }
+  catch ( itk::ExceptionObject & err )
+  {
+    std::cerr << err << std::endl;
+    return 1;
+  }
+  std::cerr << std::fixed << std::setprecision( 3 )
+    << "  ResampleImageFilter:             " << seconds[ 0 ] << " s" << std::endl
+    << "  CubicBSplineResampleImageFilter: " << seconds[ 1 ] << " s" << std::endl;
+
+  if ( !cubicResampler->GetConfigurationIsValid() )
+  {
+    std::cerr << "ERROR: the configuration was not recognized as valid."
+      << cubicResampler->GetWarningReport().GetWarningReportAsString() << std::endl;
+    return 1;
+  }
+
+  /** Compare the voxels at least 4 voxels away from the border, whose
+   * interpolation support is inside the moving image.
+   */
+  const long border = 4;
+  double maximumDifference = 0.0;
+  IteratorType cit( cubicResampler->GetOutput(), region );
+  for ( cit.GoToBegin(); !cit.IsAtEnd(); ++cit )
+  {
+    const IndexType & voxel = cit.GetIndex();
+    bool isInside = true;
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      isInside &= voxel[ d ] >= border
+        && voxel[ d ] < static_cast<long>( imageSize ) - border;
+    }
+    if ( isInside )
+    {
+      maximumDifference = vnl_math_max( maximumDifference, static_cast<double>(
+        vnl_math_abs( cit.Get() - resampler->GetOutput()->GetPixel( voxel ) ) ) );
+    }
+  }
+  std::cerr << "  Maximum difference: " << maximumDifference << std::endl;
+
+  /** The intensities are in the range [-200, 200+imageSize]. */
+  if ( maximumDifference > 1e-2 )
+  {
+    std::cerr << "ERROR: the CubicBSplineResampleImageFilter differs from "
+      << "the ResampleImageFilter." << std::endl;
+    return 1;
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
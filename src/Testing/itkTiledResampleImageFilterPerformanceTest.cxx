@@ -0,0 +1,226 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "itkTiledResampleImageFilter.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+#include "elxTimer.h"
+#include "vnl/vnl_math.h"
+#include "vnl/vnl_random.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+/** Helper function to print the throughput of a resampling run. */
+void PrintThroughput( const std::string & name,
+  const double numberOfVoxels, const double seconds )
+{
+  std::cerr << std::setw( 40 ) << std::left << name;
+  if ( seconds > 0.0 )
+  {
+    std::cerr << std::setw( 14 ) << std::right << std::fixed << std::setprecision( 0 )
+      << numberOfVoxels / seconds << " voxels/s" << std::endl;
+  }
+  else
+  {
+    std::cerr << "  too fast to measure" << std::endl;
+  }
+
+} // end PrintThroughput()
+
+//-------------------------------------------------------------------------------------
+
+// Compare the throughput of the TiledResampleImageFilter, with and without
+// tiles, for a B-spline transform with a grid spacing of 16 voxels and
+// linear interpolation. The image sizes (the number of voxels along each
+// dimension) can be given on the command line; the default is 256 and 512
+// in Release mode. CTest runs it for a small image only.
+int main( int argc, char *argv[] )
+{
+  /** Some basic type definitions. */
+  const unsigned int Dimension = 3;
+  const unsigned int SplineOrder = 3;
+  typedef double CoordinateRepresentationType;
+  typedef itk::Image< float, Dimension >                    ImageType;
+  typedef itk::TiledResampleImageFilter<
+    ImageType, ImageType, CoordinateRepresentationType >    ResamplerType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    CoordinateRepresentationType, Dimension, SplineOrder >  BSplineTransformType;
+  typedef itk::AdvancedCombinationTransform<
+    CoordinateRepresentationType, Dimension >               CombinationTransformType;
+  typedef itk::LinearInterpolateImageFunction<
+    ImageType, CoordinateRepresentationType >               InterpolatorType;
+  typedef BSplineTransformType::ParametersType              ParametersType;
+  typedef ImageType::RegionType                             RegionType;
+  typedef ImageType::SizeType                               SizeType;
+  typedef ImageType::IndexType                              IndexType;
+  typedef ImageType::SpacingType                            SpacingType;
+  typedef ImageType::PointType                              OriginType;
+  typedef ImageType::DirectionType                          DirectionType;
+  typedef itk::ImageRegionIteratorWithIndex< ImageType >    IteratorType;
+  typedef itk::ImageRegionConstIterator< ImageType >        ConstIteratorType;
+
+  /** The image sizes. Distinguish between Debug and Release mode. */
+  std::vector< unsigned long > imageSizes;
+  for ( int i = 1; i < argc; ++i )
+  {
+    imageSizes.push_back( static_cast<unsigned long>( atol( argv[ i ] ) ) );
+  }
+  if ( imageSizes.empty() )
+  {
+#ifndef NDEBUG
+    imageSizes.push_back( 32 );
+#else
+    imageSizes.push_back( 256 );
+    imageSizes.push_back( 512 );
+#endif
+  }
+
+  const double gridSpacingInVoxels = 16.0;
+  vnl_random randomGenerator( 12345 );
+
+  for ( unsigned int s = 0; s < imageSizes.size(); ++s )
+  {
+    const unsigned long imageSize = imageSizes[ s ];
+    std::cerr << "Image size: " << imageSize << "^" << Dimension << std::endl;
+
+    /** Create a moving image with a smooth pattern. */
+    SizeType size;
+    size.Fill( imageSize );
+    IndexType index;
+    index.Fill( 0 );
+    RegionType region( index, size );
+    SpacingType spacing;
+    spacing.Fill( 1.0 );
+    OriginType origin;
+    origin.Fill( 0.0 );
+    DirectionType direction;
+    direction.SetIdentity();
+
+    ImageType::Pointer movingImage = ImageType::New();
+    movingImage->SetRegions( region );
+    movingImage->SetSpacing( spacing );
+    movingImage->SetOrigin( origin );
+    movingImage->SetDirection( direction );
+    movingImage->Allocate();
+    IteratorType it( movingImage, region );
+    for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+      const IndexType & voxel = it.GetIndex();
+      it.Set( static_cast<float>( 100.0 * vcl_sin( voxel[ 0 ] / 7.0 )
+        + 100.0 * vcl_cos( voxel[ 1 ] / 5.0 ) + voxel[ 2 ] ) );
+    }
+
+    /** Create a B-spline transform that covers the image, with random
+     * displacements of at most 2 voxels.
+     */
+    BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+    SizeType gridSize;
+    SpacingType gridSpacing;
+    OriginType gridOrigin;
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      gridSpacing[ d ] = gridSpacingInVoxels * spacing[ d ];
+      gridSize[ d ] = static_cast<unsigned long>(
+        vcl_ceil( imageSize / gridSpacingInVoxels ) ) + SplineOrder;
+      gridOrigin[ d ] = origin[ d ] - gridSpacing[ d ];
+    }
+    bsplineTransform->SetGridOrigin( gridOrigin );
+    bsplineTransform->SetGridSpacing( gridSpacing );
+    bsplineTransform->SetGridRegion( RegionType( index, gridSize ) );
+    bsplineTransform->SetGridDirection( direction );
+
+    ParametersType parameters( bsplineTransform->GetNumberOfParameters() );
+    for ( unsigned int i = 0; i < parameters.GetSize(); ++i )
+    {
+      parameters[ i ] = randomGenerator.drand64( -2.0, 2.0 );
+    }
+    bsplineTransform->SetParameters( parameters );
+
+    /** As in elastix, the B-spline transform is the current transform
+     * of a combination transform.
+     */
+    CombinationTransformType::Pointer transform = CombinationTransformType::New();
+    transform->SetCurrentTransform( bsplineTransform );
+
+    /** Set up the resampler. */
+    InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    ResamplerType::Pointer resampler = ResamplerType::New();
+    resampler->SetInput( movingImage );
+    resampler->SetTransform( transform );
+    resampler->SetInterpolator( interpolator );
+    resampler->SetSize( size );
+    resampler->SetOutputSpacing( spacing );
+    resampler->SetOutputOrigin( origin );
+    resampler->SetOutputDirection( direction );
+    resampler->SetDefaultPixelValue( 0 );
+
+    /** Resample in raster order and in tiles. The raster result is kept
+     * for the comparison.
+     */
+    const double numberOfVoxels = static_cast<double>( region.GetNumberOfPixels() );
+    ImageType::Pointer rasterImage;
+    for ( unsigned int useTiles = 0; useTiles < 2; ++useTiles )
+    {
+      resampler->SetUseTiles( useTiles == 1 );
+      tmr::Timer::Pointer timer = tmr::Timer::New();
+      timer->StartTimer();
+      try
+      {
+        resampler->Update();
+      }
+      catch ( itk::ExceptionObject & err )
+      {
+        std::cerr << err << std::endl;
+        return 1;
+      }
+      timer->StopTimer();
+      PrintThroughput( useTiles == 1 ? "  Tiled resampling:" : "  Raster resampling:",
+        numberOfVoxels, timer->GetElapsedClockSec() );
+
+      if ( useTiles == 0 )
+      {
+        rasterImage = resampler->GetOutput();
+        rasterImage->DisconnectPipeline();
+      }
+    }
+    std::cerr << "  Tile size: " << resampler->GetComputedTileSize() << std::endl;
+
+    /** Both should give the same image, up to rounding errors. */
+    double maximumDifference = 0.0;
+    ConstIteratorType rit( rasterImage, region );
+    ConstIteratorType tit( resampler->GetOutput(), region );
+    for ( rit.GoToBegin(), tit.GoToBegin(); !rit.IsAtEnd(); ++rit, ++tit )
+    {
+      maximumDifference = vnl_math_max( maximumDifference,
+        static_cast<double>( vcl_abs( tit.Get() - rit.Get() ) ) );
+    }
+    std::cerr << "  Maximum difference: " << maximumDifference << std::endl;
+    if ( maximumDifference > 1e-3 )
+    {
+      std::cerr << "ERROR: the tiled resampling differs from the raster "
+        << "resampling by at most " << maximumDifference << "." << std::endl;
+      return 1;
+    }
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
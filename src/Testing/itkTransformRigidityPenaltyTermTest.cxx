@@ -0,0 +1,375 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "RigidityPenalty/itkTransformRigidityPenaltyTerm.h"
+#include "itkTransformRigidityPenaltyTermReference.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "vnl/vnl_math.h"
+#include "vnl/vnl_random.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/** This test compares the value and derivative of the rigidity penalty term,
+ * which are computed in a single pass over the control point grid, with those
+ * of the filter based reference implementation. This is done for small 2D and
+ * 3D grids with an anisotropic grid spacing, on one and on several threads.
+ */
+
+//-------------------------------------------------------------------------------------
+
+/** Compare two numbers, relative to the magnitude of the reference. */
+bool IsClose( const double value, const double referenceValue, const double scale )
+{
+  const double tolerance = 1e-9 * std::max( 1.0, vnl_math_abs( scale ) );
+  return vnl_math_abs( value - referenceValue ) <= tolerance;
+
+} // end IsClose()
+
+//-------------------------------------------------------------------------------------
+
+/** Fill an image with rigidity coefficients in [0, 1]. The fixed pattern varies
+ * smoothly, the moving pattern is a block of rigid tissue.
+ */
+template< class TRigidityImage >
+void FillRigidityImage( TRigidityImage * image, const bool smooth )
+{
+  typedef itk::ImageRegionIteratorWithIndex< TRigidityImage > IteratorType;
+  const unsigned int dimension = TRigidityImage::ImageDimension;
+
+  IteratorType it( image, image->GetLargestPossibleRegion() );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const typename TRigidityImage::IndexType index = it.GetIndex();
+    double value = 0.0;
+    if ( smooth )
+    {
+      double argument = 0.0;
+      for ( unsigned int d = 0; d < dimension; ++d )
+      {
+        argument += ( 0.3 - 0.1 * d ) * index[ d ];
+      }
+      value = 0.5 + 0.5 * vcl_sin( argument );
+    }
+    else
+    {
+      value = 1.0;
+      for ( unsigned int d = 0; d < dimension; ++d )
+      {
+        if ( index[ d ] < 8 || index[ d ] >= 16 )
+        {
+          value = 0.2;
+        }
+      }
+    }
+    it.Set( value );
+  }
+
+} // end FillRigidityImage()
+
+//-------------------------------------------------------------------------------------
+
+/** Set up a rigidity penalty term. Both implementations have the same interface. */
+template< class TRigidityPenaltyTerm >
+void SetUpRigidityPenaltyTerm(
+  TRigidityPenaltyTerm * term,
+  const typename TRigidityPenaltyTerm::FixedImageType * image,
+  typename TRigidityPenaltyTerm::RigidityImageType * fixedRigidityImage,
+  typename TRigidityPenaltyTerm::RigidityImageType * movingRigidityImage,
+  typename TRigidityPenaltyTerm::InterpolatorType * interpolator,
+  typename TRigidityPenaltyTerm::BSplineTransformType * transform,
+  const bool useAllConditions,
+  const unsigned int numberOfThreads )
+{
+  term->SetFixedImage( image );
+  term->SetMovingImage( image );
+  term->SetFixedImageRegion( image->GetLargestPossibleRegion() );
+  term->SetInterpolator( interpolator );
+  term->SetTransform( transform );
+  term->SetComputeGradient( false );
+
+  term->SetLinearityConditionWeight( 1.0 );
+  term->SetOrthonormalityConditionWeight( 2.0 );
+  term->SetPropernessConditionWeight( 0.5 );
+  term->SetFixedRigidityImage( fixedRigidityImage );
+  term->SetUseFixedRigidityImage( true );
+
+  if ( useAllConditions )
+  {
+    /** All conditions, and both rigidity images, dilated. */
+    term->SetMovingRigidityImage( movingRigidityImage );
+    term->SetUseMovingRigidityImage( true );
+    term->SetDilateRigidityImages( true );
+    term->SetDilationRadiusMultiplier( 1.0 );
+  }
+  else
+  {
+    /** Leave out the properness condition completely, and calculate the
+     * orthonormality condition without using it.
+     */
+    term->SetUseMovingRigidityImage( false );
+    term->SetDilateRigidityImages( false );
+    term->SetUseOrthonormalityCondition( false );
+    term->SetUsePropernessCondition( false );
+    term->SetCalculatePropernessCondition( false );
+  }
+
+  term->SetUseMultiThread( numberOfThreads > 1 );
+  term->SetNumberOfThreads( numberOfThreads );
+  term->Initialize();
+
+} // end SetUpRigidityPenaltyTerm()
+
+//-------------------------------------------------------------------------------------
+
+/** Compare both implementations for a given dimension and number of threads.
+ * Returns the number of failures.
+ */
+template< unsigned int Dimension >
+unsigned int TestRigidityPenaltyTerm(
+  const unsigned int numberOfThreads, const bool useAllConditions )
+{
+  typedef itk::Image< float, Dimension >                  ImageType;
+  typedef itk::TransformRigidityPenaltyTerm<
+    ImageType, double >                                   RigidityPenaltyTermType;
+  typedef itk::TransformRigidityPenaltyTermReference<
+    ImageType, double >                                   ReferenceTermType;
+  typedef typename RigidityPenaltyTermType
+    ::BSplineTransformType                                BSplineTransformType;
+  typedef typename RigidityPenaltyTermType::RigidityImageType RigidityImageType;
+  typedef typename RigidityPenaltyTermType::ParametersType    ParametersType;
+  typedef typename RigidityPenaltyTermType::DerivativeType    DerivativeType;
+  typedef typename RigidityPenaltyTermType::MeasureType       MeasureType;
+  typedef itk::LinearInterpolateImageFunction<
+    ImageType, double >                                   InterpolatorType;
+
+  /** Create the images, all on the domain [0, 23]^D. */
+  typename ImageType::RegionType imageRegion;
+  typename ImageType::SizeType imageSize;
+  imageSize.Fill( 24 );
+  imageRegion.SetSize( imageSize );
+
+  typename ImageType::Pointer image = ImageType::New();
+  image->SetRegions( imageRegion );
+  image->Allocate();
+  image->FillBuffer( 0.0f );
+
+  typename RigidityImageType::Pointer fixedRigidityImage = RigidityImageType::New();
+  fixedRigidityImage->SetRegions( imageRegion );
+  fixedRigidityImage->Allocate();
+  FillRigidityImage( fixedRigidityImage.GetPointer(), true );
+
+  typename RigidityImageType::Pointer movingRigidityImage = RigidityImageType::New();
+  movingRigidityImage->SetRegions( imageRegion );
+  movingRigidityImage->Allocate();
+  FillRigidityImage( movingRigidityImage.GetPointer(), false );
+
+  typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+
+  /** Create a B-spline transform with a different grid spacing per dimension. */
+  typename BSplineTransformType::Pointer transform = BSplineTransformType::New();
+  typename BSplineTransformType::RegionType gridRegion;
+  typename BSplineTransformType::SizeType gridSize;
+  typename BSplineTransformType::SpacingType gridSpacing;
+  typename BSplineTransformType::OriginType gridOrigin;
+  for ( unsigned int d = 0; d < Dimension; ++d )
+  {
+    gridSpacing[ d ] = 4.0 + d;
+    gridOrigin[ d ] = -gridSpacing[ d ];
+    gridSize[ d ] = static_cast<unsigned long>(
+      vcl_ceil( 23.0 / gridSpacing[ d ] ) ) + 3;
+  }
+  gridRegion.SetSize( gridSize );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+
+  /** Random parameters, that outlive the transform. */
+  vnl_random randomGenerator( 12345 );
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for ( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = randomGenerator.drand64( -1.0, 1.0 );
+  }
+  transform->SetParameters( parameters );
+
+  /** Set up both implementations. */
+  typename RigidityPenaltyTermType::Pointer term = RigidityPenaltyTermType::New();
+  typename ReferenceTermType::Pointer reference = ReferenceTermType::New();
+  try
+  {
+    SetUpRigidityPenaltyTerm( term.GetPointer(), image.GetPointer(),
+      fixedRigidityImage.GetPointer(), movingRigidityImage.GetPointer(),
+      interpolator.GetPointer(), transform.GetPointer(),
+      useAllConditions, numberOfThreads );
+    SetUpRigidityPenaltyTerm( reference.GetPointer(), image.GetPointer(),
+      fixedRigidityImage.GetPointer(), movingRigidityImage.GetPointer(),
+      interpolator.GetPointer(), transform.GetPointer(),
+      useAllConditions, 1 );
+  }
+  catch ( itk::ExceptionObject & excp )
+  {
+    std::cerr << excp << std::endl;
+    return 1;
+  }
+
+  std::ostringstream description;
+  description << Dimension << "D, " << numberOfThreads << " thread(s), "
+    << ( useAllConditions ? "all conditions" : "no properness condition" );
+
+  /** Evaluate twice, with different parameters, so that the work buffers
+   * are reused and the moving rigidity coefficients are recomputed.
+   */
+  unsigned int numberOfFailures = 0;
+  for ( unsigned int iteration = 0; iteration < 2; ++iteration )
+  {
+    MeasureType value = 0.0;
+    MeasureType referenceValue = 0.0;
+    DerivativeType derivative;
+    DerivativeType referenceDerivative;
+    try
+    {
+      reference->GetValueAndDerivative( parameters, referenceValue, referenceDerivative );
+      term->GetValueAndDerivative( parameters, value, derivative );
+    }
+    catch ( itk::ExceptionObject & excp )
+    {
+      std::cerr << excp << std::endl;
+      return numberOfFailures + 1;
+    }
+
+    /** Compare the values. */
+    if ( !IsClose( value, referenceValue, referenceValue ) )
+    {
+      std::cerr << "ERROR (" << description.str() << "): value " << value
+        << " differs from the reference value " << referenceValue << std::endl;
+      ++numberOfFailures;
+    }
+
+    /** Compare the values and gradient magnitudes of the conditions. */
+    const double conditions[ 6 ] = {
+      term->GetLinearityConditionValue(),
+      term->GetOrthonormalityConditionValue(),
+      term->GetPropernessConditionValue(),
+      term->GetLinearityConditionGradientMagnitude(),
+      term->GetOrthonormalityConditionGradientMagnitude(),
+      term->GetPropernessConditionGradientMagnitude() };
+    const double referenceConditions[ 6 ] = {
+      reference->GetLinearityConditionValue(),
+      reference->GetOrthonormalityConditionValue(),
+      reference->GetPropernessConditionValue(),
+      reference->GetLinearityConditionGradientMagnitude(),
+      reference->GetOrthonormalityConditionGradientMagnitude(),
+      reference->GetPropernessConditionGradientMagnitude() };
+    for ( unsigned int i = 0; i < 6; ++i )
+    {
+      if ( !IsClose( conditions[ i ], referenceConditions[ i ], referenceConditions[ i ] ) )
+      {
+        std::cerr << "ERROR (" << description.str() << "): condition value or "
+          << "gradient magnitude " << i << " is " << conditions[ i ]
+          << ", but the reference is " << referenceConditions[ i ] << std::endl;
+        ++numberOfFailures;
+      }
+    }
+
+    /** Compare the derivatives, relative to the largest reference element. */
+    if ( derivative.GetSize() != referenceDerivative.GetSize() )
+    {
+      std::cerr << "ERROR (" << description.str() << "): the derivative has "
+        << derivative.GetSize() << " elements, but the reference has "
+        << referenceDerivative.GetSize() << std::endl;
+      return numberOfFailures + 1;
+    }
+    const double derivativeScale = referenceDerivative.inf_norm();
+    for ( unsigned int i = 0; i < derivative.GetSize(); ++i )
+    {
+      if ( !IsClose( derivative[ i ], referenceDerivative[ i ], derivativeScale ) )
+      {
+        std::cerr << "ERROR (" << description.str() << "): derivative[" << i
+          << "] is " << derivative[ i ] << ", but the reference is "
+          << referenceDerivative[ i ] << std::endl;
+        ++numberOfFailures;
+        break;
+      }
+    }
+
+    /** GetValue() and GetDerivative() should give the same results. */
+    const MeasureType valueOnly = term->GetValue( parameters );
+    DerivativeType derivativeOnly;
+    term->GetDerivative( parameters, derivativeOnly );
+    if ( !IsClose( valueOnly, referenceValue, referenceValue ) )
+    {
+      std::cerr << "ERROR (" << description.str() << "): GetValue() returns "
+        << valueOnly << ", but the reference value is " << referenceValue << std::endl;
+      ++numberOfFailures;
+    }
+    for ( unsigned int i = 0; i < derivativeOnly.GetSize(); ++i )
+    {
+      if ( !IsClose( derivativeOnly[ i ], referenceDerivative[ i ], derivativeScale ) )
+      {
+        std::cerr << "ERROR (" << description.str() << "): GetDerivative() returns "
+          << derivativeOnly[ i ] << " for element " << i << ", but the reference is "
+          << referenceDerivative[ i ] << std::endl;
+        ++numberOfFailures;
+        break;
+      }
+    }
+
+    /** Change the parameters in place, since the transform refers to them. */
+    for ( unsigned int i = 0; i < parameters.GetSize(); ++i )
+    {
+      parameters[ i ] *= -0.5;
+    }
+  }
+
+  return numberOfFailures;
+
+} // end TestRigidityPenaltyTerm()
+
+//-------------------------------------------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+  /** The number of threads is larger than the number of grid planes in some
+   * cases, to check that idle threads do not contribute.
+   */
+  const unsigned int numberOfThreadsToTest[ 3 ] = { 1, 3, 16 };
+
+  unsigned int numberOfFailures = 0;
+  for ( unsigned int t = 0; t < 3; ++t )
+  {
+    for ( unsigned int c = 0; c < 2; ++c )
+    {
+      const bool useAllConditions = ( c == 0 );
+      numberOfFailures += TestRigidityPenaltyTerm< 2 >(
+        numberOfThreadsToTest[ t ], useAllConditions );
+      numberOfFailures += TestRigidityPenaltyTerm< 3 >(
+        numberOfThreadsToTest[ t ], useAllConditions );
+    }
+  }
+
+  if ( numberOfFailures > 0 )
+  {
+    std::cerr << "The rigidity penalty term differs from the reference in "
+      << numberOfFailures << " cases." << std::endl;
+    return 1;
+  }
+
+  std::cerr << "The rigidity penalty term equals the reference." << std::endl;
+  return 0;
+
+} // end main()